@@ -163,12 +163,22 @@ std::string ATHObject::GetPropertyAsString(char* _szName)
 	return strReturn;;
 }
 //================================================================================
-void ATHObject::OnCollisionEnter(b2Contact* _pContact)
+void ATHObject::OnCollisionEnter(b2Fixture* _pFixtureA, b2Fixture* _pFixtureB)
 {
 	
 }
 //================================================================================
-void ATHObject::OnCollisionExit(b2Contact* _pContact)
+void ATHObject::OnCollisionExit(b2Fixture* _pFixtureA, b2Fixture* _pFixtureB)
+{
+	
+}
+//================================================================================
+void ATHObject::OnSensorEnter(b2Fixture* _pSensor, b2Fixture* _pVisitor)
+{
+	
+}
+//================================================================================
+void ATHObject::OnSensorExit(b2Fixture* _pSensor, b2Fixture* _pVisitor)
 {
 	
 }
@@ -12,6 +12,7 @@ static const unsigned int ATHOBJECT_MAX_NAME_LENGTH = 64;
 
 class b2Body;
 class b2Contact;
+class b2Fixture;
 class ATHRenderNode;
 
 class ATHObject : public ATHEventListener
@@ -68,8 +69,14 @@ public:
 	float GetPropertyAsFloat(char* _szName);
 	std::string GetPropertyAsString(char* _szName);
 
-	virtual void OnCollisionEnter(b2Contact* _pContact);
-	virtual void OnCollisionExit(b2Contact* _pContact);
+	// Collision and sensor callbacks run on the main thread once every partition
+	// has finished stepping, in partition order. The fixtures are in contact
+	// order, A then B, for both objects. Don't destroy bodies from here, the
+	// events still queued may refer to them; let the object die instead.
+	virtual void OnCollisionEnter(b2Fixture* _pFixtureA, b2Fixture* _pFixtureB);
+	virtual void OnCollisionExit(b2Fixture* _pFixtureA, b2Fixture* _pFixtureB);
+	virtual void OnSensorEnter(b2Fixture* _pSensor, b2Fixture* _pVisitor);
+	virtual void OnSensorExit(b2Fixture* _pSensor, b2Fixture* _pVisitor);
 
 	friend class ATHObjectManager;
 };
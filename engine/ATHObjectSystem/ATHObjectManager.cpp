@@ -2,9 +2,11 @@
 
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 
 #include "../ATHRenderer/ATHRenderer.h"
 #include "../Box2D/Box2D.h"
+#include "../Box2D/Common/b2Parallel.h"
 #include "../ATHUtil/FileUtil.h"
 #include "ATHObject.h"
 
@@ -18,6 +20,80 @@ const float			TIMESTEP_LENGTH = (1.0f/30.0f);
 const float			MAX_TIMEBUFFER = 0.5f;
 const char			DEFAULT_XML_LOAD_PATH[] = "data\\base.xml";
 const float GLOBAL_LOAD_SCALE = 1.0f;
+const float			LOD_ACTIVE_RADIUS = 100.0f;
+const float			LOD_REDUCED_RADIUS = 250.0f;
+const int			LOD_REDUCED_INTERVAL = 4;
+const float			PARTITION_MIGRATION_MARGIN = 5.0f;
+
+// Steps every partition on the Box2D workers. Nothing here may call into the
+// objects, their callbacks are queued and run on the main thread afterwards.
+class ATHStepPartitionsTask : public b2ParallelTask
+{
+public:
+
+	ATHPhysicsPartition*	m_pPartitions;
+	unsigned int			m_unNumSteps;
+
+	void Execute(int32 _nIndex, int32 _nWorker)
+	{
+		ATHPhysicsPartition& partition = m_pPartitions[_nIndex];
+		for (unsigned int i = 0; i < m_unNumSteps; ++i)
+		{
+			partition.m_pWorld->Step( TIMESTEP_LENGTH, NUM_VELOCITY_ITERATIONS, NUM_POSITION_ITERATIONS );
+
+			// The sensor events only last until the next step
+			partition.m_pEvents->PushSensorEvents(partition.m_pWorld);
+		}
+	}
+};
+//================================================================================
+void ATHPhysicsEventQueue::Push(ATHPhysicsEventType _eType, b2Fixture* _pFixtureA, b2Fixture* _pFixtureB)
+{
+	ATHPhysicsEvent event;
+	event.m_eType = _eType;
+	event.m_pFixtureA = _pFixtureA;
+	event.m_pFixtureB = _pFixtureB;
+	m_vecEvents.push_back(event);
+}
+//================================================================================
+void ATHPhysicsEventQueue::PushSensorEvents(b2World* _pWorld)
+{
+	const b2SensorEvent* pBeginEvents = _pWorld->GetSensorBeginEvents();
+	for (int32 i = 0; i < _pWorld->GetSensorBeginEventCount(); ++i)
+		Push(APE_SENSOR_ENTER, pBeginEvents[i].sensorFixture, pBeginEvents[i].visitorFixture);
+
+	const b2SensorEvent* pEndEvents = _pWorld->GetSensorEndEvents();
+	for (int32 i = 0; i < _pWorld->GetSensorEndEventCount(); ++i)
+		Push(APE_SENSOR_EXIT, pEndEvents[i].sensorFixture, pEndEvents[i].visitorFixture);
+}
+//================================================================================
+void ATHPhysicsEventQueue::PushContact(ATHPhysicsEventType _eType, b2Contact* _pContact)
+{
+	if (_pContact->GetFixtureA()->GetBody()->GetWorld()->IsLocked())
+	{
+		Push(_eType, _pContact->GetFixtureA(), _pContact->GetFixtureB());
+		return;
+	}
+
+	// Not stepping, so this is the main thread destroying a body and the
+	// fixtures are about to go away
+	ATHPhysicsEvent event;
+	event.m_eType = _eType;
+	event.m_pFixtureA = _pContact->GetFixtureA();
+	event.m_pFixtureB = _pContact->GetFixtureB();
+	m_pManager->DispatchEvent(event);
+}
+//================================================================================
+void ATHPhysicsEventQueue::BeginContact(b2Contact* contact)
+{
+	PushContact(APE_COLLISION_ENTER, contact);
+}
+//================================================================================
+void ATHPhysicsEventQueue::EndContact(b2Contact* contact)
+{
+	PushContact(APE_COLLISION_EXIT, contact);
+}
+//================================================================================
 
 ATHObjectManager::ATHObjectManager() :	m_fTimeBuffer( 0.0f ),
 										m_pWorld( nullptr ),
@@ -35,9 +111,22 @@ void ATHObjectManager::Init()
 }
 //================================================================================
 void ATHObjectManager::InitBox2D()
+{
+	ATHPhysicsPartition partition;
+	CreateWorld(partition);
+	m_pWorld = partition.m_pWorld;
+	partition.m_aabbBounds.lowerBound = b2Vec2(-b2_maxFloat, -b2_maxFloat);
+	partition.m_aabbBounds.upperBound = b2Vec2(b2_maxFloat, b2_maxFloat);
+	m_vecPartitions.push_back(partition);
+
+	// https://dl.dropboxusercontent.com/u/22926149/ATHEngine/Comments/ATHObjectManager.Init.txt
+}
+//================================================================================
+void ATHObjectManager::CreateWorld(ATHPhysicsPartition& _partition)
 {
 	// Box2D Init
-	m_pWorld = new b2World(b2Vec2(0.0f, 0.0f));
+	// Static level geometry gets its own compact broad-phase tree.
+	b2World* pWorld = new b2World(b2Vec2(0.0f, 0.0f), b2_splitTreeBroadPhase);
 
 	ATHBox2DRenderer* pDebugRenderer = ATHRenderer::GetInstance()->GetDebugRenderer();
 	uint32 flags = 0;
@@ -48,11 +137,28 @@ void ATHObjectManager::InitBox2D()
 	flags += b2Draw::e_centerOfMassBit;
 
 	pDebugRenderer->SetFlags(flags);
-	m_pWorld->SetDebugDraw(pDebugRenderer);
+	pWorld->SetDebugDraw(pDebugRenderer);
 
-	m_pWorld->SetContactListener(this);
+	// Collisions reach the objects once the step is over, see DispatchEvents
+	ATHPhysicsEventQueue* pEvents = new ATHPhysicsEventQueue();
+	pEvents->m_pManager = this;
+	pWorld->SetContactListener(pEvents);
 
-	// https://dl.dropboxusercontent.com/u/22926149/ATHEngine/Comments/ATHObjectManager.Init.txt
+	// No custom contact filter, so pairs can be filtered in the broad-phase
+	pWorld->SetBroadPhaseFiltering(true);
+
+	// Sensors report overlaps through events instead of contacts
+	pWorld->SetSensorEvents(true);
+
+	// Only simulate the area around the camera at full rate
+	b2SimulationLODDef lodDef;
+	lodDef.activeRadius = LOD_ACTIVE_RADIUS;
+	lodDef.reducedRadius = LOD_REDUCED_RADIUS;
+	lodDef.reducedInterval = LOD_REDUCED_INTERVAL;
+	pWorld->SetSimulationLOD(&lodDef);
+
+	_partition.m_pWorld = pWorld;
+	_partition.m_pEvents = pEvents;
 }
 //================================================================================
 void ATHObjectManager::Update( float _fDT )
@@ -65,14 +171,34 @@ void ATHObjectManager::Update( float _fDT )
 
 	unsigned int unNumSteps = 0;
 
+	D3DXVECTOR3 vCameraPos = ATHRenderer::GetInstance()->GetCamera()->GetViewPosition();
+	b2Vec2 vFocus(vCameraPos.x, vCameraPos.y);
+	for (unsigned int i = 0; i < m_vecPartitions.size(); ++i)
+		m_vecPartitions[i].m_pWorld->SetFocusPoints(&vFocus, 1);
+
 	while( m_fTimeBuffer > TIMESTEP_LENGTH )
 	{
-		m_pWorld->Step( TIMESTEP_LENGTH, NUM_VELOCITY_ITERATIONS, NUM_POSITION_ITERATIONS );
 		m_fTimeBuffer -= TIMESTEP_LENGTH;
 		unNumSteps += 1;
 	}
 
-	m_pWorld->DrawDebugData();
+	if (unNumSteps > 0)
+	{
+		ATHStepPartitionsTask stepTask;
+		stepTask.m_pPartitions = &m_vecPartitions[0];
+		stepTask.m_unNumSteps = unNumSteps;
+		b2ParallelFor(&stepTask, (int32)m_vecPartitions.size());
+
+		// Back on the main thread, hand out the callbacks in partition order so
+		// they come in the same order every frame
+		for (unsigned int i = 0; i < m_vecPartitions.size(); ++i)
+			DispatchEvents(m_vecPartitions[i]);
+
+		MigrateObjects();
+	}
+
+	for (unsigned int i = 0; i < m_vecPartitions.size(); ++i)
+		m_vecPartitions[i].m_pWorld->DrawDebugData();
 
 	std::list<ATHObject*>::iterator itrObjects = m_liObjects.begin();
 	std::list<ATHObject*>::iterator itrObjectsEnd = m_liObjects.end();
@@ -109,7 +235,15 @@ void ATHObjectManager::Update( float _fDT )
 void ATHObjectManager::Shutdown()
 {
 	ClearObjects();
-	delete m_pWorld;
+
+	for (unsigned int i = 0; i < m_vecPartitions.size(); ++i)
+	{
+		delete m_vecPartitions[i].m_pWorld;
+		delete m_vecPartitions[i].m_pEvents;
+	}
+
+	m_vecPartitions.clear();
+	m_pWorld = nullptr;
 
 	if (m_szLibraryBuffer)
 		delete m_szLibraryBuffer;
@@ -151,6 +285,53 @@ ATHObject* ATHObjectManager::InstanceObject(float3 _fPos, char* _szName)
 
 }
 //================================================================================
+void ATHObjectManager::InstanceObjects(float3 _fPos, char* _szName, unsigned int _unCount, std::vector<ATHObject*>* _pOutObjects)
+{
+	if (!m_pLibraryObjectsNode || _unCount == 0)
+		return;
+
+	rapidxml::xml_node<>* pObjectNode = m_pLibraryObjectsNode->first_node(_szName);
+	if (!pObjectNode)
+	{
+		std::cout << "Failed to instance object " << _szName << "\n";
+		return;
+	}
+
+	// Parse the body once and create every copy of it in one batch
+	std::vector<b2Body*> vecBodies(_unCount, nullptr);
+
+	b2BodyDef bodyDef;
+	std::vector<b2FixtureDef> vecFixtureDefs;
+	if (ParseB2Body(pObjectNode, bodyDef, vecFixtureDefs))
+	{
+		bodyDef.position = b2Vec2(_fPos.vX, _fPos.vY);
+
+		std::vector<b2BodyDef> vecBodyDefs(_unCount, bodyDef);
+		std::vector<int32> vecFixtureCounts(_unCount, (int32)vecFixtureDefs.size());
+		std::vector<b2FixtureDef> vecAllFixtureDefs;
+		vecAllFixtureDefs.reserve(_unCount * vecFixtureDefs.size());
+		for (unsigned int i = 0; i < _unCount; ++i)
+			vecAllFixtureDefs.insert(vecAllFixtureDefs.end(), vecFixtureDefs.begin(), vecFixtureDefs.end());
+
+		GetWorldAt(bodyDef.position)->CreateBodies(&vecBodyDefs[0], _unCount, &vecAllFixtureDefs[0], &vecFixtureCounts[0], &vecBodies[0]);
+
+		FreeFixtureShapes(vecFixtureDefs);
+	}
+
+	for (unsigned int i = 0; i < _unCount; ++i)
+	{
+		ATHObject* pNewObject = GenerateObject(pObjectNode, vecBodies[i]);
+		pNewObject->SetPosition(_fPos);
+
+		std::cout << "Instanced Object: " << pNewObject->GetName() << "\n";
+
+		AddObject(pNewObject);
+
+		if (_pOutObjects)
+			_pOutObjects->push_back(pNewObject);
+	}
+}
+//================================================================================
 void ATHObjectManager::ClearObjects()
 {
 	std::list<ATHObject*>::iterator itrObjects = m_liObjects.begin();
@@ -170,22 +351,172 @@ void ATHObjectManager::ClearObjects()
 	}
 }
 //================================================================================
-void ATHObjectManager::BeginContact(b2Contact* contact)
+b2World* ATHObjectManager::CreatePartition(const b2AABB& _aabbBounds)
 {
-	ATHObject* pObjectA = (ATHObject*)contact->GetFixtureA()->GetBody()->GetUserData();
-	ATHObject* pObjectB = (ATHObject*)contact->GetFixtureB()->GetBody()->GetUserData();
+	ATHPhysicsPartition partition;
+	CreateWorld(partition);
+	partition.m_aabbBounds = _aabbBounds;
+	m_vecPartitions.push_back(partition);
 
-	IF(pObjectA)->OnCollisionEnter(contact);
-	IF(pObjectB)->OnCollisionEnter(contact);
+	return partition.m_pWorld;
 }
 //================================================================================
-void ATHObjectManager::EndContact(b2Contact* contact)
+b2World* ATHObjectManager::GetWorldAt(const b2Vec2& _vPos)
 {
-	ATHObject* pObjectA = (ATHObject*)contact->GetFixtureA()->GetBody()->GetUserData();
-	ATHObject* pObjectB = (ATHObject*)contact->GetFixtureB()->GetBody()->GetUserData();
+	// The first partition containing the point wins, anything else is left to m_pWorld
+	for (unsigned int i = 1; i < m_vecPartitions.size(); ++i)
+	{
+		const b2AABB& aabbBounds = m_vecPartitions[i].m_aabbBounds;
+		if (aabbBounds.lowerBound.x <= _vPos.x && _vPos.x <= aabbBounds.upperBound.x &&
+			aabbBounds.lowerBound.y <= _vPos.y && _vPos.y <= aabbBounds.upperBound.y)
+			return m_vecPartitions[i].m_pWorld;
+	}
 
-	IF(pObjectA)->OnCollisionExit(contact);
-	IF(pObjectB)->OnCollisionExit(contact);
+	return m_pWorld;
+}
+//================================================================================
+b2Body* ATHObjectManager::MigrateBody(b2Body* _pBody, b2World* _pTargetWorld)
+{
+	b2World* pSourceWorld = _pBody->GetWorld();
+	if (pSourceWorld == _pTargetWorld)
+		return _pBody;
+
+	// Joints can't span worlds
+	if (_pBody->GetJointList())
+		return _pBody;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = _pBody->GetType();
+	bodyDef.position = _pBody->GetPosition();
+	bodyDef.angle = _pBody->GetAngle();
+	bodyDef.linearVelocity = _pBody->GetLinearVelocity();
+	bodyDef.angularVelocity = _pBody->GetAngularVelocity();
+	bodyDef.linearDamping = _pBody->GetLinearDamping();
+	bodyDef.angularDamping = _pBody->GetAngularDamping();
+	bodyDef.allowSleep = _pBody->IsSleepingAllowed();
+	bodyDef.awake = _pBody->IsAwake();
+	bodyDef.fixedRotation = _pBody->IsFixedRotation();
+	bodyDef.bullet = _pBody->IsBullet();
+	bodyDef.active = _pBody->IsActive();
+	bodyDef.userData = _pBody->GetUserData();
+	bodyDef.gravityScale = _pBody->GetGravityScale();
+
+	// The target world clones the shapes, so they can be shared until the old body is gone
+	std::vector<b2FixtureDef> vecFixtureDefs;
+	for (b2Fixture* pFixture = _pBody->GetFixtureList(); pFixture; pFixture = pFixture->GetNext())
+	{
+		b2FixtureDef fixtureDef;
+		fixtureDef.shape = pFixture->GetShape();
+		fixtureDef.userData = pFixture->GetUserData();
+		fixtureDef.friction = pFixture->GetFriction();
+		fixtureDef.restitution = pFixture->GetRestitution();
+		fixtureDef.density = pFixture->GetDensity();
+		fixtureDef.isSensor = pFixture->IsSensor();
+		fixtureDef.filter = pFixture->GetFilterData();
+		vecFixtureDefs.push_back(fixtureDef);
+	}
+
+	// The fixture list is newest first
+	std::reverse(vecFixtureDefs.begin(), vecFixtureDefs.end());
+
+	b2Body* pNewBody = nullptr;
+	int32 nFixtureCount = (int32)vecFixtureDefs.size();
+	_pTargetWorld->CreateBodies(&bodyDef, 1, vecFixtureDefs.empty() ? nullptr : &vecFixtureDefs[0], &nFixtureCount, &pNewBody);
+
+	pSourceWorld->DestroyBody(_pBody);
+
+	ATHObject* pObject = (ATHObject*)pNewBody->GetUserData();
+	if (pObject)
+		pObject->m_pBody = pNewBody;
+
+	return pNewBody;
+}
+//================================================================================
+void ATHObjectManager::MigrateObjects()
+{
+	if (m_vecPartitions.size() < 2)
+		return;
+
+	std::list<ATHObject*>::iterator itrObjects = m_liObjects.begin();
+	std::list<ATHObject*>::iterator itrObjectsEnd = m_liObjects.end();
+	for (; itrObjects != itrObjectsEnd; ++itrObjects)
+	{
+		ATHObject* pCurrObj = (*itrObjects);
+		b2Body* pBody = pCurrObj->m_pBody;
+
+		// Only free moving bodies change worlds, the rest define the partitions
+		if (!pCurrObj->GetAlive() || !pBody || pBody->GetType() != b2_dynamicBody)
+			continue;
+
+		b2World* pWorld = pBody->GetWorld();
+		b2Vec2 vPos = pBody->GetWorldCenter();
+
+		// Bodies leave a partition only once they are clear of its bounds, so
+		// anything drifting along a border doesn't bounce between worlds
+		bool bInside = false;
+		for (unsigned int i = 1; i < m_vecPartitions.size(); ++i)
+		{
+			if (m_vecPartitions[i].m_pWorld != pWorld)
+				continue;
+
+			b2AABB aabbBounds = m_vecPartitions[i].m_aabbBounds;
+			b2Vec2 vMargin(PARTITION_MIGRATION_MARGIN, PARTITION_MIGRATION_MARGIN);
+			aabbBounds.lowerBound -= vMargin;
+			aabbBounds.upperBound += vMargin;
+			bInside = aabbBounds.lowerBound.x <= vPos.x && vPos.x <= aabbBounds.upperBound.x &&
+					  aabbBounds.lowerBound.y <= vPos.y && vPos.y <= aabbBounds.upperBound.y;
+			break;
+		}
+
+		if (bInside)
+			continue;
+
+		// A body anchoring a gravity field would leave it behind
+		bool bAnchorsGravity = false;
+		for (b2GravitySource* pSource = pWorld->GetGravitySourceList(); pSource; pSource = pSource->GetNext())
+			bAnchorsGravity |= pSource->GetBody() == pBody;
+
+		b2World* pTargetWorld = GetWorldAt(vPos);
+		if (pTargetWorld != pWorld && !bAnchorsGravity)
+			MigrateBody(pBody, pTargetWorld);
+	}
+}
+//================================================================================
+void ATHObjectManager::DispatchEvent(const ATHPhysicsEvent& _event)
+{
+	ATHObject* pObjectA = (ATHObject*)_event.m_pFixtureA->GetBody()->GetUserData();
+	ATHObject* pObjectB = (ATHObject*)_event.m_pFixtureB->GetBody()->GetUserData();
+
+	switch (_event.m_eType)
+	{
+	case APE_COLLISION_ENTER:
+		IF(pObjectA)->OnCollisionEnter(_event.m_pFixtureA, _event.m_pFixtureB);
+		IF(pObjectB)->OnCollisionEnter(_event.m_pFixtureA, _event.m_pFixtureB);
+		break;
+	case APE_COLLISION_EXIT:
+		IF(pObjectA)->OnCollisionExit(_event.m_pFixtureA, _event.m_pFixtureB);
+		IF(pObjectB)->OnCollisionExit(_event.m_pFixtureA, _event.m_pFixtureB);
+		break;
+	case APE_SENSOR_ENTER:
+		IF(pObjectA)->OnSensorEnter(_event.m_pFixtureA, _event.m_pFixtureB);
+		IF(pObjectB)->OnSensorEnter(_event.m_pFixtureA, _event.m_pFixtureB);
+		break;
+	case APE_SENSOR_EXIT:
+		IF(pObjectA)->OnSensorExit(_event.m_pFixtureA, _event.m_pFixtureB);
+		IF(pObjectB)->OnSensorExit(_event.m_pFixtureA, _event.m_pFixtureB);
+		break;
+	}
+}
+//================================================================================
+void ATHObjectManager::DispatchEvents(ATHPhysicsPartition& _partition)
+{
+	// Nothing destroys bodies between the steps, so every queued fixture is
+	// still alive, in the order the world reported it
+	std::vector<ATHPhysicsEvent>& vecEvents = _partition.m_pEvents->m_vecEvents;
+	for (unsigned int i = 0; i < vecEvents.size(); ++i)
+		DispatchEvent(vecEvents[i]);
+
+	vecEvents.clear();
 }
 //================================================================================
 void ATHObjectManager::LoadObjectsFromXML( const char* _szFilePath )
@@ -241,7 +572,7 @@ void ATHObjectManager::LoadXMLFromFile( const char* _szPath )
 
 }
 //================================================================================
-ATHObject* ATHObjectManager::GenerateObject(rapidxml::xml_node<>* pRootObjNode)
+ATHObject* ATHObjectManager::GenerateObject(rapidxml::xml_node<>* pRootObjNode, b2Body* _pBody)
 {
 	ATHObject* pReturnObject = nullptr;
 
@@ -259,7 +590,7 @@ ATHObject* ATHObjectManager::GenerateObject(rapidxml::xml_node<>* pRootObjNode)
 	LoadProperties( pReturnObject, pRootObjNode->first_node("Properties") );
 
 	ATHRenderNode* pRenderNode = GenerateRenderNode(pRootObjNode);
-	b2Body*	pBody = GenerateB2Body(pRootObjNode);
+	b2Body*	pBody = _pBody ? _pBody : GenerateB2Body(pRootObjNode);
 
 	pReturnObject->Init(pRenderNode, pBody);
 
@@ -327,10 +658,27 @@ void ATHObjectManager::LoadProperties(ATHObject* _pLoadTarget, rapidxml::xml_nod
 b2Body* ATHObjectManager::GenerateB2Body(rapidxml::xml_node<>* pXMLNode)
 {
 	b2Body* pReturnBody = nullptr;
-	
+
+	b2BodyDef bodyDef;
+	std::vector<b2FixtureDef> vecFixtureDefs;
+	if (!ParseB2Body(pXMLNode, bodyDef, vecFixtureDefs))
+		return nullptr;
+
+	// Create the body with all of its fixtures so the mass is only computed once
+	int32 nFixtureCount = (int32)vecFixtureDefs.size();
+	GetWorldAt(bodyDef.position)->CreateBodies(&bodyDef, 1, &vecFixtureDefs[0], &nFixtureCount, &pReturnBody);
+
+	// The shapes were cloned onto the body
+	FreeFixtureShapes(vecFixtureDefs);
+
+	return pReturnBody;
+}
+//================================================================================
+bool ATHObjectManager::ParseB2Body(rapidxml::xml_node<>* pXMLNode, b2BodyDef& _bodyDef, std::vector<b2FixtureDef>& _vecFixtureDefs)
+{
 	rapidxml::xml_node<>* pBodyNode = pXMLNode->first_node("B2Body");
 	if (!pBodyNode)
-		return nullptr;
+		return false;
 
 	// Get the position of the object
 	float fPosX = 0.0f;
@@ -344,28 +692,21 @@ b2Body* ATHObjectManager::GenerateB2Body(rapidxml::xml_node<>* pXMLNode)
 		fPosZ = (float)atof(nodePos->first_attribute("Z")->value()) * GLOBAL_LOAD_SCALE;
 	}
 
-	b2BodyDef bodyDef;
-	bodyDef.position = b2Vec2( fPosX, fPosY );
+	_bodyDef.position = b2Vec2( fPosX, fPosY );
 
 	// Set the type of the body to be created;
 	char* szBodyType = pBodyNode->first_attribute("Type")->value();
 	if (!strcmp(szBodyType, "static"))
-		bodyDef.type = b2_staticBody;
+		_bodyDef.type = b2_staticBody;
 	else if (!strcmp(szBodyType, "kinematic"))
-		bodyDef.type = b2_kinematicBody;
+		_bodyDef.type = b2_kinematicBody;
 	else if (!strcmp(szBodyType, "dynamic"))
-		bodyDef.type = b2_dynamicBody;
+		_bodyDef.type = b2_dynamicBody;
 
 	float fBodyDensity = (float)atof(pBodyNode->first_attribute("Density")->value());
 
-	// Create the body
-	pReturnBody = m_pWorld->CreateBody(&bodyDef);
-
 	// Grab the shape node
 	rapidxml::xml_node<>* pNodeShape = pBodyNode->first_node("B2Shape");
-	if (!pNodeShape)
-		return nullptr;
-
 	while (pNodeShape)
 	{
 		b2FixtureDef pFixtureDef;
@@ -394,18 +735,24 @@ b2Body* ATHObjectManager::GenerateB2Body(rapidxml::xml_node<>* pXMLNode)
 			pFixtureDef.shape = GenerateB2PolygonShape(pNodeShape);
 		}
 
-		// Clone the shape onto the body and clean up
-		pReturnBody->CreateFixture(&pFixtureDef);
-
-		if (pFixtureDef.shape )
-			delete pFixtureDef.shape;
+		if (pFixtureDef.shape)
+			_vecFixtureDefs.push_back(pFixtureDef);
 
 		pNodeShape = pNodeShape->next_sibling("B2Shape");
 	}
 
+	if (_vecFixtureDefs.empty())
+		return false;
 
+	return true;
+}
+//================================================================================
+void ATHObjectManager::FreeFixtureShapes(std::vector<b2FixtureDef>& _vecFixtureDefs)
+{
+	for (unsigned int i = 0; i < _vecFixtureDefs.size(); ++i)
+		delete _vecFixtureDefs[i].shape;
 
-	return pReturnBody;
+	_vecFixtureDefs.clear();
 }
 //================================================================================
 b2Shape* ATHObjectManager::GenerateB2PolygonShape(rapidxml::xml_node<>* pXMLShapeNode)
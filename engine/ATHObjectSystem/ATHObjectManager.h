@@ -2,18 +2,60 @@
 #define ATHOBJECTMANAGER_H
 
 #include <list>
+#include <vector>
 #include "../ATHUtil/FileUtil.h"
 #include "../ATHUtil/hDataTypes.h"
 #include "../Box2D/Dynamics/b2WorldCallbacks.h"
+#include "../Box2D/Collision/b2Collision.h"
 
 class b2World;
 class b2Body;
+struct b2BodyDef;
+struct b2FixtureDef;
 class ATHRenderNode;
 class ATHObject;
 class b2Shape;
+class b2Fixture;
+class ATHObjectManager;
 
+enum ATHPhysicsEventType{ APE_COLLISION_ENTER, APE_COLLISION_EXIT, APE_SENSOR_ENTER, APE_SENSOR_EXIT };
 
-class ATHObjectManager : public b2ContactListener
+// A collision or sensor callback held back until the partitions are done stepping
+struct ATHPhysicsEvent
+{
+	ATHPhysicsEventType m_eType;
+	b2Fixture* m_pFixtureA;
+	b2Fixture* m_pFixtureB;
+};
+
+// Records the events of one world while it steps on a worker. Contacts ended
+// outside of a step, by destroying a body, are passed on right away since the
+// fixtures won't outlive the call.
+class ATHPhysicsEventQueue : public b2ContactListener
+{
+public:
+
+	ATHObjectManager* m_pManager;
+	std::vector<ATHPhysicsEvent> m_vecEvents;
+
+	void Push(ATHPhysicsEventType _eType, b2Fixture* _pFixtureA, b2Fixture* _pFixtureB);
+	void PushSensorEvents(b2World* _pWorld);
+	void PushContact(ATHPhysicsEventType _eType, b2Contact* _pContact);
+
+	virtual void BeginContact(b2Contact* contact);
+	virtual void EndContact(b2Contact* contact);
+};
+
+// A region of space simulated by its own b2World. Partitions share nothing,
+// so they are stepped concurrently.
+struct ATHPhysicsPartition
+{
+	b2World* m_pWorld;
+	b2AABB m_aabbBounds;
+	ATHPhysicsEventQueue* m_pEvents;
+};
+
+class ATHObjectManager
 {
 private:
 
@@ -30,6 +72,12 @@ private:
 	std::list<ATHObject*> m_liStaticObjects;
 	std::list< ATHObject* > m_liToRemove;
 
+	// Partition 0 is m_pWorld, which covers everything outside the others
+	std::vector<ATHPhysicsPartition> m_vecPartitions;
+
+	void CreateWorld(ATHPhysicsPartition& _partition);
+	void MigrateObjects();
+
 public:
 
 	b2World* m_pWorld;
@@ -45,11 +93,17 @@ public:
 	void AddObject( ATHObject* pObject );
 	void AddObjectStatic( ATHObject* pObject );
 	ATHObject* InstanceObject(float3 _fPos, char* _szName);
+	void InstanceObjects(float3 _fPos, char* _szName, unsigned int _unCount, std::vector<ATHObject*>* _pOutObjects = nullptr);
 	void ClearObjects();
 
+	// Physics partitions
+	b2World* CreatePartition(const b2AABB& _aabbBounds);
+	b2World* GetWorldAt(const b2Vec2& _vPos);
+	b2Body* MigrateBody(b2Body* _pBody, b2World* _pTargetWorld);
+
 	// Collision functions
-	virtual void BeginContact(b2Contact* contact);
-	virtual void EndContact(b2Contact* contact);
+	void DispatchEvent(const ATHPhysicsEvent& _event);
+	void DispatchEvents(ATHPhysicsPartition& _partition);
 
 	// Object Loading
 	void LoadObjectsFromXML( const char* _szFilePath );
@@ -57,12 +111,14 @@ public:
 	void LoadXMLFromFile( const char* _szPath );
 
 	// Object parsing
-	ATHObject* GenerateObject(rapidxml::xml_node<>* pRootObjNode );
+	ATHObject* GenerateObject(rapidxml::xml_node<>* pRootObjNode, b2Body* _pBody = nullptr );
 	ATHObject* GenerateObjectFromReference(rapidxml::xml_node<>* pRefNode);
 	void LoadProperties(ATHObject* _pLoadTarget, rapidxml::xml_node<>* _pXMLPropertiesNode);
 	
 	// Box2d Parsing
 	b2Body* GenerateB2Body(rapidxml::xml_node<>* pXMLNode);
+	bool ParseB2Body(rapidxml::xml_node<>* pXMLNode, b2BodyDef& _bodyDef, std::vector<b2FixtureDef>& _vecFixtureDefs);
+	void FreeFixtureShapes(std::vector<b2FixtureDef>& _vecFixtureDefs);
 	b2Shape* GenerateB2PolygonShape(rapidxml::xml_node<>* pXMLShapeNode);
 	b2Shape* GenerateB2CircleShape(rapidxml::xml_node<>* pXMLShapeNode);
 
@@ -47,8 +47,10 @@ For discussion please visit http://box2d.org/forum
 
 #include "Dynamics/b2Body.h"
 #include "Dynamics/b2Fixture.h"
+#include "Dynamics/b2GravitySource.h"
 #include "Dynamics/b2WorldCallbacks.h"
 #include "Dynamics/b2TimeStep.h"
+#include "Dynamics/b2Profiler.h"
 #include "Dynamics/b2World.h"
 
 #include "Dynamics/Contacts/b2Contact.h"
@@ -17,11 +17,19 @@
 */
 
 #include "b2BroadPhase.h"
+#include "../Common/b2Snapshot.h"
+#include "b2SweepAndPrune.h"
+#include "b2UniformGrid.h"
 #include <cstring>
+#include <new>
 using namespace std;
 
-b2BroadPhase::b2BroadPhase()
+b2BroadPhase::b2BroadPhase(b2BroadPhaseType type)
 {
+	m_type = type;
+	m_split = type == b2_splitTreeBroadPhase;
+	CreateIndex();
+
 	m_proxyCount = 0;
 
 	m_pairCapacity = 16;
@@ -35,28 +43,130 @@ b2BroadPhase::b2BroadPhase()
 
 b2BroadPhase::~b2BroadPhase()
 {
+	DestroyIndex();
+
 	b2Free(m_moveBuffer);
 	b2Free(m_pairBuffer);
 }
 
-int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
+void b2BroadPhase::CreateIndex()
+{
+	switch (m_type)
+	{
+	case b2_sweepAndPruneBroadPhase:
+		{
+			void* mem = b2Alloc(sizeof(b2SweepAndPrune));
+			m_index = new (mem) b2SweepAndPrune;
+		}
+		break;
+
+	case b2_uniformGridBroadPhase:
+		{
+			void* mem = b2Alloc(sizeof(b2UniformGrid));
+			m_index = new (mem) b2UniformGrid(b2_gridCellSize);
+		}
+		break;
+
+	default:
+		m_index = NULL;
+		break;
+	}
+}
+
+void b2BroadPhase::DestroyIndex()
 {
-	int32 proxyId = m_tree.CreateProxy(aabb, userData);
+	if (m_index)
+	{
+		m_index->~b2BroadPhaseIndex();
+		b2Free(m_index);
+		m_index = NULL;
+	}
+}
+
+int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData, bool isStatic, uint16 categoryBits, uint16 maskBits)
+{
+	int32 proxyId;
+	if (m_index)
+	{
+		proxyId = m_index->CreateProxy(aabb, userData);
+	}
+	else if (m_split && isStatic)
+	{
+		proxyId = m_staticTree.CreateProxy(aabb, userData, categoryBits, maskBits) | e_staticProxy;
+	}
+	else
+	{
+		proxyId = m_tree.CreateProxy(aabb, userData, categoryBits, maskBits);
+	}
+
 	++m_proxyCount;
 	BufferMove(proxyId);
 	return proxyId;
 }
 
+void b2BroadPhase::CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds, bool isStatic,
+								 const uint16* categoryBits, const uint16* maskBits)
+{
+	if (m_index)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			proxyIds[i] = m_index->CreateProxy(aabbs[i], userData[i]);
+		}
+	}
+	else if (m_split && isStatic)
+	{
+		m_staticTree.CreateProxies(aabbs, userData, count, proxyIds, categoryBits, maskBits);
+		for (int32 i = 0; i < count; ++i)
+		{
+			proxyIds[i] |= e_staticProxy;
+		}
+	}
+	else
+	{
+		m_tree.CreateProxies(aabbs, userData, count, proxyIds, categoryBits, maskBits);
+	}
+
+	m_proxyCount += count;
+	for (int32 i = 0; i < count; ++i)
+	{
+		BufferMove(proxyIds[i]);
+	}
+}
+
 void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
 	--m_proxyCount;
-	m_tree.DestroyProxy(proxyId);
+	if (m_index)
+	{
+		m_index->DestroyProxy(proxyId);
+	}
+	else if (proxyId & e_staticProxy)
+	{
+		m_staticTree.DestroyProxy(proxyId & ~e_staticProxy);
+	}
+	else
+	{
+		m_tree.DestroyProxy(proxyId);
+	}
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	bool buffer;
+	if (m_index)
+	{
+		buffer = m_index->MoveProxy(proxyId, aabb, displacement);
+	}
+	else if (proxyId & e_staticProxy)
+	{
+		buffer = m_staticTree.MoveProxy(proxyId & ~e_staticProxy, aabb, displacement);
+	}
+	else
+	{
+		buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	}
 	if (buffer)
 	{
 		BufferMove(proxyId);
@@ -68,6 +178,23 @@ void b2BroadPhase::TouchProxy(int32 proxyId)
 	BufferMove(proxyId);
 }
 
+void b2BroadPhase::SetProxyFilter(int32 proxyId, uint16 categoryBits, uint16 maskBits)
+{
+	if (m_index)
+	{
+		return;
+	}
+
+	if (proxyId & e_staticProxy)
+	{
+		m_staticTree.SetProxyFilter(proxyId & ~e_staticProxy, categoryBits, maskBits);
+	}
+	else
+	{
+		m_tree.SetProxyFilter(proxyId, categoryBits, maskBits);
+	}
+}
+
 void b2BroadPhase::BufferMove(int32 proxyId)
 {
 	if (m_moveCount == m_moveCapacity)
@@ -95,7 +222,7 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 	}
 }
 
-// This is called from b2DynamicTree::Query when we are gathering pairs.
+// This is called from b2DynamicTree::Query (or the index) when we are gathering pairs.
 bool b2BroadPhase::QueryCallback(int32 proxyId)
 {
 	// A proxy cannot form a pair with itself.
@@ -120,3 +247,99 @@ bool b2BroadPhase::QueryCallback(int32 proxyId)
 
 	return true;
 }
+
+void b2BroadPhase::WriteSnapshot(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_type);
+	snapshot->Write(m_proxyCount);
+	snapshot->Write(m_moveCount);
+	snapshot->Write(m_moveBuffer, m_moveCount * sizeof(int32));
+
+	if (m_index)
+	{
+		m_index->WriteSnapshot(snapshot);
+	}
+	else
+	{
+		m_tree.WriteSnapshot(snapshot);
+		if (m_split)
+		{
+			m_staticTree.WriteSnapshot(snapshot);
+		}
+	}
+}
+
+bool b2BroadPhase::ReadSnapshot(b2SnapshotReader* reader)
+{
+	b2BroadPhaseType type;
+	int32 proxyCount, moveCount;
+	reader->Read(&type);
+	reader->Read(&proxyCount);
+	reader->Read(&moveCount);
+	if (reader->IsValid() == false || type != m_type || proxyCount < 0 || moveCount < 0 ||
+		moveCount > reader->GetRemainingSize() / (int32)sizeof(int32))
+	{
+		reader->Invalidate();
+		return false;
+	}
+
+	if (moveCount > m_moveCapacity)
+	{
+		b2Free(m_moveBuffer);
+		m_moveCapacity = moveCount;
+		m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+	}
+
+	m_proxyCount = proxyCount;
+	m_moveCount = moveCount;
+	reader->Read(m_moveBuffer, m_moveCount * sizeof(int32));
+
+	int32 actualCount;
+	if (m_index)
+	{
+		// Start from an empty index so its storage is rebuilt from the proxies alone.
+		DestroyIndex();
+		CreateIndex();
+		if (m_index->ReadSnapshot(reader) == false)
+		{
+			return false;
+		}
+		actualCount = m_index->GetProxyCount();
+	}
+	else
+	{
+		if (m_tree.ReadSnapshot(reader) == false)
+		{
+			return false;
+		}
+		actualCount = m_tree.GetProxyCount();
+
+		if (m_split)
+		{
+			if (m_staticTree.ReadSnapshot(reader) == false)
+			{
+				return false;
+			}
+			actualCount += m_staticTree.GetProxyCount();
+		}
+	}
+
+	if (actualCount != m_proxyCount)
+	{
+		reader->Invalidate();
+		return false;
+	}
+
+	// Pending moves are either proxies or cleared entries.
+	for (int32 i = 0; i < m_moveCount; ++i)
+	{
+		int32 proxyId = m_moveBuffer[i];
+		if (proxyId != e_nullProxy && IsProxyValid(proxyId) == false)
+		{
+			reader->Invalidate();
+			return false;
+		}
+	}
+
+	return true;
+}
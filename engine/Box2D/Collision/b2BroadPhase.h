@@ -22,6 +22,7 @@
 #include "../Common/b2Settings.h"
 #include "../Collision/b2Collision.h"
 #include "b2DynamicTree.h"
+#include "b2BroadPhaseIndex.h"
 
 #include <algorithm>
 
@@ -32,9 +33,101 @@ struct b2Pair
 	int32 next;
 };
 
+/// Adapts a broad-phase query callback to the b2BroadPhaseIndex interface.
+template <typename T>
+class b2BroadPhaseQueryWrapper : public b2BroadPhaseQueryCallback
+{
+public:
+	bool QueryCallback(int32 proxyId)
+	{
+		return callback->QueryCallback(proxyId);
+	}
+
+	T* callback;
+};
+
+/// Adapts a broad-phase packet query callback to a single query lane.
+template <typename T>
+class b2BroadPhaseLaneWrapper
+{
+public:
+	bool QueryCallback(int32 proxyId)
+	{
+		return callback->QueryCallback(lane, proxyId);
+	}
+
+	T* callback;
+	int32 lane;
+};
+
+/// Forwards callbacks from the static tree of a split broad-phase. The proxy ids
+/// are tagged and stopped queries are remembered so the other tree skips them.
+template <typename T>
+class b2SplitTreeWrapper
+{
+public:
+	bool QueryCallback(int32 proxyId)
+	{
+		if (stopped || callback->QueryCallback(proxyId | tag) == false)
+		{
+			stopped = 1;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool QueryCallback(int32 lane, int32 proxyId)
+	{
+		int32 bit = 1 << lane;
+		if ((stopped & bit) || callback->QueryCallback(lane, proxyId | tag) == false)
+		{
+			stopped |= bit;
+			return false;
+		}
+
+		return true;
+	}
+
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		float32 value = callback->RayCastCallback(input, proxyId | tag);
+		if (value == 0.0f)
+		{
+			stopped = 1;
+		}
+		else if (value > 0.0f)
+		{
+			maxFraction = value;
+		}
+
+		return value;
+	}
+
+	T* callback;
+	int32 tag;
+	int32 stopped;
+	float32 maxFraction;
+};
+
+/// Adapts a broad-phase ray-cast callback to the b2BroadPhaseIndex interface.
+template <typename T>
+class b2BroadPhaseRayCastWrapper : public b2BroadPhaseRayCastCallback
+{
+public:
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		return callback->RayCastCallback(input, proxyId);
+	}
+
+	T* callback;
+};
+
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
+/// The proxies live in a dynamic tree by default. A sweep-and-prune list or a
+/// uniform grid can be selected instead when the broad-phase is constructed.
 class b2BroadPhase
 {
 public:
@@ -44,12 +137,26 @@ public:
 		e_nullProxy = -1
 	};
 
-	b2BroadPhase();
+	b2BroadPhase(b2BroadPhaseType type = b2_dynamicTreeBroadPhase);
 	~b2BroadPhase();
 
+	/// Get the spatial structure holding the proxies.
+	b2BroadPhaseType GetType() const;
+
 	/// Create a proxy with an initial AABB. Pairs are not reported until
-	/// UpdatePairs is called.
-	int32 CreateProxy(const b2AABB& aabb, void* userData);
+	/// UpdatePairs is called. A split-tree broad-phase keeps static proxies
+	/// in their own tree. The tree broad-phases only pair proxies whose filter
+	/// bits accept each other, like b2Filter without groups. The other types
+	/// ignore the bits.
+	int32 CreateProxy(const b2AABB& aabb, void* userData, bool isStatic = false,
+					  uint16 categoryBits = 0xFFFF, uint16 maskBits = 0xFFFF);
+
+	/// Create many proxies at once. The trees take them with one bulk build,
+	/// the other broad-phase types one at a time.
+	/// @param proxyIds receives the id of each proxy.
+	/// @param categoryBits, maskBits the filter bits of each proxy, or NULL for all bits.
+	void CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds, bool isStatic = false,
+					   const uint16* categoryBits = NULL, const uint16* maskBits = NULL);
 
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
@@ -61,18 +168,31 @@ public:
 	/// Call to trigger a re-processing of it's pairs on the next call to UpdatePairs.
 	void TouchProxy(int32 proxyId);
 
+	/// Change the filter bits of a proxy. Touch the proxy if pairs may have been
+	/// let through by the change.
+	void SetProxyFilter(int32 proxyId, uint16 categoryBits, uint16 maskBits);
+
 	/// Get the fat AABB for a proxy.
 	const b2AABB& GetFatAABB(int32 proxyId) const;
 
 	/// Get user data from a proxy. Returns NULL if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
 
+	/// Set the user data of a proxy.
+	void SetUserData(int32 proxyId, void* userData);
+
+	/// Does this id refer to a proxy? Used to check ids read from a snapshot.
+	bool IsProxyValid(int32 proxyId) const;
+
 	/// Test overlap of fat AABBs.
 	bool TestOverlap(int32 proxyIdA, int32 proxyIdB) const;
 
 	/// Get the number of proxies.
 	int32 GetProxyCount() const;
 
+	/// Get the number of pairs the last UpdatePairs found, counting duplicates.
+	int32 GetPairCount() const;
+
 	/// Update the pairs. This results in pair callbacks. This can only add pairs.
 	template <typename T>
 	void UpdatePairs(T* callback);
@@ -82,6 +202,12 @@ public:
 	template <typename T>
 	void Query(T* callback, const b2AABB& aabb) const;
 
+	/// Query up to b2_simdWidth AABBs at once. The callback is called with the index
+	/// of the query: bool QueryCallback(int32 lane, int32 proxyId).
+	/// @see b2DynamicTree::QueryPacket
+	template <typename T>
+	void QueryPacket(T* callback, const b2AABB* aabbs, int32 count) const;
+
 	/// Ray-cast against the proxies in the tree. This relies on the callback
 	/// to perform a exact ray-cast in the case were the proxy contains a shape.
 	/// The callback also performs the any collision filtering. This has performance
@@ -92,26 +218,53 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
-	/// Get the height of the embedded tree.
+	/// Get the height of the embedded tree. Zero if the tree is not in use.
 	int32 GetTreeHeight() const;
 
-	/// Get the balance of the embedded tree.
+	/// Get the balance of the embedded tree. Zero if the tree is not in use.
 	int32 GetTreeBalance() const;
 
-	/// Get the quality metric of the embedded tree.
+	/// Get the quality metric of the embedded tree. Zero if the tree is not in use.
 	float32 GetTreeQuality() const;
 
+	/// Write the proxies and the pending moves to a snapshot. User data is not written.
+	void WriteSnapshot(b2Snapshot* snapshot) const;
+
+	/// Replace the proxies with ones written by WriteSnapshot. Proxy ids are preserved.
+	/// User data is cleared and must be set again with SetUserData.
+	/// @return false if the data is malformed or from another broad-phase type.
+	bool ReadSnapshot(b2SnapshotReader* reader);
+
 private:
 
 	friend class b2DynamicTree;
+	template <typename T> friend class b2BroadPhaseQueryWrapper;
+	template <typename T> friend class b2SplitTreeWrapper;
+
+	void CreateIndex();
+	void DestroyIndex();
+
+	// Proxy ids from the static tree of a split broad-phase carry this bit.
+	enum
+	{
+		e_staticProxy = 0x40000000
+	};
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
 
 	bool QueryCallback(int32 proxyId);
 
+	b2BroadPhaseType m_type;
 	b2DynamicTree m_tree;
 
+	// Holds the static proxies of a split-tree broad-phase.
+	b2DynamicTree m_staticTree;
+	bool m_split;
+
+	// Replaces m_tree when a different broad-phase type is selected.
+	b2BroadPhaseIndex* m_index;
+
 	int32 m_proxyCount;
 
 	int32* m_moveBuffer;
@@ -141,20 +294,76 @@ inline bool b2PairLessThan(const b2Pair& pair1, const b2Pair& pair2)
 	return false;
 }
 
+inline b2BroadPhaseType b2BroadPhase::GetType() const
+{
+	return m_type;
+}
+
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
 {
+	if (m_index)
+	{
+		return m_index->GetUserData(proxyId);
+	}
+
+	if (proxyId & e_staticProxy)
+	{
+		return m_staticTree.GetUserData(proxyId & ~e_staticProxy);
+	}
+
 	return m_tree.GetUserData(proxyId);
 }
 
+inline void b2BroadPhase::SetUserData(int32 proxyId, void* userData)
+{
+	if (m_index)
+	{
+		m_index->SetUserData(proxyId, userData);
+	}
+	else if (proxyId & e_staticProxy)
+	{
+		m_staticTree.SetUserData(proxyId & ~e_staticProxy, userData);
+	}
+	else
+	{
+		m_tree.SetUserData(proxyId, userData);
+	}
+}
+
+inline bool b2BroadPhase::IsProxyValid(int32 proxyId) const
+{
+	if (m_index)
+	{
+		return m_index->IsProxyValid(proxyId);
+	}
+
+	if (proxyId & e_staticProxy)
+	{
+		return m_split && m_staticTree.IsProxyValid(proxyId & ~e_staticProxy);
+	}
+
+	return m_tree.IsProxyValid(proxyId);
+}
+
 inline bool b2BroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB) const
 {
-	const b2AABB& aabbA = m_tree.GetFatAABB(proxyIdA);
-	const b2AABB& aabbB = m_tree.GetFatAABB(proxyIdB);
+	const b2AABB& aabbA = GetFatAABB(proxyIdA);
+	const b2AABB& aabbB = GetFatAABB(proxyIdB);
 	return b2TestOverlap(aabbA, aabbB);
 }
 
 inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 {
+	if (m_index)
+	{
+		return m_index->GetFatAABB(proxyId);
+	}
+
+	if (proxyId & e_staticProxy)
+	{
+		return m_staticTree.GetFatAABB(proxyId & ~e_staticProxy);
+	}
+
 	return m_tree.GetFatAABB(proxyId);
 }
 
@@ -163,19 +372,24 @@ inline int32 b2BroadPhase::GetProxyCount() const
 	return m_proxyCount;
 }
 
+inline int32 b2BroadPhase::GetPairCount() const
+{
+	return m_pairCount;
+}
+
 inline int32 b2BroadPhase::GetTreeHeight() const
 {
-	return m_tree.GetHeight();
+	return m_index ? 0 : m_tree.GetHeight();
 }
 
 inline int32 b2BroadPhase::GetTreeBalance() const
 {
-	return m_tree.GetMaxBalance();
+	return m_index ? 0 : m_tree.GetMaxBalance();
 }
 
 inline float32 b2BroadPhase::GetTreeQuality() const
 {
-	return m_tree.GetAreaRatio();
+	return m_index ? 0.0f : m_tree.GetAreaRatio();
 }
 
 template <typename T>
@@ -184,6 +398,18 @@ void b2BroadPhase::UpdatePairs(T* callback)
 	// Reset pair buffer
 	m_pairCount = 0;
 
+	b2BroadPhaseQueryWrapper<b2BroadPhase> wrapper;
+	wrapper.callback = this;
+
+	b2SplitTreeWrapper<b2BroadPhase> staticWrapper;
+	staticWrapper.callback = this;
+	staticWrapper.tag = e_staticProxy;
+
+	if (m_index)
+	{
+		m_index->Flush();
+	}
+
 	// Perform tree queries for all moving proxies.
 	for (int32 i = 0; i < m_moveCount; ++i)
 	{
@@ -195,10 +421,28 @@ void b2BroadPhase::UpdatePairs(T* callback)
 
 		// We have to query the tree with the fat AABB so that
 		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
+		const b2AABB& fatAABB = GetFatAABB(m_queryProxyId);
 
 		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
+		if (m_index)
+		{
+			m_index->Query(&wrapper, fatAABB);
+			continue;
+		}
+
+		// Only visit the proxies this one may collide with.
+		const b2TreeNode& node = (m_queryProxyId & e_staticProxy) ?
+			m_staticTree.GetProxyNode(m_queryProxyId & ~e_staticProxy) : m_tree.GetProxyNode(m_queryProxyId);
+		uint16 categoryBits = node.categoryBits;
+		uint16 maskBits = node.maskBits;
+
+		m_tree.QueryFiltered(this, fatAABB, categoryBits, maskBits);
+
+		if (m_split)
+		{
+			staticWrapper.stopped = 0;
+			m_staticTree.QueryFiltered(&staticWrapper, fatAABB, categoryBits, maskBits);
+		}
 	}
 
 	// Reset move buffer
@@ -212,8 +456,8 @@ void b2BroadPhase::UpdatePairs(T* callback)
 	while (i < m_pairCount)
 	{
 		b2Pair* primaryPair = m_pairBuffer + i;
-		void* userDataA = m_tree.GetUserData(primaryPair->proxyIdA);
-		void* userDataB = m_tree.GetUserData(primaryPair->proxyIdB);
+		void* userDataA = GetUserData(primaryPair->proxyIdA);
+		void* userDataB = GetUserData(primaryPair->proxyIdB);
 
 		callback->AddPair(userDataA, userDataB);
 		++i;
@@ -230,19 +474,118 @@ void b2BroadPhase::UpdatePairs(T* callback)
 		}
 	}
 
-	// Try to keep the tree balanced.
-	//m_tree.Rebalance(4);
+	// Tighten the tree and rebuild it once its quality has degraded.
+	if (m_index == NULL)
+	{
+		m_tree.Optimize();
+	}
+
+	// The static tree rarely changes, so keep it in the compact layout.
+	if (m_split)
+	{
+		m_staticTree.Optimize();
+		if (m_staticTree.IsCompact() == false)
+		{
+			m_staticTree.BuildCompact();
+		}
+	}
 }
 
 template <typename T>
 inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb) const
 {
+	if (m_index)
+	{
+		b2BroadPhaseQueryWrapper<T> wrapper;
+		wrapper.callback = callback;
+		m_index->Query(&wrapper, aabb);
+		return;
+	}
+
+	if (m_split)
+	{
+		b2SplitTreeWrapper<T> wrapper;
+		wrapper.callback = callback;
+		wrapper.tag = e_staticProxy;
+		wrapper.stopped = 0;
+		m_staticTree.Query(&wrapper, aabb);
+		if (wrapper.stopped)
+		{
+			return;
+		}
+	}
+
 	m_tree.Query(callback, aabb);
 }
 
+template <typename T>
+inline void b2BroadPhase::QueryPacket(T* callback, const b2AABB* aabbs, int32 count) const
+{
+	if (m_index)
+	{
+		// The other indices have no packet traversal, so run the lanes one by one.
+		b2BroadPhaseLaneWrapper<T> lane;
+		lane.callback = callback;
+
+		b2BroadPhaseQueryWrapper< b2BroadPhaseLaneWrapper<T> > wrapper;
+		wrapper.callback = &lane;
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			lane.lane = i;
+			m_index->Query(&wrapper, aabbs[i]);
+		}
+		return;
+	}
+
+	if (m_split)
+	{
+		b2SplitTreeWrapper<T> wrapper;
+		wrapper.callback = callback;
+		wrapper.tag = e_staticProxy;
+		wrapper.stopped = 0;
+		m_staticTree.QueryPacket(&wrapper, aabbs, count);
+
+		// Lanes stopped in the static tree stay stopped.
+		wrapper.tag = 0;
+		m_tree.QueryPacket(&wrapper, aabbs, count);
+		return;
+	}
+
+	m_tree.QueryPacket(callback, aabbs, count);
+}
+
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) const
 {
+	if (m_index)
+	{
+		b2BroadPhaseRayCastWrapper<T> wrapper;
+		wrapper.callback = callback;
+		m_index->RayCast(&wrapper, input);
+		return;
+	}
+
+	if (m_split)
+	{
+		// Cast against the static tree first and carry the clipped ray over.
+		b2SplitTreeWrapper<T> wrapper;
+		wrapper.callback = callback;
+		wrapper.tag = e_staticProxy;
+		wrapper.stopped = 0;
+		wrapper.maxFraction = input.maxFraction;
+		m_staticTree.RayCast(&wrapper, input);
+		if (wrapper.stopped)
+		{
+			return;
+		}
+
+		b2RayCastInput subInput = input;
+		subInput.maxFraction = wrapper.maxFraction;
+		m_tree.RayCast(callback, subInput);
+		return;
+	}
+
 	m_tree.RayCast(callback, input);
 }
 
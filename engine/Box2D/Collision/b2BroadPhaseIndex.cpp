@@ -0,0 +1,433 @@
+#include "b2BroadPhaseIndex.h"
+#include "../Common/b2Snapshot.h"
+#include <cstring>
+
+b2BroadPhaseIndex::b2BroadPhaseIndex()
+{
+	m_proxyCapacity = 16;
+	m_proxies = (b2IndexProxy*)b2Alloc(m_proxyCapacity * sizeof(b2IndexProxy));
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		m_proxies[i].next = i + 1;
+		m_proxies[i].allocated = false;
+	}
+	m_proxies[m_proxyCapacity - 1].next = e_nullProxy;
+	m_freeList = 0;
+
+	m_largeCapacity = 16;
+	m_largeCount = 0;
+	m_large = (int32*)b2Alloc(m_largeCapacity * sizeof(int32));
+}
+
+b2BroadPhaseIndex::~b2BroadPhaseIndex()
+{
+	b2Free(m_large);
+	b2Free(m_proxies);
+}
+
+int32 b2BroadPhaseIndex::CreateProxy(const b2AABB& aabb, void* userData)
+{
+	if (m_freeList == e_nullProxy)
+	{
+		b2IndexProxy* oldProxies = m_proxies;
+		int32 oldCapacity = m_proxyCapacity;
+		m_proxyCapacity *= 2;
+		m_proxies = (b2IndexProxy*)b2Alloc(m_proxyCapacity * sizeof(b2IndexProxy));
+		memcpy(m_proxies, oldProxies, oldCapacity * sizeof(b2IndexProxy));
+		b2Free(oldProxies);
+
+		for (int32 i = oldCapacity; i < m_proxyCapacity; ++i)
+		{
+			m_proxies[i].next = i + 1;
+			m_proxies[i].allocated = false;
+		}
+		m_proxies[m_proxyCapacity - 1].next = e_nullProxy;
+		m_freeList = oldCapacity;
+	}
+
+	int32 proxyId = m_freeList;
+	b2IndexProxy* proxy = m_proxies + proxyId;
+	m_freeList = proxy->next;
+
+	// Fatten the aabb.
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	proxy->aabb.lowerBound = aabb.lowerBound - r;
+	proxy->aabb.upperBound = aabb.upperBound + r;
+	proxy->userData = userData;
+	proxy->next = e_nullProxy;
+	proxy->slot = e_nullProxy;
+	proxy->allocated = true;
+	proxy->large = IsLarge(proxy->aabb);
+
+	if (proxy->large)
+	{
+		AddLarge(proxyId);
+	}
+	else
+	{
+		InsertProxy(proxyId);
+	}
+
+	return proxyId;
+}
+
+void b2BroadPhaseIndex::DestroyProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(m_proxies[proxyId].allocated);
+
+	if (m_proxies[proxyId].large)
+	{
+		RemoveLarge(proxyId);
+	}
+	else
+	{
+		RemoveProxy(proxyId);
+	}
+
+	m_proxies[proxyId].allocated = false;
+	m_proxies[proxyId].next = m_freeList;
+	m_freeList = proxyId;
+}
+
+bool b2BroadPhaseIndex::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2IndexProxy* proxy = m_proxies + proxyId;
+	b2Assert(proxy->allocated);
+
+	if (proxy->aabb.Contains(aabb))
+	{
+		return false;
+	}
+
+	// Extend AABB.
+	b2AABB b = aabb;
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	b.lowerBound = b.lowerBound - r;
+	b.upperBound = b.upperBound + r;
+
+	// Predict AABB displacement.
+	b2Vec2 d = b2_aabbMultiplier * displacement;
+
+	if (d.x < 0.0f)
+	{
+		b.lowerBound.x += d.x;
+	}
+	else
+	{
+		b.upperBound.x += d.x;
+	}
+
+	if (d.y < 0.0f)
+	{
+		b.lowerBound.y += d.y;
+	}
+	else
+	{
+		b.upperBound.y += d.y;
+	}
+
+	b2AABB oldAABB = proxy->aabb;
+	bool wasLarge = proxy->large;
+	bool large = IsLarge(b);
+
+	if (wasLarge && large)
+	{
+		proxy->aabb = b;
+	}
+	else if (wasLarge)
+	{
+		RemoveLarge(proxyId);
+		proxy->aabb = b;
+		proxy->large = false;
+		InsertProxy(proxyId);
+	}
+	else if (large)
+	{
+		RemoveProxy(proxyId);
+		proxy->aabb = b;
+		proxy->large = true;
+		AddLarge(proxyId);
+	}
+	else
+	{
+		proxy->aabb = b;
+		UpdateProxy(proxyId, oldAABB);
+	}
+
+	return true;
+}
+
+void b2BroadPhaseIndex::Query(b2BroadPhaseQueryCallback* callback, const b2AABB& aabb) const
+{
+	if (QueryProxies(callback, aabb) == false)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < m_largeCount; ++i)
+	{
+		int32 proxyId = m_large[i];
+		if (b2TestOverlap(m_proxies[proxyId].aabb, aabb))
+		{
+			if (callback->QueryCallback(proxyId) == false)
+			{
+				return;
+			}
+		}
+	}
+}
+
+// Clips the ray against each proxy the segment bounds overlap. The candidates
+// come from a single query over the initial segment, so they are tested again
+// against the clipped segment before they are reported.
+class b2IndexRayCastWrapper : public b2BroadPhaseQueryCallback
+{
+public:
+	bool QueryCallback(int32 proxyId)
+	{
+		const b2AABB& aabb = index->GetFatAABB(proxyId);
+		if (b2TestOverlap(aabb, segmentAABB) == false)
+		{
+			return true;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2Vec2 c = aabb.GetCenter();
+		b2Vec2 h = aabb.GetExtents();
+		float32 separation = b2Abs(b2Dot(v, input.p1 - c)) - b2Dot(abs_v, h);
+		if (separation > 0.0f)
+		{
+			return true;
+		}
+
+		b2RayCastInput subInput;
+		subInput.p1 = input.p1;
+		subInput.p2 = input.p2;
+		subInput.maxFraction = maxFraction;
+
+		float32 value = callback->RayCastCallback(subInput, proxyId);
+
+		if (value == 0.0f)
+		{
+			// The client has terminated the ray cast.
+			return false;
+		}
+
+		if (value > 0.0f)
+		{
+			// Update segment bounding box.
+			maxFraction = value;
+			b2Vec2 t = input.p1 + maxFraction * (input.p2 - input.p1);
+			segmentAABB.lowerBound = b2Min(input.p1, t);
+			segmentAABB.upperBound = b2Max(input.p1, t);
+		}
+
+		return true;
+	}
+
+	const b2BroadPhaseIndex* index;
+	b2BroadPhaseRayCastCallback* callback;
+	b2RayCastInput input;
+	b2Vec2 v;
+	b2Vec2 abs_v;
+	float32 maxFraction;
+	b2AABB segmentAABB;
+};
+
+void b2BroadPhaseIndex::RayCast(b2BroadPhaseRayCastCallback* callback, const b2RayCastInput& input) const
+{
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	b2IndexRayCastWrapper wrapper;
+	wrapper.index = this;
+	wrapper.callback = callback;
+	wrapper.input = input;
+
+	// v is perpendicular to the segment.
+	wrapper.v = b2Cross(1.0f, r);
+	wrapper.abs_v = b2Abs(wrapper.v);
+	wrapper.maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2Vec2 t = p1 + input.maxFraction * (p2 - p1);
+	wrapper.segmentAABB.lowerBound = b2Min(p1, t);
+	wrapper.segmentAABB.upperBound = b2Max(p1, t);
+
+	b2AABB segmentAABB = wrapper.segmentAABB;
+	Query(&wrapper, segmentAABB);
+}
+
+void b2BroadPhaseIndex::AddLarge(int32 proxyId)
+{
+	if (m_largeCount == m_largeCapacity)
+	{
+		int32* oldLarge = m_large;
+		m_largeCapacity *= 2;
+		m_large = (int32*)b2Alloc(m_largeCapacity * sizeof(int32));
+		memcpy(m_large, oldLarge, m_largeCount * sizeof(int32));
+		b2Free(oldLarge);
+	}
+
+	m_proxies[proxyId].slot = m_largeCount;
+	m_large[m_largeCount] = proxyId;
+	++m_largeCount;
+}
+
+void b2BroadPhaseIndex::RemoveLarge(int32 proxyId)
+{
+	int32 slot = m_proxies[proxyId].slot;
+	b2Assert(0 <= slot && slot < m_largeCount && m_large[slot] == proxyId);
+
+	--m_largeCount;
+	m_large[slot] = m_large[m_largeCount];
+	m_proxies[m_large[slot]].slot = slot;
+	m_proxies[proxyId].slot = e_nullProxy;
+}
+
+int32 b2BroadPhaseIndex::GetProxyCount() const
+{
+	int32 count = 0;
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		if (m_proxies[i].allocated)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+void b2BroadPhaseIndex::WriteSnapshot(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_proxyCapacity);
+	snapshot->Write(m_freeList);
+	snapshot->Write(m_proxies, m_proxyCapacity * sizeof(b2IndexProxy));
+	snapshot->Write(m_largeCount);
+	snapshot->Write(m_large, m_largeCount * sizeof(int32));
+}
+
+bool b2BroadPhaseIndex::ReadSnapshot(b2SnapshotReader* reader)
+{
+	int32 capacity, freeList;
+	reader->Read(&capacity);
+	reader->Read(&freeList);
+	if (reader->IsValid() == false || capacity <= 0 || freeList < e_nullProxy || freeList >= capacity ||
+		capacity > reader->GetRemainingSize() / (int32)sizeof(b2IndexProxy))
+	{
+		reader->Invalidate();
+		return false;
+	}
+
+	if (capacity != m_proxyCapacity)
+	{
+		b2Free(m_proxies);
+		m_proxyCapacity = capacity;
+		m_proxies = (b2IndexProxy*)b2Alloc(m_proxyCapacity * sizeof(b2IndexProxy));
+	}
+
+	m_freeList = freeList;
+	reader->Read(m_proxies, m_proxyCapacity * sizeof(b2IndexProxy));
+
+	int32 largeCount;
+	reader->Read(&largeCount);
+	if (reader->IsValid() == false || largeCount < 0 || largeCount > m_proxyCapacity)
+	{
+		reader->Invalidate();
+		return false;
+	}
+
+	if (largeCount > m_largeCapacity)
+	{
+		b2Free(m_large);
+		m_largeCapacity = largeCount;
+		m_large = (int32*)b2Alloc(m_largeCapacity * sizeof(int32));
+	}
+
+	m_largeCount = largeCount;
+	reader->Read(m_large, m_largeCount * sizeof(int32));
+	if (reader->IsValid() == false)
+	{
+		return false;
+	}
+
+	// The flags were read as raw bytes.
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		b2IndexProxy* proxy = m_proxies + i;
+		uint8 allocated, large;
+		memcpy(&allocated, &proxy->allocated, sizeof(uint8));
+		memcpy(&large, &proxy->large, sizeof(uint8));
+		proxy->allocated = allocated != 0;
+		proxy->large = large != 0;
+	}
+
+	// Each large proxy must be in the large list once, at its own slot.
+	for (int32 i = 0; i < m_largeCount; ++i)
+	{
+		int32 proxyId = m_large[i];
+		if (IsProxyValid(proxyId) == false || m_proxies[proxyId].large == false || m_proxies[proxyId].slot != i)
+		{
+			reader->Invalidate();
+			return false;
+		}
+	}
+
+	// Every free proxy must be on the free list. A cycle runs past the capacity.
+	int32 freeCount = 0;
+	for (int32 proxyId = m_freeList; proxyId != e_nullProxy; proxyId = m_proxies[proxyId].next)
+	{
+		if (proxyId < 0 || proxyId >= m_proxyCapacity || m_proxies[proxyId].allocated || freeCount == m_proxyCapacity)
+		{
+			reader->Invalidate();
+			return false;
+		}
+		++freeCount;
+	}
+
+	int32 largeProxyCount = 0;
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		const b2IndexProxy* proxy = m_proxies + i;
+		if (proxy->allocated == false)
+		{
+			continue;
+		}
+
+		// The storage is rebuilt from the AABB, so it must be sane and agree with the large flag.
+		if (proxy->aabb.IsValid() == false || proxy->large != IsLarge(proxy->aabb))
+		{
+			reader->Invalidate();
+			return false;
+		}
+
+		if (proxy->large)
+		{
+			++largeProxyCount;
+		}
+	}
+
+	if (largeProxyCount != m_largeCount || freeCount + GetProxyCount() != m_proxyCapacity)
+	{
+		reader->Invalidate();
+		return false;
+	}
+
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		b2IndexProxy* proxy = m_proxies + i;
+		proxy->userData = NULL;
+		if (proxy->allocated && proxy->large == false)
+		{
+			InsertProxy(i);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,166 @@
+#ifndef B2_BROAD_PHASE_INDEX_H
+#define B2_BROAD_PHASE_INDEX_H
+
+#include "../Common/b2Settings.h"
+#include "../Collision/b2Collision.h"
+
+class b2Snapshot;
+class b2SnapshotReader;
+
+/// The spatial structure used by b2BroadPhase.
+enum b2BroadPhaseType
+{
+	b2_dynamicTreeBroadPhase = 0,
+	b2_sweepAndPruneBroadPhase,
+	b2_uniformGridBroadPhase,
+
+	/// A dynamic tree for moving proxies and a second tree for static proxies. The
+	/// static tree is kept in the compact 4-wide layout, which speeds up traversal
+	/// of large static level geometry.
+	b2_splitTreeBroadPhase
+};
+
+/// Called for each proxy found by b2BroadPhaseIndex::Query.
+class b2BroadPhaseQueryCallback
+{
+public:
+	virtual ~b2BroadPhaseQueryCallback() {}
+
+	/// Return false to terminate the query.
+	virtual bool QueryCallback(int32 proxyId) = 0;
+};
+
+/// Called for each proxy found by b2BroadPhaseIndex::RayCast. This follows
+/// the b2DynamicTree ray-cast callback rules: return 0 to terminate, a
+/// positive fraction to clip the ray or a negative value to ignore the proxy.
+class b2BroadPhaseRayCastCallback
+{
+public:
+	virtual ~b2BroadPhaseRayCastCallback() {}
+
+	virtual float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId) = 0;
+};
+
+/// A spatial index b2BroadPhase can use in place of b2DynamicTree. Proxies are
+/// fattened exactly like tree proxies, so the contact manager sees the same
+/// pairs. Proxies the index reports as large are kept in a flat list that
+/// every query checks, which keeps a few big shapes (like the ground) from
+/// degrading the index for everything else.
+class b2BroadPhaseIndex
+{
+public:
+
+	enum
+	{
+		e_nullProxy = -1
+	};
+
+	b2BroadPhaseIndex();
+	virtual ~b2BroadPhaseIndex();
+
+	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	/// Destroy a proxy.
+	void DestroyProxy(int32 proxyId);
+
+	/// Move a proxy with a swepted AABB. If the proxy has moved outside of its fattened AABB,
+	/// then the proxy is updated in the index and this returns true.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
+
+	/// Get proxy user data.
+	void* GetUserData(int32 proxyId) const;
+
+	/// Get the fat AABB for a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Set the user data of a proxy.
+	void SetUserData(int32 proxyId, void* userData);
+
+	/// Does this id refer to a proxy in the index? Used to check ids read from a snapshot.
+	bool IsProxyValid(int32 proxyId) const;
+
+	/// Get the number of proxies. This scans the proxy pool.
+	int32 GetProxyCount() const;
+
+	/// Write the proxies to a snapshot. User data is not written.
+	void WriteSnapshot(b2Snapshot* snapshot) const;
+
+	/// Load proxies written by WriteSnapshot into an empty index. Proxy ids are
+	/// preserved and the index storage is rebuilt by inserting the proxies in id
+	/// order. User data is cleared and must be set again with SetUserData.
+	/// @return false if the data is malformed.
+	bool ReadSnapshot(b2SnapshotReader* reader);
+
+	/// Called by the broad-phase before it computes pairs. Implementations can
+	/// use this to fold in deferred work.
+	virtual void Flush() {}
+
+	/// Report every proxy whose fat AABB overlaps the supplied AABB.
+	void Query(b2BroadPhaseQueryCallback* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the proxies. The ray extends from p1 to p1 + maxFraction * (p2 - p1).
+	void RayCast(b2BroadPhaseRayCastCallback* callback, const b2RayCastInput& input) const;
+
+protected:
+
+	struct b2IndexProxy
+	{
+		b2AABB aabb;
+		void* userData;
+		int32 next;		// free list
+		int32 slot;		// position in the large list or the implementation's storage
+		bool allocated;
+		bool large;
+	};
+
+	/// Should this fat AABB bypass the index?
+	virtual bool IsLarge(const b2AABB& aabb) const = 0;
+
+	/// Add, remove or update a proxy that is not large. UpdateProxy is called
+	/// after the proxy AABB has changed.
+	virtual void InsertProxy(int32 proxyId) = 0;
+	virtual void RemoveProxy(int32 proxyId) = 0;
+	virtual void UpdateProxy(int32 proxyId, const b2AABB& oldAABB) = 0;
+
+	/// Query the proxies that are not large. Return false if the callback terminated the query.
+	virtual bool QueryProxies(b2BroadPhaseQueryCallback* callback, const b2AABB& aabb) const = 0;
+
+	b2IndexProxy* m_proxies;
+	int32 m_proxyCapacity;
+	int32 m_freeList;
+
+private:
+
+	void AddLarge(int32 proxyId);
+	void RemoveLarge(int32 proxyId);
+
+	int32* m_large;
+	int32 m_largeCount;
+	int32 m_largeCapacity;
+};
+
+inline void* b2BroadPhaseIndex::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
+}
+
+inline void b2BroadPhaseIndex::SetUserData(int32 proxyId, void* userData)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	m_proxies[proxyId].userData = userData;
+}
+
+inline const b2AABB& b2BroadPhaseIndex::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].aabb;
+}
+
+inline bool b2BroadPhaseIndex::IsProxyValid(int32 proxyId) const
+{
+	return 0 <= proxyId && proxyId < m_proxyCapacity && m_proxies[proxyId].allocated;
+}
+
+#endif
@@ -17,6 +17,7 @@
 */
 
 #include "b2Collision.h"
+#include "b2SimdKernels.h"
 #include "Shapes/b2CircleShape.h"
 #include "Shapes/b2PolygonShape.h"
 
@@ -60,28 +61,17 @@ void b2CollidePolygonAndCircle(
 	b2Vec2 cLocal = b2MulT(xfA, c);
 
 	// Find the min separating edge.
-	int32 normalIndex = 0;
-	float32 separation = -b2_maxFloat;
+	float32 separation;
 	float32 radius = polygonA->m_radius + circleB->m_radius;
 	int32 vertexCount = polygonA->m_vertexCount;
 	const b2Vec2* vertices = polygonA->m_vertices;
 	const b2Vec2* normals = polygonA->m_normals;
 
-	for (int32 i = 0; i < vertexCount; ++i)
+	int32 normalIndex = b2FindMaxPlaneSeparation(vertices, normals, vertexCount, cLocal, &separation);
+	if (separation > radius)
 	{
-		float32 s = b2Dot(normals[i], cLocal - vertices[i]);
-
-		if (s > radius)
-		{
-			// Early out.
-			return;
-		}
-
-		if (s > separation)
-		{
-			separation = s;
-			normalIndex = i;
-		}
+		// Early out.
+		return;
 	}
 
 	// Vertices that subtend the incident face.
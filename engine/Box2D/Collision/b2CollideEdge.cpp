@@ -17,6 +17,7 @@
  */
 
 #include "b2Collision.h"
+#include "b2SimdKernels.h"
 #include "Shapes/b2CircleShape.h"
 #include "Shapes/b2EdgeShape.h"
 #include "Shapes/b2PolygonShape.h"
@@ -622,17 +623,7 @@ b2EPAxis b2EPCollider::ComputeEdgeSeparation()
 	b2EPAxis axis;
 	axis.type = b2EPAxis::e_edgeA;
 	axis.index = m_front ? 0 : 1;
-	axis.separation = FLT_MAX;
-	
-	for (int32 i = 0; i < m_polygonB.count; ++i)
-	{
-		float32 s = b2Dot(m_normal, m_polygonB.vertices[i] - m_v1);
-		if (s < axis.separation)
-		{
-			axis.separation = s;
-		}
-	}
-	
+	axis.separation = b2MinSeparation(m_polygonB.vertices, m_polygonB.count, m_normal, m_v1);
 	return axis;
 }
 
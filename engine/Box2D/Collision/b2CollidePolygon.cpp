@@ -17,8 +17,26 @@
 */
 
 #include "b2Collision.h"
+#include "b2SimdKernels.h"
 #include "Shapes/b2PolygonShape.h"
 
+#if defined(B2_SIMD_COLLISION)
+
+// Find the max separation between poly1 and poly2 using edge normals from poly1.
+// All edges are tested in SIMD lanes instead of climbing from the edge facing poly2.
+static float32 b2FindMaxSeparation(int32* edgeIndex,
+								 const b2PolygonShape* poly1, const b2Transform& xf1,
+								 const b2PolygonShape* poly2, const b2Transform& xf2)
+{
+	float32 separation;
+	*edgeIndex = b2FindMaxEdgeSeparation(&separation,
+										 poly1->m_vertices, poly1->m_normals, poly1->m_vertexCount,
+										 poly2->m_vertices, poly2->m_vertexCount, b2MulT(xf1, xf2));
+	return separation;
+}
+
+#else
+
 // Find the separation between poly1 and poly2 for a give edge normal on poly1.
 static float32 b2EdgeSeparation(const b2PolygonShape* poly1, const b2Transform& xf1, int32 edge1,
 							  const b2PolygonShape* poly2, const b2Transform& xf2)
@@ -36,18 +54,7 @@ static float32 b2EdgeSeparation(const b2PolygonShape* poly1, const b2Transform&
 	b2Vec2 normal1 = b2MulT(xf2.q, normal1World);
 
 	// Find support vertex on poly2 for -normal.
-	int32 index = 0;
-	float32 minDot = b2_maxFloat;
-
-	for (int32 i = 0; i < count2; ++i)
-	{
-		float32 dot = b2Dot(vertices2[i], normal1);
-		if (dot < minDot)
-		{
-			minDot = dot;
-			index = i;
-		}
-	}
+	int32 index = b2FindMinDot(vertices2, count2, normal1);
 
 	b2Vec2 v1 = b2Mul(xf1, vertices1[edge1]);
 	b2Vec2 v2 = b2Mul(xf2, vertices2[index]);
@@ -68,17 +75,7 @@ static float32 b2FindMaxSeparation(int32* edgeIndex,
 	b2Vec2 dLocal1 = b2MulT(xf1.q, d);
 
 	// Find edge normal on poly1 that has the largest projection onto d.
-	int32 edge = 0;
-	float32 maxDot = -b2_maxFloat;
-	for (int32 i = 0; i < count1; ++i)
-	{
-		float32 dot = b2Dot(normals1[i], dLocal1);
-		if (dot > maxDot)
-		{
-			maxDot = dot;
-			edge = i;
-		}
-	}
+	int32 edge = b2FindMaxDot(normals1, count1, dLocal1);
 
 	// Get the separation for the edge normal.
 	float32 s = b2EdgeSeparation(poly1, xf1, edge, poly2, xf2);
@@ -138,6 +135,8 @@ static float32 b2FindMaxSeparation(int32* edgeIndex,
 	return bestSeparation;
 }
 
+#endif
+
 static void b2FindIncidentEdge(b2ClipVertex c[2],
 							 const b2PolygonShape* poly1, const b2Transform& xf1, int32 edge1,
 							 const b2PolygonShape* poly2, const b2Transform& xf2)
@@ -154,17 +153,7 @@ static void b2FindIncidentEdge(b2ClipVertex c[2],
 	b2Vec2 normal1 = b2MulT(xf2.q, b2Mul(xf1.q, normals1[edge1]));
 
 	// Find the incident edge on poly2.
-	int32 index = 0;
-	float32 minDot = b2_maxFloat;
-	for (int32 i = 0; i < count2; ++i)
-	{
-		float32 dot = b2Dot(normal1, normals2[i]);
-		if (dot < minDot)
-		{
-			minDot = dot;
-			index = i;
-		}
-	}
+	int32 index = b2FindMinDot(normals2, count2, normal1);
 
 	// Build the clip vertices for the incident edge.
 	int32 i1 = index;
@@ -21,10 +21,37 @@
 #include "Shapes/b2EdgeShape.h"
 #include "Shapes/b2ChainShape.h"
 #include "Shapes/b2PolygonShape.h"
+#include "../Common/b2Parallel.h"
 
 // GJK using Voronoi regions (Christer Ericson) and Barycentric coordinates.
 int32 b2_gjkCalls, b2_gjkIters, b2_gjkMaxIters;
 
+// The statistics gathered by each worker of a b2ParallelFor dispatch, padded
+// to a cache line so the workers don't share one.
+struct b2GJKStats
+{
+	int32 calls;
+	int32 iters;
+	int32 maxIters;
+	int32 padding[13];
+};
+
+static b2GJKStats s_gjkStats[b2_maxWorkers];
+
+void b2MergeGJKStats()
+{
+	for (int32 i = 0; i < b2_maxWorkers; ++i)
+	{
+		b2GJKStats* stats = s_gjkStats + i;
+		b2_gjkCalls += stats->calls;
+		b2_gjkIters += stats->iters;
+		b2_gjkMaxIters = b2Max(b2_gjkMaxIters, stats->maxIters);
+		stats->calls = 0;
+		stats->iters = 0;
+		stats->maxIters = 0;
+	}
+}
+
 void b2DistanceProxy::Set(const b2Shape* shape, int32 index)
 {
 	switch (shape->GetType())
@@ -444,8 +471,6 @@ void b2Distance(b2DistanceOutput* output,
 				b2SimplexCache* cache,
 				const b2DistanceInput* input)
 {
-	++b2_gjkCalls;
-
 	const b2DistanceProxy* proxyA = &input->proxyA;
 	const b2DistanceProxy* proxyB = &input->proxyB;
 
@@ -541,7 +566,6 @@ void b2Distance(b2DistanceOutput* output,
 
 		// Iteration count is equated to the number of support point calls.
 		++iter;
-		++b2_gjkIters;
 
 		// Check for duplicate support points. This is the main termination criteria.
 		bool duplicate = false;
@@ -564,7 +588,21 @@ void b2Distance(b2DistanceOutput* output,
 		++simplex.m_count;
 	}
 
-	b2_gjkMaxIters = b2Max(b2_gjkMaxIters, iter);
+	// Workers running b2ParallelFor tasks keep their own statistics.
+	int32 worker = b2GetWorkerIndex();
+	if (worker < 0)
+	{
+		++b2_gjkCalls;
+		b2_gjkIters += iter;
+		b2_gjkMaxIters = b2Max(b2_gjkMaxIters, iter);
+	}
+	else
+	{
+		b2GJKStats* stats = s_gjkStats + worker;
+		++stats->calls;
+		stats->iters += iter;
+		stats->maxIters = b2Max(stats->maxIters, iter);
+	}
 
 	// Prepare output.
 	simplex.GetWitnessPoints(&output->pointA, &output->pointB);
@@ -21,6 +21,7 @@
 #define B2_DISTANCE_H
 
 #include "../Common/b2Math.h"
+#include "b2SimdKernels.h"
 
 class b2Shape;
 
@@ -90,6 +91,10 @@ void b2Distance(b2DistanceOutput* output,
 				b2SimplexCache* cache, 
 				const b2DistanceInput* input);
 
+/// Add the GJK statistics gathered by the b2ParallelFor workers into b2_gjkCalls,
+/// b2_gjkIters and b2_gjkMaxIters. b2ParallelFor calls this after each dispatch.
+void b2MergeGJKStats();
+
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -106,36 +111,12 @@ inline const b2Vec2& b2DistanceProxy::GetVertex(int32 index) const
 
 inline int32 b2DistanceProxy::GetSupport(const b2Vec2& d) const
 {
-	int32 bestIndex = 0;
-	float32 bestValue = b2Dot(m_vertices[0], d);
-	for (int32 i = 1; i < m_count; ++i)
-	{
-		float32 value = b2Dot(m_vertices[i], d);
-		if (value > bestValue)
-		{
-			bestIndex = i;
-			bestValue = value;
-		}
-	}
-
-	return bestIndex;
+	return b2FindMaxDot(m_vertices, m_count, d);
 }
 
 inline const b2Vec2& b2DistanceProxy::GetSupportVertex(const b2Vec2& d) const
 {
-	int32 bestIndex = 0;
-	float32 bestValue = b2Dot(m_vertices[0], d);
-	for (int32 i = 1; i < m_count; ++i)
-	{
-		float32 value = b2Dot(m_vertices[i], d);
-		if (value > bestValue)
-		{
-			bestIndex = i;
-			bestValue = value;
-		}
-	}
-
-	return m_vertices[bestIndex];
+	return m_vertices[b2FindMaxDot(m_vertices, m_count, d)];
 }
 
 #endif
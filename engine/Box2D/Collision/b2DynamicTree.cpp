@@ -17,6 +17,7 @@
 */
 
 #include "b2DynamicTree.h"
+#include "../Common/b2Snapshot.h"
 #include <cstring>
 #include <cfloat>
 using namespace std;
@@ -44,12 +45,32 @@ b2DynamicTree::b2DynamicTree()
 	m_path = 0;
 
 	m_insertionCount = 0;
+
+	m_changeCount = 0;
+	m_baseAreaRatio = 0.0f;
+
+	m_compactNodes = NULL;
+	m_compactRoot = b2_nullNode;
+	m_compactCount = 0;
+	m_compactCapacity = 0;
 }
 
 b2DynamicTree::~b2DynamicTree()
 {
 	// This frees the entire tree in one shot.
 	b2Free(m_nodes);
+
+	if (m_compactNodes)
+	{
+		b2Free(m_compactNodes);
+	}
+}
+
+// Give an internal node the union of the filter bits below it.
+static inline void b2CombineFilters(b2TreeNode* node, const b2TreeNode* child1, const b2TreeNode* child2)
+{
+	node->categoryBits = child1->categoryBits | child2->categoryBits;
+	node->maskBits = child1->maskBits | child2->maskBits;
 }
 
 // Allocate a node from the pool. Grow the pool if necessary.
@@ -87,6 +108,8 @@ int32 b2DynamicTree::AllocateNode()
 	m_nodes[nodeId].child2 = b2_nullNode;
 	m_nodes[nodeId].height = 0;
 	m_nodes[nodeId].userData = NULL;
+	m_nodes[nodeId].categoryBits = 0xFFFF;
+	m_nodes[nodeId].maskBits = 0xFFFF;
 	++m_nodeCount;
 	return nodeId;
 }
@@ -105,7 +128,7 @@ void b2DynamicTree::FreeNode(int32 nodeId)
 // Create a proxy in the tree as a leaf node. We return the index
 // of the node instead of a pointer so that we can grow
 // the node pool.
-int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
+int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData, uint16 categoryBits, uint16 maskBits)
 {
 	int32 proxyId = AllocateNode();
 
@@ -115,12 +138,59 @@ int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 	m_nodes[proxyId].aabb.upperBound = aabb.upperBound + r;
 	m_nodes[proxyId].userData = userData;
 	m_nodes[proxyId].height = 0;
+	m_nodes[proxyId].categoryBits = categoryBits;
+	m_nodes[proxyId].maskBits = maskBits;
 
 	InsertLeaf(proxyId);
+	++m_changeCount;
 
 	return proxyId;
 }
 
+void b2DynamicTree::CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds,
+								  const uint16* categoryBits, const uint16* maskBits)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	int32 leafCount = m_root == b2_nullNode ? 0 : (m_nodeCount + 1) / 2;
+
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 proxyId = AllocateNode();
+		m_nodes[proxyId].aabb.lowerBound = aabbs[i].lowerBound - r;
+		m_nodes[proxyId].aabb.upperBound = aabbs[i].upperBound + r;
+		m_nodes[proxyId].userData = userData[i];
+		m_nodes[proxyId].height = 0;
+		if (categoryBits)
+		{
+			m_nodes[proxyId].categoryBits = categoryBits[i];
+			m_nodes[proxyId].maskBits = maskBits[i];
+		}
+		proxyIds[i] = proxyId;
+	}
+
+	// A small batch goes in like single proxies. Otherwise the rebuild picks up
+	// the new leaves along with the old ones and gives a better tree for less.
+	if (count < leafCount)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			InsertLeaf(proxyIds[i]);
+		}
+
+		m_changeCount += count;
+		return;
+	}
+
+	RebuildTopDown();
+	m_baseAreaRatio = GetAreaRatio();
+	m_changeCount = 0;
+}
+
 void b2DynamicTree::DestroyProxy(int32 proxyId)
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
@@ -141,8 +211,6 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		return false;
 	}
 
-	RemoveLeaf(proxyId);
-
 	// Extend AABB.
 	b2AABB b = aabb;
 	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
@@ -170,15 +238,49 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		b.upperBound.y += d.y;
 	}
 
+	++m_changeCount;
+
+	// If the parent still holds the new AABB the tree stays valid without
+	// restructuring. The ancestors are tightened by the next Refit.
+	int32 parent = m_nodes[proxyId].parent;
+	if (parent != b2_nullNode && m_nodes[parent].aabb.Contains(b))
+	{
+		m_nodes[proxyId].aabb = b;
+		m_compactRoot = b2_nullNode;
+		return true;
+	}
+
+	RemoveLeaf(proxyId);
+
 	m_nodes[proxyId].aabb = b;
 
 	InsertLeaf(proxyId);
 	return true;
 }
 
+void b2DynamicTree::SetProxyFilter(int32 proxyId, uint16 categoryBits, uint16 maskBits)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+
+	m_nodes[proxyId].categoryBits = categoryBits;
+	m_nodes[proxyId].maskBits = maskBits;
+	m_compactRoot = b2_nullNode;
+
+	// Bits may have been removed, so the ancestors are recomputed rather than merged.
+	int32 index = m_nodes[proxyId].parent;
+	while (index != b2_nullNode)
+	{
+		b2TreeNode* node = m_nodes + index;
+		b2CombineFilters(node, m_nodes + node->child1, m_nodes + node->child2);
+		index = node->parent;
+	}
+}
+
 void b2DynamicTree::InsertLeaf(int32 leaf)
 {
 	++m_insertionCount;
+	m_compactRoot = b2_nullNode;
 
 	if (m_root == b2_nullNode)
 	{
@@ -309,6 +411,7 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 
 		m_nodes[index].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
 		m_nodes[index].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+		b2CombineFilters(m_nodes + index, m_nodes + child1, m_nodes + child2);
 
 		index = m_nodes[index].parent;
 	}
@@ -318,6 +421,8 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 
 void b2DynamicTree::RemoveLeaf(int32 leaf)
 {
+	m_compactRoot = b2_nullNode;
+
 	if (leaf == m_root)
 	{
 		m_root = b2_nullNode;
@@ -360,6 +465,7 @@ void b2DynamicTree::RemoveLeaf(int32 leaf)
 			int32 child2 = m_nodes[index].child2;
 
 			m_nodes[index].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+			b2CombineFilters(m_nodes + index, m_nodes + child1, m_nodes + child2);
 			m_nodes[index].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
 
 			index = m_nodes[index].parent;
@@ -437,7 +543,9 @@ int32 b2DynamicTree::Balance(int32 iA)
 			A->child2 = iG;
 			G->parent = iA;
 			A->aabb.Combine(B->aabb, G->aabb);
+			b2CombineFilters(A, B, G);
 			C->aabb.Combine(A->aabb, F->aabb);
+			b2CombineFilters(C, A, F);
 
 			A->height = 1 + b2Max(B->height, G->height);
 			C->height = 1 + b2Max(A->height, F->height);
@@ -448,7 +556,9 @@ int32 b2DynamicTree::Balance(int32 iA)
 			A->child2 = iF;
 			F->parent = iA;
 			A->aabb.Combine(B->aabb, F->aabb);
+			b2CombineFilters(A, B, F);
 			C->aabb.Combine(A->aabb, G->aabb);
+			b2CombineFilters(C, A, G);
 
 			A->height = 1 + b2Max(B->height, F->height);
 			C->height = 1 + b2Max(A->height, G->height);
@@ -497,7 +607,9 @@ int32 b2DynamicTree::Balance(int32 iA)
 			A->child1 = iE;
 			E->parent = iA;
 			A->aabb.Combine(C->aabb, E->aabb);
+			b2CombineFilters(A, C, E);
 			B->aabb.Combine(A->aabb, D->aabb);
+			b2CombineFilters(B, A, D);
 
 			A->height = 1 + b2Max(C->height, E->height);
 			B->height = 1 + b2Max(A->height, D->height);
@@ -508,7 +620,9 @@ int32 b2DynamicTree::Balance(int32 iA)
 			A->child1 = iD;
 			D->parent = iA;
 			A->aabb.Combine(C->aabb, D->aabb);
+			b2CombineFilters(A, C, D);
 			B->aabb.Combine(A->aabb, E->aabb);
+			b2CombineFilters(B, A, E);
 
 			A->height = 1 + b2Max(C->height, D->height);
 			B->height = 1 + b2Max(A->height, E->height);
@@ -643,11 +757,13 @@ void b2DynamicTree::ValidateMetrics(int32 index) const
 	height = 1 + b2Max(height1, height2);
 	b2Assert(node->height == height);
 
+	// Leaves moved in place may leave the ancestors loose until the next refit.
 	b2AABB aabb;
 	aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
 
-	b2Assert(aabb.lowerBound == node->aabb.lowerBound);
-	b2Assert(aabb.upperBound == node->aabb.upperBound);
+	b2Assert(node->aabb.Contains(aabb));
+	b2Assert(node->categoryBits == (m_nodes[child1].categoryBits | m_nodes[child2].categoryBits));
+	b2Assert(node->maskBits == (m_nodes[child1].maskBits | m_nodes[child2].maskBits));
 
 	ValidateMetrics(child1);
 	ValidateMetrics(child2);
@@ -672,6 +788,93 @@ void b2DynamicTree::Validate() const
 	b2Assert(m_nodeCount + freeCount == m_nodeCapacity);
 }
 
+// Check the links of a tree read from a snapshot without asserting. Every node
+// must be reached exactly once, either from the root or from the free list, so
+// broken child, parent and free list indices and cycles are all rejected.
+bool b2DynamicTree::IsStructureValid() const
+{
+	char* reached = (char*)b2Alloc(m_nodeCapacity);
+	memset(reached, 0, m_nodeCapacity);
+
+	bool valid = m_root == b2_nullNode || m_nodes[m_root].parent == b2_nullNode;
+	int32 reachedCount = 0;
+
+	b2GrowableStack<int32, 256> stack;
+	if (m_root != b2_nullNode)
+	{
+		stack.Push(m_root);
+	}
+
+	while (valid && stack.GetCount() > 0)
+	{
+		int32 index = stack.Pop();
+		if (reached[index])
+		{
+			valid = false;
+			break;
+		}
+
+		reached[index] = 1;
+		++reachedCount;
+
+		const b2TreeNode* node = m_nodes + index;
+		if (node->IsLeaf())
+		{
+			valid = node->child2 == b2_nullNode && node->height == 0 && node->aabb.IsValid();
+			continue;
+		}
+
+		int32 child1 = node->child1;
+		int32 child2 = node->child2;
+		if (child1 < 0 || child1 >= m_nodeCapacity || child2 < 0 || child2 >= m_nodeCapacity)
+		{
+			valid = false;
+			break;
+		}
+
+		const b2TreeNode* node1 = m_nodes + child1;
+		const b2TreeNode* node2 = m_nodes + child2;
+		valid = node1->parent == index && node2->parent == index &&
+			node->height == 1 + b2Max(node1->height, node2->height) &&
+			node->aabb.Contains(node1->aabb) && node->aabb.Contains(node2->aabb);
+
+		stack.Push(child1);
+		stack.Push(child2);
+	}
+
+	int32 freeCount = 0;
+	int32 freeIndex = m_freeList;
+	while (valid && freeIndex != b2_nullNode)
+	{
+		if (freeIndex < 0 || freeIndex >= m_nodeCapacity || reached[freeIndex] || m_nodes[freeIndex].height != -1)
+		{
+			valid = false;
+			break;
+		}
+
+		reached[freeIndex] = 1;
+		++freeCount;
+		freeIndex = m_nodes[freeIndex].next;
+	}
+
+	b2Free(reached);
+
+	return valid && reachedCount == m_nodeCount && reachedCount + freeCount == m_nodeCapacity;
+}
+
+int32 b2DynamicTree::GetProxyCount() const
+{
+	int32 count = 0;
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height == 0)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
 int32 b2DynamicTree::GetMaxBalance() const
 {
 	int32 maxBalance = 0;
@@ -696,6 +899,8 @@ int32 b2DynamicTree::GetMaxBalance() const
 
 void b2DynamicTree::RebuildBottomUp()
 {
+	m_compactRoot = b2_nullNode;
+
 	int32* nodes = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
 	int32 count = 0;
 
@@ -754,6 +959,7 @@ void b2DynamicTree::RebuildBottomUp()
 		parent->child2 = index2;
 		parent->height = 1 + b2Max(child1->height, child2->height);
 		parent->aabb.Combine(child1->aabb, child2->aabb);
+		b2CombineFilters(parent, child1, child2);
 		parent->parent = b2_nullNode;
 
 		child1->parent = parentIndex;
@@ -769,3 +975,446 @@ void b2DynamicTree::RebuildBottomUp()
 
 	Validate();
 }
+
+void b2DynamicTree::RebuildTopDown()
+{
+	m_compactRoot = b2_nullNode;
+
+	int32* leaves = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	b2Vec2* centers = (b2Vec2*)b2Alloc(m_nodeCount * sizeof(b2Vec2));
+	int32 count = 0;
+
+	// Build array of leaves. Free the rest.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			m_nodes[i].parent = b2_nullNode;
+			leaves[count] = i;
+			centers[count] = m_nodes[i].aabb.GetCenter();
+			++count;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	if (count > 0)
+	{
+		m_root = BuildTopDown(leaves, centers, count);
+		m_nodes[m_root].parent = b2_nullNode;
+	}
+	else
+	{
+		m_root = b2_nullNode;
+	}
+
+	b2Free(centers);
+	b2Free(leaves);
+}
+
+// Build a sub-tree over the given leaves and return its root. The leaves are
+// split where the binned surface area heuristic is smallest. The leaf centers
+// are kept alongside so the passes over them stay in cache.
+int32 b2DynamicTree::BuildTopDown(int32* leaves, b2Vec2* centers, int32 count)
+{
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	const int32 k_binCount = 16;
+
+	// Bound the leaf centers and pick the longest axis.
+	b2Vec2 lower = centers[0];
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < count; ++i)
+	{
+		const b2Vec2& c = centers[i];
+		lower = b2Min(lower, c);
+		upper = b2Max(upper, c);
+	}
+
+	b2Vec2 extent = upper - lower;
+	int32 axis = extent.x >= extent.y ? 0 : 1;
+	float32 axisLower = axis == 0 ? lower.x : lower.y;
+	float32 axisExtent = axis == 0 ? extent.x : extent.y;
+
+	int32 splitCount = count / 2;
+
+	// Binning two leaves always splits them in center order. Coincident centers
+	// cannot be binned, so just split the range in half.
+	if (count == 2)
+	{
+		if (axisExtent > b2_epsilon && (axis == 0 ? centers[0].x > centers[1].x : centers[0].y > centers[1].y))
+		{
+			b2Swap(leaves[0], leaves[1]);
+			b2Swap(centers[0], centers[1]);
+		}
+	}
+	else if (axisExtent > b2_epsilon)
+	{
+		// Empty bins are inverted so leaves combine into them without a branch.
+		b2AABB binAABBs[k_binCount];
+		int32 binCounts[k_binCount];
+		for (int32 i = 0; i < k_binCount; ++i)
+		{
+			binAABBs[i].lowerBound.Set(b2_maxFloat, b2_maxFloat);
+			binAABBs[i].upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+			binCounts[i] = 0;
+		}
+
+		float32 binScale = k_binCount / axisExtent;
+		for (int32 i = 0; i < count; ++i)
+		{
+			const b2AABB& aabb = m_nodes[leaves[i]].aabb;
+			const b2Vec2& c = centers[i];
+			int32 bin = (int32)(binScale * ((axis == 0 ? c.x : c.y) - axisLower));
+			bin = b2Clamp(bin, 0, k_binCount - 1);
+
+			binAABBs[bin].lowerBound = b2Min(binAABBs[bin].lowerBound, aabb.lowerBound);
+			binAABBs[bin].upperBound = b2Max(binAABBs[bin].upperBound, aabb.upperBound);
+			++binCounts[bin];
+		}
+
+		// Sweep from the right to get the cost of everything right of each split.
+		float32 rightAreas[k_binCount];
+		int32 rightCounts[k_binCount];
+		b2AABB rightAABB;
+		int32 rightCount = 0;
+		for (int32 i = k_binCount - 1; i > 0; --i)
+		{
+			if (binCounts[i] > 0)
+			{
+				if (rightCount == 0)
+				{
+					rightAABB = binAABBs[i];
+				}
+				else
+				{
+					rightAABB.Combine(binAABBs[i]);
+				}
+				rightCount += binCounts[i];
+			}
+
+			rightCounts[i] = rightCount;
+			rightAreas[i] = rightCount > 0 ? rightAABB.GetPerimeter() : 0.0f;
+		}
+
+		// Sweep from the left and keep the cheapest split.
+		float32 bestCost = b2_maxFloat;
+		int32 bestBin = -1;
+		b2AABB leftAABB;
+		int32 leftCount = 0;
+		for (int32 i = 0; i < k_binCount - 1; ++i)
+		{
+			if (binCounts[i] > 0)
+			{
+				if (leftCount == 0)
+				{
+					leftAABB = binAABBs[i];
+				}
+				else
+				{
+					leftAABB.Combine(binAABBs[i]);
+				}
+				leftCount += binCounts[i];
+			}
+
+			if (leftCount == 0 || rightCounts[i + 1] == 0)
+			{
+				continue;
+			}
+
+			float32 cost = leftCount * leftAABB.GetPerimeter() + rightCounts[i + 1] * rightAreas[i + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		// The first and last bins are never empty, so a split always exists.
+		b2Assert(bestBin >= 0);
+
+		// Partition the leaves around the split.
+		int32 i = 0;
+		int32 j = count;
+		while (i < j)
+		{
+			const b2Vec2& c = centers[i];
+			int32 bin = (int32)(binScale * ((axis == 0 ? c.x : c.y) - axisLower));
+			bin = b2Clamp(bin, 0, k_binCount - 1);
+
+			if (bin <= bestBin)
+			{
+				++i;
+			}
+			else
+			{
+				--j;
+				b2Swap(leaves[i], leaves[j]);
+				b2Swap(centers[i], centers[j]);
+			}
+		}
+
+		splitCount = i;
+	}
+
+	int32 child1 = BuildTopDown(leaves, centers, splitCount);
+	int32 child2 = BuildTopDown(leaves + splitCount, centers + splitCount, count - splitCount);
+
+	// Allocating may move the node pool, so only take pointers afterwards.
+	int32 parentIndex = AllocateNode();
+	b2TreeNode* parent = m_nodes + parentIndex;
+	parent->child1 = child1;
+	parent->child2 = child2;
+	parent->height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+	parent->aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	b2CombineFilters(parent, m_nodes + child1, m_nodes + child2);
+	parent->parent = b2_nullNode;
+
+	m_nodes[child1].parent = parentIndex;
+	m_nodes[child2].parent = parentIndex;
+
+	return parentIndex;
+}
+
+void b2DynamicTree::Refit()
+{
+	m_compactRoot = b2_nullNode;
+	RefitNode(m_root);
+}
+
+void b2DynamicTree::RefitNode(int32 index)
+{
+	if (index == b2_nullNode)
+	{
+		return;
+	}
+
+	b2TreeNode* node = m_nodes + index;
+	if (node->IsLeaf())
+	{
+		return;
+	}
+
+	RefitNode(node->child1);
+	RefitNode(node->child2);
+
+	node->aabb.Combine(m_nodes[node->child1].aabb, m_nodes[node->child2].aabb);
+	b2CombineFilters(node, m_nodes + node->child1, m_nodes + node->child2);
+}
+
+void b2DynamicTree::Optimize()
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Measuring the quality is O(n), so wait until about a quarter of the
+	// leaves have changed.
+	int32 leafCount = (m_nodeCount + 1) / 2;
+	if (m_changeCount < b2Max(leafCount / 4, 64))
+	{
+		return;
+	}
+
+	m_changeCount = 0;
+
+	Refit();
+
+	float32 areaRatio = GetAreaRatio();
+	if (m_baseAreaRatio == 0.0f || areaRatio > b2_treeRebuildRatio * m_baseAreaRatio)
+	{
+		RebuildTopDown();
+		m_baseAreaRatio = GetAreaRatio();
+	}
+}
+
+void b2DynamicTree::BuildCompact()
+{
+	m_compactRoot = b2_nullNode;
+	m_compactCount = 0;
+
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Every compact node but a lone leaf root holds at least two children,
+	// so there are fewer compact nodes than leaves.
+	int32 leafCount = (m_nodeCount + 1) / 2;
+	if (m_compactCapacity < leafCount)
+	{
+		if (m_compactNodes)
+		{
+			b2Free(m_compactNodes);
+		}
+
+		m_compactCapacity = b2Max(leafCount, 2 * m_compactCapacity);
+		m_compactNodes = (b2TreeNode4*)b2Alloc(m_compactCapacity * sizeof(b2TreeNode4));
+	}
+
+	m_compactRoot = BuildCompactNode(m_root);
+}
+
+// Collapse the binary sub-tree at nodeId into a compact node. The internal
+// node with the largest perimeter is opened until four children are gathered.
+int32 b2DynamicTree::BuildCompactNode(int32 nodeId)
+{
+	int32 slots[b2_simdWidth];
+	int32 count = 1;
+	slots[0] = nodeId;
+
+	while (count < b2_simdWidth)
+	{
+		// Open the largest internal node. The first one is taken regardless,
+		// so a box with NaN bounds still gets opened and the recursion ends.
+		int32 best = -1;
+		float32 bestArea = -1.0f;
+		for (int32 i = 0; i < count; ++i)
+		{
+			const b2TreeNode* node = m_nodes + slots[i];
+			if (node->IsLeaf())
+			{
+				continue;
+			}
+
+			float32 area = node->aabb.GetPerimeter();
+			if (best == -1 || area > bestArea)
+			{
+				best = i;
+				bestArea = area;
+			}
+		}
+
+		if (best == -1)
+		{
+			break;
+		}
+
+		const b2TreeNode* node = m_nodes + slots[best];
+		slots[best] = node->child1;
+		slots[count] = node->child2;
+		++count;
+	}
+
+	// BuildCompact sizes the array for a well formed tree. Grow rather than
+	// overrun it if the tree is not.
+	b2Assert(m_compactCount < m_compactCapacity);
+	if (m_compactCount == m_compactCapacity)
+	{
+		b2TreeNode4* oldNodes = m_compactNodes;
+		m_compactCapacity *= 2;
+		m_compactNodes = (b2TreeNode4*)b2Alloc(m_compactCapacity * sizeof(b2TreeNode4));
+		memcpy(m_compactNodes, oldNodes, m_compactCount * sizeof(b2TreeNode4));
+		b2Free(oldNodes);
+	}
+
+	int32 index = m_compactCount;
+	++m_compactCount;
+
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		int32 child = b2_nullNode;
+		b2AABB aabb;
+		uint16 categoryBits = 0;
+		uint16 maskBits = 0;
+		if (i < count)
+		{
+			const b2TreeNode* node = m_nodes + slots[i];
+			aabb = node->aabb;
+			categoryBits = node->categoryBits;
+			maskBits = node->maskBits;
+			child = node->IsLeaf() ? -2 - slots[i] : BuildCompactNode(slots[i]);
+		}
+		else
+		{
+			// An inverted box never overlaps anything.
+			aabb.lowerBound.Set(b2_maxFloat, b2_maxFloat);
+			aabb.upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+		}
+
+		b2TreeNode4* compact = m_compactNodes + index;
+		compact->lowerX[i] = aabb.lowerBound.x;
+		compact->lowerY[i] = aabb.lowerBound.y;
+		compact->upperX[i] = aabb.upperBound.x;
+		compact->upperY[i] = aabb.upperBound.y;
+		compact->children[i] = child;
+		compact->categoryBits[i] = categoryBits;
+		compact->maskBits[i] = maskBits;
+	}
+
+	return index;
+}
+
+void b2DynamicTree::WriteSnapshot(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_root);
+	snapshot->Write(m_nodeCapacity);
+	snapshot->Write(m_nodeCount);
+	snapshot->Write(m_freeList);
+	snapshot->Write(m_path);
+	snapshot->Write(m_insertionCount);
+	snapshot->Write(m_changeCount);
+	snapshot->Write(m_baseAreaRatio);
+
+	// Free nodes are written too so the free list and future ids match.
+	snapshot->Write(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+}
+
+bool b2DynamicTree::ReadSnapshot(b2SnapshotReader* reader)
+{
+	int32 root, capacity, count, freeList;
+	reader->Read(&root);
+	reader->Read(&capacity);
+	reader->Read(&count);
+	reader->Read(&freeList);
+	if (reader->IsValid() == false || capacity <= 0 || count < 0 || count > capacity ||
+		root < b2_nullNode || root >= capacity || freeList < b2_nullNode || freeList >= capacity ||
+		capacity > reader->GetRemainingSize() / (int32)sizeof(b2TreeNode))
+	{
+		reader->Invalidate();
+		return false;
+	}
+
+	if (capacity != m_nodeCapacity)
+	{
+		b2Free(m_nodes);
+		m_nodeCapacity = capacity;
+		m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
+	}
+
+	m_root = root;
+	m_nodeCount = count;
+	m_freeList = freeList;
+	reader->Read(&m_path);
+	reader->Read(&m_insertionCount);
+	reader->Read(&m_changeCount);
+	reader->Read(&m_baseAreaRatio);
+	reader->Read(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		m_nodes[i].userData = NULL;
+	}
+
+	m_compactRoot = b2_nullNode;
+
+	if (reader->IsValid() == false || IsStructureValid() == false)
+	{
+		reader->Invalidate();
+		return false;
+	}
+
+	return true;
+}
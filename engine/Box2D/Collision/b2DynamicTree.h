@@ -21,6 +21,10 @@
 
 #include "b2Collision.h"
 #include "../Common/b2GrowableStack.h"
+#include "../Common/b2Simd.h"
+
+class b2Snapshot;
+class b2SnapshotReader;
 
 #define b2_nullNode (-1)
 
@@ -48,6 +52,29 @@ struct b2TreeNode
 
 	// leaf = 0, free node = -1
 	int32 height;
+
+	/// The collision filter of a leaf. Internal nodes hold the union over their
+	/// subtree, so filtered queries can skip subtrees with nothing to collide with.
+	uint16 categoryBits;
+	uint16 maskBits;
+};
+
+/// A node in the compact tree layout. The bounds of up to four children are stored
+/// side by side so one SIMD compare tests all of them.
+struct b2TreeNode4
+{
+	float32 lowerX[b2_simdWidth];
+	float32 lowerY[b2_simdWidth];
+	float32 upperX[b2_simdWidth];
+	float32 upperY[b2_simdWidth];
+
+	/// A compact node index, b2_nullNode for an unused slot, or a leaf
+	/// encoded as -2 - proxyId.
+	int32 children[b2_simdWidth];
+
+	/// The filter bits of each child, as in b2TreeNode.
+	uint16 categoryBits[b2_simdWidth];
+	uint16 maskBits[b2_simdWidth];
 };
 
 /// A dynamic AABB tree broad-phase, inspired by Nathanael Presson's btDbvt.
@@ -68,17 +95,29 @@ public:
 	~b2DynamicTree();
 
 	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
-	int32 CreateProxy(const b2AABB& aabb, void* userData);
+	/// The filter bits are only used by QueryFiltered.
+	int32 CreateProxy(const b2AABB& aabb, void* userData, uint16 categoryBits = 0xFFFF, uint16 maskBits = 0xFFFF);
+
+	/// Create many proxies at once. When the batch is large compared to the tree
+	/// the whole tree is rebuilt top-down instead of inserting the leaves one by one.
+	/// @param proxyIds receives the id of each proxy.
+	/// @param categoryBits, maskBits the filter bits of each proxy, or NULL to
+	/// let every proxy pass QueryFiltered.
+	void CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds,
+					   const uint16* categoryBits = NULL, const uint16* maskBits = NULL);
 
 	/// Destroy a proxy. This asserts if the id is invalid.
 	void DestroyProxy(int32 proxyId);
 
 	/// Move a proxy with a swepted AABB. If the proxy has moved outside of its fattened AABB,
-	/// then the proxy is removed from the tree and re-inserted. Otherwise
-	/// the function returns immediately.
-	/// @return true if the proxy was re-inserted.
+	/// then the proxy is refattened. If the parent node still contains the new AABB the leaf
+	/// is updated in place, otherwise it is removed from the tree and re-inserted.
+	/// @return true if the fat AABB changed.
 	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
 
+	/// Change the filter bits of a proxy.
+	void SetProxyFilter(int32 proxyId, uint16 categoryBits, uint16 maskBits);
+
 	/// Get proxy user data.
 	/// @return the proxy user data or 0 if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
@@ -86,11 +125,33 @@ public:
 	/// Get the fat AABB for a proxy.
 	const b2AABB& GetFatAABB(int32 proxyId) const;
 
+	/// Get the leaf node of a proxy, for its filter bits.
+	const b2TreeNode& GetProxyNode(int32 proxyId) const;
+
+	/// Does this id refer to a proxy in the tree? Used to check ids read from a snapshot.
+	bool IsProxyValid(int32 proxyId) const;
+
+	/// Get the number of proxies. This scans the node pool.
+	int32 GetProxyCount() const;
+
 	/// Query an AABB for overlapping proxies. The callback class
 	/// is called for each proxy that overlaps the supplied AABB.
 	template <typename T>
 	void Query(T* callback, const b2AABB& aabb) const;
 
+	/// Query an AABB for the proxies a proxy with the given filter bits may collide
+	/// with, that is those whose category is in maskBits and whose mask has a bit
+	/// of categoryBits. Subtrees with no such proxy are skipped.
+	template <typename T>
+	void QueryFiltered(T* callback, const b2AABB& aabb, uint16 categoryBits, uint16 maskBits) const;
+
+	/// Query up to b2_simdWidth AABBs in one traversal. Each node is tested against
+	/// all of them at once in SIMD lanes. The callback is called with the index of
+	/// the query and the overlapping proxy: bool QueryCallback(int32 lane, int32 proxyId).
+	/// Returning false stops that query only.
+	template <typename T>
+	void QueryPacket(T* callback, const b2AABB* aabbs, int32 count) const;
+
 	/// Ray-cast against the proxies in the tree. This relies on the callback
 	/// to perform a exact ray-cast in the case were the proxy contains a shape.
 	/// The callback also performs the any collision filtering. This has performance
@@ -118,6 +179,39 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Rebuild the tree top-down using a binned surface area heuristic. This is
+	/// O(n log n) and produces a much better tree than incremental insertion.
+	void RebuildTopDown();
+
+	/// Recompute the internal node AABBs from the leaves. Leaves that are moved
+	/// in place leave their ancestors loose until this is called.
+	void Refit();
+
+	/// Build a compact 4-wide copy of the tree. Query and RayCast traverse the copy
+	/// until the tree changes again. This is O(n), so it suits trees that rarely
+	/// change, such as one holding only static proxies.
+	void BuildCompact();
+
+	/// Is the compact layout built and up to date?
+	bool IsCompact() const;
+
+	/// Refit and rebuild the tree if its quality has degraded. The quality is only
+	/// checked after a good part of the tree has changed, so this is cheap to call
+	/// every step. See b2_treeRebuildRatio.
+	void Optimize();
+
+	/// Write the tree to a snapshot. User data is not written.
+	void WriteSnapshot(b2Snapshot* snapshot) const;
+
+	/// Replace the tree with one written by WriteSnapshot. Node and proxy ids are
+	/// preserved. User data is cleared and must be set again with SetUserData.
+	/// @return false if the data is malformed, including any broken link between
+	/// nodes. The tree is then unusable and must be destroyed.
+	bool ReadSnapshot(b2SnapshotReader* reader);
+
+	/// Set the user data of a proxy.
+	void SetUserData(int32 proxyId, void* userData);
+
 private:
 
 	int32 AllocateNode();
@@ -131,9 +225,25 @@ private:
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
 
+	int32 BuildTopDown(int32* leaves, b2Vec2* centers, int32 count);
+	void RefitNode(int32 index);
+
+	int32 BuildCompactNode(int32 nodeId);
+
+	template <typename T>
+	void QueryCompact(T* callback, const b2AABB& aabb) const;
+
+	template <typename T>
+	void QueryFilteredCompact(T* callback, const b2AABB& aabb, uint16 categoryBits, uint16 maskBits) const;
+
+	template <typename T>
+	void RayCastCompact(T* callback, const b2RayCastInput& input) const;
+
 	void ValidateStructure(int32 index) const;
 	void ValidateMetrics(int32 index) const;
 
+	bool IsStructureValid() const;
+
 	int32 m_root;
 
 	b2TreeNode* m_nodes;
@@ -146,6 +256,18 @@ private:
 	uint32 m_path;
 
 	int32 m_insertionCount;
+
+	/// Leaves moved since the quality was last checked.
+	int32 m_changeCount;
+
+	/// The area ratio right after the last top-down rebuild.
+	float32 m_baseAreaRatio;
+
+	/// The compact layout. The root is b2_nullNode when the layout is stale.
+	b2TreeNode4* m_compactNodes;
+	int32 m_compactRoot;
+	int32 m_compactCount;
+	int32 m_compactCapacity;
 };
 
 inline void* b2DynamicTree::GetUserData(int32 proxyId) const
@@ -154,15 +276,46 @@ inline void* b2DynamicTree::GetUserData(int32 proxyId) const
 	return m_nodes[proxyId].userData;
 }
 
+inline void b2DynamicTree::SetUserData(int32 proxyId, void* userData)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+	m_nodes[proxyId].userData = userData;
+}
+
 inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
 	return m_nodes[proxyId].aabb;
 }
 
+inline bool b2DynamicTree::IsProxyValid(int32 proxyId) const
+{
+	// Free nodes have height -1 and internal nodes a positive height.
+	return 0 <= proxyId && proxyId < m_nodeCapacity && m_nodes[proxyId].height == 0;
+}
+
+inline const b2TreeNode& b2DynamicTree::GetProxyNode(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+	return m_nodes[proxyId];
+}
+
+inline bool b2DynamicTree::IsCompact() const
+{
+	return m_compactRoot != b2_nullNode;
+}
+
 template <typename T>
 inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 {
+	if (m_compactRoot != b2_nullNode)
+	{
+		QueryCompact(callback, aabb);
+		return;
+	}
+
 	b2GrowableStack<int32, 256> stack;
 	stack.Push(m_root);
 
@@ -195,9 +348,173 @@ inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 	}
 }
 
+template <typename T>
+inline void b2DynamicTree::QueryFiltered(T* callback, const b2AABB& aabb, uint16 categoryBits, uint16 maskBits) const
+{
+	if (m_compactRoot != b2_nullNode)
+	{
+		QueryFilteredCompact(callback, aabb, categoryBits, maskBits);
+		return;
+	}
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		if (nodeId == b2_nullNode)
+		{
+			continue;
+		}
+
+		const b2TreeNode* node = m_nodes + nodeId;
+
+		if ((node->categoryBits & maskBits) == 0 || (node->maskBits & categoryBits) == 0)
+		{
+			continue;
+		}
+
+		if (b2TestOverlap(node->aabb, aabb))
+		{
+			if (node->IsLeaf())
+			{
+				bool proceed = callback->QueryCallback(nodeId);
+				if (proceed == false)
+				{
+					return;
+				}
+			}
+			else
+			{
+				stack.Push(node->child1);
+				stack.Push(node->child2);
+			}
+		}
+	}
+}
+
+// Runs one lane of a packet query as a plain query.
+template <typename T>
+struct b2TreeLaneWrapper
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		return callback->QueryCallback(lane, proxyId);
+	}
+
+	T* callback;
+	int32 lane;
+};
+
+template <typename T>
+inline void b2DynamicTree::QueryPacket(T* callback, const b2AABB* aabbs, int32 count) const
+{
+	b2Assert(0 < count && count <= b2_simdWidth);
+
+	// The compact layout already spends its lanes on the children.
+	if (m_compactRoot != b2_nullNode)
+	{
+		b2TreeLaneWrapper<T> lane;
+		lane.callback = callback;
+		for (int32 i = 0; i < count; ++i)
+		{
+			lane.lane = i;
+			QueryCompact(&lane, aabbs[i]);
+		}
+		return;
+	}
+
+	// Transpose the queries into lanes. Unused lanes get an inverted box that
+	// never overlaps.
+	float32 lowerX[b2_simdWidth], lowerY[b2_simdWidth];
+	float32 upperX[b2_simdWidth], upperY[b2_simdWidth];
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		if (i < count)
+		{
+			lowerX[i] = aabbs[i].lowerBound.x;
+			lowerY[i] = aabbs[i].lowerBound.y;
+			upperX[i] = aabbs[i].upperBound.x;
+			upperY[i] = aabbs[i].upperBound.y;
+		}
+		else
+		{
+			lowerX[i] = b2_maxFloat;
+			lowerY[i] = b2_maxFloat;
+			upperX[i] = -b2_maxFloat;
+			upperY[i] = -b2_maxFloat;
+		}
+	}
+
+	b2FloatW qLowerX = b2LoadW(lowerX);
+	b2FloatW qLowerY = b2LoadW(lowerY);
+	b2FloatW qUpperX = b2LoadW(upperX);
+	b2FloatW qUpperY = b2LoadW(upperY);
+
+	int32 active = (1 << count) - 1;
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		if (nodeId == b2_nullNode)
+		{
+			continue;
+		}
+
+		const b2TreeNode* node = m_nodes + nodeId;
+
+		// Same test as b2TestOverlap, once per lane.
+		b2FloatW overlapX = b2AndW(	b2LessEqualW(b2SplatW(node->aabb.lowerBound.x), qUpperX),
+									b2GreaterEqualW(b2SplatW(node->aabb.upperBound.x), qLowerX));
+		b2FloatW overlapY = b2AndW(	b2LessEqualW(b2SplatW(node->aabb.lowerBound.y), qUpperY),
+									b2GreaterEqualW(b2SplatW(node->aabb.upperBound.y), qLowerY));
+		int32 mask = b2MaskBitsW(b2AndW(overlapX, overlapY)) & active;
+		if (mask == 0)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			for (int32 lane = 0; lane < count; ++lane)
+			{
+				if ((mask & (1 << lane)) == 0)
+				{
+					continue;
+				}
+
+				bool proceed = callback->QueryCallback(lane, nodeId);
+				if (proceed == false)
+				{
+					active &= ~(1 << lane);
+					if (active == 0)
+					{
+						return;
+					}
+				}
+			}
+		}
+		else
+		{
+			stack.Push(node->child1);
+			stack.Push(node->child2);
+		}
+	}
+}
+
 template <typename T>
 inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) const
 {
+	if (m_compactRoot != b2_nullNode)
+	{
+		RayCastCompact(callback, input);
+		return;
+	}
+
 	b2Vec2 p1 = input.p1;
 	b2Vec2 p2 = input.p2;
 	b2Vec2 r = p2 - p1;
@@ -281,4 +598,199 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 	}
 }
 
+template <typename T>
+inline void b2DynamicTree::QueryCompact(T* callback, const b2AABB& aabb) const
+{
+	b2FloatW qLowerX = b2SplatW(aabb.lowerBound.x);
+	b2FloatW qLowerY = b2SplatW(aabb.lowerBound.y);
+	b2FloatW qUpperX = b2SplatW(aabb.upperBound.x);
+	b2FloatW qUpperY = b2SplatW(aabb.upperBound.y);
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_compactRoot);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2TreeNode4* node = m_compactNodes + stack.Pop();
+
+		// Same test as b2TestOverlap, once per child. It rejects rather than
+		// accepts, so NaN bounds overlap as they do in the binary tree.
+		b2FloatW separateX = b2OrW(	b2GreaterW(b2LoadW(node->lowerX), qUpperX),
+									b2GreaterW(qLowerX, b2LoadW(node->upperX)));
+		b2FloatW separateY = b2OrW(	b2GreaterW(b2LoadW(node->lowerY), qUpperY),
+									b2GreaterW(qLowerY, b2LoadW(node->upperY)));
+		int32 mask = ~b2MaskBitsW(b2OrW(separateX, separateY));
+
+		for (int32 i = 0; i < b2_simdWidth; ++i)
+		{
+			int32 child = node->children[i];
+			if ((mask & (1 << i)) == 0 || child == b2_nullNode)
+			{
+				continue;
+			}
+
+			if (child >= 0)
+			{
+				stack.Push(child);
+				continue;
+			}
+
+			bool proceed = callback->QueryCallback(-2 - child);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2DynamicTree::QueryFilteredCompact(T* callback, const b2AABB& aabb, uint16 categoryBits, uint16 maskBits) const
+{
+	b2FloatW qLowerX = b2SplatW(aabb.lowerBound.x);
+	b2FloatW qLowerY = b2SplatW(aabb.lowerBound.y);
+	b2FloatW qUpperX = b2SplatW(aabb.upperBound.x);
+	b2FloatW qUpperY = b2SplatW(aabb.upperBound.y);
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_compactRoot);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2TreeNode4* node = m_compactNodes + stack.Pop();
+
+		b2FloatW separateX = b2OrW(	b2GreaterW(b2LoadW(node->lowerX), qUpperX),
+									b2GreaterW(qLowerX, b2LoadW(node->upperX)));
+		b2FloatW separateY = b2OrW(	b2GreaterW(b2LoadW(node->lowerY), qUpperY),
+									b2GreaterW(qLowerY, b2LoadW(node->upperY)));
+		int32 mask = ~b2MaskBitsW(b2OrW(separateX, separateY));
+
+		for (int32 i = 0; i < b2_simdWidth; ++i)
+		{
+			int32 child = node->children[i];
+			if ((mask & (1 << i)) == 0 || child == b2_nullNode)
+			{
+				continue;
+			}
+
+			if ((node->categoryBits[i] & maskBits) == 0 || (node->maskBits[i] & categoryBits) == 0)
+			{
+				continue;
+			}
+
+			if (child >= 0)
+			{
+				stack.Push(child);
+				continue;
+			}
+
+			bool proceed = callback->QueryCallback(-2 - child);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2DynamicTree::RayCastCompact(T* callback, const b2RayCastInput& input) const
+{
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	float32 maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2Vec2 t = p1 + maxFraction * (p2 - p1);
+	b2FloatW segLowerX = b2SplatW(b2Min(p1.x, t.x));
+	b2FloatW segLowerY = b2SplatW(b2Min(p1.y, t.y));
+	b2FloatW segUpperX = b2SplatW(b2Max(p1.x, t.x));
+	b2FloatW segUpperY = b2SplatW(b2Max(p1.y, t.y));
+
+	b2FloatW zero = b2ZeroW();
+	b2FloatW half = b2SplatW(0.5f);
+	b2FloatW p1X = b2SplatW(p1.x);
+	b2FloatW p1Y = b2SplatW(p1.y);
+	b2FloatW vX = b2SplatW(v.x);
+	b2FloatW vY = b2SplatW(v.y);
+	b2FloatW absVX = b2SplatW(abs_v.x);
+	b2FloatW absVY = b2SplatW(abs_v.y);
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_compactRoot);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2TreeNode4* node = m_compactNodes + stack.Pop();
+
+		b2FloatW lowerX = b2LoadW(node->lowerX);
+		b2FloatW lowerY = b2LoadW(node->lowerY);
+		b2FloatW upperX = b2LoadW(node->upperX);
+		b2FloatW upperY = b2LoadW(node->upperY);
+
+		b2FloatW separateX = b2OrW(b2GreaterW(lowerX, segUpperX), b2GreaterW(segLowerX, upperX));
+		b2FloatW separateY = b2OrW(b2GreaterW(lowerY, segUpperY), b2GreaterW(segLowerY, upperY));
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2FloatW cX = b2MulW(half, b2AddW(lowerX, upperX));
+		b2FloatW cY = b2MulW(half, b2AddW(lowerY, upperY));
+		b2FloatW hX = b2MulW(half, b2SubW(upperX, lowerX));
+		b2FloatW hY = b2MulW(half, b2SubW(upperY, lowerY));
+		b2FloatW d = b2AddW(b2MulW(vX, b2SubW(p1X, cX)), b2MulW(vY, b2SubW(p1Y, cY)));
+		d = b2MaxW(d, b2SubW(zero, d));
+		b2FloatW separation = b2SubW(d, b2AddW(b2MulW(absVX, hX), b2MulW(absVY, hY)));
+
+		b2FloatW miss = b2OrW(b2OrW(separateX, separateY), b2GreaterW(separation, zero));
+		int32 mask = ~b2MaskBitsW(miss);
+
+		for (int32 i = 0; i < b2_simdWidth; ++i)
+		{
+			int32 child = node->children[i];
+			if ((mask & (1 << i)) == 0 || child == b2_nullNode)
+			{
+				continue;
+			}
+
+			if (child >= 0)
+			{
+				stack.Push(child);
+				continue;
+			}
+
+			b2RayCastInput subInput;
+			subInput.p1 = input.p1;
+			subInput.p2 = input.p2;
+			subInput.maxFraction = maxFraction;
+
+			float32 value = callback->RayCastCallback(subInput, -2 - child);
+
+			if (value == 0.0f)
+			{
+				// The client has terminated the ray cast.
+				return;
+			}
+
+			if (value > 0.0f)
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				t = p1 + maxFraction * (p2 - p1);
+				segLowerX = b2SplatW(b2Min(p1.x, t.x));
+				segLowerY = b2SplatW(b2Min(p1.y, t.y));
+				segUpperX = b2SplatW(b2Max(p1.x, t.x));
+				segUpperY = b2SplatW(b2Max(p1.y, t.y));
+			}
+		}
+	}
+}
+
 #endif
@@ -0,0 +1,230 @@
+#ifndef B2_SIMD_KERNELS_H
+#define B2_SIMD_KERNELS_H
+
+#include "../Common/b2Math.h"
+#include "../Common/b2Simd.h"
+
+// The vertex searches shared by GJK and the polygon collision routines. With
+// B2_SIMD_COLLISION defined, searches over more than four vertices test four per
+// instruction. Smaller ones stay scalar since reducing the lanes costs more than
+// it saves. Ties go to the lowest index like the scalar loops, so both give the
+// same results.
+
+#if defined(B2_SIMD_COLLISION)
+
+// Load up to four points into lanes. Missing points repeat the last one, which
+// never wins a tie against it.
+inline void b2LoadPointsW(b2FloatW* x, b2FloatW* y, const b2Vec2* points, int32 count)
+{
+	if (count >= b2_simdWidth)
+	{
+		b2DeinterleaveW(&points[0].x, x, y);
+		return;
+	}
+
+	const b2Vec2* last = points + count - 1;
+	b2LoadPairsW(&points[0].x, &points[b2Min(1, count - 1)].x, &points[b2Min(2, count - 1)].x, &last->x, x, y);
+}
+
+// The lane indices of the first group of points.
+inline b2FloatW b2FirstIndicesW()
+{
+	static const float32 indices[b2_simdWidth] = {0.0f, 1.0f, 2.0f, 3.0f};
+	return b2LoadW(indices);
+}
+
+// Reduce the lanes of a search to the lowest index with the largest value.
+inline int32 b2ReduceMaxW(b2FloatW values, b2FloatW indices, float32* value)
+{
+	b2FloatW best = b2MaxLanesW(values);
+	b2FloatW candidates = b2SelectW(b2EqualW(values, best), indices, b2SplatW(b2_maxFloat));
+	*value = b2FirstLaneW(best);
+	return int32(b2FirstLaneW(b2MinLanesW(candidates)));
+}
+
+#endif
+
+/// Find the first point with the largest dot product with d.
+inline int32 b2FindMaxDot(const b2Vec2* points, int32 count, const b2Vec2& d)
+{
+	b2Assert(count > 0);
+
+#if defined(B2_SIMD_COLLISION)
+	if (count > b2_simdWidth)
+	{
+		b2FloatW dx = b2SplatW(d.x), dy = b2SplatW(d.y);
+		b2FloatW best = b2SplatW(-b2_maxFloat);
+		b2FloatW bestIndex = b2ZeroW();
+		b2FloatW index = b2FirstIndicesW();
+		b2FloatW width = b2SplatW(float32(b2_simdWidth));
+		for (int32 i = 0; i < count; i += b2_simdWidth)
+		{
+			b2FloatW x, y;
+			b2LoadPointsW(&x, &y, points + i, count - i);
+			b2FloatW dot = b2AddW(b2MulW(x, dx), b2MulW(y, dy));
+			b2FloatW mask = b2GreaterW(dot, best);
+			best = b2SelectW(mask, dot, best);
+			bestIndex = b2SelectW(mask, index, bestIndex);
+			index = b2AddW(index, width);
+		}
+
+		float32 value;
+		return b2ReduceMaxW(best, bestIndex, &value);
+	}
+#endif
+
+	int32 bestIndex = 0;
+	float32 bestValue = b2Dot(points[0], d);
+	for (int32 i = 1; i < count; ++i)
+	{
+		float32 value = b2Dot(points[i], d);
+		if (value > bestValue)
+		{
+			bestIndex = i;
+			bestValue = value;
+		}
+	}
+
+	return bestIndex;
+}
+
+/// Find the first point with the smallest dot product with d.
+inline int32 b2FindMinDot(const b2Vec2* points, int32 count, const b2Vec2& d)
+{
+	return b2FindMaxDot(points, count, -d);
+}
+
+/// Find the first plane with the largest separation of a point, where plane i
+/// passes through points[i] with the normal normals[i].
+inline int32 b2FindMaxPlaneSeparation(const b2Vec2* points, const b2Vec2* normals, int32 count,
+									  const b2Vec2& p, float32* separation)
+{
+	b2Assert(count > 0);
+
+#if defined(B2_SIMD_COLLISION)
+	if (count > b2_simdWidth)
+	{
+		b2FloatW px = b2SplatW(p.x), py = b2SplatW(p.y);
+		b2FloatW best = b2SplatW(-b2_maxFloat);
+		b2FloatW bestIndex = b2ZeroW();
+		b2FloatW index = b2FirstIndicesW();
+		b2FloatW width = b2SplatW(float32(b2_simdWidth));
+		for (int32 i = 0; i < count; i += b2_simdWidth)
+		{
+			b2FloatW x, y, nx, ny;
+			b2LoadPointsW(&x, &y, points + i, count - i);
+			b2LoadPointsW(&nx, &ny, normals + i, count - i);
+			b2FloatW s = b2AddW(b2MulW(nx, b2SubW(px, x)), b2MulW(ny, b2SubW(py, y)));
+			b2FloatW mask = b2GreaterW(s, best);
+			best = b2SelectW(mask, s, best);
+			bestIndex = b2SelectW(mask, index, bestIndex);
+			index = b2AddW(index, width);
+		}
+
+		return b2ReduceMaxW(best, bestIndex, separation);
+	}
+#endif
+
+	int32 bestIndex = 0;
+	float32 bestSeparation = -b2_maxFloat;
+	for (int32 i = 0; i < count; ++i)
+	{
+		float32 s = b2Dot(normals[i], p - points[i]);
+		if (s > bestSeparation)
+		{
+			bestIndex = i;
+			bestSeparation = s;
+		}
+	}
+
+	*separation = bestSeparation;
+	return bestIndex;
+}
+
+#if defined(B2_SIMD_COLLISION)
+
+/// Find the edge of polygon 1 with the largest separation from polygon 2 by
+/// testing every edge against every vertex, four edges at a time. xf takes
+/// polygon 2 into the frame of polygon 1.
+inline int32 b2FindMaxEdgeSeparation(float32* separation,
+									 const b2Vec2* vertices1, const b2Vec2* normals1, int32 count1,
+									 const b2Vec2* vertices2, int32 count2, const b2Transform& xf)
+{
+	b2Assert(count1 > 0 && count2 > 0);
+
+	// Move the vertices of polygon 2, four at a time.
+	float32 x2[b2_maxPolygonVertices + b2_simdWidth];
+	float32 y2[b2_maxPolygonVertices + b2_simdWidth];
+	b2FloatW c = b2SplatW(xf.q.c), s = b2SplatW(xf.q.s);
+	b2FloatW px = b2SplatW(xf.p.x), py = b2SplatW(xf.p.y);
+	for (int32 j = 0; j < count2; j += b2_simdWidth)
+	{
+		b2FloatW x, y;
+		b2LoadPointsW(&x, &y, vertices2 + j, count2 - j);
+		b2StoreW(x2 + j, b2AddW(b2SubW(b2MulW(c, x), b2MulW(s, y)), px));
+		b2StoreW(y2 + j, b2AddW(b2AddW(b2MulW(s, x), b2MulW(c, y)), py));
+	}
+
+	b2FloatW best = b2SplatW(-b2_maxFloat);
+	b2FloatW bestIndex = b2ZeroW();
+	b2FloatW index = b2FirstIndicesW();
+	b2FloatW width = b2SplatW(float32(b2_simdWidth));
+	for (int32 i = 0; i < count1; i += b2_simdWidth)
+	{
+		b2FloatW x1, y1, nx, ny;
+		b2LoadPointsW(&x1, &y1, vertices1 + i, count1 - i);
+		b2LoadPointsW(&nx, &ny, normals1 + i, count1 - i);
+
+		// The separation of an edge is that of the deepest vertex.
+		b2FloatW edgeSeparation = b2SplatW(b2_maxFloat);
+		for (int32 j = 0; j < count2; ++j)
+		{
+			b2FloatW dx = b2SubW(b2SplatW(x2[j]), x1);
+			b2FloatW dy = b2SubW(b2SplatW(y2[j]), y1);
+			edgeSeparation = b2MinW(edgeSeparation, b2AddW(b2MulW(nx, dx), b2MulW(ny, dy)));
+		}
+
+		b2FloatW mask = b2GreaterW(edgeSeparation, best);
+		best = b2SelectW(mask, edgeSeparation, best);
+		bestIndex = b2SelectW(mask, index, bestIndex);
+		index = b2AddW(index, width);
+	}
+
+	return b2ReduceMaxW(best, bestIndex, separation);
+}
+
+#endif
+
+/// Get the smallest separation of the points from the plane through p with the normal n.
+inline float32 b2MinSeparation(const b2Vec2* points, int32 count, const b2Vec2& n, const b2Vec2& p)
+{
+	b2Assert(count > 0);
+
+#if defined(B2_SIMD_COLLISION)
+	if (count > b2_simdWidth)
+	{
+		b2FloatW nx = b2SplatW(n.x), ny = b2SplatW(n.y);
+		b2FloatW px = b2SplatW(p.x), py = b2SplatW(p.y);
+		b2FloatW best = b2SplatW(b2_maxFloat);
+		for (int32 i = 0; i < count; i += b2_simdWidth)
+		{
+			b2FloatW x, y;
+			b2LoadPointsW(&x, &y, points + i, count - i);
+			b2FloatW s = b2AddW(b2MulW(nx, b2SubW(x, px)), b2MulW(ny, b2SubW(y, py)));
+			best = b2MinW(best, s);
+		}
+
+		return b2FirstLaneW(b2MinLanesW(best));
+	}
+#endif
+
+	float32 separation = b2_maxFloat;
+	for (int32 i = 0; i < count; ++i)
+	{
+		separation = b2Min(separation, b2Dot(n, points[i] - p));
+	}
+
+	return separation;
+}
+
+#endif
@@ -0,0 +1,213 @@
+#include "b2SweepAndPrune.h"
+#include <algorithm>
+#include <cstring>
+
+b2SweepAndPrune::b2SweepAndPrune()
+{
+	m_entryCapacity = 16;
+	m_entryCount = 0;
+	m_holeCount = 0;
+	m_entries = (b2SapEntry*)b2Alloc(m_entryCapacity * sizeof(b2SapEntry));
+
+	m_pendingCapacity = 16;
+	m_pendingCount = 0;
+	m_pending = (int32*)b2Alloc(m_pendingCapacity * sizeof(int32));
+
+	m_maxWidth = 0.0f;
+}
+
+b2SweepAndPrune::~b2SweepAndPrune()
+{
+	b2Free(m_pending);
+	b2Free(m_entries);
+}
+
+// Ties are broken by proxy id so the order does not depend on the sort implementation.
+bool b2SweepAndPrune::EntryLessThan(const b2SapEntry& a, const b2SapEntry& b)
+{
+	if (a.lowerX != b.lowerX)
+	{
+		return a.lowerX < b.lowerX;
+	}
+
+	return a.proxyId < b.proxyId;
+}
+
+bool b2SweepAndPrune::IsLarge(const b2AABB& aabb) const
+{
+	return aabb.upperBound.x - aabb.lowerBound.x > b2_sapLargeProxyWidth;
+}
+
+void b2SweepAndPrune::InsertProxy(int32 proxyId)
+{
+	if (m_pendingCount == m_pendingCapacity)
+	{
+		int32* oldPending = m_pending;
+		m_pendingCapacity *= 2;
+		m_pending = (int32*)b2Alloc(m_pendingCapacity * sizeof(int32));
+		memcpy(m_pending, oldPending, m_pendingCount * sizeof(int32));
+		b2Free(oldPending);
+	}
+
+	m_proxies[proxyId].slot = -2 - m_pendingCount;
+	m_pending[m_pendingCount] = proxyId;
+	++m_pendingCount;
+}
+
+void b2SweepAndPrune::RemoveProxy(int32 proxyId)
+{
+	int32 slot = m_proxies[proxyId].slot;
+	if (slot >= 0)
+	{
+		// Leave a hole so the list stays sorted.
+		b2Assert(slot < m_entryCount && m_entries[slot].proxyId == proxyId);
+		m_entries[slot].proxyId = e_nullProxy;
+		++m_holeCount;
+	}
+	else
+	{
+		int32 index = -2 - slot;
+		b2Assert(0 <= index && index < m_pendingCount && m_pending[index] == proxyId);
+		--m_pendingCount;
+		m_pending[index] = m_pending[m_pendingCount];
+		m_proxies[m_pending[index]].slot = -2 - index;
+	}
+
+	m_proxies[proxyId].slot = e_nullProxy;
+}
+
+void b2SweepAndPrune::UpdateProxy(int32 proxyId, const b2AABB& oldAABB)
+{
+	B2_NOT_USED(oldAABB);
+
+	int32 slot = m_proxies[proxyId].slot;
+	if (slot < 0)
+	{
+		// Pending proxies are scanned directly.
+		return;
+	}
+
+	const b2AABB& aabb = m_proxies[proxyId].aabb;
+	m_maxWidth = b2Max(m_maxWidth, aabb.upperBound.x - aabb.lowerBound.x);
+
+	b2SapEntry entry;
+	entry.lowerX = aabb.lowerBound.x;
+	entry.proxyId = proxyId;
+
+	// Shift the entry to its new place.
+	while (slot > 0 && EntryLessThan(entry, m_entries[slot - 1]))
+	{
+		m_entries[slot] = m_entries[slot - 1];
+		if (m_entries[slot].proxyId != e_nullProxy)
+		{
+			m_proxies[m_entries[slot].proxyId].slot = slot;
+		}
+		--slot;
+	}
+
+	while (slot < m_entryCount - 1 && EntryLessThan(m_entries[slot + 1], entry))
+	{
+		m_entries[slot] = m_entries[slot + 1];
+		if (m_entries[slot].proxyId != e_nullProxy)
+		{
+			m_proxies[m_entries[slot].proxyId].slot = slot;
+		}
+		++slot;
+	}
+
+	m_entries[slot] = entry;
+	m_proxies[proxyId].slot = slot;
+}
+
+void b2SweepAndPrune::Flush()
+{
+	if (m_pendingCount == 0 && m_holeCount == 0)
+	{
+		return;
+	}
+
+	// Remove holes.
+	int32 count = 0;
+	for (int32 i = 0; i < m_entryCount; ++i)
+	{
+		if (m_entries[i].proxyId != e_nullProxy)
+		{
+			m_entries[count++] = m_entries[i];
+		}
+	}
+	m_entryCount = count;
+	m_holeCount = 0;
+
+	if (m_entryCount + m_pendingCount > m_entryCapacity)
+	{
+		b2SapEntry* oldEntries = m_entries;
+		while (m_entryCount + m_pendingCount > m_entryCapacity)
+		{
+			m_entryCapacity *= 2;
+		}
+		m_entries = (b2SapEntry*)b2Alloc(m_entryCapacity * sizeof(b2SapEntry));
+		memcpy(m_entries, oldEntries, m_entryCount * sizeof(b2SapEntry));
+		b2Free(oldEntries);
+	}
+
+	// Append the pending proxies sorted, then merge in place.
+	b2SapEntry* pending = m_entries + m_entryCount;
+	for (int32 i = 0; i < m_pendingCount; ++i)
+	{
+		int32 proxyId = m_pending[i];
+		pending[i].lowerX = m_proxies[proxyId].aabb.lowerBound.x;
+		pending[i].proxyId = proxyId;
+	}
+	std::sort(pending, pending + m_pendingCount, EntryLessThan);
+	std::inplace_merge(m_entries, pending, pending + m_pendingCount, EntryLessThan);
+	m_entryCount += m_pendingCount;
+	m_pendingCount = 0;
+
+	m_maxWidth = 0.0f;
+	for (int32 i = 0; i < m_entryCount; ++i)
+	{
+		b2IndexProxy* proxy = m_proxies + m_entries[i].proxyId;
+		proxy->slot = i;
+		m_maxWidth = b2Max(m_maxWidth, proxy->aabb.upperBound.x - proxy->aabb.lowerBound.x);
+	}
+}
+
+bool b2SweepAndPrune::QueryProxies(b2BroadPhaseQueryCallback* callback, const b2AABB& aabb) const
+{
+	// Any overlapping entry starts no further left than this.
+	b2SapEntry key;
+	key.lowerX = aabb.lowerBound.x - m_maxWidth;
+	key.proxyId = e_nullProxy;
+
+	const b2SapEntry* begin = std::lower_bound(m_entries, m_entries + m_entryCount, key, EntryLessThan);
+	const b2SapEntry* end = m_entries + m_entryCount;
+	for (const b2SapEntry* entry = begin; entry < end && entry->lowerX <= aabb.upperBound.x; ++entry)
+	{
+		if (entry->proxyId == e_nullProxy)
+		{
+			continue;
+		}
+
+		if (b2TestOverlap(m_proxies[entry->proxyId].aabb, aabb))
+		{
+			if (callback->QueryCallback(entry->proxyId) == false)
+			{
+				return false;
+			}
+		}
+	}
+
+	for (int32 i = 0; i < m_pendingCount; ++i)
+	{
+		int32 proxyId = m_pending[i];
+		if (b2TestOverlap(m_proxies[proxyId].aabb, aabb))
+		{
+			if (callback->QueryCallback(proxyId) == false)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,52 @@
+#ifndef B2_SWEEP_AND_PRUNE_H
+#define B2_SWEEP_AND_PRUNE_H
+
+#include "b2BroadPhaseIndex.h"
+
+/// A sweep-and-prune broad-phase index. Proxies are kept sorted by the lower
+/// x bound of their fat AABB. A query scans the entries whose lower bound lies
+/// within the query interval widened by the widest proxy, then rejects on y.
+/// This is cheap when shapes are of similar size. Moving a proxy shifts it to
+/// its new place in the list, which is cheap for coherent motion. New proxies
+/// and holes left by destroyed proxies are folded in by Flush.
+class b2SweepAndPrune : public b2BroadPhaseIndex
+{
+public:
+	b2SweepAndPrune();
+	~b2SweepAndPrune();
+
+	/// Merge new proxies into the sorted list and remove holes.
+	void Flush();
+
+protected:
+	bool IsLarge(const b2AABB& aabb) const;
+	void InsertProxy(int32 proxyId);
+	void RemoveProxy(int32 proxyId);
+	void UpdateProxy(int32 proxyId, const b2AABB& oldAABB);
+	bool QueryProxies(b2BroadPhaseQueryCallback* callback, const b2AABB& aabb) const;
+
+private:
+
+	struct b2SapEntry
+	{
+		float32 lowerX;
+		int32 proxyId;		// e_nullProxy for a hole
+	};
+
+	static bool EntryLessThan(const b2SapEntry& a, const b2SapEntry& b);
+
+	// Proxy slots >= 0 index the sorted entries, pending proxies use -2 - index.
+	b2SapEntry* m_entries;
+	int32 m_entryCount;
+	int32 m_entryCapacity;
+	int32 m_holeCount;
+
+	int32* m_pending;
+	int32 m_pendingCount;
+	int32 m_pendingCapacity;
+
+	// The widest proxy in the sorted entries. This may overestimate.
+	float32 m_maxWidth;
+};
+
+#endif
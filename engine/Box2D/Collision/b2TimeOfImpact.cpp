@@ -21,6 +21,7 @@
 #include "b2TimeOfImpact.h"
 #include "Shapes/b2CircleShape.h"
 #include "Shapes/b2PolygonShape.h"
+#include "../Common/b2Parallel.h"
 
 #include <cstdio>
 using namespace std;
@@ -28,6 +29,38 @@ using namespace std;
 int32 b2_toiCalls, b2_toiIters, b2_toiMaxIters;
 int32 b2_toiRootIters, b2_toiMaxRootIters;
 
+// The statistics gathered by each worker of a b2ParallelFor dispatch, padded
+// to a cache line so the workers don't share one.
+struct b2TOIStats
+{
+	int32 calls;
+	int32 iters;
+	int32 maxIters;
+	int32 rootIters;
+	int32 maxRootIters;
+	int32 padding[11];
+};
+
+static b2TOIStats s_toiStats[b2_maxWorkers];
+
+void b2MergeTOIStats()
+{
+	for (int32 i = 0; i < b2_maxWorkers; ++i)
+	{
+		b2TOIStats* stats = s_toiStats + i;
+		b2_toiCalls += stats->calls;
+		b2_toiIters += stats->iters;
+		b2_toiMaxIters = b2Max(b2_toiMaxIters, stats->maxIters);
+		b2_toiRootIters += stats->rootIters;
+		b2_toiMaxRootIters = b2Max(b2_toiMaxRootIters, stats->maxRootIters);
+		stats->calls = 0;
+		stats->iters = 0;
+		stats->maxIters = 0;
+		stats->rootIters = 0;
+		stats->maxRootIters = 0;
+	}
+}
+
 struct b2SeparationFunction
 {
 	enum Type
@@ -256,8 +289,6 @@ struct b2SeparationFunction
 // by computing the largest time at which separation is maintained.
 void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 {
-	++b2_toiCalls;
-
 	output->state = b2TOIOutput::e_unknown;
 	output->t = input->tMax;
 
@@ -282,6 +313,8 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 	float32 t1 = 0.0f;
 	const int32 k_maxIterations = 20;	// TODO_ERIN b2Settings
 	int32 iter = 0;
+	int32 rootIters = 0;
+	int32 maxRootIters = 0;
 
 	// Prepare input for distance query.
 	b2SimplexCache cache;
@@ -444,7 +477,6 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 				}
 
 				++rootIterCount;
-				++b2_toiRootIters;
 
 				if (rootIterCount == 50)
 				{
@@ -452,7 +484,8 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 				}
 			}
 
-			b2_toiMaxRootIters = b2Max(b2_toiMaxRootIters, rootIterCount);
+			rootIters += rootIterCount;
+			maxRootIters = b2Max(maxRootIters, rootIterCount);
 
 			++pushBackIter;
 
@@ -463,7 +496,6 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 		}
 
 		++iter;
-		++b2_toiIters;
 
 		if (done)
 		{
@@ -479,5 +511,23 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 		}
 	}
 
-	b2_toiMaxIters = b2Max(b2_toiMaxIters, iter);
+	// Workers running b2ParallelFor tasks keep their own statistics.
+	int32 worker = b2GetWorkerIndex();
+	if (worker < 0)
+	{
+		++b2_toiCalls;
+		b2_toiIters += iter;
+		b2_toiMaxIters = b2Max(b2_toiMaxIters, iter);
+		b2_toiRootIters += rootIters;
+		b2_toiMaxRootIters = b2Max(b2_toiMaxRootIters, maxRootIters);
+	}
+	else
+	{
+		b2TOIStats* stats = s_toiStats + worker;
+		++stats->calls;
+		stats->iters += iter;
+		stats->maxIters = b2Max(stats->maxIters, iter);
+		stats->rootIters += rootIters;
+		stats->maxRootIters = b2Max(stats->maxRootIters, maxRootIters);
+	}
 }
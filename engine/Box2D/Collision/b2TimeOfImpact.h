@@ -55,4 +55,8 @@ struct b2TOIOutput
 /// Note: use b2Distance to compute the contact point and normal at the time of impact.
 void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input);
 
+/// Add the TOI statistics gathered by the b2ParallelFor workers into b2_toiCalls
+/// and the other TOI globals. b2ParallelFor calls this after each dispatch.
+void b2MergeTOIStats();
+
 #endif
@@ -0,0 +1,246 @@
+#include "b2UniformGrid.h"
+#include <cstring>
+
+b2UniformGrid::b2UniformGrid(float32 cellSize)
+{
+	b2Assert(cellSize > 0.0f);
+	m_cellSize = cellSize;
+	m_invCellSize = 1.0f / cellSize;
+
+	m_bucketCount = 256;
+	m_buckets = (int32*)b2Alloc(m_bucketCount * sizeof(int32));
+	for (int32 i = 0; i < m_bucketCount; ++i)
+	{
+		m_buckets[i] = e_nullProxy;
+	}
+
+	m_entryCapacity = 256;
+	m_entryCount = 0;
+	m_entries = (b2GridEntry*)b2Alloc(m_entryCapacity * sizeof(b2GridEntry));
+	m_freeEntry = e_nullProxy;
+}
+
+b2UniformGrid::~b2UniformGrid()
+{
+	b2Free(m_entries);
+	b2Free(m_buckets);
+}
+
+inline int32 b2UniformGrid::GetCell(float32 x) const
+{
+	// Clamp so far away proxies can't overflow the cell coordinates.
+	const float32 k_maxCell = 1.0e8f;
+	float32 cell = b2Clamp(x * m_invCellSize, -k_maxCell, k_maxCell);
+	return (int32)floorf(cell);
+}
+
+inline b2UniformGrid::b2CellRange b2UniformGrid::GetCellRange(const b2AABB& aabb) const
+{
+	b2CellRange range;
+	range.lowerX = GetCell(aabb.lowerBound.x);
+	range.lowerY = GetCell(aabb.lowerBound.y);
+	range.upperX = GetCell(aabb.upperBound.x);
+	range.upperY = GetCell(aabb.upperBound.y);
+	return range;
+}
+
+inline int32 b2UniformGrid::GetBucket(int32 x, int32 y) const
+{
+	uint32 h = (uint32)x * 73856093u ^ (uint32)y * 19349663u;
+	return (int32)(h & (uint32)(m_bucketCount - 1));
+}
+
+bool b2UniformGrid::IsLarge(const b2AABB& aabb) const
+{
+	b2CellRange range = GetCellRange(aabb);
+	float32 cells = float32(range.upperX - range.lowerX + 1) * float32(range.upperY - range.lowerY + 1);
+	return cells > float32(b2_gridMaxProxyCells);
+}
+
+void b2UniformGrid::Rehash(int32 bucketCount)
+{
+	b2Free(m_buckets);
+	m_bucketCount = bucketCount;
+	m_buckets = (int32*)b2Alloc(m_bucketCount * sizeof(int32));
+	for (int32 i = 0; i < m_bucketCount; ++i)
+	{
+		m_buckets[i] = e_nullProxy;
+	}
+
+	// Free entries are marked with a null proxy.
+	for (int32 i = 0; i < m_entryCount; ++i)
+	{
+		b2GridEntry* entry = m_entries + i;
+		if (entry->proxyId == e_nullProxy)
+		{
+			continue;
+		}
+
+		int32 bucket = GetBucket(entry->x, entry->y);
+		entry->next = m_buckets[bucket];
+		m_buckets[bucket] = i;
+	}
+}
+
+void b2UniformGrid::AddEntries(int32 proxyId, const b2CellRange& range)
+{
+	for (int32 y = range.lowerY; y <= range.upperY; ++y)
+	{
+		for (int32 x = range.lowerX; x <= range.upperX; ++x)
+		{
+			int32 entryId;
+			if (m_freeEntry != e_nullProxy)
+			{
+				entryId = m_freeEntry;
+				m_freeEntry = m_entries[entryId].next;
+			}
+			else
+			{
+				if (m_entryCount == m_entryCapacity)
+				{
+					b2GridEntry* oldEntries = m_entries;
+					m_entryCapacity *= 2;
+					m_entries = (b2GridEntry*)b2Alloc(m_entryCapacity * sizeof(b2GridEntry));
+					memcpy(m_entries, oldEntries, m_entryCount * sizeof(b2GridEntry));
+					b2Free(oldEntries);
+				}
+
+				entryId = m_entryCount++;
+			}
+
+			int32 bucket = GetBucket(x, y);
+			b2GridEntry* entry = m_entries + entryId;
+			entry->x = x;
+			entry->y = y;
+			entry->proxyId = proxyId;
+			entry->next = m_buckets[bucket];
+			m_buckets[bucket] = entryId;
+		}
+	}
+
+	// Keep the chains short.
+	if (m_entryCount > 2 * m_bucketCount)
+	{
+		Rehash(2 * m_bucketCount);
+	}
+}
+
+void b2UniformGrid::RemoveEntries(int32 proxyId, const b2CellRange& range)
+{
+	for (int32 y = range.lowerY; y <= range.upperY; ++y)
+	{
+		for (int32 x = range.lowerX; x <= range.upperX; ++x)
+		{
+			int32 bucket = GetBucket(x, y);
+			int32* link = m_buckets + bucket;
+			while (*link != e_nullProxy)
+			{
+				b2GridEntry* entry = m_entries + *link;
+				if (entry->proxyId == proxyId && entry->x == x && entry->y == y)
+				{
+					int32 entryId = *link;
+					*link = entry->next;
+					entry->proxyId = e_nullProxy;
+					entry->next = m_freeEntry;
+					m_freeEntry = entryId;
+					break;
+				}
+
+				link = &entry->next;
+			}
+		}
+	}
+}
+
+void b2UniformGrid::InsertProxy(int32 proxyId)
+{
+	AddEntries(proxyId, GetCellRange(m_proxies[proxyId].aabb));
+}
+
+void b2UniformGrid::RemoveProxy(int32 proxyId)
+{
+	RemoveEntries(proxyId, GetCellRange(m_proxies[proxyId].aabb));
+}
+
+void b2UniformGrid::UpdateProxy(int32 proxyId, const b2AABB& oldAABB)
+{
+	b2CellRange oldRange = GetCellRange(oldAABB);
+	b2CellRange newRange = GetCellRange(m_proxies[proxyId].aabb);
+	if (oldRange.lowerX == newRange.lowerX && oldRange.lowerY == newRange.lowerY &&
+		oldRange.upperX == newRange.upperX && oldRange.upperY == newRange.upperY)
+	{
+		return;
+	}
+
+	RemoveEntries(proxyId, oldRange);
+	AddEntries(proxyId, newRange);
+}
+
+bool b2UniformGrid::QueryProxies(b2BroadPhaseQueryCallback* callback, const b2AABB& aabb) const
+{
+	b2CellRange range = GetCellRange(aabb);
+	float32 cells = float32(range.upperX - range.lowerX + 1) * float32(range.upperY - range.lowerY + 1);
+
+	// A query that covers more cells than there are entries is cheaper as a scan.
+	if (cells > float32(m_entryCount))
+	{
+		for (int32 i = 0; i < m_proxyCapacity; ++i)
+		{
+			const b2IndexProxy* proxy = m_proxies + i;
+			if (proxy->allocated == false || proxy->large)
+			{
+				continue;
+			}
+
+			if (b2TestOverlap(proxy->aabb, aabb))
+			{
+				if (callback->QueryCallback(i) == false)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	for (int32 y = range.lowerY; y <= range.upperY; ++y)
+	{
+		for (int32 x = range.lowerX; x <= range.upperX; ++x)
+		{
+			int32 entryId = m_buckets[GetBucket(x, y)];
+			while (entryId != e_nullProxy)
+			{
+				const b2GridEntry* entry = m_entries + entryId;
+				entryId = entry->next;
+
+				if (entry->x != x || entry->y != y)
+				{
+					continue;
+				}
+
+				const b2AABB& proxyAABB = m_proxies[entry->proxyId].aabb;
+				if (b2TestOverlap(proxyAABB, aabb) == false)
+				{
+					continue;
+				}
+
+				// A proxy in several cells is only reported from the first cell
+				// it shares with the query.
+				int32 firstX = b2Max(range.lowerX, GetCell(proxyAABB.lowerBound.x));
+				int32 firstY = b2Max(range.lowerY, GetCell(proxyAABB.lowerBound.y));
+				if (x != firstX || y != firstY)
+				{
+					continue;
+				}
+
+				if (callback->QueryCallback(entry->proxyId) == false)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,58 @@
+#ifndef B2_UNIFORM_GRID_H
+#define B2_UNIFORM_GRID_H
+
+#include "b2BroadPhaseIndex.h"
+
+/// A uniform grid broad-phase index backed by a spatial hash. Each proxy is
+/// entered in every cell its fat AABB touches, so the cell size should be
+/// a bit larger than a typical shape (see b2_gridCellSize). A proxy that only
+/// moves within its cells costs nothing to update.
+class b2UniformGrid : public b2BroadPhaseIndex
+{
+public:
+	b2UniformGrid(float32 cellSize);
+	~b2UniformGrid();
+
+protected:
+	bool IsLarge(const b2AABB& aabb) const;
+	void InsertProxy(int32 proxyId);
+	void RemoveProxy(int32 proxyId);
+	void UpdateProxy(int32 proxyId, const b2AABB& oldAABB);
+	bool QueryProxies(b2BroadPhaseQueryCallback* callback, const b2AABB& aabb) const;
+
+private:
+
+	struct b2GridEntry
+	{
+		int32 x, y;
+		int32 proxyId;
+		int32 next;
+	};
+
+	struct b2CellRange
+	{
+		int32 lowerX, lowerY;
+		int32 upperX, upperY;
+	};
+
+	int32 GetCell(float32 x) const;
+	b2CellRange GetCellRange(const b2AABB& aabb) const;
+	int32 GetBucket(int32 x, int32 y) const;
+
+	void AddEntries(int32 proxyId, const b2CellRange& range);
+	void RemoveEntries(int32 proxyId, const b2CellRange& range);
+	void Rehash(int32 bucketCount);
+
+	float32 m_cellSize;
+	float32 m_invCellSize;
+
+	int32* m_buckets;
+	int32 m_bucketCount;
+
+	b2GridEntry* m_entries;
+	int32 m_entryCount;
+	int32 m_entryCapacity;
+	int32 m_freeEntry;
+};
+
+#endif
@@ -65,6 +65,15 @@ b2BlockAllocator::b2BlockAllocator()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
 
+	memset(m_takenCounts, 0, sizeof(m_takenCounts));
+	memset(m_peakCounts, 0, sizeof(m_peakCounts));
+	m_largeCount = 0;
+	m_allocationCount = 0;
+	m_freeCount = 0;
+
+	m_threadCaching = false;
+	memset(m_caches, 0, sizeof(m_caches));
+
 	if (s_blockSizeLookupInitialized == false)
 	{
 		int32 j = 0;
@@ -96,21 +105,13 @@ b2BlockAllocator::~b2BlockAllocator()
 	b2Free(m_chunks);
 }
 
-void* b2BlockAllocator::Allocate(int32 size)
+b2Block* b2BlockAllocator::AllocateBlock(int32 index)
 {
-	if (size == 0)
-		return NULL;
-
-	b2Assert(0 < size);
-
-	if (size > b2_maxBlockSize)
+	if (++m_takenCounts[index] > m_peakCounts[index])
 	{
-		return b2Alloc(size);
+		m_peakCounts[index] = m_takenCounts[index];
 	}
 
-	int32 index = s_blockSizeLookup[size];
-	b2Assert(0 <= index && index < b2_blockSizes);
-
 	if (m_freeLists[index])
 	{
 		b2Block* block = m_freeLists[index];
@@ -119,26 +120,68 @@ void* b2BlockAllocator::Allocate(int32 size)
 	}
 	else
 	{
-		if (m_chunkCount == m_chunkSpace)
+		return AllocateChunk(index, 1);
+	}
+}
+
+void b2BlockAllocator::AllocateBlocks(int32 index, void** blocks, int32 count)
+{
+	m_takenCounts[index] += count;
+	if (m_takenCounts[index] > m_peakCounts[index])
+	{
+		m_peakCounts[index] = m_takenCounts[index];
+	}
+
+	int32 i = 0;
+	while (i < count && m_freeLists[index])
+	{
+		b2Block* block = m_freeLists[index];
+		m_freeLists[index] = block->next;
+		blocks[i++] = block;
+	}
+
+	int32 blockSize = s_blockSizes[index];
+	int32 blockCount = b2_chunkSize / blockSize;
+	while (i < count)
+	{
+		int32 n = count - i < blockCount ? count - i : blockCount;
+		int8* memory = (int8*)AllocateChunk(index, n);
+		for (int32 j = 0; j < n; ++j)
 		{
-			b2Chunk* oldChunks = m_chunks;
-			m_chunkSpace += b2_chunkArrayIncrement;
-			m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
-			memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
-			memset(m_chunks + m_chunkCount, 0, b2_chunkArrayIncrement * sizeof(b2Chunk));
-			b2Free(oldChunks);
+			blocks[i++] = memory + blockSize * j;
 		}
+	}
+}
+
+// Get a new chunk for a size class. The first reserveCount blocks are left to
+// the caller and the rest go on the free list, which must be empty.
+b2Block* b2BlockAllocator::AllocateChunk(int32 index, int32 reserveCount)
+{
+	b2Assert(m_freeLists[index] == NULL);
 
-		b2Chunk* chunk = m_chunks + m_chunkCount;
-		chunk->blocks = (b2Block*)b2Alloc(b2_chunkSize);
+	if (m_chunkCount == m_chunkSpace)
+	{
+		b2Chunk* oldChunks = m_chunks;
+		m_chunkSpace += b2_chunkArrayIncrement;
+		m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+		memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
+		memset(m_chunks + m_chunkCount, 0, b2_chunkArrayIncrement * sizeof(b2Chunk));
+		b2Free(oldChunks);
+	}
+
+	b2Chunk* chunk = m_chunks + m_chunkCount;
+	chunk->blocks = (b2Block*)b2Alloc(b2_chunkSize);
 #if defined(_DEBUG)
-		memset(chunk->blocks, 0xcd, b2_chunkSize);
+	memset(chunk->blocks, 0xcd, b2_chunkSize);
 #endif
-		int32 blockSize = s_blockSizes[index];
-		chunk->blockSize = blockSize;
-		int32 blockCount = b2_chunkSize / blockSize;
-		b2Assert(blockCount * blockSize <= b2_chunkSize);
-		for (int32 i = 0; i < blockCount - 1; ++i)
+	int32 blockSize = s_blockSizes[index];
+	chunk->blockSize = blockSize;
+	int32 blockCount = b2_chunkSize / blockSize;
+	b2Assert(blockCount * blockSize <= b2_chunkSize);
+	b2Assert(0 < reserveCount && reserveCount <= blockCount);
+	if (reserveCount < blockCount)
+	{
+		for (int32 i = reserveCount; i < blockCount - 1; ++i)
 		{
 			b2Block* block = (b2Block*)((int8*)chunk->blocks + blockSize * i);
 			b2Block* next = (b2Block*)((int8*)chunk->blocks + blockSize * (i + 1));
@@ -147,10 +190,133 @@ void* b2BlockAllocator::Allocate(int32 size)
 		b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (blockCount - 1));
 		last->next = NULL;
 
-		m_freeLists[index] = chunk->blocks->next;
-		++m_chunkCount;
+		m_freeLists[index] = (b2Block*)((int8*)chunk->blocks + blockSize * reserveCount);
+	}
+	++m_chunkCount;
+
+	return chunk->blocks;
+}
+
+void b2BlockAllocator::FreeBlock(b2Block* block, int32 index)
+{
+	--m_takenCounts[index];
+	block->next = m_freeLists[index];
+	m_freeLists[index] = block;
+}
+
+// Move half a cache worth of blocks from the shared pool into a worker cache.
+void b2BlockAllocator::RefillCache(b2BlockCache* cache, int32 index)
+{
+	m_lock.Lock();
+	for (int32 i = 0; i < b2_blockCacheSize / 2; ++i)
+	{
+		b2Block* block = AllocateBlock(index);
+		block->next = cache->freeLists[index];
+		cache->freeLists[index] = block;
+	}
+	m_lock.Unlock();
+
+	cache->counts[index] += b2_blockCacheSize / 2;
+}
+
+// Return all but keep blocks from a worker cache to the shared pool.
+void b2BlockAllocator::DrainCache(b2BlockCache* cache, int32 index, int32 keep)
+{
+	m_lock.Lock();
+	while (cache->counts[index] > keep)
+	{
+		b2Block* block = cache->freeLists[index];
+		cache->freeLists[index] = block->next;
+		--cache->counts[index];
+		FreeBlock(block, index);
+	}
+	m_lock.Unlock();
+}
+
+void* b2BlockAllocator::Allocate(int32 size)
+{
+	if (size == 0)
+		return NULL;
+
+	b2Assert(0 < size);
+
+	if (size > b2_maxBlockSize)
+	{
+		if (m_threadCaching)
+		{
+			m_lock.Lock();
+			++m_largeCount;
+			++m_allocationCount;
+			m_lock.Unlock();
+		}
+		else
+		{
+			++m_largeCount;
+			++m_allocationCount;
+		}
+
+		return b2Alloc(size);
+	}
+
+	int32 index = s_blockSizeLookup[size];
+	b2Assert(0 <= index && index < b2_blockSizes);
+
+	if (m_threadCaching)
+	{
+		int32 worker = b2GetWorkerIndex();
+		if (worker < 0)
+		{
+			m_lock.Lock();
+			b2Block* block = AllocateBlock(index);
+			++m_allocationCount;
+			m_lock.Unlock();
+			return block;
+		}
+
+		b2Assert(worker < b2_maxWorkers);
+		b2BlockCache* cache = m_caches + worker;
+		if (cache->freeLists[index] == NULL)
+		{
+			RefillCache(cache, index);
+		}
+
+		b2Block* block = cache->freeLists[index];
+		cache->freeLists[index] = block->next;
+		--cache->counts[index];
+		++cache->allocationCount;
+		return block;
+	}
+
+	++m_allocationCount;
+	return AllocateBlock(index);
+}
+
+void b2BlockAllocator::Allocate(int32 size, void** blocks, int32 count)
+{
+	// Large blocks and calls from the workers gain nothing from batching.
+	if (size == 0 || size > b2_maxBlockSize || (m_threadCaching && b2GetWorkerIndex() >= 0))
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			blocks[i] = Allocate(size);
+		}
+		return;
+	}
+
+	int32 index = s_blockSizeLookup[size];
+	b2Assert(0 <= index && index < b2_blockSizes);
+
+	if (m_threadCaching)
+	{
+		m_lock.Lock();
+	}
+
+	AllocateBlocks(index, blocks, count);
+	m_allocationCount += count;
 
-		return chunk->blocks;
+	if (m_threadCaching)
+	{
+		m_lock.Unlock();
 	}
 }
 
@@ -165,6 +331,19 @@ void b2BlockAllocator::Free(void* p, int32 size)
 
 	if (size > b2_maxBlockSize)
 	{
+		if (m_threadCaching)
+		{
+			m_lock.Lock();
+			--m_largeCount;
+			++m_freeCount;
+			m_lock.Unlock();
+		}
+		else
+		{
+			--m_largeCount;
+			++m_freeCount;
+		}
+
 		b2Free(p);
 		return;
 	}
@@ -173,7 +352,13 @@ void b2BlockAllocator::Free(void* p, int32 size)
 	b2Assert(0 <= index && index < b2_blockSizes);
 
 #ifdef _DEBUG
-	// Verify the memory address and size is valid.
+	// Verify the memory address and size is valid. The chunk array may grow
+	// on another thread, so hold the lock while walking it.
+	if (m_threadCaching)
+	{
+		m_lock.Lock();
+	}
+
 	int32 blockSize = s_blockSizes[index];
 	bool found = false;
 	for (int32 i = 0; i < m_chunkCount; ++i)
@@ -193,14 +378,44 @@ void b2BlockAllocator::Free(void* p, int32 size)
 		}
 	}
 
+	if (m_threadCaching)
+	{
+		m_lock.Unlock();
+	}
+
 	b2Assert(found);
 
 	memset(p, 0xfd, blockSize);
 #endif
 
 	b2Block* block = (b2Block*)p;
-	block->next = m_freeLists[index];
-	m_freeLists[index] = block;
+
+	if (m_threadCaching)
+	{
+		int32 worker = b2GetWorkerIndex();
+		if (worker < 0)
+		{
+			m_lock.Lock();
+			FreeBlock(block, index);
+			++m_freeCount;
+			m_lock.Unlock();
+			return;
+		}
+
+		b2Assert(worker < b2_maxWorkers);
+		b2BlockCache* cache = m_caches + worker;
+		block->next = cache->freeLists[index];
+		cache->freeLists[index] = block;
+		++cache->freeCount;
+		if (++cache->counts[index] > b2_blockCacheSize)
+		{
+			DrainCache(cache, index, b2_blockCacheSize / 2);
+		}
+		return;
+	}
+
+	++m_freeCount;
+	FreeBlock(block, index);
 }
 
 void b2BlockAllocator::Clear()
@@ -214,4 +429,67 @@ void b2BlockAllocator::Clear()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_takenCounts, 0, sizeof(m_takenCounts));
+
+	// Keep the traffic counted by the caches.
+	for (int32 i = 0; i < b2_maxWorkers; ++i)
+	{
+		m_allocationCount += m_caches[i].allocationCount;
+		m_freeCount += m_caches[i].freeCount;
+	}
+	memset(m_caches, 0, sizeof(m_caches));
+}
+
+void b2BlockAllocator::SetThreadCaching(bool flag)
+{
+	if (flag == m_threadCaching)
+	{
+		return;
+	}
+
+	if (flag == false)
+	{
+		// Give the cached blocks back so the serial path can reach them.
+		for (int32 i = 0; i < b2_maxWorkers; ++i)
+		{
+			for (int32 j = 0; j < b2_blockSizes; ++j)
+			{
+				DrainCache(m_caches + i, j, 0);
+			}
+		}
+	}
+
+	m_threadCaching = flag;
+}
+
+void b2BlockAllocator::GetStats(b2BlockAllocatorStats* stats) const
+{
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		int32 cached = 0;
+		for (int32 j = 0; j < b2_maxWorkers; ++j)
+		{
+			cached += m_caches[j].counts[i];
+		}
+
+		stats->liveBlocks[i] = m_takenCounts[i] - cached;
+		stats->peakBlocks[i] = m_peakCounts[i];
+	}
+
+	stats->largeBlocks = m_largeCount;
+	stats->chunkCount = m_chunkCount;
+
+	stats->allocationCount = m_allocationCount;
+	stats->freeCount = m_freeCount;
+	for (int32 i = 0; i < b2_maxWorkers; ++i)
+	{
+		stats->allocationCount += m_caches[i].allocationCount;
+		stats->freeCount += m_caches[i].freeCount;
+	}
+}
+
+int32 b2BlockAllocator::GetBlockSize(int32 index)
+{
+	b2Assert(0 <= index && index < b2_blockSizes);
+	return s_blockSizes[index];
 }
@@ -20,15 +20,39 @@
 #define B2_BLOCK_ALLOCATOR_H
 
 #include "b2Settings.h"
+#include "b2Parallel.h"
 
 const int32 b2_chunkSize = 16 * 1024;
 const int32 b2_maxBlockSize = 640;
 const int32 b2_blockSizes = 14;
 const int32 b2_chunkArrayIncrement = 128;
+const int32 b2_blockCacheSize = 32;
 
 struct b2Block;
 struct b2Chunk;
 
+/// Block allocator usage. See b2BlockAllocator::GetStats.
+struct b2BlockAllocatorStats
+{
+	/// Blocks allocated and not yet freed, per size class.
+	int32 liveBlocks[b2_blockSizes];
+
+	/// The most blocks of each size class taken from the chunks at once. With
+	/// thread caching this includes blocks parked in worker caches.
+	int32 peakBlocks[b2_blockSizes];
+
+	/// Live allocations larger than b2_maxBlockSize. These are passed to b2Alloc.
+	int32 largeBlocks;
+
+	/// The number of chunks obtained from b2Alloc.
+	int32 chunkCount;
+
+	/// Calls to Allocate and Free since construction. These wrap around, so take
+	/// the difference of two samples to measure the traffic in between.
+	uint32 allocationCount;
+	uint32 freeCount;
+};
+
 /// This is a small object allocator used for allocating small
 /// objects that persist for more than one time step.
 /// See: http://www.codeproject.com/useritems/Small_Block_Allocator.asp
@@ -41,19 +65,64 @@ public:
 	/// Allocate memory. This will use b2Alloc if the size is larger than b2_maxBlockSize.
 	void* Allocate(int32 size);
 
+	/// Allocate count blocks of the same size. Freed blocks are reused first, then the
+	/// rest are carved in order out of new chunks, so a large batch lies contiguously.
+	void Allocate(int32 size, void** blocks, int32 count);
+
 	/// Free memory. This will use b2Free if the size is larger than b2_maxBlockSize.
 	void Free(void* p, int32 size);
 
 	void Clear();
 
+	/// Enable/disable per-worker caches. When enabled, Allocate and Free may be called
+	/// concurrently. Calls from inside b2ParallelFor use the free lists cached for the
+	/// calling worker and only lock the shared pool to move blocks in batches. Other
+	/// calls lock the shared pool directly. Only one b2ParallelFor may use the
+	/// allocator at a time. Do not toggle this while other threads use the allocator.
+	void SetThreadCaching(bool flag);
+	bool GetThreadCaching() const { return m_threadCaching; }
+
+	/// Get the usage statistics. This should be called while no other thread uses
+	/// the allocator.
+	void GetStats(b2BlockAllocatorStats* stats) const;
+
+	/// Get the block size of a size class.
+	static int32 GetBlockSize(int32 index);
+
 private:
 
+	struct b2BlockCache
+	{
+		b2Block* freeLists[b2_blockSizes];
+		int32 counts[b2_blockSizes];
+		uint32 allocationCount;
+		uint32 freeCount;
+	};
+
+	b2Block* AllocateBlock(int32 index);
+	void AllocateBlocks(int32 index, void** blocks, int32 count);
+	b2Block* AllocateChunk(int32 index, int32 reserveCount);
+	void FreeBlock(b2Block* block, int32 index);
+	void RefillCache(b2BlockCache* cache, int32 index);
+	void DrainCache(b2BlockCache* cache, int32 index, int32 keep);
+
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
 
 	b2Block* m_freeLists[b2_blockSizes];
 
+	// Blocks taken from the chunks and not returned to m_freeLists.
+	int32 m_takenCounts[b2_blockSizes];
+	int32 m_peakCounts[b2_blockSizes];
+	int32 m_largeCount;
+	uint32 m_allocationCount;
+	uint32 m_freeCount;
+
+	bool m_threadCaching;
+	b2SpinLock m_lock;
+	b2BlockCache m_caches[b2_maxWorkers];
+
 	static int32 s_blockSizes[b2_blockSizes];
 	static uint8 s_blockSizeLookup[b2_maxBlockSize + 1];
 	static bool s_blockSizeLookupInitialized;
@@ -92,3 +92,78 @@ void b2Mat33::GetSymInverse33(b2Mat33* M) const
 	M->ez.y = M->ey.z;
 	M->ez.z = det * (a11 * a22 - a12 * a12);
 }
+
+#if defined(B2_DETERMINISTIC)
+
+// These only use basic arithmetic, which IEEE rounds the same everywhere. Both are
+// accurate to a few float ulps.
+
+void b2SinCos(float32 angle, float32* s, float32* c)
+{
+	// Wrap to [-pi, pi]. Two pi is split so the product with the turn count is
+	// exact, which keeps large angles precise.
+	float32 turns = floorf(angle * (0.5f / b2_pi) + 0.5f);
+	float32 x = angle - turns * 6.28125f;
+	x = x - turns * 1.9353071795864769e-3f;
+
+	// Fold into [-pi/2, pi/2]. The sine is symmetric there and the cosine flips sign.
+	float32 sign = 1.0f;
+	if (x > 0.5f * b2_pi)
+	{
+		x = (3.140625f - x) + 9.6765358979311600e-4f;
+		sign = -1.0f;
+	}
+	else if (x < -0.5f * b2_pi)
+	{
+		x = (-3.140625f - x) - 9.6765358979311600e-4f;
+		sign = -1.0f;
+	}
+
+	// Taylor series, the error is below a float ulp on this interval.
+	float32 x2 = x * x;
+	*s = x * (1.0f + x2 * (-1.6666667e-1f + x2 * (8.3333333e-3f + x2 * (-1.9841270e-4f +
+		x2 * (2.7557319e-6f + x2 * -2.5052108e-8f)))));
+	*c = sign * (1.0f + x2 * (-0.5f + x2 * (4.1666667e-2f + x2 * (-1.3888889e-3f +
+		x2 * (2.4801587e-5f + x2 * (-2.7557319e-7f + x2 * 2.0876757e-9f))))));
+}
+
+float32 b2Atan2(float32 y, float32 x)
+{
+	float32 ax = b2Abs(x);
+	float32 ay = b2Abs(y);
+	float32 mx = b2Max(ax, ay);
+	float32 mn = b2Min(ax, ay);
+	float32 a = mx > 0.0f ? mn / mx : 0.0f;
+
+	// Reduce the ratio below tan(pi/8) and use the Cephes polynomial.
+	float32 r = 0.0f;
+	if (a > 0.41421356f)
+	{
+		r = 0.25f * b2_pi;
+		a = (a - 1.0f) / (a + 1.0f);
+	}
+
+	float32 a2 = a * a;
+	r += (((8.05374449538e-2f * a2 - 1.38776856032e-1f) * a2 + 1.99777106478e-1f) * a2 -
+		3.33329491539e-1f) * a2 * a + a;
+
+	// Move the angle to the right octant.
+	if (ay > ax)
+	{
+		r = 0.5f * b2_pi - r;
+	}
+
+	if (x < 0.0f)
+	{
+		r = b2_pi - r;
+	}
+
+	if (y < 0.0f)
+	{
+		r = -r;
+	}
+
+	return r;
+}
+
+#endif
@@ -57,8 +57,29 @@ inline float32 b2InvSqrt(float32 x)
 }
 
 #define	b2Sqrt(x)	std::sqrt(x)
+
+#if defined(B2_DETERMINISTIC)
+
+/// Compute the sine and cosine of an angle in radians. Deterministic builds use
+/// a polynomial instead of the C runtime, which differs between platforms.
+void b2SinCos(float32 angle, float32* s, float32* c);
+
+/// Compute the angle of (x, y) in radians, like std::atan2.
+float32 b2Atan2(float32 y, float32 x);
+
+#else
+
+/// Compute the sine and cosine of an angle in radians.
+inline void b2SinCos(float32 angle, float32* s, float32* c)
+{
+	*s = sinf(angle);
+	*c = cosf(angle);
+}
+
 #define	b2Atan2(y, x)	std::atan2(y, x)
 
+#endif
+
 /// A 2D column vector.
 struct b2Vec2
 {
@@ -313,17 +334,13 @@ struct b2Rot
 	/// Initialize from an angle in radians
 	explicit b2Rot(float32 angle)
 	{
-		/// TODO_ERIN optimize
-		s = sinf(angle);
-		c = cosf(angle);
+		b2SinCos(angle, &s, &c);
 	}
 
 	/// Set using an angle in radians.
 	void Set(float32 angle)
 	{
-		/// TODO_ERIN optimize
-		s = sinf(angle);
-		c = cosf(angle);
+		b2SinCos(angle, &s, &c);
 	}
 
 	/// Set to the identity rotation
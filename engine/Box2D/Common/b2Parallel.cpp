@@ -0,0 +1,307 @@
+#include "b2Parallel.h"
+#include "b2Math.h"
+#include "../Collision/b2Distance.h"
+#include "../Collision/b2TimeOfImpact.h"
+
+#if defined(_MSC_VER)
+#define B2_THREAD_LOCAL __declspec(thread)
+#elif __cplusplus >= 201103L
+#define B2_THREAD_LOCAL thread_local
+#else
+#define B2_THREAD_LOCAL
+#endif
+
+static B2_THREAD_LOCAL int32 s_workerIndex = -1;
+
+// Set while the thread runs items of a parallel dispatch. Nested calls from
+// there run inline, so the thread count never multiplies.
+static B2_THREAD_LOCAL bool s_dispatched = false;
+
+int32 b2GetWorkerIndex()
+{
+	return s_workerIndex;
+}
+
+static void b2RunSerial(b2ParallelTask* task, int32 count)
+{
+	// A nested call keeps the worker of the enclosing item, which owns the
+	// per-worker data for as long as the item runs.
+	int32 oldIndex = s_workerIndex;
+	int32 worker = s_dispatched ? oldIndex : 0;
+	s_workerIndex = worker;
+	for (int32 i = 0; i < count; ++i)
+	{
+		task->Execute(i, worker);
+	}
+	s_workerIndex = oldIndex;
+}
+
+#if defined(_MSC_VER)
+
+#include <ppl.h>
+#include <intrin.h>
+
+void b2SpinLock::Lock()
+{
+	while (_InterlockedExchange(&m_flag, 1) != 0)
+	{
+		while (m_flag != 0)
+		{
+		}
+	}
+}
+
+void b2SpinLock::Unlock()
+{
+	_InterlockedExchange(&m_flag, 0);
+}
+
+int32 b2GetWorkerCount()
+{
+	int32 count = (int32)Concurrency::GetProcessorCount();
+	return b2Clamp(count, 1, b2_maxWorkers);
+}
+
+static void b2Dispatch(b2ParallelTask* task, int32 count)
+{
+	int32 workerCount = b2Min(b2GetWorkerCount(), count);
+	if (workerCount <= 1 || s_dispatched)
+	{
+		b2RunSerial(task, count);
+		return;
+	}
+
+	volatile long next = 0;
+	Concurrency::parallel_for(0, workerCount, [&](int32 worker)
+	{
+		int32 oldIndex = s_workerIndex;
+		bool oldDispatched = s_dispatched;
+		s_workerIndex = worker;
+		s_dispatched = true;
+		for (;;)
+		{
+			int32 index = (int32)_InterlockedIncrement(&next) - 1;
+			if (index >= count)
+			{
+				break;
+			}
+
+			task->Execute(index, worker);
+		}
+		s_workerIndex = oldIndex;
+		s_dispatched = oldDispatched;
+	});
+}
+
+#elif __cplusplus >= 201103L
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+void b2SpinLock::Lock()
+{
+	while (__sync_lock_test_and_set(&m_flag, 1) != 0)
+	{
+		while (__atomic_load_n(&m_flag, __ATOMIC_RELAXED) != 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void b2SpinLock::Unlock()
+{
+	__sync_lock_release(&m_flag);
+}
+
+static void b2RunWorker(b2ParallelTask* task, std::atomic<int32>* next, int32 count, int32 worker)
+{
+	int32 oldIndex = s_workerIndex;
+	bool oldDispatched = s_dispatched;
+	s_workerIndex = worker;
+	s_dispatched = true;
+	for (;;)
+	{
+		int32 index = next->fetch_add(1);
+		if (index >= count)
+		{
+			break;
+		}
+
+		task->Execute(index, worker);
+	}
+	s_workerIndex = oldIndex;
+	s_dispatched = oldDispatched;
+}
+
+int32 b2GetWorkerCount()
+{
+	int32 count = (int32)std::thread::hardware_concurrency();
+	return b2Clamp(count, 1, b2_maxWorkers);
+}
+
+// Threads for workers 1 and up, started on first use and kept until exit.
+// The calling thread is worker 0.
+class b2WorkerPool
+{
+public:
+	b2WorkerPool()
+	{
+		m_threadCount = b2GetWorkerCount() - 1;
+		m_task = NULL;
+		m_count = 0;
+		m_workerCount = 0;
+		m_generation = 0;
+		m_activeCount = 0;
+		m_quit = false;
+
+		for (int32 i = 0; i < m_threadCount; ++i)
+		{
+			m_threads[i] = std::thread(&b2WorkerPool::ThreadMain, this, i + 1);
+		}
+	}
+
+	~b2WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_all();
+
+		for (int32 i = 0; i < m_threadCount; ++i)
+		{
+			m_threads[i].join();
+		}
+	}
+
+	void Run(b2ParallelTask* task, int32 count, int32 workerCount)
+	{
+		// Dispatches from different threads take turns.
+		std::lock_guard<std::mutex> run(m_runMutex);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_task = task;
+			m_count = count;
+			m_workerCount = workerCount;
+			m_next = 0;
+			m_activeCount = workerCount - 1;
+			++m_generation;
+		}
+		m_wake.notify_all();
+
+		b2RunWorker(task, &m_next, count, 0);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_activeCount > 0)
+		{
+			m_done.wait(lock);
+		}
+	}
+
+private:
+	void ThreadMain(int32 worker)
+	{
+		uint32 generation = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;)
+		{
+			while (m_quit == false && m_generation == generation)
+			{
+				m_wake.wait(lock);
+			}
+
+			if (m_quit)
+			{
+				break;
+			}
+
+			// A dispatch waits for all of its workers, so none is missed.
+			generation = m_generation;
+			if (worker >= m_workerCount)
+			{
+				continue;
+			}
+
+			b2ParallelTask* task = m_task;
+			int32 count = m_count;
+			lock.unlock();
+
+			b2RunWorker(task, &m_next, count, worker);
+
+			lock.lock();
+			if (--m_activeCount == 0)
+			{
+				m_done.notify_one();
+			}
+		}
+	}
+
+	std::thread m_threads[b2_maxWorkers];
+	int32 m_threadCount;
+
+	std::mutex m_runMutex;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	b2ParallelTask* m_task;
+	int32 m_count;
+	int32 m_workerCount;
+	std::atomic<int32> m_next;
+	uint32 m_generation;
+	int32 m_activeCount;
+	bool m_quit;
+};
+
+static void b2Dispatch(b2ParallelTask* task, int32 count)
+{
+	int32 workerCount = b2Min(b2GetWorkerCount(), count);
+	if (workerCount <= 1 || s_dispatched)
+	{
+		b2RunSerial(task, count);
+		return;
+	}
+
+	static b2WorkerPool s_pool;
+	s_pool.Run(task, count, workerCount);
+}
+
+#else
+
+void b2SpinLock::Lock()
+{
+}
+
+void b2SpinLock::Unlock()
+{
+}
+
+int32 b2GetWorkerCount()
+{
+	return 1;
+}
+
+static void b2Dispatch(b2ParallelTask* task, int32 count)
+{
+	b2RunSerial(task, count);
+}
+
+#endif
+
+void b2ParallelFor(b2ParallelTask* task, int32 count)
+{
+	bool nested = s_dispatched;
+	b2Dispatch(task, count);
+
+	// The workers gather the collision statistics on their own. The outermost
+	// dispatch adds them up once every worker is done.
+	if (nested == false)
+	{
+		b2MergeGJKStats();
+		b2MergeTOIStats();
+	}
+}
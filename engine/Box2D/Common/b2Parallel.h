@@ -0,0 +1,52 @@
+#ifndef B2_PARALLEL_H
+#define B2_PARALLEL_H
+
+#include "b2Settings.h"
+
+/// A unit of work for b2ParallelFor. Execute is called once for every index
+/// in [0, count). Calls may run concurrently, so an implementation must only
+/// write to data owned by that index or by that worker.
+class b2ParallelTask
+{
+public:
+	virtual ~b2ParallelTask() {}
+
+	/// Process one item.
+	/// @param index the item index.
+	/// @param worker the calling worker, in [0, b2GetWorkerCount()). Two calls
+	/// with the same worker index never overlap.
+	virtual void Execute(int32 index, int32 worker) = 0;
+};
+
+/// Get the number of workers b2ParallelFor will use. This is at least 1 and
+/// at most b2_maxWorkers.
+int32 b2GetWorkerCount();
+
+/// Run a task over [0, count) on the worker pool. Items are handed out
+/// dynamically, so uneven item costs balance across workers. Returns once
+/// every item is done. This uses the Concurrency Runtime on MSVC and falls
+/// back to a pool of std::thread workers (C++11), started once and reused,
+/// or a serial loop elsewhere. A call made from inside a task runs inline on
+/// the calling worker. The outermost call adds the GJK and TOI statistics the
+/// workers gathered into the globals before it returns.
+void b2ParallelFor(b2ParallelTask* task, int32 count);
+
+/// Get the worker index of the calling thread while it runs a b2ParallelFor
+/// task, or -1 when called outside of one.
+int32 b2GetWorkerIndex();
+
+/// A minimal spin lock for short critical sections shared between workers.
+/// Without thread support this does nothing.
+class b2SpinLock
+{
+public:
+	b2SpinLock() : m_flag(0) {}
+
+	void Lock();
+	void Unlock();
+
+private:
+	volatile long m_flag;
+};
+
+#endif
@@ -78,6 +78,21 @@ typedef double float64;
 /// Maximum number of sub-steps per contact in continuous physics simulation.
 #define b2_maxSubSteps			8
 
+/// The dynamic tree is rebuilt when its area ratio grows past this multiple of the
+/// ratio measured right after the last rebuild. See b2DynamicTree::Optimize.
+#define b2_treeRebuildRatio		1.5f
+
+/// Proxies wider than this along the x-axis bypass the sweep-and-prune broad-phase
+/// sorted list and are tested by every query instead.
+#define b2_sapLargeProxyWidth	8.0f
+
+/// The cell size of the uniform grid broad-phase. This works best at about twice the
+/// size of a typical shape.
+#define b2_gridCellSize			2.0f
+
+/// Proxies that cover more grid cells than this bypass the uniform grid.
+#define b2_gridMaxProxyCells	16
+
 
 // Dynamics
 
@@ -112,6 +127,10 @@ typedef double float64;
 #define b2_baumgarte				0.2f
 #define b2_toiBaugarte				0.75f
 
+/// The number of graph colors the wide contact solver uses to batch constraints.
+/// Constraints that don't fit in any color are solved one at a time afterwards.
+#define b2_wideColorCount			16
+
 
 // Sleep
 
@@ -124,6 +143,90 @@ typedef double float64;
 /// A body cannot sleep if its angular velocity is above this tolerance.
 #define b2_angularSleepTolerance	(2.0f / 180.0f * b2_pi)
 
+// Gravity
+
+/// The most gravity sources in a leaf of the Barnes-Hut gravity tree.
+#define b2_gravityTreeLeafSize		4
+
+/// The depth limit of the gravity tree. Sources closer than the root size
+/// over 2^depth stay in one leaf.
+#define b2_gravityTreeMaxDepth		24
+
+// Simulation level of detail
+
+/// The most focus points the simulation level of detail is centered on.
+#define b2_maxFocusPoints			8
+
+// Threading
+
+/// The maximum number of worker threads used by the parallel solver paths.
+/// Each worker owns a b2StackAllocator, so keep this modest.
+#define b2_maxWorkers				8
+
+/// The number of contacts a worker updates at a time in the parallel narrow-phase.
+#define b2_collideBlockSize			64
+
+/// The number of queries or ray-casts a worker runs at a time in the batched world queries.
+#define b2_queryBlockSize			64
+
+/// The number of time of impact computations a worker runs at a time in batched
+/// continuous physics.
+#define b2_toiBlockSize				16
+
+/// The number of bodies a worker pulls at a time in Barnes-Hut gravity.
+#define b2_gravityBlockSize			64
+
+/// The number of joints or wide contact batches a worker solves at a time in the
+/// parallel constraint solver.
+#define b2_solverBlockSize			8
+
+/// Islands with fewer contacts and joints than this are solved on one thread even
+/// with the parallel constraint solver enabled.
+#define b2_parallelSolverMinConstraints	256
+
+// Profiling
+
+/// The number of steps b2Profiler keeps for its statistics.
+#define b2_profileStepCount			300
+
+/// The number of timed events b2Profiler keeps for trace export. The oldest
+/// events are overwritten first.
+#define b2_profileEventCount		32768
+
+/// The number of bins in a b2Profiler histogram.
+#define b2_profileHistogramBins		20
+
+// Collision
+
+/// Define B2_SIMD_COLLISION in the project to run the vertex searches of GJK and
+/// the polygon collision routines four vertices at a time, see b2SimdKernels.h.
+/// Polygon pairs then test every edge against every vertex instead of climbing
+/// from the edge facing the other polygon, so manifolds can differ slightly.
+
+// Determinism
+
+/// Define B2_DETERMINISTIC in every project that includes Box2D for lockstep simulation.
+/// b2World::Step then gives bit-identical results for the same inputs across compilers,
+/// optimization levels and worker counts. Trigonometry uses portable polynomials instead
+/// of the C runtime. Floats must be evaluated with SSE2 rather than the x87 stack, and
+/// the Box2D sources must be compiled without float contraction or reordering, that is
+/// with /fp:strict on MSVC or -ffp-contract=off on GCC and clang. Building the solution
+/// with /p:B2Deterministic=true sets this up.
+#if defined(B2_DETERMINISTIC)
+#if defined(__FAST_MATH__)
+#error "B2_DETERMINISTIC cannot be used with -ffast-math"
+#endif
+#if defined(_MSC_VER)
+#if defined(_M_IX86) && (!defined(_M_IX86_FP) || _M_IX86_FP < 2)
+#error "B2_DETERMINISTIC needs SSE2 floating point, build with /arch:SSE2"
+#endif
+#elif defined(__GNUC__)
+#if defined(__i386__) && !defined(__SSE2_MATH__)
+#error "B2_DETERMINISTIC needs SSE2 floating point, build with -msse2 -mfpmath=sse"
+#endif
+#endif
+#endif
+
 // Memory Allocation
 
 /// Implement this function to use your own memory allocator.
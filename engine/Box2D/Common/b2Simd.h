@@ -0,0 +1,294 @@
+#ifndef B2_SIMD_H
+#define B2_SIMD_H
+
+#include "b2Settings.h"
+#include <cstring>
+
+// A minimal 4-wide float vector used by the wide solver paths. On x86 this
+// maps to SSE2, elsewhere it falls back to plain arrays so the wide paths
+// still compile and produce the same results.
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define B2_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+/// The number of lanes in a b2FloatW.
+#define b2_simdWidth 4
+
+#if defined(B2_SIMD_SSE2)
+
+typedef __m128 b2FloatW;
+
+inline b2FloatW b2ZeroW() { return _mm_setzero_ps(); }
+inline b2FloatW b2SplatW(float32 s) { return _mm_set1_ps(s); }
+inline b2FloatW b2LoadW(const float32* p) { return _mm_loadu_ps(p); }
+inline void b2StoreW(float32* p, b2FloatW a) { _mm_storeu_ps(p, a); }
+
+/// Load eight floats, putting the even ones in a and the odd ones in b.
+inline void b2DeinterleaveW(const float32* p, b2FloatW* a, b2FloatW* b)
+{
+	__m128 lo = _mm_loadu_ps(p);
+	__m128 hi = _mm_loadu_ps(p + 4);
+	*a = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+	*b = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+/// Load a pair of floats from each of four addresses, putting the first ones in a
+/// and the second ones in b.
+inline void b2LoadPairsW(const float32* p0, const float32* p1, const float32* p2, const float32* p3,
+						 b2FloatW* a, b2FloatW* b)
+{
+	__m128 lo = _mm_loadh_pi(_mm_castpd_ps(_mm_load_sd((const double*)p0)), (const __m64*)p1);
+	__m128 hi = _mm_loadh_pi(_mm_castpd_ps(_mm_load_sd((const double*)p2)), (const __m64*)p3);
+	*a = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+	*b = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm_add_ps(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm_sub_ps(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm_mul_ps(a, b); }
+inline b2FloatW b2DivW(b2FloatW a, b2FloatW b) { return _mm_div_ps(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm_min_ps(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm_max_ps(a, b); }
+inline b2FloatW b2SqrtW(b2FloatW a) { return _mm_sqrt_ps(a); }
+
+/// Get the smallest or largest lane in every lane.
+inline b2FloatW b2MinLanesW(b2FloatW a)
+{
+	a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+inline b2FloatW b2MaxLanesW(b2FloatW a)
+{
+	a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+/// Get the first lane.
+inline float32 b2FirstLaneW(b2FloatW a) { return _mm_cvtss_f32(a); }
+
+/// Comparisons return a lane mask with all bits set where the test passes.
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return _mm_cmpge_ps(a, b); }
+inline b2FloatW b2GreaterW(b2FloatW a, b2FloatW b) { return _mm_cmpgt_ps(a, b); }
+inline b2FloatW b2LessEqualW(b2FloatW a, b2FloatW b) { return _mm_cmple_ps(a, b); }
+inline b2FloatW b2EqualW(b2FloatW a, b2FloatW b) { return _mm_cmpeq_ps(a, b); }
+
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return _mm_and_ps(a, b); }
+inline b2FloatW b2OrW(b2FloatW a, b2FloatW b) { return _mm_or_ps(a, b); }
+
+/// Per lane mask ? a : b.
+inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/// Get a bit per lane that is set where the mask lane is set.
+inline int32 b2MaskBitsW(b2FloatW mask) { return _mm_movemask_ps(mask); }
+
+#else
+
+struct b2FloatW
+{
+	float32 v[b2_simdWidth];
+};
+
+inline b2FloatW b2SplatW(float32 s)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) r.v[i] = s;
+	return r;
+}
+
+inline b2FloatW b2ZeroW() { return b2SplatW(0.0f); }
+
+inline b2FloatW b2LoadW(const float32* p)
+{
+	b2FloatW r;
+	memcpy(r.v, p, sizeof(r.v));
+	return r;
+}
+
+inline void b2StoreW(float32* p, b2FloatW a) { memcpy(p, a.v, sizeof(a.v)); }
+
+inline void b2DeinterleaveW(const float32* p, b2FloatW* a, b2FloatW* b)
+{
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		a->v[i] = p[2 * i];
+		b->v[i] = p[2 * i + 1];
+	}
+}
+
+inline void b2LoadPairsW(const float32* p0, const float32* p1, const float32* p2, const float32* p3,
+						 b2FloatW* a, b2FloatW* b)
+{
+	const float32* p[b2_simdWidth] = {p0, p1, p2, p3};
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		a->v[i] = p[i][0];
+		b->v[i] = p[i][1];
+	}
+}
+
+#define B2_SIMD_BINARY(name, expr) \
+	inline b2FloatW name(b2FloatW a, b2FloatW b) \
+	{ \
+		b2FloatW r; \
+		for (int32 i = 0; i < b2_simdWidth; ++i) { float32 x = a.v[i]; float32 y = b.v[i]; r.v[i] = (expr); } \
+		return r; \
+	}
+
+B2_SIMD_BINARY(b2AddW, x + y)
+B2_SIMD_BINARY(b2SubW, x - y)
+B2_SIMD_BINARY(b2MulW, x * y)
+B2_SIMD_BINARY(b2DivW, x / y)
+B2_SIMD_BINARY(b2MinW, x < y ? x : y)
+B2_SIMD_BINARY(b2MaxW, x > y ? x : y)
+
+#undef B2_SIMD_BINARY
+
+inline b2FloatW b2SqrtW(b2FloatW a)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) r.v[i] = std::sqrt(a.v[i]);
+	return r;
+}
+
+inline b2FloatW b2MinLanesW(b2FloatW a)
+{
+	float32 m = a.v[0];
+	for (int32 i = 1; i < b2_simdWidth; ++i) m = m < a.v[i] ? m : a.v[i];
+	return b2SplatW(m);
+}
+
+inline b2FloatW b2MaxLanesW(b2FloatW a)
+{
+	float32 m = a.v[0];
+	for (int32 i = 1; i < b2_simdWidth; ++i) m = m > a.v[i] ? m : a.v[i];
+	return b2SplatW(m);
+}
+
+inline float32 b2FirstLaneW(b2FloatW a) { return a.v[0]; }
+
+inline float32 b2MaskLaneW(bool flag)
+{
+	uint32 bits = flag ? 0xFFFFFFFF : 0;
+	float32 f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+inline uint32 b2LaneBitsW(float32 f)
+{
+	uint32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+#define B2_SIMD_COMPARE(name, op) \
+	inline b2FloatW name(b2FloatW a, b2FloatW b) \
+	{ \
+		b2FloatW r; \
+		for (int32 i = 0; i < b2_simdWidth; ++i) r.v[i] = b2MaskLaneW(a.v[i] op b.v[i]); \
+		return r; \
+	}
+
+B2_SIMD_COMPARE(b2GreaterEqualW, >=)
+B2_SIMD_COMPARE(b2GreaterW, >)
+B2_SIMD_COMPARE(b2LessEqualW, <=)
+B2_SIMD_COMPARE(b2EqualW, ==)
+
+#undef B2_SIMD_COMPARE
+
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		uint32 bits = b2LaneBitsW(a.v[i]) & b2LaneBitsW(b.v[i]);
+		memcpy(r.v + i, &bits, sizeof(bits));
+	}
+	return r;
+}
+
+inline b2FloatW b2OrW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		uint32 bits = b2LaneBitsW(a.v[i]) | b2LaneBitsW(b.v[i]);
+		memcpy(r.v + i, &bits, sizeof(bits));
+	}
+	return r;
+}
+
+inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		r.v[i] = b2LaneBitsW(mask.v[i]) ? a.v[i] : b.v[i];
+	}
+	return r;
+}
+
+inline int32 b2MaskBitsW(b2FloatW mask)
+{
+	int32 bits = 0;
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		if (b2LaneBitsW(mask.v[i]))
+		{
+			bits |= 1 << i;
+		}
+	}
+	return bits;
+}
+
+#endif
+
+/// a + b * c
+inline b2FloatW b2MulAddW(b2FloatW a, b2FloatW b, b2FloatW c)
+{
+	return b2AddW(a, b2MulW(b, c));
+}
+
+/// a - b * c
+inline b2FloatW b2MulSubW(b2FloatW a, b2FloatW b, b2FloatW c)
+{
+	return b2SubW(a, b2MulW(b, c));
+}
+
+/// The angle of (x, y) in each lane, like b2Atan2. This uses the polynomial of the
+/// deterministic build and matches b2Atan2 there up to the sign of zero.
+inline b2FloatW b2Atan2W(b2FloatW y, b2FloatW x)
+{
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW(1.0f);
+	b2FloatW ax = b2MaxW(x, b2SubW(zero, x));
+	b2FloatW ay = b2MaxW(y, b2SubW(zero, y));
+	b2FloatW mx = b2MaxW(ax, ay);
+	b2FloatW mn = b2MinW(ax, ay);
+	b2FloatW a = b2SelectW(b2GreaterW(mx, zero), b2DivW(mn, mx), zero);
+
+	// Reduce the ratio below tan(pi/8) and use the Cephes polynomial.
+	b2FloatW reduce = b2GreaterW(a, b2SplatW(0.41421356f));
+	b2FloatW r = b2SelectW(reduce, b2SplatW(0.25f * b2_pi), zero);
+	a = b2SelectW(reduce, b2DivW(b2SubW(a, one), b2AddW(a, one)), a);
+
+	b2FloatW a2 = b2MulW(a, a);
+	b2FloatW t = b2SubW(b2MulW(b2SplatW(8.05374449538e-2f), a2), b2SplatW(1.38776856032e-1f));
+	t = b2AddW(b2MulW(t, a2), b2SplatW(1.99777106478e-1f));
+	t = b2SubW(b2MulW(t, a2), b2SplatW(3.33329491539e-1f));
+	r = b2AddW(r, b2AddW(b2MulW(b2MulW(t, a2), a), a));
+
+	// Move the angle to the right octant.
+	r = b2SelectW(b2GreaterW(ay, ax), b2SubW(b2SplatW(0.5f * b2_pi), r), r);
+	r = b2SelectW(b2GreaterW(zero, x), b2SubW(b2SplatW(b2_pi), r), r);
+	r = b2SelectW(b2GreaterW(zero, y), b2SubW(zero, r), r);
+	return r;
+}
+
+#endif
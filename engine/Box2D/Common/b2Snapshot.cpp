@@ -0,0 +1,48 @@
+#include "b2Snapshot.h"
+#include "b2Math.h"
+
+b2Snapshot::b2Snapshot()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_capacity = 0;
+}
+
+b2Snapshot::~b2Snapshot()
+{
+	if (m_data)
+	{
+		b2Free(m_data);
+	}
+}
+
+void b2Snapshot::Clear()
+{
+	m_size = 0;
+}
+
+void b2Snapshot::SetData(const void* data, int32 size)
+{
+	m_size = 0;
+	Write(data, size);
+}
+
+void b2Snapshot::Reserve(int32 capacity)
+{
+	char* oldData = m_data;
+	m_capacity = b2Max(capacity, 2 * m_capacity);
+	m_data = (char*)b2Alloc(m_capacity);
+	if (oldData)
+	{
+		memcpy(m_data, oldData, m_size);
+		b2Free(oldData);
+	}
+}
+
+b2SnapshotReader::b2SnapshotReader(const void* data, int32 size)
+{
+	m_data = (const char*)data;
+	m_size = size;
+	m_offset = 0;
+	m_valid = data != NULL;
+}
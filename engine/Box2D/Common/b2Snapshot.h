@@ -0,0 +1,147 @@
+#ifndef B2_SNAPSHOT_H
+#define B2_SNAPSHOT_H
+
+#include "b2Settings.h"
+#include <cstring>
+
+/// A growable byte buffer holding a binary world snapshot. See b2World::SaveSnapshot.
+/// The buffer is kept when the snapshot is cleared, so saving into the same
+/// snapshot every step stops touching the heap once it has grown.
+/// Values are written in the memory layout of this build, so a snapshot should
+/// be restored by the same build of the engine.
+class b2Snapshot
+{
+public:
+	b2Snapshot();
+	~b2Snapshot();
+
+	/// Discard the contents but keep the buffer.
+	void Clear();
+
+	/// Replace the contents, e.g. with a snapshot loaded from a file.
+	void SetData(const void* data, int32 size);
+
+	/// Get the snapshot bytes, e.g. to save them to a file.
+	const void* GetData() const;
+
+	/// Get the number of snapshot bytes.
+	int32 GetSize() const;
+
+	/// Append raw bytes.
+	void Write(const void* data, int32 size);
+
+	/// Append a value.
+	template <typename T>
+	void Write(const T& value)
+	{
+		Write(&value, sizeof(T));
+	}
+
+private:
+
+	b2Snapshot(const b2Snapshot&);
+	b2Snapshot& operator=(const b2Snapshot&);
+
+	void Reserve(int32 capacity);
+
+	char* m_data;
+	int32 m_size;
+	int32 m_capacity;
+};
+
+/// Reads values back from snapshot bytes in the order they were written. Reading
+/// past the end yields zeros and marks the reader invalid.
+class b2SnapshotReader
+{
+public:
+	b2SnapshotReader(const void* data, int32 size);
+
+	/// Read raw bytes.
+	void Read(void* data, int32 size);
+
+	/// Read a value.
+	template <typename T>
+	void Read(T* value)
+	{
+		Read(value, sizeof(T));
+	}
+
+	/// Read a bool. Any nonzero byte is true, so bad data can't produce an invalid bool.
+	void Read(bool* value)
+	{
+		uint8 byte;
+		Read(&byte, sizeof(uint8));
+		*value = byte != 0;
+	}
+
+	/// Mark the data as bad, e.g. when a value read is out of range.
+	void Invalidate();
+
+	/// False if the data ran out or was marked bad.
+	bool IsValid() const;
+
+	/// Get the number of bytes left to read. Used to bound counts read from the
+	/// data before anything is allocated for them.
+	int32 GetRemainingSize() const;
+
+private:
+
+	const char* m_data;
+	int32 m_size;
+	int32 m_offset;
+	bool m_valid;
+};
+
+inline const void* b2Snapshot::GetData() const
+{
+	return m_data;
+}
+
+inline int32 b2Snapshot::GetSize() const
+{
+	return m_size;
+}
+
+inline void b2Snapshot::Write(const void* data, int32 size)
+{
+	if (m_size + size > m_capacity)
+	{
+		Reserve(m_size + size);
+	}
+
+	memcpy(m_data + m_size, data, size);
+	m_size += size;
+}
+
+inline void b2SnapshotReader::Read(void* data, int32 size)
+{
+	if (m_valid == false || size < 0 || size > m_size - m_offset)
+	{
+		m_valid = false;
+		if (size > 0)
+		{
+			memset(data, 0, size);
+		}
+		return;
+	}
+
+	memcpy(data, m_data + m_offset, size);
+	m_offset += size;
+}
+
+inline void b2SnapshotReader::Invalidate()
+{
+	m_valid = false;
+}
+
+inline bool b2SnapshotReader::IsValid() const
+{
+	return m_valid;
+}
+
+inline int32 b2SnapshotReader::GetRemainingSize() const
+{
+	return m_size - m_offset;
+}
+
+#endif
@@ -18,39 +18,88 @@
 
 #include "b2StackAllocator.h"
 #include "b2Math.h"
+#include <cstring>
 
 b2StackAllocator::b2StackAllocator()
 {
+	m_firstPage.data = m_data;
+	m_firstPage.capacity = b2_stackSize;
+	m_firstPage.next = NULL;
+	m_page = &m_firstPage;
 	m_index = 0;
 	m_allocation = 0;
 	m_maxAllocation = 0;
+	m_entries = m_entryBuffer;
 	m_entryCount = 0;
+	m_entryCapacity = b2_maxStackEntries;
 }
 
 b2StackAllocator::~b2StackAllocator()
 {
 	b2Assert(m_index == 0);
 	b2Assert(m_entryCount == 0);
+
+	b2StackPage* page = m_firstPage.next;
+	while (page)
+	{
+		b2StackPage* next = page->next;
+		b2Free(page);
+		page = next;
+	}
+
+	if (m_entries != m_entryBuffer)
+	{
+		b2Free(m_entries);
+	}
 }
 
 void* b2StackAllocator::Allocate(int32 size)
 {
-	b2Assert(m_entryCount < b2_maxStackEntries);
-
-	b2StackEntry* entry = m_entries + m_entryCount;
-	entry->size = size;
-	if (m_index + size > b2_stackSize)
+	if (m_entryCount == m_entryCapacity)
 	{
-		entry->data = (char*)b2Alloc(size);
-		entry->usedMalloc = true;
+		b2StackEntry* oldEntries = m_entries;
+		m_entryCapacity *= 2;
+		m_entries = (b2StackEntry*)b2Alloc(m_entryCapacity * sizeof(b2StackEntry));
+		memcpy(m_entries, oldEntries, m_entryCount * sizeof(b2StackEntry));
+		if (oldEntries != m_entryBuffer)
+		{
+			b2Free(oldEntries);
+		}
 	}
-	else
+
+	if (m_index + size > m_page->capacity)
 	{
-		entry->data = m_data + m_index;
-		entry->usedMalloc = false;
-		m_index += size;
+		// Pages after the current one are empty. Reuse the next page if it is
+		// large enough, otherwise replace it with one that is.
+		b2StackPage* next = m_page->next;
+		if (next == NULL || next->capacity < size)
+		{
+			int32 capacity = b2Max(2 * m_page->capacity, size);
+			b2StackPage* page = (b2StackPage*)b2Alloc(sizeof(b2StackPage) + capacity);
+			page->data = (char*)(page + 1);
+			page->capacity = capacity;
+			page->next = NULL;
+
+			if (next != NULL)
+			{
+				page->next = next->next;
+				b2Free(next);
+			}
+
+			m_page->next = page;
+			next = page;
+		}
+
+		m_page = next;
+		m_index = 0;
 	}
 
+	b2StackEntry* entry = m_entries + m_entryCount;
+	entry->data = m_page->data + m_index;
+	entry->size = size;
+	entry->page = m_page;
+	m_index += size;
+
 	m_allocation += size;
 	m_maxAllocation = b2Max(m_maxAllocation, m_allocation);
 	++m_entryCount;
@@ -63,17 +112,20 @@ void b2StackAllocator::Free(void* p)
 	b2Assert(m_entryCount > 0);
 	b2StackEntry* entry = m_entries + m_entryCount - 1;
 	b2Assert(p == entry->data);
-	if (entry->usedMalloc)
-	{
-		b2Free(p);
-	}
-	else
-	{
-		m_index -= entry->size;
-	}
+
+	// Rewind to where this entry started. This may step back to an earlier page.
+	m_page = entry->page;
+	m_index = (int32)(entry->data - m_page->data);
+
 	m_allocation -= entry->size;
 	--m_entryCount;
 
+	if (m_entryCount == 0)
+	{
+		m_page = &m_firstPage;
+		m_index = 0;
+	}
+
 	p = NULL;
 }
 
@@ -81,3 +133,23 @@ int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+int32 b2StackAllocator::GetCapacity() const
+{
+	int32 capacity = 0;
+	for (const b2StackPage* page = &m_firstPage; page; page = page->next)
+	{
+		capacity += page->capacity;
+	}
+	return capacity;
+}
+
+int32 b2StackAllocator::GetPageCount() const
+{
+	int32 count = 0;
+	for (const b2StackPage* page = m_firstPage.next; page; page = page->next)
+	{
+		++count;
+	}
+	return count;
+}
@@ -24,16 +24,26 @@
 const int32 b2_stackSize = 100 * 1024;	// 100k
 const int32 b2_maxStackEntries = 32;
 
+struct b2StackPage
+{
+	char* data;
+	int32 capacity;
+	b2StackPage* next;
+};
+
 struct b2StackEntry
 {
 	char* data;
 	int32 size;
-	bool usedMalloc;
+	b2StackPage* page;
 };
 
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
+// When the inline buffer is exhausted the stack continues on heap pages
+// chained after it. Pages are kept until the allocator is destroyed, so once
+// a scene has reached its high-water mark no step touches the heap.
 class b2StackAllocator
 {
 public:
@@ -43,18 +53,29 @@ public:
 	void* Allocate(int32 size);
 	void Free(void* p);
 
+	/// Get the most bytes that were allocated at once.
 	int32 GetMaxAllocation() const;
 
+	/// Get the bytes reserved by the inline buffer and the chained pages.
+	int32 GetCapacity() const;
+
+	/// Get the number of heap pages chained after the inline buffer.
+	int32 GetPageCount() const;
+
 private:
 
 	char m_data[b2_stackSize];
+	b2StackPage m_firstPage;
+	b2StackPage* m_page;
 	int32 m_index;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
 
-	b2StackEntry m_entries[b2_maxStackEntries];
+	b2StackEntry m_entryBuffer[b2_maxStackEntries];
+	b2StackEntry* m_entries;
 	int32 m_entryCount;
+	int32 m_entryCapacity;
 };
 
 #endif
@@ -58,6 +58,14 @@ float32 b2Timer::GetMilliseconds() const
 	return ms;
 }
 
+float64 b2Timer::GetMicroseconds() const
+{
+	LARGE_INTEGER largeInteger;
+	QueryPerformanceCounter(&largeInteger);
+	float64 count = float64(largeInteger.QuadPart);
+	return 1000.0 * s_invFrequency * (count - m_start);
+}
+
 #elif defined(__linux__) || defined (__APPLE__)
 
 #include <sys/time.h>
@@ -72,14 +80,21 @@ void b2Timer::Reset()
     timeval t;
     gettimeofday(&t, 0);
     m_start_sec = t.tv_sec;
-    m_start_msec = t.tv_usec * 0.001f;
+    m_start_usec = t.tv_usec;
 }
 
 float32 b2Timer::GetMilliseconds() const
 {
     timeval t;
     gettimeofday(&t, 0);
-    return (t.tv_sec - m_start_sec) * 1000 + t.tv_usec * 0.001f - m_start_msec;
+    return (t.tv_sec - m_start_sec) * 1000 + t.tv_usec * 0.001f - m_start_usec * 0.001f;
+}
+
+float64 b2Timer::GetMicroseconds() const
+{
+    timeval t;
+    gettimeofday(&t, 0);
+    return float64(t.tv_sec - m_start_sec) * 1000000.0 + float64(t.tv_usec) - float64(m_start_usec);
 }
 
 #else
@@ -97,4 +112,9 @@ float32 b2Timer::GetMilliseconds() const
 	return 0.0f;
 }
 
+float64 b2Timer::GetMicroseconds() const
+{
+	return 0.0;
+}
+
 #endif
@@ -16,6 +16,9 @@
 * 3. This notice may not be removed or altered from any source distribution.
 */
 
+#ifndef B2_TIMER_H
+#define B2_TIMER_H
+
 #include "../Common/b2Settings.h"
 
 /// Timer for profiling. This has platform specific code and may
@@ -33,6 +36,10 @@ public:
 	/// Get the time since construction or the last reset.
 	float32 GetMilliseconds() const;
 
+	/// Get the time since construction or the last reset in microseconds. This keeps
+	/// its precision over long runs, so use it for timestamps.
+	float64 GetMicroseconds() const;
+
 private:
 
 #if defined(_WIN32)
@@ -40,6 +47,8 @@ private:
 	static float64 s_invFrequency;
 #elif defined(__linux__) || defined (__APPLE__)
 	unsigned long m_start_sec;
-	unsigned long m_start_msec;
+	unsigned long m_start_usec;
 #endif
 };
+
+#endif
@@ -23,6 +23,7 @@
 #include "../../Collision/b2Collision.h"
 #include "../../Collision/Shapes/b2Shape.h"
 #include "../../Dynamics/b2Fixture.h"
+#include "../../Dynamics/Contacts/b2ContactSolver.h"
 
 class b2Body;
 class b2Contact;
@@ -140,6 +141,7 @@ public:
 
 protected:
 	friend class b2ContactManager;
+	friend class b2CollideTask;
 	friend class b2World;
 	friend class b2ContactSolver;
 	friend class b2Body;
@@ -164,12 +166,18 @@ protected:
 		e_bulletHitFlag		= 0x0010,
 
 		// This contact has a valid TOI in m_toi
-		e_toiFlag			= 0x0020
+		e_toiFlag			= 0x0020,
+
+		// m_constraintCache matches the fixtures and bodies
+		e_constraintCacheFlag	= 0x0040
 	};
 
 	/// Flag this contact for filtering. Filtering will occur the next time step.
 	void FlagForFiltering();
 
+	/// Gather the solver data that only changes with the fixtures and body masses.
+	void UpdateConstraintCache();
+
 	static void AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destroyFcn,
 						b2Shape::Type typeA, b2Shape::Type typeB);
 	static void InitializeRegisters();
@@ -183,6 +191,12 @@ protected:
 
 	void Update(b2ContactListener* listener);
 
+	// Update is split for the parallel narrow-phase. UpdateManifold only writes
+	// to this contact, so different contacts may be updated concurrently.
+	// ReportUpdate wakes bodies and calls the listener, so it must run in order.
+	bool UpdateManifold(b2Manifold* oldManifold);
+	void ReportUpdate(const b2Manifold& oldManifold, bool touching, b2ContactListener* listener);
+
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
 
@@ -209,6 +223,8 @@ protected:
 
 	float32 m_friction;
 	float32 m_restitution;
+
+	b2ContactConstraintCache m_constraintCache;
 };
 
 inline b2Manifold* b2Contact::GetManifold()
@@ -22,7 +22,9 @@
 #include "../../Dynamics/b2Body.h"
 #include "../../Dynamics/b2Fixture.h"
 #include "../../Dynamics/b2World.h"
+#include "../../Dynamics/Joints/b2Joint.h"
 #include "../../Common/b2StackAllocator.h"
+#include "../../Common/b2Simd.h"
 
 #define B2_DEBUG_SOLVER 0
 
@@ -48,6 +50,12 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_count = def->count;
 	m_positionConstraints = (b2ContactPositionConstraint*)m_allocator->Allocate(m_count * sizeof(b2ContactPositionConstraint));
 	m_velocityConstraints = (b2ContactVelocityConstraint*)m_allocator->Allocate(m_count * sizeof(b2ContactVelocityConstraint));
+	m_colors = NULL;
+	m_wideConstraints = NULL;
+	m_wideCount = 0;
+	m_joints = def->joints;
+	m_jointCount = def->jointCount;
+	m_coloredJoints = NULL;
 	m_positions = def->positions;
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
@@ -57,14 +65,17 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	{
 		b2Contact* contact = m_contacts[i];
 
-		b2Fixture* fixtureA = contact->m_fixtureA;
-		b2Fixture* fixtureB = contact->m_fixtureB;
-		b2Shape* shapeA = fixtureA->GetShape();
-		b2Shape* shapeB = fixtureB->GetShape();
-		float32 radiusA = shapeA->m_radius;
-		float32 radiusB = shapeB->m_radius;
-		b2Body* bodyA = fixtureA->GetBody();
-		b2Body* bodyB = fixtureB->GetBody();
+		// Resting contacts keep their fixture and mass data across steps.
+		if ((contact->m_flags & b2Contact::e_constraintCacheFlag) == 0)
+		{
+			contact->UpdateConstraintCache();
+		}
+
+		const b2ContactConstraintCache* cache = &contact->m_constraintCache;
+
+		// Each contact edge points at the other body.
+		int32 indexA = contact->m_nodeB.other->m_islandIndex;
+		int32 indexB = contact->m_nodeA.other->m_islandIndex;
 		b2Manifold* manifold = contact->GetManifold();
 
 		int32 pointCount = manifold->pointCount;
@@ -73,31 +84,31 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 		vc->friction = contact->m_friction;
 		vc->restitution = contact->m_restitution;
-		vc->indexA = bodyA->m_islandIndex;
-		vc->indexB = bodyB->m_islandIndex;
-		vc->invMassA = bodyA->m_invMass;
-		vc->invMassB = bodyB->m_invMass;
-		vc->invIA = bodyA->m_invI;
-		vc->invIB = bodyB->m_invI;
+		vc->indexA = indexA;
+		vc->indexB = indexB;
+		vc->invMassA = cache->invMassA;
+		vc->invMassB = cache->invMassB;
+		vc->invIA = cache->invIA;
+		vc->invIB = cache->invIB;
 		vc->contactIndex = i;
 		vc->pointCount = pointCount;
 		vc->K.SetZero();
 		vc->normalMass.SetZero();
 
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
-		pc->indexA = bodyA->m_islandIndex;
-		pc->indexB = bodyB->m_islandIndex;
-		pc->invMassA = bodyA->m_invMass;
-		pc->invMassB = bodyB->m_invMass;
-		pc->localCenterA = bodyA->m_sweep.localCenter;
-		pc->localCenterB = bodyB->m_sweep.localCenter;
-		pc->invIA = bodyA->m_invI;
-		pc->invIB = bodyB->m_invI;
+		pc->indexA = indexA;
+		pc->indexB = indexB;
+		pc->invMassA = cache->invMassA;
+		pc->invMassB = cache->invMassB;
+		pc->localCenterA = cache->localCenterA;
+		pc->localCenterB = cache->localCenterB;
+		pc->invIA = cache->invIA;
+		pc->invIB = cache->invIB;
 		pc->localNormal = manifold->localNormal;
 		pc->localPoint = manifold->localPoint;
 		pc->pointCount = pointCount;
-		pc->radiusA = radiusA;
-		pc->radiusB = radiusB;
+		pc->radiusA = cache->radiusA;
+		pc->radiusB = cache->radiusB;
 		pc->type = manifold->type;
 
 		for (int32 j = 0; j < pointCount; ++j)
@@ -129,6 +140,21 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_wideConstraints)
+	{
+		m_allocator->Free(m_wideConstraints);
+	}
+
+	if (m_coloredJoints)
+	{
+		m_allocator->Free(m_coloredJoints);
+	}
+
+	if (m_colors)
+	{
+		m_allocator->Free(m_colors);
+	}
+
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
@@ -243,10 +269,21 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			}
 		}
 	}
+
+	if (m_step.wideSolver || m_step.parallelSolver)
+	{
+		PrepareWideConstraints();
+	}
 }
 
 void b2ContactSolver::WarmStart()
 {
+	if (m_wideConstraints)
+	{
+		WarmStartWide();
+		return;
+	}
+
 	// Warm start.
 	for (int32 i = 0; i < m_count; ++i)
 	{
@@ -287,6 +324,12 @@ void b2ContactSolver::WarmStart()
 
 void b2ContactSolver::SolveVelocityConstraints()
 {
+	if (m_wideConstraints)
+	{
+		SolveVelocityConstraintsWide();
+		return;
+	}
+
 	for (int32 i = 0; i < m_count; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
@@ -597,6 +640,11 @@ void b2ContactSolver::SolveVelocityConstraints()
 
 void b2ContactSolver::StoreImpulses()
 {
+	if (m_wideConstraints)
+	{
+		StoreWideImpulses();
+	}
+
 	for (int32 i = 0; i < m_count; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
@@ -664,6 +712,11 @@ struct b2PositionSolverManifold
 // Sequential solver.
 bool b2ContactSolver::SolvePositionConstraints()
 {
+	if (m_wideConstraints)
+	{
+		return SolvePositionConstraintsWide();
+	}
+
 	float32 minSeparation = 0.0f;
 
 	for (int32 i = 0; i < m_count; ++i)
@@ -830,3 +883,712 @@ bool b2ContactSolver::SolveTOIPositionConstraints(int32 toiIndexA, int32 toiInde
 	// push the separation above -b2_linearSlop.
 	return minSeparation >= -1.5f * b2_linearSlop;
 }
+
+// Wide solver
+//
+// The wide solver solves up to b2_simdWidth contact constraints at once, one per
+// SIMD lane. The constraints are first colored so that no two constraints of the
+// same color touch the same dynamic body. Each color is then cut into batches of
+// constraints with the same point count. Lanes in a batch never write the same
+// body, so a batch can gather its bodies, solve and scatter them back. Static and
+// kinematic bodies have no inverse mass and are only read, so they are shared.
+//
+// The math is the same as the scalar solver above. Only the order in which the
+// constraints are visited differs, so results match up to round-off and the
+// usual Gauss-Seidel ordering differences.
+
+struct b2VelocityConstraintPointW
+{
+	float32 rAx[b2_simdWidth], rAy[b2_simdWidth];
+	float32 rBx[b2_simdWidth], rBy[b2_simdWidth];
+	float32 normalImpulse[b2_simdWidth];
+	float32 tangentImpulse[b2_simdWidth];
+	float32 normalMass[b2_simdWidth];
+	float32 tangentMass[b2_simdWidth];
+	float32 velocityBias[b2_simdWidth];
+};
+
+struct b2ContactConstraintW
+{
+	b2VelocityConstraintPointW points[b2_maxManifoldPoints];
+	float32 normalX[b2_simdWidth], normalY[b2_simdWidth];
+	float32 invMassA[b2_simdWidth], invMassB[b2_simdWidth];
+	float32 invIA[b2_simdWidth], invIB[b2_simdWidth];
+	float32 friction[b2_simdWidth];
+
+	// Block solver, K = [k11 k12; k12 k22] and normalMass = inverse(K).
+	float32 k11[b2_simdWidth], k12[b2_simdWidth], k22[b2_simdWidth];
+	float32 nm11[b2_simdWidth], nm12[b2_simdWidth], nm21[b2_simdWidth], nm22[b2_simdWidth];
+
+	int32 constraints[b2_simdWidth];
+	int32 indexA[b2_simdWidth];
+	int32 indexB[b2_simdWidth];
+	int32 count;
+	int32 pointCount;
+};
+
+struct b2BodyW
+{
+	b2FloatW vx, vy, w;
+};
+
+static inline b2BodyW b2GatherBodies(const b2Velocity* velocities, const int32* indices, int32 count)
+{
+	float32 vx[b2_simdWidth] = {0.0f};
+	float32 vy[b2_simdWidth] = {0.0f};
+	float32 w[b2_simdWidth] = {0.0f};
+	for (int32 i = 0; i < count; ++i)
+	{
+		const b2Velocity& v = velocities[indices[i]];
+		vx[i] = v.v.x;
+		vy[i] = v.v.y;
+		w[i] = v.w;
+	}
+
+	b2BodyW b;
+	b.vx = b2LoadW(vx);
+	b.vy = b2LoadW(vy);
+	b.w = b2LoadW(w);
+	return b;
+}
+
+// Bodies without mass are skipped. They don't change and other threads of the
+// parallel solver may be reading them.
+static inline void b2ScatterBodies(b2Velocity* velocities, const int32* indices, int32 count, const b2BodyW& b,
+	const float32* invMass, const float32* invI)
+{
+	float32 vx[b2_simdWidth], vy[b2_simdWidth], w[b2_simdWidth];
+	b2StoreW(vx, b.vx);
+	b2StoreW(vy, b.vy);
+	b2StoreW(w, b.w);
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (invMass[i] == 0.0f && invI[i] == 0.0f)
+		{
+			continue;
+		}
+
+		b2Velocity& v = velocities[indices[i]];
+		v.v.x = vx[i];
+		v.v.y = vy[i];
+		v.w = w[i];
+	}
+}
+
+// Relative velocity at a contact point projected on (dx, dy).
+static inline b2FloatW b2RelativeVelocityW(const b2BodyW& A, const b2BodyW& B,
+	b2FloatW rAx, b2FloatW rAy, b2FloatW rBx, b2FloatW rBy, b2FloatW dx, b2FloatW dy)
+{
+	// dv = vB + cross(wB, rB) - vA - cross(wA, rA)
+	b2FloatW dvx = b2AddW(b2SubW(b2SubW(B.vx, b2MulW(B.w, rBy)), A.vx), b2MulW(A.w, rAy));
+	b2FloatW dvy = b2SubW(b2SubW(b2AddW(B.vy, b2MulW(B.w, rBx)), A.vy), b2MulW(A.w, rAx));
+	return b2AddW(b2MulW(dvx, dx), b2MulW(dvy, dy));
+}
+
+// cross(r, P)
+static inline b2FloatW b2CrossW(b2FloatW rx, b2FloatW ry, b2FloatW Px, b2FloatW Py)
+{
+	return b2SubW(b2MulW(rx, Py), b2MulW(ry, Px));
+}
+
+// Take the first color that neither body has used yet. Bodies without mass are
+// only read, so they can be shared. Returns b2_wideColorCount if all are taken.
+static int32 b2TakeColor(uint32* bodyColors, int32 indexA, bool movableA, int32 indexB, bool movableB)
+{
+	uint32 used = 0;
+	if (movableA)
+	{
+		used |= bodyColors[indexA];
+	}
+	if (movableB)
+	{
+		used |= bodyColors[indexB];
+	}
+
+	int32 color = b2_wideColorCount;
+	for (int32 c = 0; c < b2_wideColorCount; ++c)
+	{
+		if ((used & (1 << c)) == 0)
+		{
+			color = c;
+			break;
+		}
+	}
+
+	if (color < b2_wideColorCount)
+	{
+		if (movableA)
+		{
+			bodyColors[indexA] |= 1 << color;
+		}
+		if (movableB)
+		{
+			bodyColors[indexB] |= 1 << color;
+		}
+	}
+
+	return color;
+}
+
+void b2ContactSolver::PrepareWideConstraints()
+{
+	memset(m_colorStarts, 0, sizeof(m_colorStarts));
+	memset(m_jointColorStarts, 0, sizeof(m_jointColorStarts));
+
+	// Joints are only colored for the parallel solver.
+	int32 jointCount = m_step.parallelSolver ? m_jointCount : 0;
+
+	if (m_count == 0 && jointCount == 0)
+	{
+		return;
+	}
+
+	// Only bodies with mass are written by the solver.
+	int32 bodyCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		if (vc->invMassA > 0.0f || vc->invIA > 0.0f)
+		{
+			b2Assert(vc->indexA >= 0);
+			bodyCount = b2Max(bodyCount, vc->indexA + 1);
+		}
+
+		if (vc->invMassB > 0.0f || vc->invIB > 0.0f)
+		{
+			b2Assert(vc->indexB >= 0);
+			bodyCount = b2Max(bodyCount, vc->indexB + 1);
+		}
+	}
+
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		b2Body* bodyA = m_joints[i]->GetBodyA();
+		b2Body* bodyB = m_joints[i]->GetBodyB();
+		if (bodyA->GetType() == b2_dynamicBody)
+		{
+			bodyCount = b2Max(bodyCount, bodyA->m_islandIndex + 1);
+		}
+
+		if (bodyB->GetType() == b2_dynamicBody)
+		{
+			bodyCount = b2Max(bodyCount, bodyB->m_islandIndex + 1);
+		}
+	}
+
+	m_colors = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+
+	if (jointCount > 0)
+	{
+		m_coloredJoints = (b2Joint**)m_allocator->Allocate(jointCount * sizeof(b2Joint*));
+	}
+
+	uint32* bodyColors = (uint32*)m_allocator->Allocate(bodyCount * sizeof(uint32));
+	memset(bodyColors, 0, bodyCount * sizeof(uint32));
+
+	// Joints take their colors first, then the contacts fill in around them.
+	if (jointCount > 0)
+	{
+		int32* jointColors = (int32*)m_allocator->Allocate(jointCount * sizeof(int32));
+		int32 jointColorSizes[b2_wideColorCount + 1];
+		memset(jointColorSizes, 0, sizeof(jointColorSizes));
+
+		for (int32 i = 0; i < jointCount; ++i)
+		{
+			b2Body* bodyA = m_joints[i]->GetBodyA();
+			b2Body* bodyB = m_joints[i]->GetBodyB();
+			bool movableA = bodyA->GetType() == b2_dynamicBody;
+			bool movableB = bodyB->GetType() == b2_dynamicBody;
+
+			// Joints write both bodies even when one has no mass, and gear joints
+			// also move the bodies of their two joints. Those are left to the
+			// serial color so they never run next to a reader of the same body.
+			int32 color = b2_wideColorCount;
+			if (movableA && movableB && m_joints[i]->GetType() != e_gearJoint)
+			{
+				color = b2TakeColor(bodyColors, bodyA->m_islandIndex, true, bodyB->m_islandIndex, true);
+			}
+
+			jointColors[i] = color;
+			++jointColorSizes[color];
+		}
+
+		for (int32 color = 0; color <= b2_wideColorCount; ++color)
+		{
+			m_jointColorStarts[color + 1] = m_jointColorStarts[color] + jointColorSizes[color];
+			jointColorSizes[color] = m_jointColorStarts[color];
+		}
+
+		// Sort by color, keeping the island order within a color.
+		for (int32 i = 0; i < jointCount; ++i)
+		{
+			m_coloredJoints[jointColorSizes[jointColors[i]]++] = m_joints[i];
+		}
+
+		m_allocator->Free(jointColors);
+	}
+
+	// Greedy coloring. Index b2_wideColorCount holds the constraints that didn't fit.
+	const int32 groupCount = (b2_wideColorCount + 1) * b2_maxManifoldPoints;
+	int32 groupSizes[groupCount];
+	int32 groupStarts[groupCount];
+	memset(groupSizes, 0, sizeof(groupSizes));
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		bool movableA = vc->invMassA > 0.0f || vc->invIA > 0.0f;
+		bool movableB = vc->invMassB > 0.0f || vc->invIB > 0.0f;
+
+		int32 color = b2TakeColor(bodyColors, vc->indexA, movableA, vc->indexB, movableB);
+
+		int32 group = color * b2_maxManifoldPoints + vc->pointCount - 1;
+		m_colors[i] = group;
+		++groupSizes[group];
+	}
+
+	m_allocator->Free(bodyColors);
+
+	// Colored groups are packed into full batches, the rest get a batch each.
+	m_wideCount = 0;
+	for (int32 group = 0; group < groupCount; ++group)
+	{
+		groupStarts[group] = m_wideCount;
+		if (group < b2_wideColorCount * b2_maxManifoldPoints)
+		{
+			m_wideCount += (groupSizes[group] + b2_simdWidth - 1) / b2_simdWidth;
+		}
+		else
+		{
+			m_wideCount += groupSizes[group];
+		}
+	}
+
+	for (int32 color = 0; color <= b2_wideColorCount; ++color)
+	{
+		m_colorStarts[color] = groupStarts[color * b2_maxManifoldPoints];
+	}
+	m_colorStarts[b2_wideColorCount + 1] = m_wideCount;
+
+	m_wideConstraints = (b2ContactConstraintW*)m_allocator->Allocate(m_wideCount * sizeof(b2ContactConstraintW));
+	memset(m_wideConstraints, 0, m_wideCount * sizeof(b2ContactConstraintW));
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		int32 group = m_colors[i];
+
+		// Fill the batches of a group in order.
+		b2ContactConstraintW* wc = m_wideConstraints + groupStarts[group];
+		if (wc->count == b2_simdWidth || (group >= b2_wideColorCount * b2_maxManifoldPoints && wc->count == 1))
+		{
+			++groupStarts[group];
+			++wc;
+		}
+
+		int32 lane = wc->count++;
+		wc->pointCount = vc->pointCount;
+		wc->constraints[lane] = i;
+		wc->indexA[lane] = vc->indexA;
+		wc->indexB[lane] = vc->indexB;
+		wc->invMassA[lane] = vc->invMassA;
+		wc->invMassB[lane] = vc->invMassB;
+		wc->invIA[lane] = vc->invIA;
+		wc->invIB[lane] = vc->invIB;
+		wc->normalX[lane] = vc->normal.x;
+		wc->normalY[lane] = vc->normal.y;
+		wc->friction[lane] = vc->friction;
+
+		for (int32 j = 0; j < vc->pointCount; ++j)
+		{
+			const b2VelocityConstraintPoint* vcp = vc->points + j;
+			b2VelocityConstraintPointW* wcp = wc->points + j;
+			wcp->rAx[lane] = vcp->rA.x;
+			wcp->rAy[lane] = vcp->rA.y;
+			wcp->rBx[lane] = vcp->rB.x;
+			wcp->rBy[lane] = vcp->rB.y;
+			wcp->normalImpulse[lane] = vcp->normalImpulse;
+			wcp->tangentImpulse[lane] = vcp->tangentImpulse;
+			wcp->normalMass[lane] = vcp->normalMass;
+			wcp->tangentMass[lane] = vcp->tangentMass;
+			wcp->velocityBias[lane] = vcp->velocityBias;
+		}
+
+		if (vc->pointCount == 2)
+		{
+			wc->k11[lane] = vc->K.ex.x;
+			wc->k12[lane] = vc->K.ex.y;
+			wc->k22[lane] = vc->K.ey.y;
+			wc->nm11[lane] = vc->normalMass.ex.x;
+			wc->nm21[lane] = vc->normalMass.ex.y;
+			wc->nm12[lane] = vc->normalMass.ey.x;
+			wc->nm22[lane] = vc->normalMass.ey.y;
+		}
+	}
+}
+
+void b2ContactSolver::WarmStartWide()
+{
+	WarmStartWide(0, m_wideCount);
+}
+
+void b2ContactSolver::WarmStartWide(int32 begin, int32 end)
+{
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2ContactConstraintW* wc = m_wideConstraints + i;
+
+		b2BodyW A = b2GatherBodies(m_velocities, wc->indexA, wc->count);
+		b2BodyW B = b2GatherBodies(m_velocities, wc->indexB, wc->count);
+
+		b2FloatW mA = b2LoadW(wc->invMassA);
+		b2FloatW mB = b2LoadW(wc->invMassB);
+		b2FloatW iA = b2LoadW(wc->invIA);
+		b2FloatW iB = b2LoadW(wc->invIB);
+
+		// tangent = cross(normal, 1)
+		b2FloatW nx = b2LoadW(wc->normalX);
+		b2FloatW ny = b2LoadW(wc->normalY);
+		b2FloatW tx = ny;
+		b2FloatW ty = b2SubW(b2ZeroW(), nx);
+
+		for (int32 j = 0; j < wc->pointCount; ++j)
+		{
+			b2VelocityConstraintPointW* wcp = wc->points + j;
+			b2FloatW ni = b2LoadW(wcp->normalImpulse);
+			b2FloatW ti = b2LoadW(wcp->tangentImpulse);
+			b2FloatW Px = b2AddW(b2MulW(ni, nx), b2MulW(ti, tx));
+			b2FloatW Py = b2AddW(b2MulW(ni, ny), b2MulW(ti, ty));
+
+			A.w = b2MulSubW(A.w, iA, b2CrossW(b2LoadW(wcp->rAx), b2LoadW(wcp->rAy), Px, Py));
+			A.vx = b2MulSubW(A.vx, mA, Px);
+			A.vy = b2MulSubW(A.vy, mA, Py);
+			B.w = b2MulAddW(B.w, iB, b2CrossW(b2LoadW(wcp->rBx), b2LoadW(wcp->rBy), Px, Py));
+			B.vx = b2MulAddW(B.vx, mB, Px);
+			B.vy = b2MulAddW(B.vy, mB, Py);
+		}
+
+		b2ScatterBodies(m_velocities, wc->indexA, wc->count, A, wc->invMassA, wc->invIA);
+		b2ScatterBodies(m_velocities, wc->indexB, wc->count, B, wc->invMassB, wc->invIB);
+	}
+}
+
+void b2ContactSolver::SolveVelocityConstraintsWide()
+{
+	SolveVelocityConstraintsWide(0, m_wideCount);
+}
+
+void b2ContactSolver::SolveVelocityConstraintsWide(int32 begin, int32 end)
+{
+	b2FloatW zero = b2ZeroW();
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2ContactConstraintW* wc = m_wideConstraints + i;
+
+		b2BodyW A = b2GatherBodies(m_velocities, wc->indexA, wc->count);
+		b2BodyW B = b2GatherBodies(m_velocities, wc->indexB, wc->count);
+
+		b2FloatW mA = b2LoadW(wc->invMassA);
+		b2FloatW mB = b2LoadW(wc->invMassB);
+		b2FloatW iA = b2LoadW(wc->invIA);
+		b2FloatW iB = b2LoadW(wc->invIB);
+		b2FloatW nx = b2LoadW(wc->normalX);
+		b2FloatW ny = b2LoadW(wc->normalY);
+		b2FloatW tx = ny;
+		b2FloatW ty = b2SubW(zero, nx);
+		b2FloatW friction = b2LoadW(wc->friction);
+
+		// Solve tangent constraints first because non-penetration is more important
+		// than friction.
+		for (int32 j = 0; j < wc->pointCount; ++j)
+		{
+			b2VelocityConstraintPointW* wcp = wc->points + j;
+			b2FloatW rAx = b2LoadW(wcp->rAx);
+			b2FloatW rAy = b2LoadW(wcp->rAy);
+			b2FloatW rBx = b2LoadW(wcp->rBx);
+			b2FloatW rBy = b2LoadW(wcp->rBy);
+
+			b2FloatW vt = b2RelativeVelocityW(A, B, rAx, rAy, rBx, rBy, tx, ty);
+			b2FloatW lambda = b2SubW(zero, b2MulW(b2LoadW(wcp->tangentMass), vt));
+
+			b2FloatW oldImpulse = b2LoadW(wcp->tangentImpulse);
+			b2FloatW maxFriction = b2MulW(friction, b2LoadW(wcp->normalImpulse));
+			b2FloatW newImpulse = b2MaxW(b2SubW(zero, maxFriction), b2MinW(b2AddW(oldImpulse, lambda), maxFriction));
+			lambda = b2SubW(newImpulse, oldImpulse);
+			b2StoreW(wcp->tangentImpulse, newImpulse);
+
+			b2FloatW Px = b2MulW(lambda, tx);
+			b2FloatW Py = b2MulW(lambda, ty);
+
+			A.vx = b2MulSubW(A.vx, mA, Px);
+			A.vy = b2MulSubW(A.vy, mA, Py);
+			A.w = b2MulSubW(A.w, iA, b2CrossW(rAx, rAy, Px, Py));
+
+			B.vx = b2MulAddW(B.vx, mB, Px);
+			B.vy = b2MulAddW(B.vy, mB, Py);
+			B.w = b2MulAddW(B.w, iB, b2CrossW(rBx, rBy, Px, Py));
+		}
+
+		// Solve normal constraints
+		if (wc->pointCount == 1)
+		{
+			b2VelocityConstraintPointW* wcp = wc->points + 0;
+			b2FloatW rAx = b2LoadW(wcp->rAx);
+			b2FloatW rAy = b2LoadW(wcp->rAy);
+			b2FloatW rBx = b2LoadW(wcp->rBx);
+			b2FloatW rBy = b2LoadW(wcp->rBy);
+
+			b2FloatW vn = b2RelativeVelocityW(A, B, rAx, rAy, rBx, rBy, nx, ny);
+			b2FloatW lambda = b2SubW(zero, b2MulW(b2LoadW(wcp->normalMass), b2SubW(vn, b2LoadW(wcp->velocityBias))));
+
+			b2FloatW oldImpulse = b2LoadW(wcp->normalImpulse);
+			b2FloatW newImpulse = b2MaxW(b2AddW(oldImpulse, lambda), zero);
+			lambda = b2SubW(newImpulse, oldImpulse);
+			b2StoreW(wcp->normalImpulse, newImpulse);
+
+			b2FloatW Px = b2MulW(lambda, nx);
+			b2FloatW Py = b2MulW(lambda, ny);
+
+			A.vx = b2MulSubW(A.vx, mA, Px);
+			A.vy = b2MulSubW(A.vy, mA, Py);
+			A.w = b2MulSubW(A.w, iA, b2CrossW(rAx, rAy, Px, Py));
+
+			B.vx = b2MulAddW(B.vx, mB, Px);
+			B.vy = b2MulAddW(B.vy, mB, Py);
+			B.w = b2MulAddW(B.w, iB, b2CrossW(rBx, rBy, Px, Py));
+		}
+		else
+		{
+			// Block solver. See the scalar version for the derivation. All four
+			// cases are evaluated and the first valid one is selected per lane.
+			b2VelocityConstraintPointW* cp1 = wc->points + 0;
+			b2VelocityConstraintPointW* cp2 = wc->points + 1;
+
+			b2FloatW r1Ax = b2LoadW(cp1->rAx), r1Ay = b2LoadW(cp1->rAy);
+			b2FloatW r1Bx = b2LoadW(cp1->rBx), r1By = b2LoadW(cp1->rBy);
+			b2FloatW r2Ax = b2LoadW(cp2->rAx), r2Ay = b2LoadW(cp2->rAy);
+			b2FloatW r2Bx = b2LoadW(cp2->rBx), r2By = b2LoadW(cp2->rBy);
+
+			b2FloatW ax = b2LoadW(cp1->normalImpulse);
+			b2FloatW ay = b2LoadW(cp2->normalImpulse);
+
+			b2FloatW k11 = b2LoadW(wc->k11);
+			b2FloatW k12 = b2LoadW(wc->k12);
+			b2FloatW k22 = b2LoadW(wc->k22);
+
+			// Compute b' = vn - velocityBias - K * a
+			b2FloatW vn1 = b2RelativeVelocityW(A, B, r1Ax, r1Ay, r1Bx, r1By, nx, ny);
+			b2FloatW vn2 = b2RelativeVelocityW(A, B, r2Ax, r2Ay, r2Bx, r2By, nx, ny);
+			b2FloatW bx = b2SubW(vn1, b2LoadW(cp1->velocityBias));
+			b2FloatW by = b2SubW(vn2, b2LoadW(cp2->velocityBias));
+			bx = b2SubW(bx, b2AddW(b2MulW(k11, ax), b2MulW(k12, ay)));
+			by = b2SubW(by, b2AddW(b2MulW(k12, ax), b2MulW(k22, ay)));
+
+			// Case 1: vn = 0, x = -inv(K) * b'
+			b2FloatW x1 = b2SubW(zero, b2AddW(b2MulW(b2LoadW(wc->nm11), bx), b2MulW(b2LoadW(wc->nm12), by)));
+			b2FloatW y1 = b2SubW(zero, b2AddW(b2MulW(b2LoadW(wc->nm21), bx), b2MulW(b2LoadW(wc->nm22), by)));
+			b2FloatW valid1 = b2AndW(b2GreaterEqualW(x1, zero), b2GreaterEqualW(y1, zero));
+
+			// Case 2: vn1 = 0 and x2 = 0
+			b2FloatW x2 = b2SubW(zero, b2MulW(b2LoadW(cp1->normalMass), bx));
+			b2FloatW vn2Case2 = b2AddW(b2MulW(k12, x2), by);
+			b2FloatW valid2 = b2AndW(b2GreaterEqualW(x2, zero), b2GreaterEqualW(vn2Case2, zero));
+
+			// Case 3: vn2 = 0 and x1 = 0
+			b2FloatW y3 = b2SubW(zero, b2MulW(b2LoadW(cp2->normalMass), by));
+			b2FloatW vn1Case3 = b2AddW(b2MulW(k12, y3), bx);
+			b2FloatW valid3 = b2AndW(b2GreaterEqualW(y3, zero), b2GreaterEqualW(vn1Case3, zero));
+
+			// Case 4: x1 = 0 and x2 = 0
+			b2FloatW valid4 = b2AndW(b2GreaterEqualW(bx, zero), b2GreaterEqualW(by, zero));
+
+			// If no case is valid the impulse is left unchanged.
+			b2FloatW xx = b2SelectW(valid4, zero, ax);
+			b2FloatW xy = b2SelectW(valid4, zero, ay);
+			xx = b2SelectW(valid3, zero, xx);
+			xy = b2SelectW(valid3, y3, xy);
+			xx = b2SelectW(valid2, x2, xx);
+			xy = b2SelectW(valid2, zero, xy);
+			xx = b2SelectW(valid1, x1, xx);
+			xy = b2SelectW(valid1, y1, xy);
+
+			// Apply the incremental impulse
+			b2FloatW dx = b2SubW(xx, ax);
+			b2FloatW dy = b2SubW(xy, ay);
+			b2FloatW P1x = b2MulW(dx, nx), P1y = b2MulW(dx, ny);
+			b2FloatW P2x = b2MulW(dy, nx), P2y = b2MulW(dy, ny);
+			b2FloatW Px = b2AddW(P1x, P2x);
+			b2FloatW Py = b2AddW(P1y, P2y);
+
+			A.vx = b2MulSubW(A.vx, mA, Px);
+			A.vy = b2MulSubW(A.vy, mA, Py);
+			A.w = b2MulSubW(A.w, iA, b2AddW(b2CrossW(r1Ax, r1Ay, P1x, P1y), b2CrossW(r2Ax, r2Ay, P2x, P2y)));
+
+			B.vx = b2MulAddW(B.vx, mB, Px);
+			B.vy = b2MulAddW(B.vy, mB, Py);
+			B.w = b2MulAddW(B.w, iB, b2AddW(b2CrossW(r1Bx, r1By, P1x, P1y), b2CrossW(r2Bx, r2By, P2x, P2y)));
+
+			b2StoreW(cp1->normalImpulse, xx);
+			b2StoreW(cp2->normalImpulse, xy);
+		}
+
+		b2ScatterBodies(m_velocities, wc->indexA, wc->count, A, wc->invMassA, wc->invIA);
+		b2ScatterBodies(m_velocities, wc->indexB, wc->count, B, wc->invMassB, wc->invIB);
+	}
+}
+
+void b2ContactSolver::StoreWideImpulses()
+{
+	// Copy the lanes back so StoreImpulses and Report see the solved impulses.
+	for (int32 i = 0; i < m_wideCount; ++i)
+	{
+		const b2ContactConstraintW* wc = m_wideConstraints + i;
+		for (int32 lane = 0; lane < wc->count; ++lane)
+		{
+			b2ContactVelocityConstraint* vc = m_velocityConstraints + wc->constraints[lane];
+			for (int32 j = 0; j < wc->pointCount; ++j)
+			{
+				vc->points[j].normalImpulse = wc->points[j].normalImpulse[lane];
+				vc->points[j].tangentImpulse = wc->points[j].tangentImpulse[lane];
+			}
+		}
+	}
+}
+
+bool b2ContactSolver::SolvePositionConstraintsWide()
+{
+	float32 minSeparation = SolvePositionConstraintsWide(0, m_wideCount);
+
+	// We can't expect minSpeparation >= -b2_linearSlop because we don't
+	// push the separation above -b2_linearSlop.
+	return minSeparation >= -3.0f * b2_linearSlop;
+}
+
+float32 b2ContactSolver::SolvePositionConstraintsWide(int32 begin, int32 end)
+{
+	b2FloatW zero = b2ZeroW();
+	b2FloatW minSeparation = zero;
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		const b2ContactConstraintW* wc = m_wideConstraints + i;
+		int32 count = wc->count;
+
+		float32 cAx[b2_simdWidth] = {0.0f}, cAy[b2_simdWidth] = {0.0f}, aA[b2_simdWidth] = {0.0f};
+		float32 cBx[b2_simdWidth] = {0.0f}, cBy[b2_simdWidth] = {0.0f}, aB[b2_simdWidth] = {0.0f};
+		int32 pointCount = 0;
+		for (int32 lane = 0; lane < count; ++lane)
+		{
+			const b2ContactPositionConstraint* pc = m_positionConstraints + wc->constraints[lane];
+			cAx[lane] = m_positions[pc->indexA].c.x;
+			cAy[lane] = m_positions[pc->indexA].c.y;
+			aA[lane] = m_positions[pc->indexA].a;
+			cBx[lane] = m_positions[pc->indexB].c.x;
+			cBy[lane] = m_positions[pc->indexB].c.y;
+			aB[lane] = m_positions[pc->indexB].a;
+			pointCount = b2Max(pointCount, pc->pointCount);
+		}
+
+		b2FloatW mA = b2LoadW(wc->invMassA);
+		b2FloatW mB = b2LoadW(wc->invMassB);
+		b2FloatW iA = b2LoadW(wc->invIA);
+		b2FloatW iB = b2LoadW(wc->invIB);
+
+		for (int32 j = 0; j < pointCount; ++j)
+		{
+			// The manifold depends on the manifold type, so it is evaluated per lane.
+			// Lanes without point j keep a zero separation and get no impulse.
+			float32 nx[b2_simdWidth] = {0.0f}, ny[b2_simdWidth] = {0.0f};
+			float32 px[b2_simdWidth] = {0.0f}, py[b2_simdWidth] = {0.0f};
+			float32 separation[b2_simdWidth] = {0.0f};
+			for (int32 lane = 0; lane < count; ++lane)
+			{
+				b2ContactPositionConstraint* pc = m_positionConstraints + wc->constraints[lane];
+				if (j >= pc->pointCount)
+				{
+					continue;
+				}
+
+				b2Transform xfA, xfB;
+				xfA.q.Set(aA[lane]);
+				xfB.q.Set(aB[lane]);
+				xfA.p = b2Vec2(cAx[lane], cAy[lane]) - b2Mul(xfA.q, pc->localCenterA);
+				xfB.p = b2Vec2(cBx[lane], cBy[lane]) - b2Mul(xfB.q, pc->localCenterB);
+
+				b2PositionSolverManifold psm;
+				psm.Initialize(pc, xfA, xfB, j);
+				nx[lane] = psm.normal.x;
+				ny[lane] = psm.normal.y;
+				px[lane] = psm.point.x;
+				py[lane] = psm.point.y;
+				separation[lane] = psm.separation;
+			}
+
+			b2FloatW normalX = b2LoadW(nx);
+			b2FloatW normalY = b2LoadW(ny);
+			b2FloatW s = b2LoadW(separation);
+
+			b2FloatW wcAx = b2LoadW(cAx), wcAy = b2LoadW(cAy), waA = b2LoadW(aA);
+			b2FloatW wcBx = b2LoadW(cBx), wcBy = b2LoadW(cBy), waB = b2LoadW(aB);
+
+			b2FloatW rAx = b2SubW(b2LoadW(px), wcAx);
+			b2FloatW rAy = b2SubW(b2LoadW(py), wcAy);
+			b2FloatW rBx = b2SubW(b2LoadW(px), wcBx);
+			b2FloatW rBy = b2SubW(b2LoadW(py), wcBy);
+
+			// Track max constraint error.
+			minSeparation = b2MinW(minSeparation, s);
+
+			// Prevent large corrections and allow slop.
+			b2FloatW C = b2MulW(b2SplatW(b2_baumgarte), b2AddW(s, b2SplatW(b2_linearSlop)));
+			C = b2MaxW(b2SplatW(-b2_maxLinearCorrection), b2MinW(C, zero));
+
+			// Compute the effective mass.
+			b2FloatW rnA = b2CrossW(rAx, rAy, normalX, normalY);
+			b2FloatW rnB = b2CrossW(rBx, rBy, normalX, normalY);
+			b2FloatW K = b2AddW(b2AddW(mA, mB), b2AddW(b2MulW(iA, b2MulW(rnA, rnA)), b2MulW(iB, b2MulW(rnB, rnB))));
+
+			// Compute normal impulse
+			b2FloatW positive = b2GreaterW(K, zero);
+			b2FloatW impulse = b2SelectW(positive, b2DivW(b2SubW(zero, C), b2SelectW(positive, K, b2SplatW(1.0f))), zero);
+
+			b2FloatW Px = b2MulW(impulse, normalX);
+			b2FloatW Py = b2MulW(impulse, normalY);
+
+			b2StoreW(cAx, b2MulSubW(wcAx, mA, Px));
+			b2StoreW(cAy, b2MulSubW(wcAy, mA, Py));
+			b2StoreW(aA, b2MulSubW(waA, iA, b2CrossW(rAx, rAy, Px, Py)));
+
+			b2StoreW(cBx, b2MulAddW(wcBx, mB, Px));
+			b2StoreW(cBy, b2MulAddW(wcBy, mB, Py));
+			b2StoreW(aB, b2MulAddW(waB, iB, b2CrossW(rBx, rBy, Px, Py)));
+		}
+
+		// Like b2ScatterBodies, bodies without mass are left alone.
+		for (int32 lane = 0; lane < count; ++lane)
+		{
+			const b2ContactPositionConstraint* pc = m_positionConstraints + wc->constraints[lane];
+			if (pc->invMassA > 0.0f || pc->invIA > 0.0f)
+			{
+				m_positions[pc->indexA].c.Set(cAx[lane], cAy[lane]);
+				m_positions[pc->indexA].a = aA[lane];
+			}
+			if (pc->invMassB > 0.0f || pc->invIB > 0.0f)
+			{
+				m_positions[pc->indexB].c.Set(cBx[lane], cBy[lane]);
+				m_positions[pc->indexB].a = aB[lane];
+			}
+		}
+	}
+
+	float32 separations[b2_simdWidth];
+	b2StoreW(separations, minSeparation);
+	float32 minimum = separations[0];
+	for (int32 i = 1; i < b2_simdWidth; ++i)
+	{
+		minimum = b2Min(minimum, separations[i]);
+	}
+
+	return minimum;
+}
@@ -25,8 +25,21 @@
 
 class b2Contact;
 class b2Body;
+class b2Joint;
 class b2StackAllocator;
 struct b2ContactPositionConstraint;
+struct b2ContactConstraintW;
+
+/// Constraint data that only depends on the fixtures and the body mass. Each
+/// contact keeps it across steps so the solver doesn't have to gather it from
+/// the fixtures, shapes and bodies every step.
+struct b2ContactConstraintCache
+{
+	b2Vec2 localCenterA, localCenterB;
+	float32 invMassA, invMassB;
+	float32 invIA, invIB;
+	float32 radiusA, radiusB;
+};
 
 struct b2VelocityConstraintPoint
 {
@@ -63,6 +76,10 @@ struct b2ContactSolverDef
 	b2Position* positions;
 	b2Velocity* velocities;
 	b2StackAllocator* allocator;
+
+	// Joints colored along with the contacts when step.parallelSolver is set.
+	b2Joint** joints;
+	int32 jointCount;
 };
 
 class b2ContactSolver
@@ -80,6 +97,19 @@ public:
 	bool SolvePositionConstraints();
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
+	// Wide solver. These are used in place of the scalar versions when
+	// m_step.wideSolver is set.
+	void PrepareWideConstraints();
+	void WarmStartWide();
+	void SolveVelocityConstraintsWide();
+	void StoreWideImpulses();
+	bool SolvePositionConstraintsWide();
+
+	// Solve a range of wide batches. The position version returns the minimum separation.
+	void WarmStartWide(int32 begin, int32 end);
+	void SolveVelocityConstraintsWide(int32 begin, int32 end);
+	float32 SolvePositionConstraintsWide(int32 begin, int32 end);
+
 	b2TimeStep m_step;
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
@@ -88,6 +118,19 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	int32* m_colors;
+	b2ContactConstraintW* m_wideConstraints;
+	int32 m_wideCount;
+
+	// Parallel solver. The wide batches and m_coloredJoints are sorted by color
+	// and color i spans [starts[i], starts[i + 1]). The last color, b2_wideColorCount,
+	// holds the constraints that didn't fit in the others.
+	b2Joint** m_joints;
+	int32 m_jointCount;
+	b2Joint** m_coloredJoints;
+	int32 m_colorStarts[b2_wideColorCount + 2];
+	int32 m_jointColorStarts[b2_wideColorCount + 2];
 };
 
 #endif
@@ -92,6 +92,9 @@ protected:
 	void SolveVelocityConstraints(const b2SolverData& data);
 	bool SolvePositionConstraints(const b2SolverData& data);
 
+	void WriteSnapshot(b2Snapshot* snapshot) const;
+	void ReadSnapshot(b2SnapshotReader* reader);
+
 	b2Vec2 m_localAnchorA;
 	b2Vec2 m_localAnchorB;
 
@@ -21,6 +21,7 @@
 #include "b2PrismaticJoint.h"
 #include "../b2Body.h"
 #include "../b2TimeStep.h"
+#include "../../Common/b2Snapshot.h"
 
 // Gear Joint:
 // C0 = (coordinate1 + ratio * coordinate2)_initial
@@ -138,14 +139,14 @@ void b2GearJoint::InitVelocityConstraints(const b2SolverData& data)
 	m_lcB = m_bodyB->m_sweep.localCenter;
 	m_lcC = m_bodyC->m_sweep.localCenter;
 	m_lcD = m_bodyD->m_sweep.localCenter;
-	m_mA = m_bodyA->m_invMass;
-	m_mB = m_bodyB->m_invMass;
-	m_mC = m_bodyC->m_invMass;
-	m_mD = m_bodyD->m_invMass;
-	m_iA = m_bodyA->m_invI;
-	m_iB = m_bodyB->m_invI;
-	m_iC = m_bodyC->m_invI;
-	m_iD = m_bodyD->m_invI;
+	m_mA = m_bodyA->InvMass();
+	m_mB = m_bodyB->InvMass();
+	m_mC = m_bodyC->InvMass();
+	m_mD = m_bodyD->InvMass();
+	m_iA = m_bodyA->InvI();
+	m_iB = m_bodyB->InvI();
+	m_iC = m_bodyC->InvI();
+	m_iD = m_bodyD->InvI();
 
 	b2Vec2 cA = data.positions[m_indexA].c;
 	float32 aA = data.positions[m_indexA].a;
@@ -421,3 +422,33 @@ void b2GearJoint::Dump()
 	b2Log("  jd.ratio = %.15lef;\n", m_ratio);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2GearJoint::WriteSnapshot(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_localAnchorC);
+	snapshot->Write(m_localAnchorD);
+	snapshot->Write(m_localAxisC);
+	snapshot->Write(m_localAxisD);
+	snapshot->Write(m_referenceAngleA);
+	snapshot->Write(m_referenceAngleB);
+	snapshot->Write(m_constant);
+	snapshot->Write(m_ratio);
+	snapshot->Write(m_impulse);
+}
+
+void b2GearJoint::ReadSnapshot(b2SnapshotReader* reader)
+{
+	reader->Read(&m_localAnchorA);
+	reader->Read(&m_localAnchorB);
+	reader->Read(&m_localAnchorC);
+	reader->Read(&m_localAnchorD);
+	reader->Read(&m_localAxisC);
+	reader->Read(&m_localAxisD);
+	reader->Read(&m_referenceAngleA);
+	reader->Read(&m_referenceAngleB);
+	reader->Read(&m_constant);
+	reader->Read(&m_ratio);
+	reader->Read(&m_impulse);
+}
@@ -84,6 +84,9 @@ protected:
 	void SolveVelocityConstraints(const b2SolverData& data);
 	bool SolvePositionConstraints(const b2SolverData& data);
 
+	void WriteSnapshot(b2Snapshot* snapshot) const;
+	void ReadSnapshot(b2SnapshotReader* reader);
+
 	b2Joint* m_joint1;
 	b2Joint* m_joint2;
 
@@ -25,6 +25,8 @@ class b2Body;
 class b2Joint;
 struct b2SolverData;
 class b2BlockAllocator;
+class b2Snapshot;
+class b2SnapshotReader;
 
 enum b2JointType
 {
@@ -149,6 +151,7 @@ protected:
 	friend class b2World;
 	friend class b2Body;
 	friend class b2Island;
+	friend class b2ColorTask;
 	friend class b2GearJoint;
 
 	static b2Joint* Create(const b2JointDef* def, b2BlockAllocator* allocator);
@@ -163,6 +166,11 @@ protected:
 	// This returns true if the position errors are within tolerance.
 	virtual bool SolvePositionConstraints(const b2SolverData& data) = 0;
 
+	// Write and read the joint parameters and the warm starting impulses. Solver
+	// temporaries are rebuilt by InitVelocityConstraints. See b2World::SaveSnapshot.
+	virtual void WriteSnapshot(b2Snapshot* snapshot) const = 0;
+	virtual void ReadSnapshot(b2SnapshotReader* reader) = 0;
+
 	b2JointType m_type;
 	b2Joint* m_prev;
 	b2Joint* m_next;
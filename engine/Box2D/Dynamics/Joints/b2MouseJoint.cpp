@@ -19,6 +19,7 @@
 #include "b2MouseJoint.h"
 #include "../b2Body.h"
 #include "../b2TimeStep.h"
+#include "../../Common/b2Snapshot.h"
 
 // p = attached point, m = mouse point
 // C = p - m
@@ -97,8 +98,8 @@ void b2MouseJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	m_indexB = m_bodyB->m_islandIndex;
 	m_localCenterB = m_bodyB->m_sweep.localCenter;
-	m_invMassB = m_bodyB->m_invMass;
-	m_invIB = m_bodyB->m_invI;
+	m_invMassB = m_bodyB->InvMass();
+	m_invIB = m_bodyB->InvI();
 
 	b2Vec2 cB = data.positions[m_indexB].c;
 	float32 aB = data.positions[m_indexB].a;
@@ -215,3 +216,27 @@ float32 b2MouseJoint::GetReactionTorque(float32 inv_dt) const
 {
 	return inv_dt * 0.0f;
 }
+
+void b2MouseJoint::WriteSnapshot(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_targetA);
+	snapshot->Write(m_frequencyHz);
+	snapshot->Write(m_dampingRatio);
+	snapshot->Write(m_beta);
+	snapshot->Write(m_impulse);
+	snapshot->Write(m_maxForce);
+	snapshot->Write(m_gamma);
+}
+
+void b2MouseJoint::ReadSnapshot(b2SnapshotReader* reader)
+{
+	reader->Read(&m_localAnchorB);
+	reader->Read(&m_targetA);
+	reader->Read(&m_frequencyHz);
+	reader->Read(&m_dampingRatio);
+	reader->Read(&m_beta);
+	reader->Read(&m_impulse);
+	reader->Read(&m_maxForce);
+	reader->Read(&m_gamma);
+}
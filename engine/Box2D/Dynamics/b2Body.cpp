@@ -56,6 +56,9 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 
 	m_world = world;
 
+	m_store = &world->m_bodyStore;
+	m_storeIndex = m_store->Create(this);
+
 	m_xf.p = bd->position;
 	m_xf.q.Set(bd->angle);
 
@@ -71,33 +74,33 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_prev = NULL;
 	m_next = NULL;
 
-	m_linearVelocity = bd->linearVelocity;
-	m_angularVelocity = bd->angularVelocity;
+	LinearVelocity() = bd->linearVelocity;
+	AngularVelocity() = bd->angularVelocity;
 
-	m_linearDamping = bd->linearDamping;
-	m_angularDamping = bd->angularDamping;
-	m_gravityScale = bd->gravityScale;
+	LinearDamping() = bd->linearDamping;
+	AngularDamping() = bd->angularDamping;
+	GravityScale() = bd->gravityScale;
 
-	m_force.SetZero();
-	m_torque = 0.0f;
+	Force().SetZero();
+	Torque() = 0.0f;
 
-	m_sleepTime = 0.0f;
+	SleepTime() = 0.0f;
 
 	m_type = bd->type;
 
 	if (m_type == b2_dynamicBody)
 	{
 		m_mass = 1.0f;
-		m_invMass = 1.0f;
+		InvMass() = 1.0f;
 	}
 	else
 	{
 		m_mass = 0.0f;
-		m_invMass = 0.0f;
+		InvMass() = 0.0f;
 	}
 
 	m_I = 0.0f;
-	m_invI = 0.0f;
+	InvI() = 0.0f;
 
 	m_userData = bd->userData;
 
@@ -123,14 +126,27 @@ void b2Body::SetType(b2BodyType type)
 		return;
 	}
 
+	b2BodyType oldType = m_type;
 	m_type = type;
 
+	// A split-tree broad-phase keeps static proxies in their own tree.
+	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+	if ((m_flags & e_activeFlag) && broadPhase->GetType() == b2_splitTreeBroadPhase &&
+		(oldType == b2_staticBody || type == b2_staticBody))
+	{
+		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+		{
+			f->DestroyProxies(broadPhase);
+			f->CreateProxies(broadPhase, m_xf);
+		}
+	}
+
 	ResetMassData();
 
 	if (m_type == b2_staticBody)
 	{
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
+		LinearVelocity().SetZero();
+		AngularVelocity() = 0.0f;
 		m_sweep.a0 = m_sweep.a;
 		m_sweep.c0 = m_sweep.c;
 		SynchronizeFixtures();
@@ -138,8 +154,8 @@ void b2Body::SetType(b2BodyType type)
 
 	SetAwake(true);
 
-	m_force.SetZero();
-	m_torque = 0.0f;
+	Force().SetZero();
+	Torque() = 0.0f;
 
 	// Since the body type changed, we need to flag contacts for filtering.
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
@@ -174,6 +190,11 @@ b2Fixture* b2Body::CreateFixture(const b2FixtureDef* def)
 
 	fixture->m_body = this;
 
+	if (m_world->m_contactManager.m_sensorEvents && fixture->m_isSensor)
+	{
+		m_world->m_sensorManager.AddSensor(fixture);
+	}
+
 	// Adjust mass properties if needed.
 	if (fixture->m_density > 0.0f)
 	{
@@ -245,6 +266,8 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 
 	b2BlockAllocator* allocator = &m_world->m_blockAllocator;
 
+	m_world->m_sensorManager.RemoveFixture(fixture);
+
 	if (m_flags & e_activeFlag)
 	{
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
@@ -265,11 +288,13 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 
 void b2Body::ResetMassData()
 {
+	ResetContactCaches();
+
 	// Compute mass data from shapes. Each shape has its own density.
 	m_mass = 0.0f;
-	m_invMass = 0.0f;
+	InvMass() = 0.0f;
 	m_I = 0.0f;
-	m_invI = 0.0f;
+	InvI() = 0.0f;
 	m_sweep.localCenter.SetZero();
 
 	// Static and kinematic bodies have zero mass.
@@ -302,14 +327,14 @@ void b2Body::ResetMassData()
 	// Compute center of mass.
 	if (m_mass > 0.0f)
 	{
-		m_invMass = 1.0f / m_mass;
-		localCenter *= m_invMass;
+		InvMass() = 1.0f / m_mass;
+		localCenter *= InvMass();
 	}
 	else
 	{
 		// Force all dynamic bodies to have a positive mass.
 		m_mass = 1.0f;
-		m_invMass = 1.0f;
+		InvMass() = 1.0f;
 	}
 
 	if (m_I > 0.0f && (m_flags & e_fixedRotationFlag) == 0)
@@ -317,13 +342,13 @@ void b2Body::ResetMassData()
 		// Center the inertia about the center of mass.
 		m_I -= m_mass * b2Dot(localCenter, localCenter);
 		b2Assert(m_I > 0.0f);
-		m_invI = 1.0f / m_I;
+		InvI() = 1.0f / m_I;
 
 	}
 	else
 	{
 		m_I = 0.0f;
-		m_invI = 0.0f;
+		InvI() = 0.0f;
 	}
 
 	// Move center of mass.
@@ -332,7 +357,7 @@ void b2Body::ResetMassData()
 	m_sweep.c0 = m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
 
 	// Update center of mass velocity.
-	m_linearVelocity += b2Cross(m_angularVelocity, m_sweep.c - oldCenter);
+	LinearVelocity() += b2Cross(AngularVelocity(), m_sweep.c - oldCenter);
 }
 
 void b2Body::SetMassData(const b2MassData* massData)
@@ -348,9 +373,11 @@ void b2Body::SetMassData(const b2MassData* massData)
 		return;
 	}
 
-	m_invMass = 0.0f;
+	ResetContactCaches();
+
+	InvMass() = 0.0f;
 	m_I = 0.0f;
-	m_invI = 0.0f;
+	InvI() = 0.0f;
 
 	m_mass = massData->mass;
 	if (m_mass <= 0.0f)
@@ -358,13 +385,13 @@ void b2Body::SetMassData(const b2MassData* massData)
 		m_mass = 1.0f;
 	}
 
-	m_invMass = 1.0f / m_mass;
+	InvMass() = 1.0f / m_mass;
 
 	if (massData->I > 0.0f && (m_flags & b2Body::e_fixedRotationFlag) == 0)
 	{
 		m_I = massData->I - m_mass * b2Dot(massData->center, massData->center);
 		b2Assert(m_I > 0.0f);
-		m_invI = 1.0f / m_I;
+		InvI() = 1.0f / m_I;
 	}
 
 	// Move center of mass.
@@ -373,7 +400,15 @@ void b2Body::SetMassData(const b2MassData* massData)
 	m_sweep.c0 = m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
 
 	// Update center of mass velocity.
-	m_linearVelocity += b2Cross(m_angularVelocity, m_sweep.c - oldCenter);
+	LinearVelocity() += b2Cross(AngularVelocity(), m_sweep.c - oldCenter);
+}
+
+void b2Body::ResetContactCaches()
+{
+	for (b2ContactEdge* ce = m_contactList; ce; ce = ce->next)
+	{
+		ce->contact->m_flags &= ~b2Contact::e_constraintCacheFlag;
+	}
 }
 
 bool b2Body::ShouldCollide(const b2Body* other) const
@@ -492,16 +527,16 @@ void b2Body::Dump()
 	b2Log("  bd.type = b2BodyType(%d);\n", m_type);
 	b2Log("  bd.position.Set(%.15lef, %.15lef);\n", m_xf.p.x, m_xf.p.y);
 	b2Log("  bd.angle = %.15lef;\n", m_sweep.a);
-	b2Log("  bd.linearVelocity.Set(%.15lef, %.15lef);\n", m_linearVelocity.x, m_linearVelocity.y);
-	b2Log("  bd.angularVelocity = %.15lef;\n", m_angularVelocity);
-	b2Log("  bd.linearDamping = %.15lef;\n", m_linearDamping);
-	b2Log("  bd.angularDamping = %.15lef;\n", m_angularDamping);
+	b2Log("  bd.linearVelocity.Set(%.15lef, %.15lef);\n", LinearVelocity().x, LinearVelocity().y);
+	b2Log("  bd.angularVelocity = %.15lef;\n", AngularVelocity());
+	b2Log("  bd.linearDamping = %.15lef;\n", LinearDamping());
+	b2Log("  bd.angularDamping = %.15lef;\n", AngularDamping());
 	b2Log("  bd.allowSleep = bool(%d);\n", m_flags & e_autoSleepFlag);
 	b2Log("  bd.awake = bool(%d);\n", m_flags & e_awakeFlag);
 	b2Log("  bd.fixedRotation = bool(%d);\n", m_flags & e_fixedRotationFlag);
 	b2Log("  bd.bullet = bool(%d);\n", m_flags & e_bulletFlag);
 	b2Log("  bd.active = bool(%d);\n", m_flags & e_activeFlag);
-	b2Log("  bd.gravityScale = %.15lef;\n", m_gravityScale);
+	b2Log("  bd.gravityScale = %.15lef;\n", GravityScale());
 	b2Log("  bodies[%d] = m_world->CreateBody(&bd);\n", m_islandIndex);
 	b2Log("\n");
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
@@ -21,6 +21,7 @@
 
 #include "../Common/b2Math.h"
 #include "../Collision/Shapes/b2Shape.h"
+#include "../Dynamics/b2BodyStore.h"
 #include <memory>
 
 class b2Fixture;
@@ -322,6 +323,10 @@ public:
 	/// @return true if the body is sleeping.
 	bool IsAwake() const;
 
+	/// Was this awake body left in place by the simulation level of detail
+	/// in the last time step? See b2World::SetSimulationLOD.
+	bool IsFrozen() const;
+
 	/// Set the active state of the body. An inactive body is not
 	/// simulated and cannot be collided with or woken up.
 	/// If you pass a flag of true, all fixtures will be added to the
@@ -396,6 +401,10 @@ private:
 	friend class b2WeldJoint;
 	friend class b2FrictionJoint;
 	friend class b2RopeJoint;
+	friend class b2BodyStore;
+	friend class b2GravityQuery;
+	friend class b2GravityTreeTask;
+	friend class b2SensorQueryCallback;
 
 	// m_flags
 	enum
@@ -406,7 +415,9 @@ private:
 		e_bulletFlag		= 0x0008,
 		e_fixedRotationFlag	= 0x0010,
 		e_activeFlag		= 0x0020,
-		e_toiFlag			= 0x0040
+		e_toiFlag			= 0x0040,
+		e_reducedFlag		= 0x0080,	// outside the active area of the level of detail
+		e_frozenFlag		= 0x0100	// not stepped by the level of detail this step
 	};
 
 	b2Body(const b2BodyDef* bd, b2World* world);
@@ -421,6 +432,25 @@ private:
 
 	void Advance(float32 t);
 
+	// Is the body awake and not frozen by the simulation level of detail?
+	bool IsStepping() const { return (m_flags & (e_awakeFlag | e_frozenFlag)) == e_awakeFlag; }
+
+	// The contact solver caches the mass data, see b2ContactConstraintCache.
+	void ResetContactCaches();
+
+	// Hot state lives in the world's body store.
+	b2Vec2& LinearVelocity() const { return m_store->m_linearVelocities[m_storeIndex]; }
+	float32& AngularVelocity() const { return m_store->m_angularVelocities[m_storeIndex]; }
+	b2Vec2& Force() const { return m_store->m_forces[m_storeIndex]; }
+	float32& Torque() const { return m_store->m_torques[m_storeIndex]; }
+	float32& InvMass() const { return m_store->m_invMasses[m_storeIndex]; }
+	float32& InvI() const { return m_store->m_invIs[m_storeIndex]; }
+	float32& LinearDamping() const { return m_store->m_linearDampings[m_storeIndex]; }
+	float32& AngularDamping() const { return m_store->m_angularDampings[m_storeIndex]; }
+	float32& GravityScale() const { return m_store->m_gravityScales[m_storeIndex]; }
+	b2Vec2& FieldGravity() const { return m_store->m_fieldGravities[m_storeIndex]; }
+	float32& SleepTime() const { return m_store->m_sleepTimes[m_storeIndex]; }
+
 	b2BodyType m_type;
 
 	uint16 m_flags;
@@ -430,11 +460,8 @@ private:
 	b2Transform m_xf;		// the body origin transform
 	b2Sweep m_sweep;		// the swept motion for CCD
 
-	b2Vec2 m_linearVelocity;
-	float32 m_angularVelocity;
-
-	b2Vec2 m_force;
-	float32 m_torque;
+	b2BodyStore* m_store;
+	int32 m_storeIndex;
 
 	b2World* m_world;
 	b2Body* m_prev;
@@ -446,16 +473,10 @@ private:
 	b2JointEdge* m_jointList;
 	b2ContactEdge* m_contactList;
 
-	float32 m_mass, m_invMass;
+	float32 m_mass;
 
 	// Rotational inertia about the center of mass.
-	float32 m_I, m_invI;
-
-	float32 m_linearDamping;
-	float32 m_angularDamping;
-	float32 m_gravityScale;
-
-	float32 m_sleepTime;
+	float32 m_I;
 
 	void* m_userData;
 };
@@ -502,12 +523,12 @@ inline void b2Body::SetLinearVelocity(const b2Vec2& v)
 		SetAwake(true);
 	}
 
-	m_linearVelocity = v;
+	LinearVelocity() = v;
 }
 
 inline b2Vec2 b2Body::GetLinearVelocity() const
 {
-	return m_linearVelocity;
+	return LinearVelocity();
 }
 
 inline void b2Body::SetAngularVelocity(float32 w)
@@ -522,12 +543,12 @@ inline void b2Body::SetAngularVelocity(float32 w)
 		SetAwake(true);
 	}
 
-	m_angularVelocity = w;
+	AngularVelocity() = w;
 }
 
 inline float32 b2Body::GetAngularVelocity() const
 {
-	return m_angularVelocity;
+	return AngularVelocity();
 }
 
 inline float32 b2Body::GetMass() const
@@ -569,7 +590,7 @@ inline b2Vec2 b2Body::GetLocalVector(const b2Vec2& worldVector) const
 
 inline b2Vec2 b2Body::GetLinearVelocityFromWorldPoint(const b2Vec2& worldPoint) const
 {
-	return m_linearVelocity + b2Cross(m_angularVelocity, worldPoint - m_sweep.c);
+	return LinearVelocity() + b2Cross(AngularVelocity(), worldPoint - m_sweep.c);
 }
 
 inline b2Vec2 b2Body::GetLinearVelocityFromLocalPoint(const b2Vec2& localPoint) const
@@ -579,32 +600,32 @@ inline b2Vec2 b2Body::GetLinearVelocityFromLocalPoint(const b2Vec2& localPoint)
 
 inline float32 b2Body::GetLinearDamping() const
 {
-	return m_linearDamping;
+	return LinearDamping();
 }
 
 inline void b2Body::SetLinearDamping(float32 linearDamping)
 {
-	m_linearDamping = linearDamping;
+	LinearDamping() = linearDamping;
 }
 
 inline float32 b2Body::GetAngularDamping() const
 {
-	return m_angularDamping;
+	return AngularDamping();
 }
 
 inline void b2Body::SetAngularDamping(float32 angularDamping)
 {
-	m_angularDamping = angularDamping;
+	AngularDamping() = angularDamping;
 }
 
 inline float32 b2Body::GetGravityScale() const
 {
-	return m_gravityScale;
+	return GravityScale();
 }
 
 inline void b2Body::SetGravityScale(float32 scale)
 {
-	m_gravityScale = scale;
+	GravityScale() = scale;
 }
 
 inline void b2Body::SetBullet(bool flag)
@@ -631,17 +652,17 @@ inline void b2Body::SetAwake(bool flag)
 		if ((m_flags & e_awakeFlag) == 0)
 		{
 			m_flags |= e_awakeFlag;
-			m_sleepTime = 0.0f;
+			SleepTime() = 0.0f;
 		}
 	}
 	else
 	{
 		m_flags &= ~e_awakeFlag;
-		m_sleepTime = 0.0f;
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		m_force.SetZero();
-		m_torque = 0.0f;
+		SleepTime() = 0.0f;
+		LinearVelocity().SetZero();
+		AngularVelocity() = 0.0f;
+		Force().SetZero();
+		Torque() = 0.0f;
 	}
 }
 
@@ -650,6 +671,11 @@ inline bool b2Body::IsAwake() const
 	return (m_flags & e_awakeFlag) == e_awakeFlag;
 }
 
+inline bool b2Body::IsFrozen() const
+{
+	return (m_flags & (e_awakeFlag | e_frozenFlag)) == (e_awakeFlag | e_frozenFlag);
+}
+
 inline bool b2Body::IsActive() const
 {
 	return (m_flags & e_activeFlag) == e_activeFlag;
@@ -754,8 +780,8 @@ inline void b2Body::ApplyForce(const b2Vec2& force, const b2Vec2& point)
 		SetAwake(true);
 	}
 
-	m_force += force;
-	m_torque += b2Cross(point - m_sweep.c, force);
+	Force() += force;
+	Torque() += b2Cross(point - m_sweep.c, force);
 }
 
 inline void b2Body::ApplyForceToCenter(const b2Vec2& force)
@@ -770,7 +796,7 @@ inline void b2Body::ApplyForceToCenter(const b2Vec2& force)
 		SetAwake(true);
 	}
 
-	m_force += force;
+	Force() += force;
 }
 
 inline void b2Body::ApplyTorque(float32 torque)
@@ -785,7 +811,7 @@ inline void b2Body::ApplyTorque(float32 torque)
 		SetAwake(true);
 	}
 
-	m_torque += torque;
+	Torque() += torque;
 }
 
 inline void b2Body::ApplyLinearImpulse(const b2Vec2& impulse, const b2Vec2& point)
@@ -799,8 +825,8 @@ inline void b2Body::ApplyLinearImpulse(const b2Vec2& impulse, const b2Vec2& poin
 	{
 		SetAwake(true);
 	}
-	m_linearVelocity += m_invMass * impulse;
-	m_angularVelocity += m_invI * b2Cross(point - m_sweep.c, impulse);
+	LinearVelocity() += InvMass() * impulse;
+	AngularVelocity() += InvI() * b2Cross(point - m_sweep.c, impulse);
 }
 
 inline void b2Body::ApplyAngularImpulse(float32 impulse)
@@ -814,7 +840,7 @@ inline void b2Body::ApplyAngularImpulse(float32 impulse)
 	{
 		SetAwake(true);
 	}
-	m_angularVelocity += m_invI * impulse;
+	AngularVelocity() += InvI() * impulse;
 }
 
 inline void b2Body::SynchronizeTransform()
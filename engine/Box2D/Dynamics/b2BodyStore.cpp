@@ -0,0 +1,162 @@
+#include "../Dynamics/b2BodyStore.h"
+#include "../Dynamics/b2Body.h"
+#include <cstring>
+
+template <typename T>
+static void b2Regrow(T*& array, int32 count, int32 capacity)
+{
+	T* old = array;
+	array = (T*)b2Alloc(capacity * sizeof(T));
+	if (old)
+	{
+		memcpy(array, old, count * sizeof(T));
+		b2Free(old);
+	}
+}
+
+b2BodyStore::b2BodyStore()
+{
+	m_bodies = NULL;
+	m_linearVelocities = NULL;
+	m_angularVelocities = NULL;
+	m_forces = NULL;
+	m_torques = NULL;
+	m_invMasses = NULL;
+	m_invIs = NULL;
+	m_linearDampings = NULL;
+	m_angularDampings = NULL;
+	m_gravityScales = NULL;
+	m_fieldGravities = NULL;
+	m_sleepTimes = NULL;
+
+	m_count = 0;
+	m_capacity = 0;
+
+	Reserve(16);
+}
+
+b2BodyStore::~b2BodyStore()
+{
+	b2Free(m_bodies);
+	b2Free(m_linearVelocities);
+	b2Free(m_angularVelocities);
+	b2Free(m_forces);
+	b2Free(m_torques);
+	b2Free(m_invMasses);
+	b2Free(m_invIs);
+	b2Free(m_linearDampings);
+	b2Free(m_angularDampings);
+	b2Free(m_gravityScales);
+	b2Free(m_fieldGravities);
+	b2Free(m_sleepTimes);
+}
+
+void b2BodyStore::Reserve(int32 capacity)
+{
+	b2Assert(capacity > m_capacity);
+
+	b2Regrow(m_bodies, m_count, capacity);
+	b2Regrow(m_linearVelocities, m_count, capacity);
+	b2Regrow(m_angularVelocities, m_count, capacity);
+	b2Regrow(m_forces, m_count, capacity);
+	b2Regrow(m_torques, m_count, capacity);
+	b2Regrow(m_invMasses, m_count, capacity);
+	b2Regrow(m_invIs, m_count, capacity);
+	b2Regrow(m_linearDampings, m_count, capacity);
+	b2Regrow(m_angularDampings, m_count, capacity);
+	b2Regrow(m_gravityScales, m_count, capacity);
+	b2Regrow(m_fieldGravities, m_count, capacity);
+	b2Regrow(m_sleepTimes, m_count, capacity);
+
+	m_capacity = capacity;
+}
+
+int32 b2BodyStore::Create(b2Body* body)
+{
+	if (m_count == m_capacity)
+	{
+		Reserve(2 * m_capacity);
+	}
+
+	int32 index = m_count;
+	++m_count;
+
+	m_bodies[index] = body;
+	m_linearVelocities[index].SetZero();
+	m_angularVelocities[index] = 0.0f;
+	m_forces[index].SetZero();
+	m_torques[index] = 0.0f;
+	m_invMasses[index] = 0.0f;
+	m_invIs[index] = 0.0f;
+	m_linearDampings[index] = 0.0f;
+	m_angularDampings[index] = 0.0f;
+	m_gravityScales[index] = 0.0f;
+	m_fieldGravities[index].SetZero();
+	m_sleepTimes[index] = 0.0f;
+
+	return index;
+}
+
+void b2BodyStore::Destroy(int32 index)
+{
+	b2Assert(0 <= index && index < m_count);
+
+	--m_count;
+	if (index == m_count)
+	{
+		return;
+	}
+
+	// Move the last slot into the hole.
+	int32 last = m_count;
+	m_bodies[index] = m_bodies[last];
+	m_linearVelocities[index] = m_linearVelocities[last];
+	m_angularVelocities[index] = m_angularVelocities[last];
+	m_forces[index] = m_forces[last];
+	m_torques[index] = m_torques[last];
+	m_invMasses[index] = m_invMasses[last];
+	m_invIs[index] = m_invIs[last];
+	m_linearDampings[index] = m_linearDampings[last];
+	m_angularDampings[index] = m_angularDampings[last];
+	m_gravityScales[index] = m_gravityScales[last];
+	m_fieldGravities[index] = m_fieldGravities[last];
+	m_sleepTimes[index] = m_sleepTimes[last];
+
+	m_bodies[index]->m_storeIndex = index;
+}
+
+void b2BodyStore::Place(b2Body* body, int32 index)
+{
+	b2Assert(0 <= index && index < m_count);
+
+	int32 other = body->m_storeIndex;
+	if (other == index)
+	{
+		return;
+	}
+
+	b2Swap(m_bodies[index], m_bodies[other]);
+	b2Swap(m_linearVelocities[index], m_linearVelocities[other]);
+	b2Swap(m_angularVelocities[index], m_angularVelocities[other]);
+	b2Swap(m_forces[index], m_forces[other]);
+	b2Swap(m_torques[index], m_torques[other]);
+	b2Swap(m_invMasses[index], m_invMasses[other]);
+	b2Swap(m_invIs[index], m_invIs[other]);
+	b2Swap(m_linearDampings[index], m_linearDampings[other]);
+	b2Swap(m_angularDampings[index], m_angularDampings[other]);
+	b2Swap(m_gravityScales[index], m_gravityScales[other]);
+	b2Swap(m_fieldGravities[index], m_fieldGravities[other]);
+	b2Swap(m_sleepTimes[index], m_sleepTimes[other]);
+
+	m_bodies[index]->m_storeIndex = index;
+	m_bodies[other]->m_storeIndex = other;
+}
+
+void b2BodyStore::ClearForces()
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		m_forces[i] = b2Vec2_zero;
+		m_torques[i] = 0.0f;
+	}
+}
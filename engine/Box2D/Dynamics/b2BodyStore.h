@@ -0,0 +1,56 @@
+#ifndef B2_BODY_STORE_H
+#define B2_BODY_STORE_H
+
+#include "../Common/b2Math.h"
+
+class b2Body;
+
+/// The hot per-body state used by the island solver, kept as a structure of
+/// arrays so integration and sleep checks touch contiguous memory instead of
+/// whole b2Body objects. Each body owns one slot, found through
+/// b2Body::m_storeIndex. Slots are kept dense: destroying a body moves the
+/// last slot into the hole. Each step the moving bodies of every island are
+/// placed in consecutive slots, in island order, so the solver walks the
+/// arrays front to back. This is an internal class owned by b2World.
+class b2BodyStore
+{
+public:
+	b2BodyStore();
+	~b2BodyStore();
+
+	/// Add a zeroed slot for a body and return its index.
+	int32 Create(b2Body* body);
+
+	/// Remove a slot. The body in the last slot is moved into it.
+	void Destroy(int32 index);
+
+	/// Move a body into a slot. The body there takes the old slot.
+	void Place(b2Body* body, int32 index);
+
+	/// Zero the forces and torques of every body.
+	void ClearForces();
+
+	int32 GetCount() const { return m_count; }
+
+	b2Body** m_bodies;
+	b2Vec2* m_linearVelocities;
+	float32* m_angularVelocities;
+	b2Vec2* m_forces;
+	float32* m_torques;
+	float32* m_invMasses;
+	float32* m_invIs;
+	float32* m_linearDampings;
+	float32* m_angularDampings;
+	float32* m_gravityScales;
+	b2Vec2* m_fieldGravities;
+	float32* m_sleepTimes;
+
+	int32 m_count;
+	int32 m_capacity;
+
+private:
+
+	void Reserve(int32 capacity);
+};
+
+#endif
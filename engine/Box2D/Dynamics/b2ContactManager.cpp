@@ -21,17 +21,33 @@
 #include "../Dynamics/b2Fixture.h"
 #include "../Dynamics/b2WorldCallbacks.h"
 #include "../Dynamics/Contacts/b2Contact.h"
+#include "../Common/b2Parallel.h"
 
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
-b2ContactManager::b2ContactManager()
+b2ContactManager::b2ContactManager(b2BroadPhaseType broadPhaseType)
+: m_broadPhase(broadPhaseType)
 {
 	m_contactList = NULL;
 	m_contactCount = 0;
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = NULL;
+
+	m_parallelCollide = false;
+	m_filterProxies = false;
+	m_sensorEvents = false;
+	m_updates = NULL;
+	m_updateCapacity = 0;
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	if (m_updates)
+	{
+		b2Free(m_updates);
+	}
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -104,9 +120,125 @@ void b2ContactManager::Destroy(b2Contact* c)
 // contact list.
 void b2ContactManager::Collide()
 {
+	if (m_parallelCollide)
+	{
+		CollideParallel();
+		return;
+	}
+
 	// Update awake contacts.
 	b2Contact* c = m_contactList;
 	while (c)
+	{
+		b2Contact* next = c->GetNext();
+		UpdateContact(c);
+		c = next;
+	}
+}
+
+void b2ContactManager::UpdateContact(b2Contact* c)
+{
+	b2Fixture* fixtureA = c->GetFixtureA();
+	b2Fixture* fixtureB = c->GetFixtureB();
+	int32 indexA = c->GetChildIndexA();
+	int32 indexB = c->GetChildIndexB();
+	b2Body* bodyA = fixtureA->GetBody();
+	b2Body* bodyB = fixtureB->GetBody();
+	 
+	// Is this contact flagged for filtering?
+	if (c->m_flags & b2Contact::e_filterFlag)
+	{
+		// Did a fixture become a tracked sensor?
+		if (m_sensorEvents && (fixtureA->IsSensor() || fixtureB->IsSensor()))
+		{
+			Destroy(c);
+			return;
+		}
+
+		// Should these bodies collide?
+		if (bodyB->ShouldCollide(bodyA) == false)
+		{
+			Destroy(c);
+			return;
+		}
+
+		// Check user filtering.
+		if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+		{
+			Destroy(c);
+			return;
+		}
+
+		// Clear the filtering flag.
+		c->m_flags &= ~b2Contact::e_filterFlag;
+	}
+
+	bool activeA = bodyA->IsStepping() && bodyA->m_type != b2_staticBody;
+	bool activeB = bodyB->IsStepping() && bodyB->m_type != b2_staticBody;
+
+	// At least one body must be awake, not frozen, and dynamic or kinematic.
+	if (activeA == false && activeB == false)
+	{
+		return;
+	}
+
+	int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
+	int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
+	bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+
+	// Here we destroy contacts that cease to overlap in the broad-phase.
+	if (overlap == false)
+	{
+		Destroy(c);
+		return;
+	}
+
+	// The contact persists.
+	c->Update(m_contactListener);
+}
+
+// Computes the manifolds for one block of gathered contacts.
+class b2CollideTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 index, int32 worker)
+	{
+		B2_NOT_USED(worker);
+
+		int32 begin = index * b2_collideBlockSize;
+		int32 end = b2Min(begin + b2_collideBlockSize, count);
+		for (int32 i = begin; i < end; ++i)
+		{
+			b2ContactUpdate* update = updates + i;
+			if (update->state == b2ContactUpdate::e_evaluate)
+			{
+				update->touching = update->contact->UpdateManifold(&update->oldManifold);
+			}
+		}
+	}
+
+	b2ContactUpdate* updates;
+	int32 count;
+};
+
+void b2ContactManager::CollideParallel()
+{
+	if (m_updateCapacity < m_contactCount)
+	{
+		if (m_updates)
+		{
+			b2Free(m_updates);
+		}
+
+		m_updateCapacity = b2Max(2 * m_updateCapacity, m_contactCount);
+		m_updates = (b2ContactUpdate*)b2Alloc(m_updateCapacity * sizeof(b2ContactUpdate));
+	}
+
+	// Gather the contacts and decide what happens to each one. Contacts that
+	// need the filter are left to the serial pass, so they see every callback
+	// reported before them.
+	int32 count = 0;
+	for (b2Contact* c = m_contactList; c; c = c->GetNext())
 	{
 		b2Fixture* fixtureA = c->GetFixtureA();
 		b2Fixture* fixtureB = c->GetFixtureB();
@@ -114,58 +246,87 @@ void b2ContactManager::Collide()
 		int32 indexB = c->GetChildIndexB();
 		b2Body* bodyA = fixtureA->GetBody();
 		b2Body* bodyB = fixtureB->GetBody();
-		 
-		// Is this contact flagged for filtering?
-		if (c->m_flags & b2Contact::e_filterFlag)
-		{
-			// Should these bodies collide?
-			if (bodyB->ShouldCollide(bodyA) == false)
-			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
-			}
 
-			// Check user filtering.
-			if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
-			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
-			}
+		b2ContactUpdate* update = m_updates + count;
+		++count;
+		update->contact = c;
 
-			// Clear the filtering flag.
-			c->m_flags &= ~b2Contact::e_filterFlag;
+		if (c->m_flags & b2Contact::e_filterFlag)
+		{
+			update->state = b2ContactUpdate::e_serial;
+			continue;
 		}
 
-		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
-		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+		bool activeA = bodyA->IsStepping() && bodyA->m_type != b2_staticBody;
+		bool activeB = bodyB->IsStepping() && bodyB->m_type != b2_staticBody;
 
-		// At least one body must be awake and it must be dynamic or kinematic.
+		// An earlier contact may still wake these bodies in the serial pass.
 		if (activeA == false && activeB == false)
 		{
-			c = c->GetNext();
+			update->state = b2ContactUpdate::e_serial;
 			continue;
 		}
 
 		int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
 		int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
-		bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+		if (m_broadPhase.TestOverlap(proxyIdA, proxyIdB) == false)
+		{
+			update->state = b2ContactUpdate::e_destroy;
+			continue;
+		}
 
-		// Here we destroy contacts that cease to overlap in the broad-phase.
-		if (overlap == false)
+		// Sensor overlap tests go through b2Distance, which updates global counters.
+		if (fixtureA->IsSensor() || fixtureB->IsSensor())
 		{
-			b2Contact* cNuke = c;
-			c = cNuke->GetNext();
-			Destroy(cNuke);
+			update->state = b2ContactUpdate::e_sensor;
 			continue;
 		}
 
-		// The contact persists.
-		c->Update(m_contactListener);
-		c = c->GetNext();
+		update->state = b2ContactUpdate::e_evaluate;
+	}
+
+	b2CollideTask task;
+	task.updates = m_updates;
+	task.count = count;
+	b2ParallelFor(&task, (count + b2_collideBlockSize - 1) / b2_collideBlockSize);
+
+	// Apply the results in list order.
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2ContactUpdate* update = m_updates + i;
+		b2Contact* c = update->contact;
+
+		// A callback earlier in this pass may have flagged the contact, for
+		// example through b2Fixture::Refilter. Undo the manifold computed on
+		// the worker and update the contact as Collide would.
+		if (update->state != b2ContactUpdate::e_serial && (c->m_flags & b2Contact::e_filterFlag))
+		{
+			if (update->state == b2ContactUpdate::e_evaluate)
+			{
+				c->m_manifold = update->oldManifold;
+			}
+
+			update->state = b2ContactUpdate::e_serial;
+		}
+
+		switch (update->state)
+		{
+		case b2ContactUpdate::e_destroy:
+			Destroy(c);
+			break;
+
+		case b2ContactUpdate::e_serial:
+			UpdateContact(c);
+			break;
+
+		case b2ContactUpdate::e_sensor:
+			c->Update(m_contactListener);
+			break;
+
+		case b2ContactUpdate::e_evaluate:
+			c->ReportUpdate(update->oldManifold, update->touching, m_contactListener);
+			break;
+		}
 	}
 }
 
@@ -194,6 +355,12 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 		return;
 	}
 
+	// Are the overlaps tracked by the sensor manager?
+	if (m_sensorEvents && (fixtureA->IsSensor() || fixtureB->IsSensor()))
+	{
+		return;
+	}
+
 	// TODO_ERIN use a hash table to remove a potential bottleneck when both
 	// bodies have a lot of contacts.
 	// Does a contact already exist?
@@ -242,13 +409,18 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 		return;
 	}
 
-	// Contact creation may swap fixtures.
-	fixtureA = c->GetFixtureA();
-	fixtureB = c->GetFixtureB();
-	indexA = c->GetChildIndexA();
-	indexB = c->GetChildIndexB();
-	bodyA = fixtureA->GetBody();
-	bodyB = fixtureB->GetBody();
+	// Contact creation may swap fixtures, so read them back from the contact.
+	Insert(c);
+
+	// Wake up the bodies
+	c->GetFixtureA()->GetBody()->SetAwake(true);
+	c->GetFixtureB()->GetBody()->SetAwake(true);
+}
+
+void b2ContactManager::Insert(b2Contact* c)
+{
+	b2Body* bodyA = c->GetFixtureA()->GetBody();
+	b2Body* bodyB = c->GetFixtureB()->GetBody();
 
 	// Insert into the world.
 	c->m_prev = NULL;
@@ -285,9 +457,5 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	}
 	bodyB->m_contactList = &c->m_nodeB;
 
-	// Wake up the bodies
-	bodyA->SetAwake(true);
-	bodyB->SetAwake(true);
-
 	++m_contactCount;
 }
@@ -20,33 +20,75 @@
 #define B2_CONTACT_MANAGER_H
 
 #include "../Collision/b2BroadPhase.h"
+#include "../Collision/b2Collision.h"
 
 class b2Contact;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
 
+// A contact gathered by the parallel narrow-phase.
+struct b2ContactUpdate
+{
+	enum State
+	{
+		e_destroy,		// no longer overlapping
+		e_serial,		// flagged for filtering or both bodies asleep, updated in the serial pass
+		e_sensor,		// updated in the serial pass
+		e_evaluate		// manifold computed on a worker
+	};
+
+	b2Contact* contact;
+	b2Manifold oldManifold;
+	State state;
+	bool touching;
+};
+
 // Delegate of b2World.
 class b2ContactManager
 {
 public:
-	b2ContactManager();
+	b2ContactManager(b2BroadPhaseType broadPhaseType = b2_dynamicTreeBroadPhase);
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
 
 	void FindNewContacts();
 
+	// Link a new contact into the contact list and the bodies' contact graph.
+	void Insert(b2Contact* c);
+
 	void Destroy(b2Contact* c);
 
 	void Collide();
-            
+
+	// Collide with the manifolds computed on worker threads. Contacts are
+	// gathered into m_updates first and all callbacks are reported afterwards
+	// in contact list order, so the results match Collide. Contacts flagged
+	// for filtering, also by a callback during the pass, are filtered when
+	// their turn comes, as Collide does.
+	void CollideParallel();
+
+	// Filter, test and update one contact for Collide. The contact may be destroyed.
+	void UpdateContact(b2Contact* c);
+
 	b2BroadPhase m_broadPhase;
 	b2Contact* m_contactList;
 	int32 m_contactCount;
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+
+	bool m_parallelCollide;
+
+	// Give the broad-phase proxies the filter bits of their fixtures.
+	bool m_filterProxies;
+
+	// Sensors get no contacts, b2SensorManager tracks their overlaps.
+	bool m_sensorEvents;
+	b2ContactUpdate* m_updates;
+	int32 m_updateCapacity;
 };
 
 #endif
@@ -36,6 +36,7 @@ b2Fixture::b2Fixture()
 	m_proxyCount = 0;
 	m_shape = NULL;
 	m_density = 0.0f;
+	m_sensorIndex = b2_nullSensor;
 }
 
 void b2Fixture::Create(b2BlockAllocator* allocator, b2Body* body, const b2FixtureDef* def)
@@ -50,6 +51,7 @@ void b2Fixture::Create(b2BlockAllocator* allocator, b2Body* body, const b2Fixtur
 	m_filter = def->filter;
 
 	m_isSensor = def->isSensor;
+	m_sensorIndex = b2_nullSensor;
 
 	m_shape = def->shape->Clone(allocator);
 
@@ -126,16 +128,35 @@ void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
 	// Create proxies in the broad-phase.
 	m_proxyCount = m_shape->GetChildCount();
 
+	uint16 categoryBits, maskBits;
+	GetProxyFilter(&categoryBits, &maskBits);
+
 	for (int32 i = 0; i < m_proxyCount; ++i)
 	{
 		b2FixtureProxy* proxy = m_proxies + i;
 		m_shape->ComputeAABB(&proxy->aabb, xf, i);
-		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy);
+		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy, m_body->GetType() == b2_staticBody, categoryBits, maskBits);
 		proxy->fixture = this;
 		proxy->childIndex = i;
 	}
 }
 
+// Positive groups collide whatever the categories, so their proxies take all
+// the bits and the broad-phase never skips them.
+void b2Fixture::GetProxyFilter(uint16* categoryBits, uint16* maskBits) const
+{
+	if (m_body->GetWorld()->m_contactManager.m_filterProxies && m_filter.groupIndex <= 0)
+	{
+		*categoryBits = m_filter.categoryBits;
+		*maskBits = m_filter.maskBits;
+	}
+	else
+	{
+		*categoryBits = 0xFFFF;
+		*maskBits = 0xFFFF;
+	}
+}
+
 void b2Fixture::DestroyProxies(b2BroadPhase* broadPhase)
 {
 	// Destroy proxies in the broad-phase.
@@ -209,10 +230,14 @@ void b2Fixture::Refilter()
 		return;
 	}
 
+	uint16 categoryBits, maskBits;
+	GetProxyFilter(&categoryBits, &maskBits);
+
 	// Touch each proxy so that new pairs may be created
 	b2BroadPhase* broadPhase = &world->m_contactManager.m_broadPhase;
 	for (int32 i = 0; i < m_proxyCount; ++i)
 	{
+		broadPhase->SetProxyFilter(m_proxies[i].proxyId, categoryBits, maskBits);
 		broadPhase->TouchProxy(m_proxies[i].proxyId);
 	}
 }
@@ -223,6 +248,23 @@ void b2Fixture::SetSensor(bool sensor)
 	{
 		m_body->SetAwake(true);
 		m_isSensor = sensor;
+
+		// Sensors tracked by the sensor manager have no contacts. Refilter
+		// destroys them, or finds them again for a fixture that stops being a sensor.
+		b2World* world = m_body->GetWorld();
+		if (world->m_contactManager.m_sensorEvents)
+		{
+			if (sensor)
+			{
+				world->m_sensorManager.AddSensor(this);
+			}
+			else
+			{
+				world->m_sensorManager.RemoveSensor(this);
+			}
+
+			Refilter();
+		}
 	}
 }
 
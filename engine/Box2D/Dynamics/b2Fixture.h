@@ -201,6 +201,7 @@ protected:
 	friend class b2World;
 	friend class b2Contact;
 	friend class b2ContactManager;
+	friend class b2SensorManager;
 
 	b2Fixture();
 
@@ -215,6 +216,9 @@ protected:
 
 	void Synchronize(b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2);
 
+	// Get the filter bits for the broad-phase proxies.
+	void GetProxyFilter(uint16* categoryBits, uint16* maskBits) const;
+
 	float32 m_density;
 
 	b2Fixture* m_next;
@@ -232,6 +236,9 @@ protected:
 
 	bool m_isSensor;
 
+	// Index into b2SensorManager::m_sensors, or b2_nullSensor.
+	int32 m_sensorIndex;
+
 	void* m_userData;
 };
 
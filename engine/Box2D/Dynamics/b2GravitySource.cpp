@@ -0,0 +1,64 @@
+#include "../Dynamics/b2GravitySource.h"
+#include "../Dynamics/b2Body.h"
+
+b2GravitySource::b2GravitySource(const b2GravitySourceDef* def)
+{
+	b2Assert(def->radius >= 0.0f);
+	b2Assert(def->minRadius > 0.0f);
+
+	m_prev = NULL;
+	m_next = NULL;
+
+	m_body = def->body;
+	m_center = def->center;
+	m_strength = def->strength;
+	m_falloff = def->falloff;
+	m_radius = def->radius;
+	m_minRadius = def->minRadius;
+
+	m_userData = def->userData;
+}
+
+b2Vec2 b2GravitySource::GetCenter() const
+{
+	if (m_body)
+	{
+		return m_body->GetWorldPoint(m_center);
+	}
+
+	return m_center;
+}
+
+b2Vec2 b2GravitySource::GetAcceleration(const b2Vec2& point) const
+{
+	return GetAcceleration(GetCenter(), point);
+}
+
+b2Vec2 b2GravitySource::GetAcceleration(const b2Vec2& center, const b2Vec2& point) const
+{
+	b2Vec2 d = center - point;
+	float32 distanceSquared = b2Dot(d, d);
+	if (distanceSquared > m_radius * m_radius)
+	{
+		return b2Vec2_zero;
+	}
+
+	float32 distance = b2Max(b2Sqrt(distanceSquared), m_minRadius);
+	float32 scale = m_strength;
+	switch (m_falloff)
+	{
+	case e_linearFalloff:
+		scale /= distance;
+		break;
+
+	case e_inverseSquareFalloff:
+		scale /= distance * distance;
+		break;
+
+	default:
+		break;
+	}
+
+	// Normalize with the clamped distance so a body at the center gets no pull.
+	return (scale / distance) * d;
+}
@@ -0,0 +1,190 @@
+#ifndef B2_GRAVITY_SOURCE_H
+#define B2_GRAVITY_SOURCE_H
+
+#include "../Common/b2Math.h"
+
+class b2Body;
+
+/// How the pull of a gravity source weakens with distance.
+enum b2GravityFalloff
+{
+	e_constantFalloff,		///< the same acceleration everywhere in range
+	e_linearFalloff,		///< strength / distance
+	e_inverseSquareFalloff	///< strength / distance^2
+};
+
+/// A gravity source definition is used to create a radial gravity field.
+struct b2GravitySourceDef
+{
+	b2GravitySourceDef()
+	{
+		userData = NULL;
+		body = NULL;
+		center.SetZero();
+		strength = 0.0f;
+		falloff = e_inverseSquareFalloff;
+		radius = 1.0f;
+		minRadius = 0.1f;
+	}
+
+	/// Use this to attach application specific data.
+	void* userData;
+
+	/// The body the field moves with, or NULL for a field fixed in the world.
+	b2Body* body;
+
+	/// The center of the field. This is a local point on the body if there is
+	/// one and a world point otherwise.
+	b2Vec2 center;
+
+	/// The acceleration scale, see b2GravityFalloff. Use a negative value to push
+	/// bodies away.
+	float32 strength;
+
+	b2GravityFalloff falloff;
+
+	/// Bodies whose center of mass is farther than this from the center are not
+	/// affected.
+	float32 radius;
+
+	/// Distances are clamped to at least this, which bounds the pull near the center.
+	float32 minRadius;
+};
+
+/// A radial gravity field, such as the pull of a planet. Every step the world
+/// finds the awake dynamic bodies in range through the broad-phase and adds the
+/// acceleration to their velocity during island integration, scaled by the body
+/// gravity scale. Fields don't wake sleeping bodies, like world gravity.
+/// Create and destroy gravity sources with b2World.
+class b2GravitySource
+{
+public:
+
+	/// Get the attached body, or NULL.
+	b2Body* GetBody() const;
+
+	/// Get the center of the field in world coordinates.
+	b2Vec2 GetCenter() const;
+
+	/// Set the center in local body coordinates, or world coordinates without a body.
+	void SetCenter(const b2Vec2& center);
+
+	float32 GetStrength() const;
+	void SetStrength(float32 strength);
+
+	b2GravityFalloff GetFalloff() const;
+	void SetFalloff(b2GravityFalloff falloff);
+
+	float32 GetRadius() const;
+	void SetRadius(float32 radius);
+
+	float32 GetMinRadius() const;
+	void SetMinRadius(float32 minRadius);
+
+	/// Get the acceleration the field gives a body centered at a world point.
+	/// This is zero out of range.
+	b2Vec2 GetAcceleration(const b2Vec2& point) const;
+
+	/// Get the next gravity source in the world's list.
+	b2GravitySource* GetNext();
+	const b2GravitySource* GetNext() const;
+
+	/// Get/set the user data pointer.
+	void* GetUserData() const;
+	void SetUserData(void* data);
+
+protected:
+
+	friend class b2World;
+	friend class b2GravityQuery;
+
+	b2GravitySource(const b2GravitySourceDef* def);
+
+	b2Vec2 GetAcceleration(const b2Vec2& center, const b2Vec2& point) const;
+
+	b2GravitySource* m_prev;
+	b2GravitySource* m_next;
+
+	b2Body* m_body;
+	b2Vec2 m_center;
+	float32 m_strength;
+	b2GravityFalloff m_falloff;
+	float32 m_radius;
+	float32 m_minRadius;
+
+	void* m_userData;
+};
+
+inline b2Body* b2GravitySource::GetBody() const
+{
+	return m_body;
+}
+
+inline void b2GravitySource::SetCenter(const b2Vec2& center)
+{
+	m_center = center;
+}
+
+inline float32 b2GravitySource::GetStrength() const
+{
+	return m_strength;
+}
+
+inline void b2GravitySource::SetStrength(float32 strength)
+{
+	m_strength = strength;
+}
+
+inline b2GravityFalloff b2GravitySource::GetFalloff() const
+{
+	return m_falloff;
+}
+
+inline void b2GravitySource::SetFalloff(b2GravityFalloff falloff)
+{
+	m_falloff = falloff;
+}
+
+inline float32 b2GravitySource::GetRadius() const
+{
+	return m_radius;
+}
+
+inline void b2GravitySource::SetRadius(float32 radius)
+{
+	b2Assert(radius >= 0.0f);
+	m_radius = radius;
+}
+
+inline float32 b2GravitySource::GetMinRadius() const
+{
+	return m_minRadius;
+}
+
+inline void b2GravitySource::SetMinRadius(float32 minRadius)
+{
+	b2Assert(minRadius > 0.0f);
+	m_minRadius = minRadius;
+}
+
+inline b2GravitySource* b2GravitySource::GetNext()
+{
+	return m_next;
+}
+
+inline const b2GravitySource* b2GravitySource::GetNext() const
+{
+	return m_next;
+}
+
+inline void* b2GravitySource::GetUserData() const
+{
+	return m_userData;
+}
+
+inline void b2GravitySource::SetUserData(void* data)
+{
+	m_userData = data;
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "../Dynamics/b2GravityTree.h"
+#include "../Common/b2GrowableStack.h"
+#include <cstring>
+
+b2GravityTree::b2GravityTree()
+{
+	m_nodeCount = 0;
+	m_nodeCapacity = 16;
+	m_nodes = (b2GravityTreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2GravityTreeNode));
+
+	m_massCount = 0;
+	m_massCapacity = 16;
+	m_masses = (b2GravityMass*)b2Alloc(m_massCapacity * sizeof(b2GravityMass));
+}
+
+b2GravityTree::~b2GravityTree()
+{
+	b2Free(m_nodes);
+	b2Free(m_masses);
+}
+
+int32 b2GravityTree::AllocateNode()
+{
+	if (m_nodeCount == m_nodeCapacity)
+	{
+		b2GravityTreeNode* oldNodes = m_nodes;
+		m_nodeCapacity *= 2;
+		m_nodes = (b2GravityTreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2GravityTreeNode));
+		memcpy(m_nodes, oldNodes, m_nodeCount * sizeof(b2GravityTreeNode));
+		b2Free(oldNodes);
+	}
+
+	int32 nodeId = m_nodeCount;
+	++m_nodeCount;
+	return nodeId;
+}
+
+void b2GravityTree::Build(const b2GravityMass* masses, int32 count)
+{
+	if (count > m_massCapacity)
+	{
+		b2Free(m_masses);
+		while (m_massCapacity < count)
+		{
+			m_massCapacity *= 2;
+		}
+		m_masses = (b2GravityMass*)b2Alloc(m_massCapacity * sizeof(b2GravityMass));
+	}
+
+	memcpy(m_masses, masses, count * sizeof(b2GravityMass));
+	m_massCount = count;
+	m_nodeCount = 0;
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	// The root is the smallest square around all masses.
+	b2Vec2 lower = m_masses[0].position;
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < count; ++i)
+	{
+		lower = b2Min(lower, m_masses[i].position);
+		upper = b2Max(upper, m_masses[i].position);
+	}
+
+	b2Vec2 extents = upper - lower;
+	float32 size = b2Max(b2Max(extents.x, extents.y), b2_linearSlop);
+
+	BuildNode(0, count, lower, size, 0);
+}
+
+// Move the masses in [first, first + count) with coordinate below the split
+// to the front. Returns how many there are.
+static int32 b2Partition(b2GravityMass* masses, int32 first, int32 count, int32 axis, float32 split)
+{
+	int32 i = first;
+	int32 j = first + count - 1;
+	while (i <= j)
+	{
+		float32 x = axis == 0 ? masses[i].position.x : masses[i].position.y;
+		if (x < split)
+		{
+			++i;
+		}
+		else
+		{
+			b2Swap(masses[i], masses[j]);
+			--j;
+		}
+	}
+
+	return i - first;
+}
+
+int32 b2GravityTree::BuildNode(int32 first, int32 count, const b2Vec2& lowerBound, float32 size, int32 depth)
+{
+	int32 nodeId = AllocateNode();
+
+	// Sum the masses. The center is weighted by the absolute strength so
+	// repulsive sources don't move it away from the group.
+	float32 strength = 0.0f;
+	float32 weight = 0.0f;
+	float32 minRadius = 0.0f;
+	b2Vec2 center(0.0f, 0.0f);
+	for (int32 i = first; i < first + count; ++i)
+	{
+		const b2GravityMass* mass = m_masses + i;
+		float32 w = b2Abs(mass->strength);
+		strength += mass->strength;
+		weight += w;
+		center += w * mass->position;
+		minRadius = b2Max(minRadius, mass->minRadius);
+	}
+
+	if (weight > 0.0f)
+	{
+		center *= 1.0f / weight;
+	}
+	else
+	{
+		center = lowerBound + b2Vec2(0.5f * size, 0.5f * size);
+	}
+
+	int32 children[4] = {-1, -1, -1, -1};
+
+	// Coincident masses can't be split, so the depth is limited.
+	if (count > b2_gravityTreeLeafSize && depth < b2_gravityTreeMaxDepth)
+	{
+		float32 half = 0.5f * size;
+		b2Vec2 mid = lowerBound + b2Vec2(half, half);
+
+		// Split on x, then split both halves on y.
+		int32 left = b2Partition(m_masses, first, count, 0, mid.x);
+		int32 lowerLeft = b2Partition(m_masses, first, left, 1, mid.y);
+		int32 lowerRight = b2Partition(m_masses, first + left, count - left, 1, mid.y);
+
+		int32 begins[4] = {first, first + lowerLeft, first + left, first + left + lowerRight};
+		int32 counts[4] = {lowerLeft, left - lowerLeft, lowerRight, count - left - lowerRight};
+		b2Vec2 lowers[4] =
+		{
+			lowerBound,
+			b2Vec2(lowerBound.x, mid.y),
+			b2Vec2(mid.x, lowerBound.y),
+			mid
+		};
+
+		for (int32 i = 0; i < 4; ++i)
+		{
+			if (counts[i] > 0)
+			{
+				children[i] = BuildNode(begins[i], counts[i], lowers[i], half, depth + 1);
+			}
+		}
+	}
+
+	// The pool may have moved while building the children.
+	b2GravityTreeNode* node = m_nodes + nodeId;
+	node->lowerBound = lowerBound;
+	node->size = size;
+	node->center = center;
+	node->strength = strength;
+	node->minRadius = minRadius;
+	for (int32 i = 0; i < 4; ++i)
+	{
+		node->children[i] = children[i];
+	}
+	node->first = first;
+	node->count = count;
+
+	return nodeId;
+}
+
+b2Vec2 b2GravityTree::GetAcceleration(const b2Vec2& point, const b2Body* body, float32 theta) const
+{
+	b2Vec2 acceleration(0.0f, 0.0f);
+	if (m_nodeCount == 0)
+	{
+		return acceleration;
+	}
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(0);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2GravityTreeNode* node = m_nodes + stack.Pop();
+
+		if (node->IsLeaf() == false)
+		{
+			b2Vec2 d = node->center - point;
+			float32 distance = d.Length();
+
+			// A cell holding the point is always opened so a body never feels
+			// its own mass through a group.
+			b2Vec2 r = point - node->lowerBound;
+			bool inside = 0.0f <= r.x && r.x <= node->size && 0.0f <= r.y && r.y <= node->size;
+
+			if (inside || node->size >= theta * distance)
+			{
+				for (int32 i = 0; i < 4; ++i)
+				{
+					if (node->children[i] != -1)
+					{
+						stack.Push(node->children[i]);
+					}
+				}
+				continue;
+			}
+
+			distance = b2Max(distance, node->minRadius);
+			acceleration += (node->strength / (distance * distance * distance)) * d;
+			continue;
+		}
+
+		for (int32 i = node->first; i < node->first + node->count; ++i)
+		{
+			const b2GravityMass* mass = m_masses + i;
+			if (mass->body != NULL && mass->body == body)
+			{
+				continue;
+			}
+
+			// Same as an inverse square b2GravitySource.
+			b2Vec2 d = mass->position - point;
+			float32 distance = b2Max(d.Length(), mass->minRadius);
+			acceleration += (mass->strength / (distance * distance * distance)) * d;
+		}
+	}
+
+	return acceleration;
+}
@@ -0,0 +1,93 @@
+#ifndef B2_GRAVITY_TREE_H
+#define B2_GRAVITY_TREE_H
+
+#include "../Common/b2Math.h"
+
+class b2Body;
+
+/// A point mass pulling with strength / distance^2.
+struct b2GravityMass
+{
+	b2Vec2 position;
+	float32 strength;
+	float32 minRadius;
+
+	/// The body carrying the mass. It is not pulled by its own masses.
+	const b2Body* body;
+};
+
+/// A square cell of the gravity tree. Leaves own a range of masses.
+struct b2GravityTreeNode
+{
+	bool IsLeaf() const
+	{
+		return children[0] == -1 && children[1] == -1 && children[2] == -1 && children[3] == -1;
+	}
+
+	b2Vec2 lowerBound;
+	float32 size;
+
+	/// The center of the masses weighted by the absolute strength.
+	b2Vec2 center;
+	float32 strength;
+
+	/// The largest minimum radius of the masses.
+	float32 minRadius;
+
+	int32 children[4];
+	int32 first;
+	int32 count;
+};
+
+/// A quadtree over point masses for Barnes-Hut gravity. A cell that is small
+/// compared to its distance from a point is treated as a single mass at the
+/// center of its masses, so the pull of n masses costs about log(n) instead of n.
+/// Sources with mixed signs are approximated less well because they are grouped
+/// by position only.
+class b2GravityTree
+{
+public:
+
+	b2GravityTree();
+	~b2GravityTree();
+
+	/// Rebuild the tree over a set of masses. The masses are copied.
+	void Build(const b2GravityMass* masses, int32 count);
+
+	/// Get the acceleration at a point.
+	/// @param body masses carried by this body are ignored. May be NULL.
+	/// @param theta a cell of size s at distance d is treated as one mass when
+	/// s < theta * d. Zero visits every mass.
+	b2Vec2 GetAcceleration(const b2Vec2& point, const b2Body* body, float32 theta) const;
+
+	/// Get the number of masses in the tree.
+	int32 GetMassCount() const;
+
+	/// Get the number of cells in the tree.
+	int32 GetNodeCount() const;
+
+private:
+
+	int32 AllocateNode();
+	int32 BuildNode(int32 first, int32 count, const b2Vec2& lowerBound, float32 size, int32 depth);
+
+	b2GravityTreeNode* m_nodes;
+	int32 m_nodeCount;
+	int32 m_nodeCapacity;
+
+	b2GravityMass* m_masses;
+	int32 m_massCount;
+	int32 m_massCapacity;
+};
+
+inline int32 b2GravityTree::GetMassCount() const
+{
+	return m_massCount;
+}
+
+inline int32 b2GravityTree::GetNodeCount() const
+{
+	return m_nodeCount;
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include "../Dynamics/Contacts/b2Contact.h"
 #include "../Dynamics/Contacts/b2ContactSolver.h"
 #include "../Dynamics/Joints/b2Joint.h"
+#include "../Common/b2Parallel.h"
 #include "../Common/b2StackAllocator.h"
 #include "../Common/b2Timer.h"
 
@@ -151,14 +152,41 @@ b2Island::b2Island(
 	int32 jointCapacity,
 	b2StackAllocator* allocator,
 	b2ContactListener* listener)
+{
+	Initialize(bodyCapacity, contactCapacity, jointCapacity, 0, allocator, listener);
+}
+
+b2Island::b2Island(
+	int32 bodyCapacity,
+	int32 contactCapacity,
+	int32 jointCapacity,
+	int32 staticCapacity,
+	b2StackAllocator* allocator,
+	b2ContactListener* listener)
+{
+	Initialize(bodyCapacity, contactCapacity, jointCapacity, staticCapacity, allocator, listener);
+}
+
+void b2Island::Initialize(
+	int32 bodyCapacity,
+	int32 contactCapacity,
+	int32 jointCapacity,
+	int32 staticCapacity,
+	b2StackAllocator* allocator,
+	b2ContactListener* listener)
 {
 	m_bodyCapacity = bodyCapacity;
 	m_contactCapacity = contactCapacity;
 	m_jointCapacity	 = jointCapacity;
+	m_staticCapacity = staticCapacity;
 	m_bodyCount = 0;
 	m_contactCount = 0;
 	m_jointCount = 0;
 
+	m_store = NULL;
+	m_storeBase = 0;
+	m_movingCount = 0;
+
 	m_allocator = allocator;
 	m_listener = listener;
 
@@ -166,26 +194,172 @@ b2Island::b2Island(
 	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
 	m_joints = (b2Joint**)m_allocator->Allocate(jointCapacity * sizeof(b2Joint*));
 
-	m_velocities = (b2Velocity*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Velocity));
-	m_positions = (b2Position*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Position));
+	// Static slots sit in front of the body slots and are addressed with negative indices.
+	int32 slotCount = m_staticCapacity + m_bodyCapacity;
+	m_velocities = (b2Velocity*)m_allocator->Allocate(slotCount * sizeof(b2Velocity)) + m_staticCapacity;
+	m_positions = (b2Position*)m_allocator->Allocate(slotCount * sizeof(b2Position)) + m_staticCapacity;
+}
+
+int32 b2Island::Gather(b2BodyStore* store, int32 base)
+{
+	// Static bodies can be in several islands, so they keep their slots.
+	int32 count = 0;
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		if (m_bodies[i]->m_type != b2_staticBody)
+		{
+			b2Swap(m_bodies[count], m_bodies[i]);
+			++count;
+		}
+	}
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		m_bodies[i]->m_islandIndex = i;
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		store->Place(m_bodies[i], base + i);
+	}
+
+	m_store = store;
+	m_storeBase = base;
+	m_movingCount = count;
+	return base + count;
 }
 
 b2Island::~b2Island()
 {
 	// Warning: the order should reverse the constructor order.
-	m_allocator->Free(m_positions);
-	m_allocator->Free(m_velocities);
+	m_allocator->Free(m_positions - m_staticCapacity);
+	m_allocator->Free(m_velocities - m_staticCapacity);
 	m_allocator->Free(m_joints);
 	m_allocator->Free(m_contacts);
 	m_allocator->Free(m_bodies);
 }
 
+// Solves the joints and wide contact batches of one color in blocks. Constraints
+// of a color never share a body with mass, so blocks can run on any worker.
+class b2ColorTask : public b2ParallelTask
+{
+public:
+	enum Phase
+	{
+		e_warmStart,
+		e_velocity,
+		e_position
+	};
+
+	void Execute(int32 index, int32 worker)
+	{
+		int32 begin = index * b2_solverBlockSize;
+		int32 end = b2Min(begin + b2_solverBlockSize, count);
+
+		// Joints come first in a color, then the batches.
+		int32 jointEnd = b2Min(end, jointCount);
+		for (int32 i = begin; i < jointEnd; ++i)
+		{
+			if (phase == e_velocity)
+			{
+				joints[i]->SolveVelocityConstraints(*data);
+			}
+			else if (phase == e_position)
+			{
+				if (joints[i]->SolvePositionConstraints(*data) == false)
+				{
+					jointsOkay[worker] = false;
+				}
+			}
+		}
+
+		int32 batchBegin = batchStart + b2Max(begin, jointCount) - jointCount;
+		int32 batchEnd = batchStart + end - jointCount;
+		if (batchBegin >= batchEnd)
+		{
+			return;
+		}
+
+		switch (phase)
+		{
+		case e_warmStart:
+			solver->WarmStartWide(batchBegin, batchEnd);
+			break;
+
+		case e_velocity:
+			solver->SolveVelocityConstraintsWide(batchBegin, batchEnd);
+			break;
+
+		case e_position:
+			{
+				float32 separation = solver->SolvePositionConstraintsWide(batchBegin, batchEnd);
+				minSeparations[worker] = b2Min(minSeparations[worker], separation);
+			}
+			break;
+		}
+	}
+
+	// Run the phase over every color in order.
+	void Run()
+	{
+		for (int32 color = 0; color <= b2_wideColorCount; ++color)
+		{
+			joints = solver->m_coloredJoints + solver->m_jointColorStarts[color];
+			jointCount = solver->m_jointColorStarts[color + 1] - solver->m_jointColorStarts[color];
+			batchStart = solver->m_colorStarts[color];
+			count = jointCount + solver->m_colorStarts[color + 1] - batchStart;
+
+			int32 blockCount = (count + b2_solverBlockSize - 1) / b2_solverBlockSize;
+
+			// The constraints left over from coloring conflict, so they are solved in order.
+			if (color == b2_wideColorCount || blockCount <= 1)
+			{
+				for (int32 i = 0; i < blockCount; ++i)
+				{
+					Execute(i, 0);
+				}
+			}
+			else
+			{
+				b2ParallelFor(this, blockCount);
+			}
+		}
+	}
+
+	b2ContactSolver* solver;
+	const b2SolverData* data;
+	Phase phase;
+
+	b2Joint** joints;
+	int32 jointCount;
+	int32 batchStart;
+	int32 count;
+
+	float32 minSeparations[b2_maxWorkers];
+	bool jointsOkay[b2_maxWorkers];
+};
+
 void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
 {
 	b2Timer timer;
 
 	float32 h = step.dt;
 
+	// The moving bodies sit in consecutive store slots, in island order.
+	b2Assert(m_store != NULL);
+	int32 base = m_storeBase;
+	b2Vec2* linearVelocities = m_store->m_linearVelocities + base;
+	float32* angularVelocities = m_store->m_angularVelocities + base;
+	const b2Vec2* forces = m_store->m_forces + base;
+	const float32* torques = m_store->m_torques + base;
+	const float32* invMasses = m_store->m_invMasses + base;
+	const float32* invIs = m_store->m_invIs + base;
+	const float32* linearDampings = m_store->m_linearDampings + base;
+	const float32* angularDampings = m_store->m_angularDampings + base;
+	const float32* gravityScales = m_store->m_gravityScales + base;
+	const b2Vec2* fieldGravities = m_store->m_fieldGravities + base;
+	float32* sleepTimes = m_store->m_sleepTimes + base;
+
 	// Integrate velocities and apply damping. Initialize the body state.
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
@@ -193,18 +367,30 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 
 		b2Vec2 c = b->m_sweep.c;
 		float32 a = b->m_sweep.a;
-		b2Vec2 v = b->m_linearVelocity;
-		float32 w = b->m_angularVelocity;
 
 		// Store positions for continuous collision.
 		b->m_sweep.c0 = b->m_sweep.c;
 		b->m_sweep.a0 = b->m_sweep.a;
 
+		m_positions[i].c = c;
+		m_positions[i].a = a;
+
+		// Static bodies don't move.
+		if (i >= m_movingCount)
+		{
+			m_velocities[i].v.SetZero();
+			m_velocities[i].w = 0.0f;
+			continue;
+		}
+
+		b2Vec2 v = linearVelocities[i];
+		float32 w = angularVelocities[i];
+
 		if (b->m_type == b2_dynamicBody)
 		{
 			// Integrate velocities.
-			v += h * (b->m_gravityScale * gravity + b->m_invMass * b->m_force);
-			w += h * b->m_invI * b->m_torque;
+			v += h * (gravityScales[i] * (gravity + fieldGravities[i]) + invMasses[i] * forces[i]);
+			w += h * invIs[i] * torques[i];
 
 			// Apply damping.
 			// ODE: dv/dt + c * v = 0
@@ -213,12 +399,10 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 			// v2 = exp(-c * dt) * v1
 			// Taylor expansion:
 			// v2 = (1.0f - c * dt) * v1
-			v *= b2Clamp(1.0f - h * b->m_linearDamping, 0.0f, 1.0f);
-			w *= b2Clamp(1.0f - h * b->m_angularDamping, 0.0f, 1.0f);
+			v *= b2Clamp(1.0f - h * linearDampings[i], 0.0f, 1.0f);
+			w *= b2Clamp(1.0f - h * angularDampings[i], 0.0f, 1.0f);
 		}
 
-		m_positions[i].c = c;
-		m_positions[i].a = a;
 		m_velocities[i].v = v;
 		m_velocities[i].w = w;
 	}
@@ -231,21 +415,39 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	solverData.positions = m_positions;
 	solverData.velocities = m_velocities;
 
+	// Small islands aren't worth spreading over the workers.
+	bool parallel = step.parallelSolver && m_contactCount + m_jointCount >= b2_parallelSolverMinConstraints;
+
 	// Initialize velocity constraints.
 	b2ContactSolverDef contactSolverDef;
 	contactSolverDef.step = step;
+	contactSolverDef.step.parallelSolver = parallel;
 	contactSolverDef.contacts = m_contacts;
 	contactSolverDef.count = m_contactCount;
 	contactSolverDef.positions = m_positions;
 	contactSolverDef.velocities = m_velocities;
 	contactSolverDef.allocator = m_allocator;
+	contactSolverDef.joints = m_joints;
+	contactSolverDef.jointCount = m_jointCount;
 
 	b2ContactSolver contactSolver(&contactSolverDef);
 	contactSolver.InitializeVelocityConstraints();
 
+	b2ColorTask colorTask;
+	colorTask.solver = &contactSolver;
+	colorTask.data = &solverData;
+
 	if (step.warmStarting)
 	{
-		contactSolver.WarmStart();
+		if (parallel)
+		{
+			colorTask.phase = b2ColorTask::e_warmStart;
+			colorTask.Run();
+		}
+		else
+		{
+			contactSolver.WarmStart();
+		}
 	}
 	
 	for (int32 i = 0; i < m_jointCount; ++i)
@@ -259,6 +461,13 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	timer.Reset();
 	for (int32 i = 0; i < step.velocityIterations; ++i)
 	{
+		if (parallel)
+		{
+			colorTask.phase = b2ColorTask::e_velocity;
+			colorTask.Run();
+			continue;
+		}
+
 		for (int32 j = 0; j < m_jointCount; ++j)
 		{
 			m_joints[j]->SolveVelocityConstraints(solverData);
@@ -309,13 +518,36 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	bool positionSolved = false;
 	for (int32 i = 0; i < step.positionIterations; ++i)
 	{
-		bool contactsOkay = contactSolver.SolvePositionConstraints();
-
+		bool contactsOkay = true;
 		bool jointsOkay = true;
-		for (int32 i = 0; i < m_jointCount; ++i)
+
+		if (parallel)
+		{
+			for (int32 j = 0; j < b2_maxWorkers; ++j)
+			{
+				colorTask.minSeparations[j] = 0.0f;
+				colorTask.jointsOkay[j] = true;
+			}
+
+			colorTask.phase = b2ColorTask::e_position;
+			colorTask.Run();
+
+			// Same tolerance as the wide solver.
+			for (int32 j = 0; j < b2_maxWorkers; ++j)
+			{
+				contactsOkay = contactsOkay && colorTask.minSeparations[j] >= -3.0f * b2_linearSlop;
+				jointsOkay = jointsOkay && colorTask.jointsOkay[j];
+			}
+		}
+		else
 		{
-			bool jointOkay = m_joints[i]->SolvePositionConstraints(solverData);
-			jointsOkay = jointsOkay && jointOkay;
+			contactsOkay = contactSolver.SolvePositionConstraints();
+
+			for (int32 i = 0; i < m_jointCount; ++i)
+			{
+				bool jointOkay = m_joints[i]->SolvePositionConstraints(solverData);
+				jointsOkay = jointsOkay && jointOkay;
+			}
 		}
 
 		if (contactsOkay && jointsOkay)
@@ -332,11 +564,15 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		b2Body* body = m_bodies[i];
 		body->m_sweep.c = m_positions[i].c;
 		body->m_sweep.a = m_positions[i].a;
-		body->m_linearVelocity = m_velocities[i].v;
-		body->m_angularVelocity = m_velocities[i].w;
 		body->SynchronizeTransform();
 	}
 
+	for (int32 i = 0; i < m_movingCount; ++i)
+	{
+		linearVelocities[i] = m_velocities[i].v;
+		angularVelocities[i] = m_velocities[i].w;
+	}
+
 	profile->solvePosition = timer.GetMilliseconds();
 
 	Report(contactSolver.m_velocityConstraints);
@@ -348,25 +584,24 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		const float32 linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
 		const float32 angTolSqr = b2_angularSleepTolerance * b2_angularSleepTolerance;
 
-		for (int32 i = 0; i < m_bodyCount; ++i)
+		for (int32 i = 0; i < m_movingCount; ++i)
 		{
 			b2Body* b = m_bodies[i];
-			if (b->GetType() == b2_staticBody)
-			{
-				continue;
-			}
 
+			// The solved velocities are still in the island buffer.
+			const b2Velocity& v = m_velocities[i];
+			float32& sleepTime = sleepTimes[i];
 			if ((b->m_flags & b2Body::e_autoSleepFlag) == 0 ||
-				b->m_angularVelocity * b->m_angularVelocity > angTolSqr ||
-				b2Dot(b->m_linearVelocity, b->m_linearVelocity) > linTolSqr)
+				v.w * v.w > angTolSqr ||
+				b2Dot(v.v, v.v) > linTolSqr)
 			{
-				b->m_sleepTime = 0.0f;
+				sleepTime = 0.0f;
 				minSleepTime = 0.0f;
 			}
 			else
 			{
-				b->m_sleepTime += h;
-				minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+				sleepTime += h;
+				minSleepTime = b2Min(minSleepTime, sleepTime);
 			}
 		}
 
@@ -392,8 +627,8 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 		b2Body* b = m_bodies[i];
 		m_positions[i].c = b->m_sweep.c;
 		m_positions[i].a = b->m_sweep.a;
-		m_velocities[i].v = b->m_linearVelocity;
-		m_velocities[i].w = b->m_angularVelocity;
+		m_velocities[i].v = b->LinearVelocity();
+		m_velocities[i].w = b->AngularVelocity();
 	}
 
 	b2ContactSolverDef contactSolverDef;
@@ -403,6 +638,8 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	contactSolverDef.step = subStep;
 	contactSolverDef.positions = m_positions;
 	contactSolverDef.velocities = m_velocities;
+	contactSolverDef.joints = NULL;
+	contactSolverDef.jointCount = 0;
 	b2ContactSolver contactSolver(&contactSolverDef);
 
 	// Solve position constraints.
@@ -505,8 +742,8 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 		b2Body* body = m_bodies[i];
 		body->m_sweep.c = c;
 		body->m_sweep.a = a;
-		body->m_linearVelocity = v;
-		body->m_angularVelocity = w;
+		body->LinearVelocity() = v;
+		body->AngularVelocity() = w;
 		body->SynchronizeTransform();
 	}
 
@@ -36,6 +36,10 @@ class b2Island
 public:
 	b2Island(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity,
 			b2StackAllocator* allocator, b2ContactListener* listener);
+
+	/// Reserve solver slots for static bodies shared with other islands. See AddStatic.
+	b2Island(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity, int32 staticCapacity,
+			b2StackAllocator* allocator, b2ContactListener* listener);
 	~b2Island();
 
 	void Clear()
@@ -43,8 +47,15 @@ public:
 		m_bodyCount = 0;
 		m_contactCount = 0;
 		m_jointCount = 0;
+		m_movingCount = 0;
 	}
 
+	/// Put the bodies that move in front of the static ones and place them in
+	/// the store slots [base, base + count), in island order. Returns the
+	/// slot after the last one used. Solve needs this, or m_store,
+	/// m_storeBase and m_movingCount set for bodies placed beforehand.
+	int32 Gather(b2BodyStore* store, int32 base);
+
 	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
 
 	void SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB);
@@ -57,6 +68,20 @@ public:
 		++m_bodyCount;
 	}
 
+	// Islands solved concurrently may share static bodies, so a static body cannot
+	// take a per-island index. Instead it is given a fixed negative solver index
+	// in [-staticCapacity, -1] and its state is copied into this island's arrays.
+	void AddStatic(b2Body* body)
+	{
+		b2Assert(body->m_type == b2_staticBody);
+		b2Assert(-m_staticCapacity <= body->m_islandIndex && body->m_islandIndex < 0);
+		int32 index = body->m_islandIndex;
+		m_positions[index].c = body->m_sweep.c;
+		m_positions[index].a = body->m_sweep.a;
+		m_velocities[index].v = body->LinearVelocity();
+		m_velocities[index].w = body->AngularVelocity();
+	}
+
 	void Add(b2Contact* contact)
 	{
 		b2Assert(m_contactCount < m_contactCapacity);
@@ -71,6 +96,9 @@ public:
 
 	void Report(const b2ContactVelocityConstraint* constraints);
 
+	void Initialize(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity, int32 staticCapacity,
+					b2StackAllocator* allocator, b2ContactListener* listener);
+
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
 
@@ -81,6 +109,11 @@ public:
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
 
+	// The first m_movingCount bodies own the store slots from m_storeBase on.
+	b2BodyStore* m_store;
+	int32 m_storeBase;
+	int32 m_movingCount;
+
 	int32 m_bodyCount;
 	int32 m_jointCount;
 	int32 m_contactCount;
@@ -88,6 +121,7 @@ public:
 	int32 m_bodyCapacity;
 	int32 m_contactCapacity;
 	int32 m_jointCapacity;
+	int32 m_staticCapacity;
 };
 
 #endif
@@ -0,0 +1,227 @@
+#include "b2Profiler.h"
+#include "../Common/b2Math.h"
+#include <cstdio>
+#include <cstring>
+
+b2Profiler::b2Profiler()
+{
+	m_steps = NULL;
+	m_stepIndex = 0;
+	m_stepCount = 0;
+
+	m_events = NULL;
+	m_eventIndex = 0;
+	m_eventCount = 0;
+}
+
+b2Profiler::~b2Profiler()
+{
+	SetEnabled(false);
+}
+
+void b2Profiler::SetEnabled(bool flag)
+{
+	if (flag == IsEnabled())
+	{
+		return;
+	}
+
+	if (flag)
+	{
+		m_steps = (b2ProfileStep*)b2Alloc(b2_profileStepCount * sizeof(b2ProfileStep));
+		m_events = (b2ProfileEvent*)b2Alloc(b2_profileEventCount * sizeof(b2ProfileEvent));
+		m_clock.Reset();
+	}
+	else
+	{
+		b2Free(m_steps);
+		b2Free(m_events);
+		m_steps = NULL;
+		m_events = NULL;
+	}
+
+	Clear();
+}
+
+void b2Profiler::Clear()
+{
+	m_stepIndex = 0;
+	m_stepCount = 0;
+	m_eventIndex = 0;
+	m_eventCount = 0;
+}
+
+void b2Profiler::AddEvent(const char* name, float64 start, int32 worker)
+{
+	if (m_events == NULL)
+	{
+		return;
+	}
+
+	b2ProfileEvent event;
+	event.name = name;
+	event.start = start;
+	event.duration = float32(GetTime() - start);
+	event.worker = worker;
+	event.bodyCount = 0;
+	event.contactCount = 0;
+	event.jointCount = 0;
+	AddEvent(event);
+}
+
+void b2Profiler::AddEvent(const b2ProfileEvent& event)
+{
+	if (m_events == NULL)
+	{
+		return;
+	}
+
+	m_events[m_eventIndex] = event;
+	m_eventIndex = (m_eventIndex + 1) % b2_profileEventCount;
+	m_eventCount = b2Min(m_eventCount + 1, b2_profileEventCount);
+}
+
+void b2Profiler::AddStep(const b2ProfileStep& step)
+{
+	if (m_steps == NULL)
+	{
+		return;
+	}
+
+	m_steps[m_stepIndex] = step;
+	m_stepIndex = (m_stepIndex + 1) % b2_profileStepCount;
+	m_stepCount = b2Min(m_stepCount + 1, b2_profileStepCount);
+}
+
+void b2Profiler::GetHistogram(float32 b2Profile::* timing, b2ProfileHistogram* histogram) const
+{
+	memset(histogram, 0, sizeof(b2ProfileHistogram));
+	histogram->stepCount = m_stepCount;
+	if (m_stepCount == 0)
+	{
+		return;
+	}
+
+	float32 minimum = b2_maxFloat;
+	float32 maximum = -b2_maxFloat;
+	float32 sum = 0.0f;
+	for (int32 i = 0; i < m_stepCount; ++i)
+	{
+		float32 value = m_steps[i].profile.*timing;
+		minimum = b2Min(minimum, value);
+		maximum = b2Max(maximum, value);
+		sum += value;
+	}
+
+	histogram->minimum = minimum;
+	histogram->maximum = maximum;
+	histogram->mean = sum / m_stepCount;
+	histogram->binWidth = (maximum - minimum) / b2_profileHistogramBins;
+
+	for (int32 i = 0; i < m_stepCount; ++i)
+	{
+		float32 value = m_steps[i].profile.*timing;
+		int32 bin = b2_profileHistogramBins - 1;
+		if (histogram->binWidth > 0.0f)
+		{
+			bin = b2Min(int32((value - minimum) / histogram->binWidth), b2_profileHistogramBins - 1);
+		}
+		++histogram->counts[bin];
+	}
+}
+
+// Names used for the contact counters in the trace.
+static const char* b2GetShapeName(int32 type)
+{
+	switch (type)
+	{
+	case b2Shape::e_circle:
+		return "circle";
+	case b2Shape::e_edge:
+		return "edge";
+	case b2Shape::e_polygon:
+		return "polygon";
+	case b2Shape::e_chain:
+		return "chain";
+	default:
+		return "unknown";
+	}
+}
+
+bool b2Profiler::WriteChromeTrace(const char* path) const
+{
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for (int32 i = 0; i < b2_maxWorkers; ++i)
+	{
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Box2D worker %d\"}},\n", i, i);
+	}
+
+	for (int32 i = 0; i < m_eventCount; ++i)
+	{
+		const b2ProfileEvent& event = GetEvent(i);
+		fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+			event.name, event.worker, event.start, event.duration);
+
+		if (event.bodyCount > 0)
+		{
+			fprintf(file, ",\"args\":{\"bodies\":%d,\"contacts\":%d,\"joints\":%d}",
+				event.bodyCount, event.contactCount, event.jointCount);
+		}
+
+		fprintf(file, "},\n");
+	}
+
+	// Counter tracks, oldest step first.
+	for (int32 age = m_stepCount - 1; age >= 0; --age)
+	{
+		const b2ProfileStep& step = GetStep(age);
+		const b2ProfileCounters& c = step.counters;
+
+		fprintf(file, "{\"name\":\"Bodies\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"total\":%d,\"awake\":%d,\"frozen\":%d,\"islands\":%d}},\n",
+			step.start, c.bodyCount, c.awakeBodyCount, c.frozenBodyCount, c.islandCount);
+		fprintf(file, "{\"name\":\"Contacts\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"total\":%d,\"touching\":%d,\"new\":%d}},\n",
+			step.start, c.contactCount, c.touchingCount, c.newContactCount);
+		fprintf(file, "{\"name\":\"Broad-phase pairs\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"pairs\":%d}},\n",
+			step.start, c.pairCount);
+		fprintf(file, "{\"name\":\"TOI\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"computations\":%d,\"impacts\":%d}},\n",
+			step.start, c.toiCount, c.toiEventCount);
+		fprintf(file, "{\"name\":\"Allocator\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"allocations\":%d,\"frees\":%d}},\n",
+			step.start, c.allocationCount, c.freeCount);
+
+		fprintf(file, "{\"name\":\"Contacts by shape\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{", step.start);
+		const char* separator = "";
+		for (int32 a = 0; a < b2Shape::e_typeCount; ++a)
+		{
+			for (int32 b = a; b < b2Shape::e_typeCount; ++b)
+			{
+				int32 count = c.shapeContactCounts[a][b];
+				if (b != a)
+				{
+					count += c.shapeContactCounts[b][a];
+				}
+
+				fprintf(file, "%s\"%s-%s\":%d", separator, b2GetShapeName(a), b2GetShapeName(b), count);
+				separator = ",";
+			}
+		}
+		fprintf(file, "}},\n");
+	}
+
+	// A final metadata event keeps the array free of a trailing comma.
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Box2D\"}}\n]}\n");
+
+	bool ok = ferror(file) == 0;
+	if (fclose(file) != 0)
+	{
+		ok = false;
+	}
+
+	return ok;
+}
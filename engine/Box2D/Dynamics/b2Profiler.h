@@ -0,0 +1,179 @@
+#ifndef B2_PROFILER_H
+#define B2_PROFILER_H
+
+#include "../Common/b2Settings.h"
+#include "../Common/b2Timer.h"
+#include "../Collision/Shapes/b2Shape.h"
+#include "../Dynamics/b2TimeStep.h"
+
+/// Counts gathered by b2Profiler for one time step.
+struct b2ProfileCounters
+{
+	int32 bodyCount;
+	int32 awakeBodyCount;
+	int32 frozenBodyCount;	// left in place by the simulation level of detail
+	int32 islandCount;
+
+	/// Contacts at the end of the step and those with touching manifolds.
+	int32 contactCount;
+	int32 touchingCount;
+
+	/// Contacts by the shape types of fixture A and fixture B.
+	int32 shapeContactCounts[b2Shape::e_typeCount][b2Shape::e_typeCount];
+
+	/// Pairs found by the broad-phase, counting duplicates, and the contacts
+	/// created from them.
+	int32 pairCount;
+	int32 newContactCount;
+
+	/// Time of impact computations and the impacts that were solved.
+	int32 toiCount;
+	int32 toiEventCount;
+
+	/// Block allocator calls made during the step.
+	int32 allocationCount;
+	int32 freeCount;
+};
+
+/// One recorded time step.
+struct b2ProfileStep
+{
+	/// When the step started, in microseconds since profiling was enabled.
+	float64 start;
+
+	b2Profile profile;
+	b2ProfileCounters counters;
+};
+
+/// A timed scope. Events on the same thread nest by time, e.g. the islands
+/// within the solve within the step.
+struct b2ProfileEvent
+{
+	/// A string literal naming the scope.
+	const char* name;
+
+	/// Start and duration in microseconds.
+	float64 start;
+	float32 duration;
+
+	/// The worker that ran the scope. The thread calling b2World::Step is worker 0.
+	int32 worker;
+
+	/// Island events carry the island size. Other events leave these zero.
+	int32 bodyCount;
+	int32 contactCount;
+	int32 jointCount;
+};
+
+/// The distribution of one b2Profile timing over the recorded steps.
+struct b2ProfileHistogram
+{
+	float32 minimum;
+	float32 maximum;
+	float32 mean;
+
+	/// Bin i counts the steps in [minimum + i * binWidth, minimum + (i + 1) * binWidth).
+	/// The maximum is counted in the last bin.
+	float32 binWidth;
+	int32 counts[b2_profileHistogramBins];
+
+	int32 stepCount;
+};
+
+/// Records timed scopes and counters for recent time steps. b2World owns one,
+/// see b2World::SetProfiling. Nothing is recorded and no memory is held while
+/// profiling is disabled.
+class b2Profiler
+{
+public:
+	b2Profiler();
+	~b2Profiler();
+
+	/// Enable/disable recording. Enabling allocates the step history and the
+	/// event buffer and restarts the clock. Disabling frees them.
+	void SetEnabled(bool flag);
+	bool IsEnabled() const { return m_steps != NULL; }
+
+	/// Forget the recorded steps and events.
+	void Clear();
+
+	/// Get the number of recorded steps, at most b2_profileStepCount.
+	int32 GetStepCount() const;
+
+	/// Get a recorded step. Age zero is the latest step.
+	const b2ProfileStep& GetStep(int32 age) const;
+
+	/// Build a histogram of one timing over the recorded steps, for example
+	/// GetHistogram(&b2Profile::solve, &histogram).
+	void GetHistogram(float32 b2Profile::* timing, b2ProfileHistogram* histogram) const;
+
+	/// Get the number of recorded events, at most b2_profileEventCount.
+	int32 GetEventCount() const;
+
+	/// Get a recorded event. Index zero is the oldest event.
+	const b2ProfileEvent& GetEvent(int32 index) const;
+
+	/// Write the recorded events and step counters to a Chrome trace JSON file.
+	/// Open it with chrome://tracing or Perfetto.
+	/// @return false if the file could not be written.
+	bool WriteChromeTrace(const char* path) const;
+
+	/// Get the time in microseconds since profiling was enabled.
+	float64 GetTime() const { return m_clock.GetMicroseconds(); }
+
+	/// Record an event. This does nothing while disabled and is not thread safe.
+	void AddEvent(const char* name, float64 start, int32 worker = 0);
+	void AddEvent(const b2ProfileEvent& event);
+
+	/// Record a finished step. This does nothing while disabled.
+	void AddStep(const b2ProfileStep& step);
+
+private:
+
+	b2Profiler(const b2Profiler&);
+	b2Profiler& operator=(const b2Profiler&);
+
+	b2Timer m_clock;
+
+	b2ProfileStep* m_steps;
+	int32 m_stepIndex;
+	int32 m_stepCount;
+
+	b2ProfileEvent* m_events;
+	int32 m_eventIndex;
+	int32 m_eventCount;
+};
+
+inline int32 b2Profiler::GetStepCount() const
+{
+	return m_stepCount;
+}
+
+inline const b2ProfileStep& b2Profiler::GetStep(int32 age) const
+{
+	b2Assert(0 <= age && age < m_stepCount);
+	int32 index = m_stepIndex - 1 - age;
+	if (index < 0)
+	{
+		index += b2_profileStepCount;
+	}
+	return m_steps[index];
+}
+
+inline int32 b2Profiler::GetEventCount() const
+{
+	return m_eventCount;
+}
+
+inline const b2ProfileEvent& b2Profiler::GetEvent(int32 index) const
+{
+	b2Assert(0 <= index && index < m_eventCount);
+	index += m_eventIndex - m_eventCount;
+	if (index < 0)
+	{
+		index += b2_profileEventCount;
+	}
+	return m_events[index];
+}
+
+#endif
@@ -0,0 +1,403 @@
+#include "b2SensorManager.h"
+#include "b2Body.h"
+#include "b2ContactManager.h"
+#include "b2Fixture.h"
+#include "b2WorldCallbacks.h"
+#include "../Collision/b2Collision.h"
+#include "../Common/b2Parallel.h"
+#include <algorithm>
+#include <cstring>
+
+// Grow an array to hold at least count elements, keeping the contents.
+template <typename T>
+static void b2Reserve(T** array, int32* capacity, int32 used, int32 count)
+{
+	if (*capacity >= count)
+	{
+		return;
+	}
+
+	T* old = *array;
+	*capacity = b2Max(b2Max(2 * *capacity, count), 16);
+	*array = (T*)b2Alloc(*capacity * sizeof(T));
+	if (old)
+	{
+		memcpy(*array, old, used * sizeof(T));
+		b2Free(old);
+	}
+}
+
+static bool b2SensorKeyLessThan(const b2SensorKey& key1, const b2SensorKey& key2)
+{
+	if (key1.fixture != key2.fixture)
+	{
+		return key1.fixture < key2.fixture;
+	}
+
+	return key1.index < key2.index;
+}
+
+static bool b2SensorOverlapLessThan(const b2SensorOverlap& overlap1, const b2SensorOverlap& overlap2)
+{
+	return overlap1.proxyId < overlap2.proxyId;
+}
+
+// Collects the fixtures overlapping one child of a sensor.
+class b2SensorQueryCallback
+{
+public:
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Fixture* visitor = proxy->fixture;
+		b2Body* visitorBody = visitor->GetBody();
+
+		// Sensors don't detect each other.
+		if (visitor->IsSensor() || visitorBody == body)
+		{
+			return true;
+		}
+
+		if (visitorBody->ShouldCollide(body) == false)
+		{
+			return true;
+		}
+
+		if (filter && filter->ShouldCollide(fixture, visitor) == false)
+		{
+			return true;
+		}
+
+		bool overlap = b2TestOverlap(fixture->GetShape(), childIndex, visitor->GetShape(), proxy->childIndex,
+									 body->GetTransform(), visitorBody->GetTransform());
+		if (overlap)
+		{
+			manager->AddOverlap(sensor, visitor);
+		}
+
+		return true;
+	}
+
+	b2SensorManager* manager;
+	const b2BroadPhase* broadPhase;
+	b2ContactFilter* filter;
+	b2Sensor* sensor;
+	b2Fixture* fixture;
+	b2Body* body;
+	int32 childIndex;
+};
+
+// Updates one sensor.
+class b2SensorTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 index, int32 worker)
+	{
+		manager->UpdateSensor(manager->m_sensors + index, worker);
+	}
+
+	b2SensorManager* manager;
+};
+
+b2SensorManager::b2SensorManager()
+{
+	m_contactManager = NULL;
+
+	m_sensors = NULL;
+	m_sensorCount = 0;
+	m_sensorCapacity = 0;
+
+	m_destroyed = NULL;
+	m_destroyedCount = 0;
+	m_destroyedCapacity = 0;
+
+	m_beginEvents = NULL;
+	m_beginEventCount = 0;
+	m_beginEventCapacity = 0;
+
+	m_endEvents = NULL;
+	m_endEventCount = 0;
+	m_endEventCapacity = 0;
+
+	for (int32 i = 0; i < b2_maxWorkers; ++i)
+	{
+		m_keys[i] = NULL;
+		m_keyCapacity[i] = 0;
+	}
+}
+
+b2SensorManager::~b2SensorManager()
+{
+	// The fixtures may be gone already.
+	for (int32 i = 0; i < m_sensorCount; ++i)
+	{
+		b2Free(m_sensors[i].overlaps);
+		b2Free(m_sensors[i].previous);
+	}
+
+	b2Free(m_sensors);
+	b2Free(m_destroyed);
+	b2Free(m_beginEvents);
+	b2Free(m_endEvents);
+
+	for (int32 i = 0; i < b2_maxWorkers; ++i)
+	{
+		b2Free(m_keys[i]);
+	}
+}
+
+void b2SensorManager::AddSensor(b2Fixture* fixture)
+{
+	b2Assert(fixture->m_sensorIndex == b2_nullSensor);
+
+	b2Reserve(&m_sensors, &m_sensorCapacity, m_sensorCount, m_sensorCount + 1);
+
+	b2Sensor* sensor = m_sensors + m_sensorCount;
+	memset(sensor, 0, sizeof(b2Sensor));
+	sensor->fixture = fixture;
+	fixture->m_sensorIndex = m_sensorCount;
+	++m_sensorCount;
+}
+
+void b2SensorManager::RemoveFixture(b2Fixture* fixture)
+{
+	// Sensors may still hold the fixture as a visitor, even a sensor fixture
+	// that was a visitor before it was made a sensor, and its memory may be
+	// reused before the next update.
+	if (m_sensorCount > 0)
+	{
+		b2Reserve(&m_destroyed, &m_destroyedCapacity, m_destroyedCount, m_destroyedCount + 1);
+		m_destroyed[m_destroyedCount++] = fixture;
+	}
+
+	if (fixture->m_sensorIndex != b2_nullSensor)
+	{
+		RemoveSensor(fixture);
+	}
+}
+
+void b2SensorManager::RemoveSensor(b2Fixture* fixture)
+{
+	int32 index = fixture->m_sensorIndex;
+	b2Assert(0 <= index && index < m_sensorCount && m_sensors[index].fixture == fixture);
+	b2Sensor* sensor = m_sensors + index;
+	b2Free(sensor->overlaps);
+	b2Free(sensor->previous);
+	fixture->m_sensorIndex = b2_nullSensor;
+
+	--m_sensorCount;
+	if (index < m_sensorCount)
+	{
+		*sensor = m_sensors[m_sensorCount];
+		sensor->fixture->m_sensorIndex = index;
+	}
+}
+
+void b2SensorManager::AddOverlap(b2Sensor* sensor, b2Fixture* fixture)
+{
+	b2Reserve(&sensor->overlaps, &sensor->overlapCapacity, sensor->overlapCount, sensor->overlapCount + 1);
+	b2SensorOverlap* overlap = sensor->overlaps + sensor->overlapCount;
+	overlap->fixture = fixture;
+	overlap->proxyId = fixture->m_proxies[0].proxyId;
+	overlap->flags = 0;
+	++sensor->overlapCount;
+}
+
+void b2SensorManager::Clear()
+{
+	for (int32 i = 0; i < m_sensorCount; ++i)
+	{
+		b2Sensor* sensor = m_sensors + i;
+		b2Free(sensor->overlaps);
+		b2Free(sensor->previous);
+		sensor->fixture->m_sensorIndex = b2_nullSensor;
+	}
+
+	m_sensorCount = 0;
+	m_destroyedCount = 0;
+	m_beginEventCount = 0;
+	m_endEventCount = 0;
+}
+
+void b2SensorManager::Update()
+{
+	m_beginEventCount = 0;
+	m_endEventCount = 0;
+
+	if (m_sensorCount == 0)
+	{
+		m_destroyedCount = 0;
+		return;
+	}
+
+	std::sort(m_destroyed, m_destroyed + m_destroyedCount);
+
+	b2SensorTask task;
+	task.manager = this;
+	b2ParallelFor(&task, m_sensorCount);
+
+	m_destroyedCount = 0;
+
+	// Gather the events in sensor order.
+	int32 beginCount = 0;
+	int32 endCount = 0;
+	for (int32 i = 0; i < m_sensorCount; ++i)
+	{
+		beginCount += m_sensors[i].beginCount;
+		endCount += m_sensors[i].endCount;
+	}
+
+	b2Reserve(&m_beginEvents, &m_beginEventCapacity, 0, beginCount);
+	b2Reserve(&m_endEvents, &m_endEventCapacity, 0, endCount);
+
+	for (int32 i = 0; i < m_sensorCount; ++i)
+	{
+		b2Sensor* sensor = m_sensors + i;
+
+		for (int32 j = 0; j < sensor->overlapCount && sensor->beginCount > 0; ++j)
+		{
+			if (sensor->overlaps[j].flags & b2SensorOverlap::e_beginFlag)
+			{
+				b2SensorEvent* event = m_beginEvents + m_beginEventCount++;
+				event->sensorFixture = sensor->fixture;
+				event->visitorFixture = sensor->overlaps[j].fixture;
+			}
+		}
+
+		for (int32 j = 0; j < sensor->previousCount && sensor->endCount > 0; ++j)
+		{
+			if (sensor->previous[j].flags & b2SensorOverlap::e_endFlag)
+			{
+				b2SensorEvent* event = m_endEvents + m_endEventCount++;
+				event->sensorFixture = sensor->fixture;
+				event->visitorFixture = sensor->previous[j].fixture;
+			}
+		}
+	}
+
+	b2Assert(m_beginEventCount == beginCount && m_endEventCount == endCount);
+}
+
+void b2SensorManager::UpdateSensor(b2Sensor* sensor, int32 worker)
+{
+	// Gather into the array of the update before last.
+	b2Swap(sensor->overlaps, sensor->previous);
+	b2Swap(sensor->overlapCapacity, sensor->previousCapacity);
+	sensor->previousCount = sensor->overlapCount;
+	sensor->overlapCount = 0;
+	sensor->beginCount = 0;
+	sensor->endCount = 0;
+
+	// Forget the visitors that were destroyed.
+	b2SensorOverlap* previous = sensor->previous;
+	int32 previousCount = 0;
+	for (int32 i = 0; i < sensor->previousCount; ++i)
+	{
+		b2Fixture* visitor = previous[i].fixture;
+		if (m_destroyedCount > 0 && std::binary_search(m_destroyed, m_destroyed + m_destroyedCount, visitor))
+		{
+			continue;
+		}
+
+		previous[previousCount] = previous[i];
+		previous[previousCount].flags = 0;
+		++previousCount;
+	}
+	sensor->previousCount = previousCount;
+
+	// An inactive sensor has no proxies and overlaps nothing.
+	b2Fixture* fixture = sensor->fixture;
+	const b2BroadPhase* broadPhase = &m_contactManager->m_broadPhase;
+
+	b2SensorQueryCallback callback;
+	callback.manager = this;
+	callback.broadPhase = broadPhase;
+	callback.filter = m_contactManager->m_contactFilter;
+	callback.sensor = sensor;
+	callback.fixture = fixture;
+	callback.body = fixture->GetBody();
+	for (int32 i = 0; i < fixture->m_proxyCount; ++i)
+	{
+		callback.childIndex = i;
+		broadPhase->Query(&callback, broadPhase->GetFatAABB(fixture->m_proxies[i].proxyId));
+	}
+
+	b2SensorOverlap* overlaps = sensor->overlaps;
+	int32 count = sensor->overlapCount;
+	if (count == 0 && previousCount == 0)
+	{
+		return;
+	}
+
+	// Match the overlaps with the previous ones by sorting both on the fixture.
+	int32 keyCount = count + previousCount;
+	b2Reserve(&m_keys[worker], &m_keyCapacity[worker], 0, keyCount);
+	b2SensorKey* keys = m_keys[worker];
+	for (int32 i = 0; i < count; ++i)
+	{
+		keys[i].fixture = overlaps[i].fixture;
+		keys[i].index = i;
+	}
+
+	for (int32 i = 0; i < previousCount; ++i)
+	{
+		keys[count + i].fixture = previous[i].fixture;
+		keys[count + i].index = count + i;
+	}
+
+	std::sort(keys, keys + keyCount, b2SensorKeyLessThan);
+
+	// A run of equal fixtures starts with its new overlaps and ends with the
+	// previous overlap, if any. Each child pair of a fixture pair reports the
+	// overlap, so only the first is kept.
+	int32 duplicateCount = 0;
+	int32 i = 0;
+	while (i < keyCount)
+	{
+		int32 j = i + 1;
+		while (j < keyCount && keys[j].fixture == keys[i].fixture)
+		{
+			++j;
+		}
+
+		if (keys[i].index < count)
+		{
+			for (int32 k = i + 1; k < j && keys[k].index < count; ++k)
+			{
+				overlaps[keys[k].index].flags = b2SensorOverlap::e_duplicateFlag;
+				++duplicateCount;
+			}
+
+			if (keys[j - 1].index < count)
+			{
+				overlaps[keys[i].index].flags = b2SensorOverlap::e_beginFlag;
+				++sensor->beginCount;
+			}
+		}
+		else
+		{
+			previous[keys[i].index - count].flags = b2SensorOverlap::e_endFlag;
+			++sensor->endCount;
+		}
+
+		i = j;
+	}
+
+	if (duplicateCount > 0)
+	{
+		int32 overlapCount = 0;
+		for (int32 k = 0; k < count; ++k)
+		{
+			if ((overlaps[k].flags & b2SensorOverlap::e_duplicateFlag) == 0)
+			{
+				overlaps[overlapCount++] = overlaps[k];
+			}
+		}
+		sensor->overlapCount = overlapCount;
+	}
+
+	// Order the overlaps by proxy id, so the events depend neither on fixture
+	// addresses nor on the broad-phase traversal. The previous overlaps were
+	// ordered the same way.
+	std::sort(overlaps, overlaps + sensor->overlapCount, b2SensorOverlapLessThan);
+}
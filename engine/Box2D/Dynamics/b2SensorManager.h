@@ -0,0 +1,115 @@
+#ifndef B2_SENSOR_MANAGER_H
+#define B2_SENSOR_MANAGER_H
+
+#include "../Common/b2Settings.h"
+
+class b2ContactManager;
+class b2Fixture;
+
+#define b2_nullSensor (-1)
+
+/// A sensor overlap that began or ended during the last time step.
+/// See b2World::SetSensorEvents.
+struct b2SensorEvent
+{
+	b2Fixture* sensorFixture;
+	b2Fixture* visitorFixture;
+};
+
+// A fixture overlapping a sensor. The proxy id is the one of its first child
+// when the overlap was found.
+struct b2SensorOverlap
+{
+	enum
+	{
+		e_beginFlag		= 0x0001,
+		e_endFlag		= 0x0002,
+		e_duplicateFlag	= 0x0004
+	};
+
+	b2Fixture* fixture;
+	int32 proxyId;
+	int32 flags;
+};
+
+// Sorts overlaps by fixture to match them between updates.
+struct b2SensorKey
+{
+	b2Fixture* fixture;
+	int32 index;
+};
+
+// The overlaps of one sensor fixture, ordered by proxy id.
+struct b2Sensor
+{
+	b2Fixture* fixture;
+
+	b2SensorOverlap* overlaps;
+	int32 overlapCount;
+	int32 overlapCapacity;
+
+	// The overlaps of the update before, flagged where they ended. The next
+	// update gathers into this array.
+	b2SensorOverlap* previous;
+	int32 previousCount;
+	int32 previousCapacity;
+
+	int32 beginCount;
+	int32 endCount;
+};
+
+// Delegate of b2World. Tracks the fixtures overlapping each sensor without
+// creating contacts.
+class b2SensorManager
+{
+public:
+	b2SensorManager();
+	~b2SensorManager();
+
+	// Start tracking a sensor fixture.
+	void AddSensor(b2Fixture* fixture);
+
+	// Stop tracking a sensor fixture. No end events are reported.
+	void RemoveSensor(b2Fixture* fixture);
+
+	// Forget a fixture that is being destroyed, both as a sensor and as a
+	// visitor held by other sensors. No end events are reported.
+	void RemoveFixture(b2Fixture* fixture);
+
+	// Record a fixture overlapping a sensor.
+	void AddOverlap(b2Sensor* sensor, b2Fixture* fixture);
+
+	// Remove every sensor and event.
+	void Clear();
+
+	// Find the overlaps of every sensor on the workers and gather the events.
+	void Update();
+
+	// Called on a worker.
+	void UpdateSensor(b2Sensor* sensor, int32 worker);
+
+	b2ContactManager* m_contactManager;
+
+	b2Sensor* m_sensors;
+	int32 m_sensorCount;
+	int32 m_sensorCapacity;
+
+	// Fixtures destroyed since the last update, sorted before the update.
+	b2Fixture** m_destroyed;
+	int32 m_destroyedCount;
+	int32 m_destroyedCapacity;
+
+	b2SensorEvent* m_beginEvents;
+	int32 m_beginEventCount;
+	int32 m_beginEventCapacity;
+
+	b2SensorEvent* m_endEvents;
+	int32 m_endEventCount;
+	int32 m_endEventCapacity;
+
+	// Sort keys for matching overlaps, one buffer per worker.
+	b2SensorKey* m_keys[b2_maxWorkers];
+	int32 m_keyCapacity[b2_maxWorkers];
+};
+
+#endif
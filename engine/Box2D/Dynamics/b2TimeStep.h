@@ -26,6 +26,7 @@ struct b2Profile
 {
 	float32 step;
 	float32 collide;
+	float32 sensors;
 	float32 solve;
 	float32 solveInit;
 	float32 solveVelocity;
@@ -43,6 +44,8 @@ struct b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool wideSolver;	// solve contacts in SIMD batches
+	bool parallelSolver;	// solve the colors of large islands on worker threads
 };
 
 /// This is an internal structure.
@@ -20,7 +20,16 @@
 #include "../Dynamics/b2Body.h"
 #include "../Dynamics/b2Fixture.h"
 #include "../Dynamics/b2Island.h"
+#include "../Dynamics/Joints/b2DistanceJoint.h"
+#include "../Dynamics/Joints/b2FrictionJoint.h"
+#include "../Dynamics/Joints/b2GearJoint.h"
+#include "../Dynamics/Joints/b2MouseJoint.h"
+#include "../Dynamics/Joints/b2PrismaticJoint.h"
 #include "../Dynamics/Joints/b2PulleyJoint.h"
+#include "../Dynamics/Joints/b2RevoluteJoint.h"
+#include "../Dynamics/Joints/b2RopeJoint.h"
+#include "../Dynamics/Joints/b2WeldJoint.h"
+#include "../Dynamics/Joints/b2WheelJoint.h"
 #include "../Dynamics/Contacts/b2Contact.h"
 #include "../Dynamics/Contacts/b2ContactSolver.h"
 #include "../Collision/b2Collision.h"
@@ -31,36 +40,66 @@
 #include "../Collision/Shapes/b2PolygonShape.h"
 #include "../Collision/b2TimeOfImpact.h"
 #include "../Common/b2Draw.h"
+#include "../Common/b2Parallel.h"
 #include "../Common/b2Timer.h"
+#include <algorithm>
 #include <new>
 
-b2World::b2World(const b2Vec2& gravity)
+b2World::b2World(const b2Vec2& gravity, b2BroadPhaseType broadPhaseType)
+: m_contactManager(broadPhaseType)
 {
+	// Register the contact types up front, so worlds stepped on different
+	// threads never race to do it in b2Contact::Create.
+	if (b2Contact::s_initialized == false)
+	{
+		b2Contact::InitializeRegisters();
+		b2Contact::s_initialized = true;
+	}
+
 	m_destructionListener = NULL;
+	m_snapshotListener = NULL;
 	m_debugDraw = NULL;
 
 	m_bodyList = NULL;
 	m_jointList = NULL;
+	m_gravitySourceList = NULL;
 
 	m_bodyCount = 0;
 	m_jointCount = 0;
+	m_gravitySourceCount = 0;
 
 	m_warmStarting = true;
 	m_continuousPhysics = true;
 	m_subStepping = false;
 
+	m_parallelIslands = false;
+	m_workerAllocators = NULL;
+	m_restoreWorld = NULL;
+	m_wideSolver = false;
+	m_parallelSolver = false;
+	m_parallelTOI = false;
+
 	m_stepComplete = true;
 
 	m_allowSleep = true;
 	m_gravity = gravity;
 
+	m_nbodyGravity = false;
+	m_nbodyTheta = 0.5f;
+
+	m_lodEnabled = false;
+	m_focusPointCount = 0;
+	m_lodStepCount = 0;
+
 	m_flags = e_clearForces;
 
 	m_inv_dt0 = 0.0f;
 
 	m_contactManager.m_allocator = &m_blockAllocator;
+	m_sensorManager.m_contactManager = &m_contactManager;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
+	memset(&m_counters, 0, sizeof(b2ProfileCounters));
 }
 
 b2World::~b2World()
@@ -82,6 +121,21 @@ b2World::~b2World()
 
 		b = bNext;
 	}
+
+	if (m_workerAllocators)
+	{
+		for (int32 i = 0; i < b2_maxWorkers; ++i)
+		{
+			m_workerAllocators[i].~b2StackAllocator();
+		}
+		b2Free(m_workerAllocators);
+	}
+
+	if (m_restoreWorld)
+	{
+		m_restoreWorld->~b2World();
+		b2Free(m_restoreWorld);
+	}
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -89,6 +143,11 @@ void b2World::SetDestructionListener(b2DestructionListener* listener)
 	m_destructionListener = listener;
 }
 
+void b2World::SetSnapshotListener(b2SnapshotListener* listener)
+{
+	m_snapshotListener = listener;
+}
+
 void b2World::SetContactFilter(b2ContactFilter* filter)
 {
 	m_contactManager.m_contactFilter = filter;
@@ -128,6 +187,158 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	return b;
 }
 
+void b2World::CreateBodies(const b2BodyDef* bodyDefs, int32 bodyCount,
+						   const b2FixtureDef* fixtureDefs, const int32* fixtureCounts, b2Body** bodies)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	// Count the fixtures and proxies. Only the trees gain from a bulk insert, the
+	// other broad-phases take the proxies one at a time as the fixtures are made.
+	// A split-tree broad-phase keeps the static proxies apart, so they are
+	// gathered ahead of the others. Otherwise the proxies stay in creation order.
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	bool split = broadPhase->GetType() == b2_splitTreeBroadPhase;
+	bool gather = split || broadPhase->GetType() == b2_dynamicTreeBroadPhase;
+
+	int32 fixtureCount = 0;
+	int32 proxyCount = 0;
+	int32 staticProxyCount = 0;
+	const b2FixtureDef* fixtureDef = fixtureDefs;
+	for (int32 i = 0; fixtureDefs && i < bodyCount; ++i)
+	{
+		int32 count = fixtureCounts ? fixtureCounts[i] : 1;
+		for (int32 j = 0; j < count; ++j, ++fixtureDef)
+		{
+			if (gather && bodyDefs[i].active)
+			{
+				int32 childCount = fixtureDef->shape->GetChildCount();
+				proxyCount += childCount;
+				staticProxyCount += split && bodyDefs[i].type == b2_staticBody ? childCount : 0;
+			}
+		}
+		fixtureCount += count;
+	}
+
+	// Take the bodies and fixtures from the allocator in one go.
+	void** bodyMemory = (void**)m_stackAllocator.Allocate(bodyCount * sizeof(void*));
+	void** fixtureMemory = (void**)m_stackAllocator.Allocate(fixtureCount * sizeof(void*));
+	m_blockAllocator.Allocate(sizeof(b2Body), bodyMemory, bodyCount);
+	m_blockAllocator.Allocate(sizeof(b2Fixture), fixtureMemory, fixtureCount);
+
+	b2AABB* aabbs = (b2AABB*)m_stackAllocator.Allocate(proxyCount * sizeof(b2AABB));
+	void** userData = (void**)m_stackAllocator.Allocate(proxyCount * sizeof(void*));
+	int32* proxyIds = (int32*)m_stackAllocator.Allocate(proxyCount * sizeof(int32));
+	uint16* categoryBits = (uint16*)m_stackAllocator.Allocate(proxyCount * sizeof(uint16));
+	uint16* maskBits = (uint16*)m_stackAllocator.Allocate(proxyCount * sizeof(uint16));
+	int32 staticIndex = 0;
+	int32 otherIndex = staticProxyCount;
+
+	fixtureDef = fixtureDefs;
+	void** memory = fixtureMemory;
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* b = new (bodyMemory[i]) b2Body(bodyDefs + i, this);
+
+		// Add to world doubly linked list.
+		b->m_prev = NULL;
+		b->m_next = m_bodyList;
+		if (m_bodyList)
+		{
+			m_bodyList->m_prev = b;
+		}
+		m_bodyList = b;
+		++m_bodyCount;
+
+		bool isStatic = split && b->m_type == b2_staticBody;
+		bool hasMass = false;
+
+		int32 count = fixtureDefs ? (fixtureCounts ? fixtureCounts[i] : 1) : 0;
+		for (int32 j = 0; j < count; ++j, ++fixtureDef)
+		{
+			b2Fixture* fixture = new (*memory++) b2Fixture;
+			fixture->Create(&m_blockAllocator, b, fixtureDef);
+
+			if (m_contactManager.m_sensorEvents && fixture->m_isSensor)
+			{
+				m_sensorManager.AddSensor(fixture);
+			}
+
+			// Gather the proxies for the trees instead of inserting them.
+			if (gather && (b->m_flags & b2Body::e_activeFlag))
+			{
+				uint16 fixtureCategoryBits, fixtureMaskBits;
+				fixture->GetProxyFilter(&fixtureCategoryBits, &fixtureMaskBits);
+
+				fixture->m_proxyCount = fixture->m_shape->GetChildCount();
+				for (int32 k = 0; k < fixture->m_proxyCount; ++k)
+				{
+					b2FixtureProxy* proxy = fixture->m_proxies + k;
+					fixture->m_shape->ComputeAABB(&proxy->aabb, b->m_xf, k);
+					proxy->fixture = fixture;
+					proxy->childIndex = k;
+
+					int32 index = isStatic ? staticIndex++ : otherIndex++;
+					aabbs[index] = proxy->aabb;
+					userData[index] = proxy;
+					categoryBits[index] = fixtureCategoryBits;
+					maskBits[index] = fixtureMaskBits;
+				}
+			}
+			else if (b->m_flags & b2Body::e_activeFlag)
+			{
+				fixture->CreateProxies(broadPhase, b->m_xf);
+			}
+
+			fixture->m_next = b->m_fixtureList;
+			b->m_fixtureList = fixture;
+			++b->m_fixtureCount;
+
+			hasMass = hasMass || fixture->m_density > 0.0f;
+		}
+
+		// The mass only needs computing once all the fixtures are on.
+		if (hasMass)
+		{
+			b->ResetMassData();
+		}
+
+		if (bodies)
+		{
+			bodies[i] = b;
+		}
+	}
+
+	b2Assert(staticIndex == staticProxyCount && otherIndex == proxyCount);
+
+	int32 otherCount = proxyCount - staticProxyCount;
+	broadPhase->CreateProxies(aabbs, userData, staticProxyCount, proxyIds, true, categoryBits, maskBits);
+	broadPhase->CreateProxies(aabbs + staticProxyCount, userData + staticProxyCount, otherCount, proxyIds + staticProxyCount, false,
+							  categoryBits + staticProxyCount, maskBits + staticProxyCount);
+
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		((b2FixtureProxy*)userData[i])->proxyId = proxyIds[i];
+	}
+
+	m_stackAllocator.Free(maskBits);
+	m_stackAllocator.Free(categoryBits);
+	m_stackAllocator.Free(proxyIds);
+	m_stackAllocator.Free(userData);
+	m_stackAllocator.Free(aabbs);
+	m_stackAllocator.Free(fixtureMemory);
+	m_stackAllocator.Free(bodyMemory);
+
+	// New contacts are created at the beginning of the next time step.
+	if (fixtureCount > 0)
+	{
+		m_flags |= e_newFixture;
+	}
+}
+
 void b2World::DestroyBody(b2Body* b)
 {
 	b2Assert(m_bodyCount > 0);
@@ -155,6 +366,26 @@ void b2World::DestroyBody(b2Body* b)
 	}
 	b->m_jointList = NULL;
 
+	// Delete the attached gravity sources.
+	b2GravitySource* gs = m_gravitySourceList;
+	while (gs)
+	{
+		b2GravitySource* gs0 = gs;
+		gs = gs->m_next;
+
+		if (gs0->m_body != b)
+		{
+			continue;
+		}
+
+		if (m_destructionListener)
+		{
+			m_destructionListener->SayGoodbye(gs0);
+		}
+
+		DestroyGravitySource(gs0);
+	}
+
 	// Delete the attached contacts.
 	b2ContactEdge* ce = b->m_contactList;
 	while (ce)
@@ -177,6 +408,7 @@ void b2World::DestroyBody(b2Body* b)
 			m_destructionListener->SayGoodbye(f0);
 		}
 
+		m_sensorManager.RemoveFixture(f0);
 		f0->DestroyProxies(&m_contactManager.m_broadPhase);
 		f0->Destroy(&m_blockAllocator);
 		f0->~b2Fixture();
@@ -205,6 +437,7 @@ void b2World::DestroyBody(b2Body* b)
 	}
 
 	--m_bodyCount;
+	m_bodyStore.Destroy(b->m_storeIndex);
 	b->~b2Body();
 	m_blockAllocator.Free(b, sizeof(b2Body));
 }
@@ -364,191 +597,356 @@ void b2World::DestroyJoint(b2Joint* j)
 	}
 }
 
-//
-void b2World::SetAllowSleeping(bool flag)
+b2GravitySource* b2World::CreateGravitySource(const b2GravitySourceDef* def)
 {
-	if (flag == m_allowSleep)
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
 	{
-		return;
+		return NULL;
 	}
 
-	m_allowSleep = flag;
-	if (m_allowSleep == false)
+	void* mem = m_blockAllocator.Allocate(sizeof(b2GravitySource));
+	b2GravitySource* source = new (mem) b2GravitySource(def);
+
+	// Add to world doubly linked list.
+	source->m_prev = NULL;
+	source->m_next = m_gravitySourceList;
+	if (m_gravitySourceList)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->m_next)
-		{
-			b->SetAwake(true);
-		}
+		m_gravitySourceList->m_prev = source;
 	}
+	m_gravitySourceList = source;
+	++m_gravitySourceCount;
+
+	return source;
 }
 
-// Find islands, integrate and solve constraints, solve position constraints
-void b2World::Solve(const b2TimeStep& step)
+void b2World::DestroyGravitySource(b2GravitySource* source)
 {
-	m_profile.solveInit = 0.0f;
-	m_profile.solveVelocity = 0.0f;
-	m_profile.solvePosition = 0.0f;
-
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount,
-					m_contactManager.m_contactCount,
-					m_jointCount,
-					&m_stackAllocator,
-					m_contactManager.m_contactListener);
+	b2Assert(m_gravitySourceCount > 0);
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
 
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	if (source->m_prev)
 	{
-		b->m_flags &= ~b2Body::e_islandFlag;
+		source->m_prev->m_next = source->m_next;
 	}
-	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+
+	if (source->m_next)
 	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
+		source->m_next->m_prev = source->m_prev;
 	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+
+	if (source == m_gravitySourceList)
 	{
-		j->m_islandFlag = false;
+		m_gravitySourceList = source->m_next;
 	}
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	--m_gravitySourceCount;
+	source->~b2GravitySource();
+	m_blockAllocator.Free(source, sizeof(b2GravitySource));
+
+	if (m_gravitySourceCount == 0)
 	{
-		if (seed->m_flags & b2Body::e_islandFlag)
+		// Nothing refreshes the field gravities anymore.
+		for (int32 i = 0; i < m_bodyStore.m_count; ++i)
 		{
-			continue;
+			m_bodyStore.m_fieldGravities[i] = b2Vec2_zero;
 		}
+	}
+}
 
-		if (seed->IsAwake() == false || seed->IsActive() == false)
+// Finds the awake dynamic bodies near a gravity source. A body with several
+// fixtures is reported once per fixture, so bodies are stamped with the source.
+class b2GravityQuery
+{
+public:
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Body* body = proxy->fixture->GetBody();
+		if (body->GetType() != b2_dynamicBody || body->IsAwake() == false)
 		{
-			continue;
+			return true;
 		}
 
-		// The seed can be dynamic or kinematic.
-		if (seed->GetType() == b2_staticBody)
+		int32 index = body->m_storeIndex;
+		if (stamps[index] != stamp)
 		{
-			continue;
+			stamps[index] = stamp;
+			fieldGravities[index] += source->GetAcceleration(center, body->GetWorldCenter());
 		}
+		return true;
+	}
 
-		// Reset island and stack.
-		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
+	const b2BroadPhase* broadPhase;
+	const b2GravitySource* source;
+	b2Vec2 center;
+	b2Vec2* fieldGravities;
+	int32* stamps;
+	int32 stamp;
+};
 
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
+// Pulls blocks of bodies through the Barnes-Hut tree. Every body only writes
+// its own field gravity.
+class b2GravityTreeTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 index, int32 worker)
+	{
+		B2_NOT_USED(worker);
+
+		int32 begin = index * b2_gravityBlockSize;
+		int32 end = b2Min(begin + b2_gravityBlockSize, count);
+		for (int32 i = begin; i < end; ++i)
 		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
-			b2Assert(b->IsActive() == true);
-			island.Add(b);
+			b2Body* b = bodies[i];
+			b->FieldGravity() += tree->GetAcceleration(b->GetWorldCenter(), b, theta);
+		}
+	}
 
-			// Make sure the body is awake.
-			b->SetAwake(true);
+	const b2GravityTree* tree;
+	b2Body** bodies;
+	int32 count;
+	float32 theta;
+};
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->GetType() == b2_staticBody)
-			{
-				continue;
-			}
+// Sum the gravity source accelerations of every body for island integration.
+void b2World::ApplyGravitySources()
+{
+	if (m_gravitySourceCount == 0)
+	{
+		return;
+	}
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
-			{
-				b2Contact* contact = ce->contact;
+	float64 start = m_profiler.GetTime();
 
-				// Has this contact already been added to an island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
-				{
-					continue;
-				}
+	int32 count = m_bodyStore.m_count;
+	for (int32 i = 0; i < count; ++i)
+	{
+		m_bodyStore.m_fieldGravities[i] = b2Vec2_zero;
+	}
 
-				// Is this contact solid and touching?
-				if (contact->IsEnabled() == false ||
-					contact->IsTouching() == false)
-				{
-					continue;
-				}
+	if (m_nbodyGravity)
+	{
+		ApplyGravityTree();
+	}
 
-				// Skip sensors.
-				bool sensorA = contact->m_fixtureA->m_isSensor;
-				bool sensorB = contact->m_fixtureB->m_isSensor;
-				if (sensorA || sensorB)
-				{
-					continue;
-				}
+	int32* stamps = (int32*)m_stackAllocator.Allocate(count * sizeof(int32));
+	memset(stamps, 0xff, count * sizeof(int32));
 
-				island.Add(contact);
-				contact->m_flags |= b2Contact::e_islandFlag;
+	b2GravityQuery query;
+	query.broadPhase = &m_contactManager.m_broadPhase;
+	query.fieldGravities = m_bodyStore.m_fieldGravities;
+	query.stamps = stamps;
+	query.stamp = 0;
 
-				b2Body* other = ce->other;
+	for (b2GravitySource* gs = m_gravitySourceList; gs; gs = gs->m_next, ++query.stamp)
+	{
+		if (m_nbodyGravity && gs->m_falloff == e_inverseSquareFalloff)
+		{
+			continue;
+		}
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+		query.source = gs;
+		query.center = gs->GetCenter();
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
-			}
+		b2AABB aabb;
+		aabb.lowerBound = query.center - b2Vec2(gs->m_radius, gs->m_radius);
+		aabb.upperBound = query.center + b2Vec2(gs->m_radius, gs->m_radius);
+		m_contactManager.m_broadPhase.Query(&query, aabb);
+	}
 
-			// Search all joints connect to this body.
-			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
-			{
-				if (je->joint->m_islandFlag == true)
-				{
-					continue;
-				}
+	m_stackAllocator.Free(stamps);
 
-				b2Body* other = je->other;
+	m_profiler.AddEvent("Gravity", start);
+}
 
-				// Don't simulate joints connected to inactive bodies.
-				if (other->IsActive() == false)
-				{
-					continue;
-				}
+// Add the pull of the inverse square sources to every awake dynamic body using
+// a quadtree over the sources.
+void b2World::ApplyGravityTree()
+{
+	b2GravityMass* masses = (b2GravityMass*)m_stackAllocator.Allocate(m_gravitySourceCount * sizeof(b2GravityMass));
+	int32 massCount = 0;
+	for (b2GravitySource* gs = m_gravitySourceList; gs; gs = gs->m_next)
+	{
+		if (gs->m_falloff != e_inverseSquareFalloff)
+		{
+			continue;
+		}
 
-				island.Add(je->joint);
-				je->joint->m_islandFlag = true;
+		b2GravityMass* mass = masses + massCount;
+		mass->position = gs->GetCenter();
+		mass->strength = gs->m_strength;
+		mass->minRadius = gs->m_minRadius;
+		mass->body = gs->m_body;
+		++massCount;
+	}
 
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+	m_gravityTree.Build(masses, massCount);
+	m_stackAllocator.Free(masses);
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
-			}
+	if (massCount == 0)
+	{
+		return;
+	}
+
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2Body*));
+	int32 bodyCount = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (b->GetType() == b2_dynamicBody && b->IsAwake())
+		{
+			bodies[bodyCount++] = b;
 		}
+	}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
+	b2GravityTreeTask task;
+	task.tree = &m_gravityTree;
+	task.bodies = bodies;
+	task.count = bodyCount;
+	task.theta = m_nbodyTheta;
+	b2ParallelFor(&task, (bodyCount + b2_gravityBlockSize - 1) / b2_gravityBlockSize);
 
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
+	m_stackAllocator.Free(bodies);
+}
+
+//
+void b2World::SetAllowSleeping(bool flag)
+{
+	if (flag == m_allowSleep)
+	{
+		return;
+	}
+
+	m_allowSleep = flag;
+	if (m_allowSleep == false)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
 		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
-			if (b->GetType() == b2_staticBody)
-			{
-				b->m_flags &= ~b2Body::e_islandFlag;
-			}
+			b->SetAwake(true);
 		}
 	}
+}
 
-	m_stackAllocator.Free(stack);
+void b2World::SetSimulationLOD(const b2SimulationLODDef* def)
+{
+	if (def == NULL)
+	{
+		m_lodEnabled = false;
+		ClearSimulationLOD();
+		return;
+	}
+
+	b2Assert(0.0f <= def->activeRadius && def->activeRadius <= def->reducedRadius);
+	b2Assert(def->reducedInterval >= 1);
+	m_lodEnabled = true;
+	m_lodDef = *def;
+}
+
+void b2World::SetFocusPoints(const b2Vec2* points, int32 count)
+{
+	b2Assert(0 <= count && count <= b2_maxFocusPoints);
+	count = b2Min(count, b2_maxFocusPoints);
+	for (int32 i = 0; i < count; ++i)
+	{
+		m_focusPoints[i] = points[i];
+	}
+	m_focusPointCount = count;
+
+	if (count == 0)
+	{
+		ClearSimulationLOD();
+	}
+}
+
+// Step every body again.
+void b2World::ClearSimulationLOD()
+{
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_flags &= ~(b2Body::e_reducedFlag | b2Body::e_frozenFlag);
+	}
+}
+
+// Flag the bodies outside the active area by their distance to the nearest focus
+// point, and freeze the awake ones that are not stepped this time. This runs before
+// the narrow-phase so contacts between frozen bodies are not updated.
+void b2World::UpdateSimulationLOD()
+{
+	bool reducedStep = m_lodStepCount % m_lodDef.reducedInterval == 0;
+	++m_lodStepCount;
+
+	float32 activeRadiusSqr = m_lodDef.activeRadius * m_lodDef.activeRadius;
+	float32 reducedRadiusSqr = m_lodDef.reducedRadius * m_lodDef.reducedRadius;
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_flags &= ~(b2Body::e_reducedFlag | b2Body::e_frozenFlag);
+		if (b->m_type == b2_staticBody)
+		{
+			continue;
+		}
+
+		float32 distanceSqr = b2_maxFloat;
+		for (int32 i = 0; i < m_focusPointCount; ++i)
+		{
+			distanceSqr = b2Min(distanceSqr, b2DistanceSquared(m_focusPoints[i], b->m_sweep.c));
+		}
+
+		if (distanceSqr <= activeRadiusSqr)
+		{
+			continue;
+		}
+
+		b->m_flags |= b2Body::e_reducedFlag;
+
+		if (b->IsAwake() == false || (reducedStep && distanceSqr <= reducedRadiusSqr))
+		{
+			continue;
+		}
+
+		// A frozen body stays put, so continuous collision must not see the
+		// motion of the last step it took.
+		b->m_flags |= b2Body::e_frozenFlag;
+		b->m_sweep.c0 = b->m_sweep.c;
+		b->m_sweep.a0 = b->m_sweep.a;
+	}
+}
+
+// Find islands, integrate and solve constraints, solve position constraints
+void b2World::Solve(const b2TimeStep& step)
+{
+	m_profile.solveInit = 0.0f;
+	m_profile.solveVelocity = 0.0f;
+	m_profile.solvePosition = 0.0f;
+
+	ApplyGravitySources();
+
+	// Islands outside the active area of the level of detail cover several steps at once.
+	b2TimeStep reducedStep = step;
+	if (m_lodEnabled)
+	{
+		reducedStep.dt = step.dt * m_lodDef.reducedInterval;
+		reducedStep.inv_dt = step.inv_dt / m_lodDef.reducedInterval;
+	}
+
+	if (m_parallelIslands)
+	{
+		SolveParallelIslands(step, reducedStep);
+	}
+	else
+	{
+		SolveIslands(step, reducedStep);
+	}
 
 	{
 		b2Timer timer;
+		float64 start = m_profiler.GetTime();
+
 		// Synchronize fixtures, check for out of range bodies.
 		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
@@ -568,749 +966,3100 @@ void b2World::Solve(const b2TimeStep& step)
 		}
 
 		// Look for new contacts.
-		m_contactManager.FindNewContacts();
+		FindNewContacts();
 		m_profile.broadphase = timer.GetMilliseconds();
+		m_profiler.AddEvent("Broad-phase", start);
 	}
 }
 
-// Find TOI contacts and solve them.
-void b2World::SolveTOI(const b2TimeStep& step)
+// Look for new contacts and count them for the profiler.
+void b2World::FindNewContacts()
 {
-	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+	int32 contactCount = m_contactManager.m_contactCount;
+	m_contactManager.FindNewContacts();
+	m_counters.pairCount += m_contactManager.m_broadPhase.GetPairCount();
+	m_counters.newContactCount += m_contactManager.m_contactCount - contactCount;
+}
 
-	if (m_stepComplete)
+// Describe a solved island to the profiler.
+static void b2SetIslandEvent(b2ProfileEvent* event, float64 start, float64 end, int32 worker, const b2Island& island)
+{
+	event->name = "Island";
+	event->start = start;
+	event->duration = float32(end - start);
+	event->worker = worker;
+	event->bodyCount = island.m_bodyCount;
+	event->contactCount = island.m_contactCount;
+	event->jointCount = island.m_jointCount;
+}
+
+// Build and solve islands one at a time on the calling thread.
+void b2World::SolveIslands(const b2TimeStep& step, const b2TimeStep& reducedStep)
+{
+	// Size the island for the worst case.
+	b2Island island(m_bodyCount,
+					m_contactManager.m_contactCount,
+					m_jointCount,
+					&m_stackAllocator,
+					m_contactManager.m_contactListener);
+
+	// Clear all the island flags.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		b->m_flags &= ~b2Body::e_islandFlag;
+	}
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		c->m_flags &= ~b2Contact::e_islandFlag;
+	}
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->m_islandFlag = false;
+	}
+
+	// Build and simulate all awake islands. Each island takes the next store slots.
+	int32 storeCursor = 0;
+	int32 stackSize = m_bodyCount;
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	{
+		if (seed->m_flags & b2Body::e_islandFlag)
 		{
-			b->m_flags &= ~b2Body::e_islandFlag;
-			b->m_sweep.alpha0 = 0.0f;
+			continue;
 		}
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		if (seed->IsAwake() == false || seed->IsActive() == false)
 		{
-			// Invalidate TOI
-			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
-			c->m_toiCount = 0;
-			c->m_toi = 1.0f;
+			continue;
 		}
-	}
 
-	// Find TOI events and solve them.
-	for (;;)
-	{
-		// Find the first TOI.
-		b2Contact* minContact = NULL;
-		float32 minAlpha = 1.0f;
+		// Frozen bodies only move when a stepped island reaches them.
+		if (seed->m_flags & b2Body::e_frozenFlag)
+		{
+			continue;
+		}
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		// The seed can be dynamic or kinematic.
+		if (seed->GetType() == b2_staticBody)
 		{
-			// Is this contact disabled?
-			if (c->IsEnabled() == false)
-			{
-				continue;
-			}
+			continue;
+		}
 
-			// Prevent excessive sub-stepping.
-			if (c->m_toiCount > b2_maxSubSteps)
+		// Reset island and stack.
+		island.Clear();
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b2Body::e_islandFlag;
+
+		// The island takes reduced steps unless it reaches the active area.
+		bool reduced = true;
+
+		// Perform a depth first search (DFS) on the constraint graph.
+		while (stackCount > 0)
+		{
+			// Grab the next body off the stack and add it to the island.
+			b2Body* b = stack[--stackCount];
+			b2Assert(b->IsActive() == true);
+			island.Add(b);
+
+			// Make sure the body is awake. Frozen bodies are stepped with the island.
+			b->SetAwake(true);
+			b->m_flags &= ~b2Body::e_frozenFlag;
+
+			// To keep islands as small as possible, we don't
+			// propagate islands across static bodies.
+			if (b->GetType() == b2_staticBody)
 			{
 				continue;
 			}
 
-			float32 alpha = 1.0f;
-			if (c->m_flags & b2Contact::e_toiFlag)
+			if ((b->m_flags & b2Body::e_reducedFlag) == 0)
 			{
-				// This contact has a valid cached TOI.
-				alpha = c->m_toi;
+				reduced = false;
 			}
-			else
+
+			// Search all contacts connected to this body.
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
 			{
-				b2Fixture* fA = c->GetFixtureA();
-				b2Fixture* fB = c->GetFixtureB();
+				b2Contact* contact = ce->contact;
 
-				// Is there a sensor?
-				if (fA->IsSensor() || fB->IsSensor())
+				// Has this contact already been added to an island?
+				if (contact->m_flags & b2Contact::e_islandFlag)
 				{
 					continue;
 				}
 
-				b2Body* bA = fA->GetBody();
-				b2Body* bB = fB->GetBody();
-
-				b2BodyType typeA = bA->m_type;
-				b2BodyType typeB = bB->m_type;
-				b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
-
-				bool activeA = bA->IsAwake() && typeA != b2_staticBody;
-				bool activeB = bB->IsAwake() && typeB != b2_staticBody;
-
-				// Is at least one body active (awake and dynamic or kinematic)?
-				if (activeA == false && activeB == false)
+				// Is this contact solid and touching?
+				if (contact->IsEnabled() == false ||
+					contact->IsTouching() == false)
 				{
 					continue;
 				}
 
-				bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
-				bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
-
-				// Are these two non-bullet dynamic bodies?
-				if (collideA == false && collideB == false)
+				// Skip sensors.
+				bool sensorA = contact->m_fixtureA->m_isSensor;
+				bool sensorB = contact->m_fixtureB->m_isSensor;
+				if (sensorA || sensorB)
 				{
 					continue;
 				}
 
-				// Compute the TOI for this contact.
-				// Put the sweeps onto the same time interval.
-				float32 alpha0 = bA->m_sweep.alpha0;
+				island.Add(contact);
+				contact->m_flags |= b2Contact::e_islandFlag;
+
+				b2Body* other = ce->other;
 
-				if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
+				// Was the other body already added to this island?
+				if (other->m_flags & b2Body::e_islandFlag)
 				{
-					alpha0 = bB->m_sweep.alpha0;
-					bA->m_sweep.Advance(alpha0);
+					continue;
 				}
-				else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
+
+				b2Assert(stackCount < stackSize);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+
+			// Search all joints connect to this body.
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				if (je->joint->m_islandFlag == true)
 				{
-					alpha0 = bA->m_sweep.alpha0;
-					bB->m_sweep.Advance(alpha0);
+					continue;
 				}
 
-				b2Assert(alpha0 < 1.0f);
-
-				int32 indexA = c->GetChildIndexA();
-				int32 indexB = c->GetChildIndexB();
+				b2Body* other = je->other;
 
-				// Compute the time of impact in interval [0, minTOI]
-				b2TOIInput input;
-				input.proxyA.Set(fA->GetShape(), indexA);
-				input.proxyB.Set(fB->GetShape(), indexB);
-				input.sweepA = bA->m_sweep;
-				input.sweepB = bB->m_sweep;
-				input.tMax = 1.0f;
-
-				b2TOIOutput output;
-				b2TimeOfImpact(&output, &input);
-
-				// Beta is the fraction of the remaining portion of the .
-				float32 beta = output.t;
-				if (output.state == b2TOIOutput::e_touching)
+				// Don't simulate joints connected to inactive bodies.
+				if (other->IsActive() == false)
 				{
-					alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
+					continue;
 				}
-				else
+
+				island.Add(je->joint);
+				je->joint->m_islandFlag = true;
+
+				if (other->m_flags & b2Body::e_islandFlag)
 				{
-					alpha = 1.0f;
+					continue;
 				}
 
-				c->m_toi = alpha;
-				c->m_flags |= b2Contact::e_toiFlag;
-			}
-
-			if (alpha < minAlpha)
-			{
-				// This is the minimum TOI found so far.
-				minContact = c;
-				minAlpha = alpha;
+				b2Assert(stackCount < stackSize);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
 			}
 		}
 
-		if (minContact == NULL || 1.0f - 10.0f * b2_epsilon < minAlpha)
-		{
-			// No more TOI events. Done!
-			m_stepComplete = true;
-			break;
-		}
-
-		// Advance the bodies to the TOI.
-		b2Fixture* fA = minContact->GetFixtureA();
-		b2Fixture* fB = minContact->GetFixtureB();
-		b2Body* bA = fA->GetBody();
-		b2Body* bB = fB->GetBody();
-
-		b2Sweep backup1 = bA->m_sweep;
-		b2Sweep backup2 = bB->m_sweep;
+		bool profiling = m_profiler.IsEnabled();
+		float64 start = profiling ? m_profiler.GetTime() : 0.0;
 
-		bA->Advance(minAlpha);
-		bB->Advance(minAlpha);
-
-		// The TOI contact likely has some new contact points.
-		minContact->Update(m_contactManager.m_contactListener);
-		minContact->m_flags &= ~b2Contact::e_toiFlag;
-		++minContact->m_toiCount;
+		b2Profile profile;
+		storeCursor = island.Gather(&m_bodyStore, storeCursor);
+		island.Solve(&profile, reduced ? reducedStep : step, m_gravity, m_allowSleep);
+		++m_counters.islandCount;
 
-		// Is the contact solid?
-		if (minContact->IsEnabled() == false || minContact->IsTouching() == false)
+		if (profiling)
 		{
-			// Restore the sweeps.
-			minContact->SetEnabled(false);
-			bA->m_sweep = backup1;
-			bB->m_sweep = backup2;
-			bA->SynchronizeTransform();
-			bB->SynchronizeTransform();
-			continue;
+			b2ProfileEvent event;
+			b2SetIslandEvent(&event, start, m_profiler.GetTime(), 0, island);
+			m_profiler.AddEvent(event);
 		}
 
-		bA->SetAwake(true);
-		bB->SetAwake(true);
-
-		// Build the island
-		island.Clear();
-		island.Add(bA);
-		island.Add(bB);
-		island.Add(minContact);
+		m_profile.solveInit += profile.solveInit;
+		m_profile.solveVelocity += profile.solveVelocity;
+		m_profile.solvePosition += profile.solvePosition;
 
-		bA->m_flags |= b2Body::e_islandFlag;
-		bB->m_flags |= b2Body::e_islandFlag;
-		minContact->m_flags |= b2Contact::e_islandFlag;
+		// Post solve cleanup.
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			// Allow static bodies to participate in other islands.
+			b2Body* b = island.m_bodies[i];
+			if (b->GetType() == b2_staticBody)
+			{
+				b->m_flags &= ~b2Body::e_islandFlag;
+			}
+		}
+	}
+
+	m_stackAllocator.Free(stack);
+}
+
+// The extent of one island within the flat arrays gathered by SolveParallelIslands.
+struct b2IslandRange
+{
+	int32 bodyStart, bodyCount;
+	int32 contactStart, contactCount;
+	int32 jointStart, jointCount;
+	int32 staticStart, staticCount;
+	bool reduced;
+};
+
+// Records PostSolve impulses on a worker so they can be reported on the main thread.
+class b2ImpulseRecorder : public b2ContactListener
+{
+public:
+	void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse)
+	{
+		B2_NOT_USED(contact);
+		impulses[count++] = *impulse;
+	}
+
+	b2ContactImpulse* impulses;
+	int32 count;
+};
+
+// Solves one gathered island using the stack allocator of the calling worker.
+class b2IslandSolverTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 index, int32 worker)
+	{
+		const b2IslandRange* range = ranges + index;
+
+		b2ImpulseRecorder recorder;
+		recorder.impulses = impulses ? impulses + range->contactStart : NULL;
+		recorder.count = 0;
+
+		b2Island island(range->bodyCount,
+						range->contactCount,
+						range->jointCount,
+						staticCount,
+						allocators + worker,
+						impulses ? &recorder : NULL);
+
+		for (int32 i = 0; i < range->staticCount; ++i)
+		{
+			island.AddStatic(statics[range->staticStart + i]);
+		}
+
+		for (int32 i = 0; i < range->bodyCount; ++i)
+		{
+			island.Add(bodies[range->bodyStart + i]);
+		}
+
+		for (int32 i = 0; i < range->contactCount; ++i)
+		{
+			island.Add(contacts[range->contactStart + i]);
+		}
+
+		for (int32 i = 0; i < range->jointCount; ++i)
+		{
+			island.Add(joints[range->jointStart + i]);
+		}
+
+		float64 start = events ? profiler->GetTime() : 0.0;
+
+		island.m_store = store;
+		island.m_storeBase = range->bodyStart;
+		island.m_movingCount = range->bodyCount;
+		island.Solve(profiles + index, range->reduced ? *reducedStep : *step, gravity, allowSleep);
+
+		if (events)
+		{
+			b2SetIslandEvent(events + index, start, profiler->GetTime(), worker, island);
+		}
+	}
+
+	const b2TimeStep* step;
+	const b2TimeStep* reducedStep;
+	b2Vec2 gravity;
+	bool allowSleep;
+
+	const b2IslandRange* ranges;
+	b2Body** bodies;
+	b2Contact** contacts;
+	b2Joint** joints;
+	b2Body** statics;
+	int32 staticCount;
+	b2BodyStore* store;
+
+	b2StackAllocator* allocators;
+	b2ContactImpulse* impulses;
+	b2Profile* profiles;
+
+	// Island events are only gathered while profiling.
+	const b2Profiler* profiler;
+	b2ProfileEvent* events;
+};
+
+// Gather every awake island first, then solve them concurrently. Islands only
+// share static bodies, which are given fixed negative solver indices so each
+// island keeps a private copy of their state (see b2Island::AddStatic).
+void b2World::SolveParallelIslands(const b2TimeStep& step, const b2TimeStep& reducedStep)
+{
+	if (m_workerAllocators == NULL)
+	{
+		m_workerAllocators = (b2StackAllocator*)b2Alloc(b2_maxWorkers * sizeof(b2StackAllocator));
+		for (int32 i = 0; i < b2_maxWorkers; ++i)
+		{
+			new (m_workerAllocators + i) b2StackAllocator();
+		}
+	}
+
+	// Clear all the island flags.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_flags &= ~b2Body::e_islandFlag;
+		b->m_islandIndex = 0;
+	}
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		c->m_flags &= ~b2Contact::e_islandFlag;
+	}
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->m_islandFlag = false;
+	}
+
+	int32 contactCapacity = m_contactManager.m_contactCount;
+
+	// Every island references a static body through a distinct contact or joint.
+	int32 staticCapacity = contactCapacity + m_jointCount;
+
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2Body*));
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2Body*));
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(contactCapacity * sizeof(b2Contact*));
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate(m_jointCount * sizeof(b2Joint*));
+	b2Body** statics = (b2Body**)m_stackAllocator.Allocate(staticCapacity * sizeof(b2Body*));
+	b2IslandRange* ranges = (b2IslandRange*)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2IslandRange));
+
+	int32 bodyCount = 0;
+	int32 contactCount = 0;
+	int32 jointCount = 0;
+	int32 staticRefCount = 0;
+	int32 staticCount = 0;
+	int32 islandCount = 0;
+
+	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	{
+		if (seed->m_flags & b2Body::e_islandFlag)
+		{
+			continue;
+		}
+
+		if (seed->IsAwake() == false || seed->IsActive() == false)
+		{
+			continue;
+		}
+
+		// Frozen bodies only move when a stepped island reaches them.
+		if (seed->m_flags & b2Body::e_frozenFlag)
+		{
+			continue;
+		}
+
+		// The seed can be dynamic or kinematic.
+		if (seed->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+
+		b2IslandRange* range = ranges + islandCount;
+		++islandCount;
+		range->bodyStart = bodyCount;
+		range->contactStart = contactCount;
+		range->jointStart = jointCount;
+		range->staticStart = staticRefCount;
+		range->reduced = true;
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b2Body::e_islandFlag;
 
-		// Get contacts on bodyA and bodyB.
-		b2Body* bodies[2] = {bA, bB};
-		for (int32 i = 0; i < 2; ++i)
+		// Perform a depth first search (DFS) on the constraint graph.
+		while (stackCount > 0)
 		{
-			b2Body* body = bodies[i];
-			if (body->m_type == b2_dynamicBody)
+			b2Body* b = stack[--stackCount];
+			b2Assert(b->IsActive() == true);
+
+			// Make sure the body is awake. Frozen bodies are stepped with the island.
+			b->SetAwake(true);
+			b->m_flags &= ~b2Body::e_frozenFlag;
+
+			// Static bodies get one solver slot for the whole step and we
+			// don't propagate islands across them.
+			if (b->GetType() == b2_staticBody)
 			{
-				for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+				if (b->m_islandIndex == 0)
 				{
-					if (island.m_bodyCount == island.m_bodyCapacity)
-					{
-						break;
-					}
+					++staticCount;
+					b->m_islandIndex = -staticCount;
+				}
 
-					if (island.m_contactCount == island.m_contactCapacity)
-					{
-						break;
-					}
+				b2Assert(staticRefCount < staticCapacity);
+				statics[staticRefCount++] = b;
+				continue;
+			}
 
-					b2Contact* contact = ce->contact;
+			if ((b->m_flags & b2Body::e_reducedFlag) == 0)
+			{
+				range->reduced = false;
+			}
 
-					// Has this contact already been added to the island?
-					if (contact->m_flags & b2Contact::e_islandFlag)
-					{
-						continue;
-					}
+			// The islands are solved concurrently, so their store slots are
+			// arranged here.
+			m_bodyStore.Place(b, bodyCount);
+			bodies[bodyCount++] = b;
 
-					// Only add static, kinematic, or bullet bodies.
-					b2Body* other = ce->other;
-					if (other->m_type == b2_dynamicBody &&
-						body->IsBullet() == false && other->IsBullet() == false)
-					{
-						continue;
-					}
+			// Search all contacts connected to this body.
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* contact = ce->contact;
 
-					// Skip sensors.
-					bool sensorA = contact->m_fixtureA->m_isSensor;
-					bool sensorB = contact->m_fixtureB->m_isSensor;
-					if (sensorA || sensorB)
-					{
-						continue;
-					}
+				// Has this contact already been added to an island?
+				if (contact->m_flags & b2Contact::e_islandFlag)
+				{
+					continue;
+				}
 
-					// Tentatively advance the body to the TOI.
-					b2Sweep backup = other->m_sweep;
-					if ((other->m_flags & b2Body::e_islandFlag) == 0)
-					{
-						other->Advance(minAlpha);
-					}
+				// Is this contact solid and touching?
+				if (contact->IsEnabled() == false ||
+					contact->IsTouching() == false)
+				{
+					continue;
+				}
 
-					// Update the contact points
-					contact->Update(m_contactManager.m_contactListener);
+				// Skip sensors.
+				bool sensorA = contact->m_fixtureA->m_isSensor;
+				bool sensorB = contact->m_fixtureB->m_isSensor;
+				if (sensorA || sensorB)
+				{
+					continue;
+				}
 
-					// Was the contact disabled by the user?
-					if (contact->IsEnabled() == false)
-					{
-						other->m_sweep = backup;
-						other->SynchronizeTransform();
-						continue;
-					}
+				contacts[contactCount++] = contact;
+				contact->m_flags |= b2Contact::e_islandFlag;
 
-					// Are there contact points?
-					if (contact->IsTouching() == false)
-					{
-						other->m_sweep = backup;
-						other->SynchronizeTransform();
-						continue;
-					}
+				b2Body* other = ce->other;
+
+				// Was the other body already added to this island?
+				if (other->m_flags & b2Body::e_islandFlag)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < m_bodyCount);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+
+			// Search all joints connect to this body.
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				if (je->joint->m_islandFlag == true)
+				{
+					continue;
+				}
+
+				b2Body* other = je->other;
+
+				// Don't simulate joints connected to inactive bodies.
+				if (other->IsActive() == false)
+				{
+					continue;
+				}
+
+				joints[jointCount++] = je->joint;
+				je->joint->m_islandFlag = true;
+
+				if (other->m_flags & b2Body::e_islandFlag)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < m_bodyCount);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+		}
+
+		range->bodyCount = bodyCount - range->bodyStart;
+		range->contactCount = contactCount - range->contactStart;
+		range->jointCount = jointCount - range->jointStart;
+		range->staticCount = staticRefCount - range->staticStart;
+
+		// Allow static bodies to participate in other islands.
+		for (int32 i = range->staticStart; i < staticRefCount; ++i)
+		{
+			statics[i]->m_flags &= ~b2Body::e_islandFlag;
+		}
+	}
+
+	// Events hold doubles, so take them before the odd sized impulses.
+	b2ProfileEvent* events = NULL;
+	if (m_profiler.IsEnabled())
+	{
+		events = (b2ProfileEvent*)m_stackAllocator.Allocate(islandCount * sizeof(b2ProfileEvent));
+	}
+
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+	b2ContactImpulse* impulses = NULL;
+	if (listener)
+	{
+		impulses = (b2ContactImpulse*)m_stackAllocator.Allocate(contactCount * sizeof(b2ContactImpulse));
+	}
+	b2Profile* profiles = (b2Profile*)m_stackAllocator.Allocate(islandCount * sizeof(b2Profile));
+
+	b2IslandSolverTask task;
+	task.step = &step;
+	task.reducedStep = &reducedStep;
+	task.gravity = m_gravity;
+	task.allowSleep = m_allowSleep;
+	task.ranges = ranges;
+	task.bodies = bodies;
+	task.contacts = contacts;
+	task.joints = joints;
+	task.statics = statics;
+	task.staticCount = staticCount;
+	task.store = &m_bodyStore;
+	task.allocators = m_workerAllocators;
+	task.impulses = impulses;
+	task.profiles = profiles;
+	task.profiler = &m_profiler;
+	task.events = events;
+
+	b2ParallelFor(&task, islandCount);
+	m_counters.islandCount += islandCount;
+
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		m_profile.solveInit += profiles[i].solveInit;
+		m_profile.solveVelocity += profiles[i].solveVelocity;
+		m_profile.solvePosition += profiles[i].solvePosition;
+	}
+
+	// Report in the same order as the serial solver.
+	if (listener)
+	{
+		for (int32 i = 0; i < contactCount; ++i)
+		{
+			listener->PostSolve(contacts[i], impulses + i);
+		}
+	}
+
+	m_stackAllocator.Free(profiles);
+	if (impulses)
+	{
+		m_stackAllocator.Free(impulses);
+	}
+	if (events)
+	{
+		for (int32 i = 0; i < islandCount; ++i)
+		{
+			m_profiler.AddEvent(events[i]);
+		}
+		m_stackAllocator.Free(events);
+	}
+	m_stackAllocator.Free(ranges);
+	m_stackAllocator.Free(statics);
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(bodies);
+	m_stackAllocator.Free(stack);
+}
+
+// A contact waiting for its time of impact in the batched TOI solver.
+struct b2TOICandidate
+{
+	b2TOIInput input;
+	b2Contact* contact;
+	float32 alpha0;
+	float32 alpha;
+	bool compute;
+};
+
+// A candidate whose impact falls within the step.
+struct b2TOIEvent
+{
+	b2Contact* contact;
+	float32 alpha;
+	int32 index;
+};
+
+// Order impacts by time. Ties keep the contact list order.
+inline bool b2TOIEventLessThan(const b2TOIEvent& event1, const b2TOIEvent& event2)
+{
+	if (event1.alpha < event2.alpha)
+	{
+		return true;
+	}
+
+	if (event1.alpha == event2.alpha)
+	{
+		return event1.index < event2.index;
+	}
+
+	return false;
+}
+
+// Compute the time of impact and map it from the remaining interval to the full step.
+static float32 b2ComputeTOI(const b2TOIInput* input, float32 alpha0)
+{
+	b2TOIOutput output;
+	b2TimeOfImpact(&output, input);
+
+	// Beta is the fraction of the remaining portion of the .
+	float32 beta = output.t;
+	if (output.state == b2TOIOutput::e_touching)
+	{
+		return b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
+	}
+
+	return 1.0f;
+}
+
+class b2TOITask : public b2ParallelTask
+{
+public:
+	void Execute(int32 index, int32 worker)
+	{
+		B2_NOT_USED(worker);
+
+		int32 begin = index * b2_toiBlockSize;
+		int32 end = b2Min(begin + b2_toiBlockSize, count);
+		for (int32 i = begin; i < end; ++i)
+		{
+			b2TOICandidate* candidate = candidates + i;
+			if (candidate->compute)
+			{
+				candidate->alpha = b2ComputeTOI(&candidate->input, candidate->alpha0);
+			}
+		}
+	}
+
+	b2TOICandidate* candidates;
+	int32 count;
+};
+
+// Check if a contact needs a time of impact. If so, put both sweeps onto the same
+// time interval and fill in the TOI input.
+bool b2World::PrepareTOI(b2Contact* c, b2TOIInput* input, float32* alpha0)
+{
+	b2Fixture* fA = c->GetFixtureA();
+	b2Fixture* fB = c->GetFixtureB();
+
+	// Is there a sensor?
+	if (fA->IsSensor() || fB->IsSensor())
+	{
+		return false;
+	}
+
+	b2Body* bA = fA->GetBody();
+	b2Body* bB = fB->GetBody();
+
+	b2BodyType typeA = bA->m_type;
+	b2BodyType typeB = bB->m_type;
+	b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
+
+	bool activeA = bA->IsStepping() && typeA != b2_staticBody;
+	bool activeB = bB->IsStepping() && typeB != b2_staticBody;
+
+	// Is at least one body active (awake, not frozen, and dynamic or kinematic)?
+	if (activeA == false && activeB == false)
+	{
+		return false;
+	}
+
+	bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
+	bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
+
+	// Are these two non-bullet dynamic bodies?
+	if (collideA == false && collideB == false)
+	{
+		return false;
+	}
+
+	// Compute the TOI for this contact.
+	// Put the sweeps onto the same time interval.
+	*alpha0 = bA->m_sweep.alpha0;
+
+	if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
+	{
+		*alpha0 = bB->m_sweep.alpha0;
+		bA->m_sweep.Advance(*alpha0);
+	}
+	else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
+	{
+		*alpha0 = bA->m_sweep.alpha0;
+		bB->m_sweep.Advance(*alpha0);
+	}
+
+	b2Assert(*alpha0 < 1.0f);
+
+	int32 indexA = c->GetChildIndexA();
+	int32 indexB = c->GetChildIndexB();
+
+	// Compute the time of impact in interval [0, minTOI]
+	input->proxyA.Set(fA->GetShape(), indexA);
+	input->proxyB.Set(fB->GetShape(), indexB);
+	input->sweepA = bA->m_sweep;
+	input->sweepB = bB->m_sweep;
+	input->tMax = 1.0f;
+	return true;
+}
+
+// Advance the bodies of a TOI contact to the impact and solve the impact together
+// with the contacts on those bodies. Returns false if the contact turned out not
+// to be solid, in which case the bodies are left as they were.
+bool b2World::SolveTOIEvent(b2Island* island, b2Contact* minContact, float32 minAlpha, const b2TimeStep& step)
+{
+	// Advance the bodies to the TOI.
+	b2Fixture* fA = minContact->GetFixtureA();
+	b2Fixture* fB = minContact->GetFixtureB();
+	b2Body* bA = fA->GetBody();
+	b2Body* bB = fB->GetBody();
+
+	b2Sweep backup1 = bA->m_sweep;
+	b2Sweep backup2 = bB->m_sweep;
+
+	bA->Advance(minAlpha);
+	bB->Advance(minAlpha);
+
+	// The TOI contact likely has some new contact points.
+	minContact->Update(m_contactManager.m_contactListener);
+	minContact->m_flags &= ~b2Contact::e_toiFlag;
+	++minContact->m_toiCount;
+
+	// Is the contact solid?
+	if (minContact->IsEnabled() == false || minContact->IsTouching() == false)
+	{
+		// Restore the sweeps.
+		minContact->SetEnabled(false);
+		bA->m_sweep = backup1;
+		bB->m_sweep = backup2;
+		bA->SynchronizeTransform();
+		bB->SynchronizeTransform();
+		return false;
+	}
+
+	++m_counters.toiEventCount;
+
+	bA->SetAwake(true);
+	bB->SetAwake(true);
+
+	// Build the island
+	island->Clear();
+	island->Add(bA);
+	island->Add(bB);
+	island->Add(minContact);
+
+	bA->m_flags |= b2Body::e_islandFlag;
+	bB->m_flags |= b2Body::e_islandFlag;
+	minContact->m_flags |= b2Contact::e_islandFlag;
+
+	// Get contacts on bodyA and bodyB.
+	b2Body* bodies[2] = {bA, bB};
+	for (int32 i = 0; i < 2; ++i)
+	{
+		b2Body* body = bodies[i];
+		if (body->m_type == b2_dynamicBody)
+		{
+			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+			{
+				if (island->m_bodyCount == island->m_bodyCapacity)
+				{
+					break;
+				}
+
+				if (island->m_contactCount == island->m_contactCapacity)
+				{
+					break;
+				}
+
+				b2Contact* contact = ce->contact;
+
+				// Has this contact already been added to the island?
+				if (contact->m_flags & b2Contact::e_islandFlag)
+				{
+					continue;
+				}
+
+				// Only add static, kinematic, or bullet bodies.
+				b2Body* other = ce->other;
+				if (other->m_type == b2_dynamicBody &&
+					body->IsBullet() == false && other->IsBullet() == false)
+				{
+					continue;
+				}
+
+				// Skip sensors.
+				bool sensorA = contact->m_fixtureA->m_isSensor;
+				bool sensorB = contact->m_fixtureB->m_isSensor;
+				if (sensorA || sensorB)
+				{
+					continue;
+				}
+
+				// Tentatively advance the body to the TOI.
+				b2Sweep backup = other->m_sweep;
+				if ((other->m_flags & b2Body::e_islandFlag) == 0)
+				{
+					other->Advance(minAlpha);
+				}
+
+				// Update the contact points
+				contact->Update(m_contactManager.m_contactListener);
+
+				// Was the contact disabled by the user?
+				if (contact->IsEnabled() == false)
+				{
+					other->m_sweep = backup;
+					other->SynchronizeTransform();
+					continue;
+				}
+
+				// Are there contact points?
+				if (contact->IsTouching() == false)
+				{
+					other->m_sweep = backup;
+					other->SynchronizeTransform();
+					continue;
+				}
+
+				// Add the contact to the island
+				contact->m_flags |= b2Contact::e_islandFlag;
+				island->Add(contact);
+
+				// Has the other body already been added to the island?
+				if (other->m_flags & b2Body::e_islandFlag)
+				{
+					continue;
+				}
+				
+				// Add the other body to the island.
+				other->m_flags |= b2Body::e_islandFlag;
+
+				if (other->m_type != b2_staticBody)
+				{
+					other->SetAwake(true);
+				}
+
+				island->Add(other);
+			}
+		}
+	}
+
+	b2TimeStep subStep;
+	subStep.dt = (1.0f - minAlpha) * step.dt;
+	subStep.inv_dt = 1.0f / subStep.dt;
+	subStep.dtRatio = 1.0f;
+	subStep.positionIterations = 20;
+	subStep.velocityIterations = step.velocityIterations;
+	subStep.warmStarting = false;
+	subStep.wideSolver = false;
+	subStep.parallelSolver = false;
+	island->SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
+
+	// Reset island flags and synchronize broad-phase proxies.
+	for (int32 i = 0; i < island->m_bodyCount; ++i)
+	{
+		b2Body* body = island->m_bodies[i];
+		body->m_flags &= ~(b2Body::e_islandFlag | b2Body::e_frozenFlag);
+
+		if (body->m_type != b2_dynamicBody)
+		{
+			continue;
+		}
+
+		body->SynchronizeFixtures();
+
+		// Invalidate all contact TOIs on this displaced body.
+		for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+		{
+			ce->contact->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+		}
+	}
+
+	return true;
+}
+
+// Solve TOI events in batches. Each batch computes the missing TOIs of all candidate
+// contacts in parallel and then solves the impacts in time order. Solving an impact
+// invalidates the TOIs of the contacts on the moved bodies and may create contacts.
+// Only those TOIs are recomputed, and the batch ends once one of them comes before
+// the next impact in the list. So impacts are solved in the order of the serial loop
+// without scanning every contact after each impact.
+void b2World::SolveTOIBatches(b2Island* island, const b2TimeStep& step)
+{
+	for (;;)
+	{
+		// Contacts are created between batches, so size the arrays for each batch.
+		// The candidates are freed first, so they go on top of the stack.
+		int32 capacity = m_contactManager.m_contactCount;
+		b2TOIEvent* events = (b2TOIEvent*)m_stackAllocator.Allocate(capacity * sizeof(b2TOIEvent));
+		b2TOICandidate* candidates = (b2TOICandidate*)m_stackAllocator.Allocate(capacity * sizeof(b2TOICandidate));
+		int32 candidateCount = 0;
+
+		// Gather candidates serially, since preparing a TOI may advance a sweep.
+		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		{
+			// Is this contact disabled?
+			if (c->IsEnabled() == false)
+			{
+				continue;
+			}
+
+			// Prevent excessive sub-stepping.
+			if (c->m_toiCount > b2_maxSubSteps)
+			{
+				continue;
+			}
+
+			b2TOICandidate* candidate = candidates + candidateCount;
+			if (c->m_flags & b2Contact::e_toiFlag)
+			{
+				// This contact has a valid cached TOI.
+				candidate->alpha = c->m_toi;
+				candidate->compute = false;
+			}
+			else
+			{
+				if (PrepareTOI(c, &candidate->input, &candidate->alpha0) == false)
+				{
+					continue;
+				}
+
+				candidate->compute = true;
+			}
+
+			candidate->contact = c;
+			++candidateCount;
+		}
+
+		b2TOITask task;
+		task.candidates = candidates;
+		task.count = candidateCount;
+		b2ParallelFor(&task, (candidateCount + b2_toiBlockSize - 1) / b2_toiBlockSize);
+
+		int32 eventCount = 0;
+
+		for (int32 i = 0; i < candidateCount; ++i)
+		{
+			b2TOICandidate* candidate = candidates + i;
+			b2Contact* c = candidate->contact;
+			if (candidate->compute)
+			{
+				c->m_toi = candidate->alpha;
+				c->m_flags |= b2Contact::e_toiFlag;
+				++m_counters.toiCount;
+			}
+
+			if (candidate->alpha <= 1.0f - 10.0f * b2_epsilon)
+			{
+				b2TOIEvent* event = events + eventCount;
+				event->contact = c;
+				event->alpha = candidate->alpha;
+				event->index = i;
+				++eventCount;
+			}
+		}
+
+		m_stackAllocator.Free(candidates);
+
+		if (eventCount == 0)
+		{
+			// No more TOI events. Done!
+			m_stackAllocator.Free(events);
+			break;
+		}
+
+		std::sort(events, events + eventCount, b2TOIEventLessThan);
+
+		// The earliest TOI recomputed during this batch.
+		float32 minAlpha = 1.0f;
+
+		for (int32 i = 0; i < eventCount; ++i)
+		{
+			b2TOIEvent* event = events + i;
+			if (minAlpha <= event->alpha)
+			{
+				// A recomputed TOI comes first. Start a new batch.
+				break;
+			}
+
+			// Skip contacts that an earlier impact disabled or whose TOI was invalidated.
+			b2Contact* c = event->contact;
+			if (c->IsEnabled() == false || (c->m_flags & b2Contact::e_toiFlag) == 0 || c->m_toi != event->alpha)
+			{
+				continue;
+			}
+
+			if (SolveTOIEvent(island, c, event->alpha, step) == false)
+			{
+				continue;
+			}
+
+			// Commit fixture proxy movements to the broad-phase so that new contacts are created.
+			// Also, some contacts can be destroyed.
+			FindNewContacts();
+
+			// Recompute the TOIs on the moved bodies, including their new contacts.
+			for (int32 j = 0; j < island->m_bodyCount; ++j)
+			{
+				b2Body* body = island->m_bodies[j];
+				if (body->m_type != b2_dynamicBody)
+				{
+					continue;
+				}
+
+				for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+				{
+					b2Contact* contact = ce->contact;
+					if (contact->m_flags & b2Contact::e_toiFlag)
+					{
+						continue;
+					}
+
+					if (contact->IsEnabled() == false || contact->m_toiCount > b2_maxSubSteps)
+					{
+						continue;
+					}
+
+					b2TOIInput input;
+					float32 alpha0;
+					if (PrepareTOI(contact, &input, &alpha0) == false)
+					{
+						continue;
+					}
+
+					float32 alpha = b2ComputeTOI(&input, alpha0);
+					++m_counters.toiCount;
+
+					contact->m_toi = alpha;
+					contact->m_flags |= b2Contact::e_toiFlag;
+					minAlpha = b2Min(minAlpha, alpha);
+				}
+			}
+		}
+
+		m_stackAllocator.Free(events);
+	}
+}
+
+// Find TOI contacts and solve them.
+void b2World::SolveTOI(const b2TimeStep& step)
+{
+	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+
+	if (m_stepComplete)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		{
+			b->m_flags &= ~b2Body::e_islandFlag;
+			b->m_sweep.alpha0 = 0.0f;
+		}
+
+		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		{
+			// Invalidate TOI
+			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+			c->m_toiCount = 0;
+			c->m_toi = 1.0f;
+		}
+	}
+
+	if (m_parallelTOI && m_subStepping == false)
+	{
+		SolveTOIBatches(&island, step);
+		m_stepComplete = true;
+		return;
+	}
+
+	// Find TOI events and solve them.
+	for (;;)
+	{
+		// Find the first TOI.
+		b2Contact* minContact = NULL;
+		float32 minAlpha = 1.0f;
+
+		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		{
+			// Is this contact disabled?
+			if (c->IsEnabled() == false)
+			{
+				continue;
+			}
+
+			// Prevent excessive sub-stepping.
+			if (c->m_toiCount > b2_maxSubSteps)
+			{
+				continue;
+			}
+
+			float32 alpha = 1.0f;
+			if (c->m_flags & b2Contact::e_toiFlag)
+			{
+				// This contact has a valid cached TOI.
+				alpha = c->m_toi;
+			}
+			else
+			{
+				b2TOIInput input;
+				float32 alpha0;
+				if (PrepareTOI(c, &input, &alpha0) == false)
+				{
+					continue;
+				}
+
+				alpha = b2ComputeTOI(&input, alpha0);
+				++m_counters.toiCount;
+
+				c->m_toi = alpha;
+				c->m_flags |= b2Contact::e_toiFlag;
+			}
+
+			if (alpha < minAlpha)
+			{
+				// This is the minimum TOI found so far.
+				minContact = c;
+				minAlpha = alpha;
+			}
+		}
+
+		if (minContact == NULL || 1.0f - 10.0f * b2_epsilon < minAlpha)
+		{
+			// No more TOI events. Done!
+			m_stepComplete = true;
+			break;
+		}
+
+		if (SolveTOIEvent(&island, minContact, minAlpha, step) == false)
+		{
+			continue;
+		}
+
+		// Commit fixture proxy movements to the broad-phase so that new contacts are created.
+		// Also, some contacts can be destroyed.
+		FindNewContacts();
+
+		if (m_subStepping)
+		{
+			m_stepComplete = false;
+			break;
+		}
+	}
+}
+
+void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
+{
+	b2Timer stepTimer;
+	float64 stepStart = m_profiler.GetTime();
+
+	memset(&m_counters, 0, sizeof(b2ProfileCounters));
+	b2BlockAllocatorStats allocatorStats;
+	if (m_profiler.IsEnabled())
+	{
+		m_blockAllocator.GetStats(&allocatorStats);
+	}
+
+	// If new fixtures were added, we need to find the new contacts.
+	if (m_flags & e_newFixture)
+	{
+		FindNewContacts();
+		m_flags &= ~e_newFixture;
+	}
+
+	m_flags |= e_locked;
+
+	b2TimeStep step;
+	step.dt = dt;
+	step.velocityIterations	= velocityIterations;
+	step.positionIterations = positionIterations;
+	if (dt > 0.0f)
+	{
+		step.inv_dt = 1.0f / dt;
+	}
+	else
+	{
+		step.inv_dt = 0.0f;
+	}
+
+	step.dtRatio = m_inv_dt0 * dt;
+
+	step.warmStarting = m_warmStarting;
+	step.wideSolver = m_wideSolver;
+	step.parallelSolver = m_parallelSolver;
+
+	// Pick the bodies to step before their contacts are updated.
+	if (m_lodEnabled && m_focusPointCount > 0 && m_stepComplete && step.dt > 0.0f)
+	{
+		UpdateSimulationLOD();
+	}
+	
+	// Update contacts. This is where some contacts are destroyed.
+	{
+		b2Timer timer;
+		float64 start = m_profiler.GetTime();
+		m_contactManager.Collide();
+		m_profile.collide = timer.GetMilliseconds();
+		m_profiler.AddEvent("Collide", start);
+	}
+
+	// Find the fixtures overlapping the sensors.
+	if (m_contactManager.m_sensorEvents)
+	{
+		b2Timer timer;
+		float64 start = m_profiler.GetTime();
+		m_sensorManager.Update();
+		m_profile.sensors = timer.GetMilliseconds();
+		m_profiler.AddEvent("Sensors", start);
+	}
+
+	// Integrate velocities, solve velocity constraints, and integrate positions.
+	if (m_stepComplete && step.dt > 0.0f)
+	{
+		b2Timer timer;
+		float64 start = m_profiler.GetTime();
+		Solve(step);
+		m_profile.solve = timer.GetMilliseconds();
+		m_profiler.AddEvent("Solve", start);
+	}
+
+	// Handle TOI events.
+	if (m_continuousPhysics && step.dt > 0.0f)
+	{
+		b2Timer timer;
+		float64 start = m_profiler.GetTime();
+		SolveTOI(step);
+		m_profile.solveTOI = timer.GetMilliseconds();
+		m_profiler.AddEvent("Solve TOI", start);
+	}
+
+	if (step.dt > 0.0f)
+	{
+		m_inv_dt0 = step.inv_dt;
+	}
+
+	if (m_flags & e_clearForces)
+	{
+		ClearForces();
+	}
+
+	m_flags &= ~e_locked;
+
+	m_profile.step = stepTimer.GetMilliseconds();
+
+	if (m_profiler.IsEnabled())
+	{
+		RecordProfile(stepStart, allocatorStats);
+	}
+}
+
+// Finish the counters for the profiler and record the step.
+void b2World::RecordProfile(float64 stepStart, const b2BlockAllocatorStats& allocatorStats)
+{
+	m_profiler.AddEvent("Step", stepStart);
+
+	b2ProfileStep record;
+	record.start = stepStart;
+	record.profile = m_profile;
+	record.counters = m_counters;
+
+	b2ProfileCounters* counters = &record.counters;
+	counters->bodyCount = m_bodyCount;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (b->IsAwake())
+		{
+			++counters->awakeBodyCount;
+		}
+
+		if (b->IsFrozen())
+		{
+			++counters->frozenBodyCount;
+		}
+	}
+
+	counters->contactCount = m_contactManager.m_contactCount;
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		int32 typeA = c->m_fixtureA->GetType();
+		int32 typeB = c->m_fixtureB->GetType();
+		++counters->shapeContactCounts[typeA][typeB];
+
+		if (c->IsTouching())
+		{
+			++counters->touchingCount;
+		}
+	}
+
+	b2BlockAllocatorStats stats;
+	m_blockAllocator.GetStats(&stats);
+	counters->allocationCount = int32(stats.allocationCount - allocatorStats.allocationCount);
+	counters->freeCount = int32(stats.freeCount - allocatorStats.freeCount);
+
+	m_profiler.AddStep(record);
+}
+
+void b2World::ClearForces()
+{
+	m_bodyStore.ClearForces();
+}
+
+struct b2WorldQueryWrapper
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		return callback->ReportFixture(proxy->fixture);
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2QueryCallback* callback;
+};
+
+void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
+{
+	b2WorldQueryWrapper wrapper;
+	wrapper.broadPhase = &m_contactManager.m_broadPhase;
+	wrapper.callback = callback;
+	m_contactManager.m_broadPhase.Query(&wrapper, aabb);
+}
+
+struct b2WorldRayCastWrapper
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		void* userData = broadPhase->GetUserData(proxyId);
+		b2FixtureProxy* proxy = (b2FixtureProxy*)userData;
+		b2Fixture* fixture = proxy->fixture;
+		int32 index = proxy->childIndex;
+		b2RayCastOutput output;
+		bool hit = fixture->RayCast(&output, input, index);
+
+		if (hit)
+		{
+			float32 fraction = output.fraction;
+			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
+			return callback->ReportFixture(fixture, point, output.normal, fraction);
+		}
+
+		return input.maxFraction;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2RayCastCallback* callback;
+};
+
+void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const
+{
+	b2WorldRayCastWrapper wrapper;
+	wrapper.broadPhase = &m_contactManager.m_broadPhase;
+	wrapper.callback = callback;
+	b2RayCastInput input;
+	input.maxFraction = 1.0f;
+	input.p1 = point1;
+	input.p2 = point2;
+	m_contactManager.m_broadPhase.RayCast(&wrapper, input);
+}
+
+// Collects the fixtures of a packet of batched queries into fixed size slots.
+struct b2BatchQueryCollector
+{
+	bool QueryCallback(int32 lane, int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		if ((proxy->fixture->GetFilterData().categoryBits & maskBits) == 0)
+		{
+			return true;
+		}
+
+		int32& count = counts[lane];
+		fixtures[lane * maxFixtures + count] = proxy->fixture;
+		++count;
+
+		// Stop this query once its slots are full.
+		return count < maxFixtures;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2Fixture** fixtures;
+	int32* counts;
+	int32 maxFixtures;
+	uint16 maskBits;
+};
+
+class b2BatchQueryTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 index, int32 worker)
+	{
+		B2_NOT_USED(worker);
+
+		int32 begin = index * b2_queryBlockSize;
+		int32 end = b2Min(begin + b2_queryBlockSize, count);
+		for (int32 i = begin; i < end; i += b2_simdWidth)
+		{
+			int32 packetCount = b2Min(end - i, int32(b2_simdWidth));
+
+			b2BatchQueryCollector collector;
+			collector.broadPhase = broadPhase;
+			collector.fixtures = fixtures + i * maxFixtures;
+			collector.counts = fixtureCounts + i;
+			collector.maxFixtures = maxFixtures;
+			collector.maskBits = maskBits;
+
+			for (int32 j = 0; j < packetCount; ++j)
+			{
+				collector.counts[j] = 0;
+			}
+
+			if (maxFixtures > 0)
+			{
+				broadPhase->QueryPacket(&collector, aabbs + i, packetCount);
+			}
+		}
+	}
+
+	const b2BroadPhase* broadPhase;
+	const b2AABB* aabbs;
+	int32 count;
+	b2Fixture** fixtures;
+	int32 maxFixtures;
+	int32* fixtureCounts;
+	uint16 maskBits;
+};
+
+void b2World::QueryAABBBatch(	const b2AABB* aabbs, int32 count, b2Fixture** fixtures,
+								int32 maxFixtures, int32* fixtureCounts, uint16 maskBits) const
+{
+	b2Assert(IsLocked() == false);
+	b2Assert(maxFixtures >= 0);
+
+	b2BatchQueryTask task;
+	task.broadPhase = &m_contactManager.m_broadPhase;
+	task.aabbs = aabbs;
+	task.count = count;
+	task.fixtures = fixtures;
+	task.maxFixtures = maxFixtures;
+	task.fixtureCounts = fixtureCounts;
+	task.maskBits = maskBits;
+	b2ParallelFor(&task, (count + b2_queryBlockSize - 1) / b2_queryBlockSize);
+}
+
+// Keeps the closest hit of one batched ray-cast.
+struct b2BatchRayCastCollector
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Fixture* fixture = proxy->fixture;
+		if ((fixture->GetFilterData().categoryBits & maskBits) == 0)
+		{
+			return -1.0f;
+		}
+
+		b2RayCastOutput output;
+		bool hit = fixture->RayCast(&output, input, proxy->childIndex);
+		if (hit == false)
+		{
+			return input.maxFraction;
+		}
+
+		float32 fraction = output.fraction;
+		hitOut->fixture = fixture;
+		hitOut->point = (1.0f - fraction) * input.p1 + fraction * input.p2;
+		hitOut->normal = output.normal;
+		hitOut->fraction = fraction;
+
+		// Clip the ray so only closer hits are reported.
+		return fraction;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2RayCastHit* hitOut;
+	uint16 maskBits;
+};
+
+class b2BatchRayCastTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 index, int32 worker)
+	{
+		B2_NOT_USED(worker);
+
+		b2BatchRayCastCollector collector;
+		collector.broadPhase = broadPhase;
+		collector.maskBits = maskBits;
+
+		int32 begin = index * b2_queryBlockSize;
+		int32 end = b2Min(begin + b2_queryBlockSize, count);
+		for (int32 i = begin; i < end; ++i)
+		{
+			b2RayCastHit* hit = hits + i;
+			hit->fixture = NULL;
+			hit->point = inputs[i].p1 + inputs[i].maxFraction * (inputs[i].p2 - inputs[i].p1);
+			hit->normal.SetZero();
+			hit->fraction = inputs[i].maxFraction;
+
+			collector.hitOut = hit;
+			broadPhase->RayCast(&collector, inputs[i]);
+		}
+	}
+
+	const b2BroadPhase* broadPhase;
+	const b2RayCastInput* inputs;
+	int32 count;
+	b2RayCastHit* hits;
+	uint16 maskBits;
+};
+
+void b2World::RayCastBatch(const b2RayCastInput* inputs, int32 count, b2RayCastHit* hits, uint16 maskBits) const
+{
+	b2Assert(IsLocked() == false);
+
+	b2BatchRayCastTask task;
+	task.broadPhase = &m_contactManager.m_broadPhase;
+	task.inputs = inputs;
+	task.count = count;
+	task.hits = hits;
+	task.maskBits = maskBits;
+	b2ParallelFor(&task, (count + b2_queryBlockSize - 1) / b2_queryBlockSize);
+}
+
+void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color& color)
+{
+	switch (fixture->GetType())
+	{
+	case b2Shape::e_circle:
+		{
+			b2CircleShape* circle = (b2CircleShape*)fixture->GetShape();
+
+			b2Vec2 center = b2Mul(xf, circle->m_p);
+			float32 radius = circle->m_radius;
+			b2Vec2 axis = b2Mul(xf.q, b2Vec2(1.0f, 0.0f));
+
+			m_debugDraw->DrawSolidCircle(center, radius, axis, color);
+		}
+		break;
+
+	case b2Shape::e_edge:
+		{
+			b2EdgeShape* edge = (b2EdgeShape*)fixture->GetShape();
+			b2Vec2 v1 = b2Mul(xf, edge->m_vertex1);
+			b2Vec2 v2 = b2Mul(xf, edge->m_vertex2);
+			m_debugDraw->DrawSegment(v1, v2, color);
+		}
+		break;
+
+	case b2Shape::e_chain:
+		{
+			b2ChainShape* chain = (b2ChainShape*)fixture->GetShape();
+			int32 count = chain->m_count;
+			const b2Vec2* vertices = chain->m_vertices;
+
+			b2Vec2 v1 = b2Mul(xf, vertices[0]);
+			for (int32 i = 1; i < count; ++i)
+			{
+				b2Vec2 v2 = b2Mul(xf, vertices[i]);
+				m_debugDraw->DrawSegment(v1, v2, color);
+				m_debugDraw->DrawCircle(v1, 0.05f, color);
+				v1 = v2;
+			}
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			b2PolygonShape* poly = (b2PolygonShape*)fixture->GetShape();
+			int32 vertexCount = poly->m_vertexCount;
+			b2Assert(vertexCount <= b2_maxPolygonVertices);
+			b2Vec2 vertices[b2_maxPolygonVertices];
+
+			for (int32 i = 0; i < vertexCount; ++i)
+			{
+				vertices[i] = b2Mul(xf, poly->m_vertices[i]);
+			}
+
+			m_debugDraw->DrawSolidPolygon(vertices, vertexCount, color);
+		}
+		break;
+            
+    default:
+        break;
+	}
+}
+
+void b2World::DrawJoint(b2Joint* joint)
+{
+	b2Body* bodyA = joint->GetBodyA();
+	b2Body* bodyB = joint->GetBodyB();
+	const b2Transform& xf1 = bodyA->GetTransform();
+	const b2Transform& xf2 = bodyB->GetTransform();
+	b2Vec2 x1 = xf1.p;
+	b2Vec2 x2 = xf2.p;
+	b2Vec2 p1 = joint->GetAnchorA();
+	b2Vec2 p2 = joint->GetAnchorB();
+
+	b2Color color(0.5f, 0.8f, 0.8f);
+
+	switch (joint->GetType())
+	{
+	case e_distanceJoint:
+		m_debugDraw->DrawSegment(p1, p2, color);
+		break;
+
+	case e_pulleyJoint:
+		{
+			b2PulleyJoint* pulley = (b2PulleyJoint*)joint;
+			b2Vec2 s1 = pulley->GetGroundAnchorA();
+			b2Vec2 s2 = pulley->GetGroundAnchorB();
+			m_debugDraw->DrawSegment(s1, p1, color);
+			m_debugDraw->DrawSegment(s2, p2, color);
+			m_debugDraw->DrawSegment(s1, s2, color);
+		}
+		break;
+
+	case e_mouseJoint:
+		// don't draw this
+		break;
+
+	default:
+		m_debugDraw->DrawSegment(x1, p1, color);
+		m_debugDraw->DrawSegment(p1, p2, color);
+		m_debugDraw->DrawSegment(x2, p2, color);
+	}
+}
+
+void b2World::DrawDebugData()
+{
+	if (m_debugDraw == NULL)
+	{
+		return;
+	}
+
+	uint32 flags = m_debugDraw->GetFlags();
+
+	if (flags & b2Draw::e_shapeBit)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			const b2Transform& xf = b->GetTransform();
+			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			{
+				if (b->IsActive() == false)
+				{
+					DrawShape(f, xf, b2Color(0.5f, 0.5f, 0.3f));
+				}
+				else if (b->GetType() == b2_staticBody)
+				{
+					DrawShape(f, xf, b2Color(0.5f, 0.9f, 0.5f));
+				}
+				else if (b->GetType() == b2_kinematicBody)
+				{
+					DrawShape(f, xf, b2Color(0.5f, 0.5f, 0.9f));
+				}
+				else if (b->IsAwake() == false)
+				{
+					DrawShape(f, xf, b2Color(0.6f, 0.6f, 0.6f));
+				}
+				else
+				{
+					DrawShape(f, xf, b2Color(0.9f, 0.7f, 0.7f));
+				}
+			}
+		}
+	}
+
+	if (flags & b2Draw::e_jointBit)
+	{
+		for (b2Joint* j = m_jointList; j; j = j->GetNext())
+		{
+			DrawJoint(j);
+		}
+	}
+
+	if (flags & b2Draw::e_pairBit)
+	{
+		b2Color color(0.3f, 0.9f, 0.9f);
+		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->GetNext())
+		{
+			//b2Fixture* fixtureA = c->GetFixtureA();
+			//b2Fixture* fixtureB = c->GetFixtureB();
+
+			//b2Vec2 cA = fixtureA->GetAABB().GetCenter();
+			//b2Vec2 cB = fixtureB->GetAABB().GetCenter();
+
+			//m_debugDraw->DrawSegment(cA, cB, color);
+		}
+	}
+
+	if (flags & b2Draw::e_aabbBit)
+	{
+		b2Color color(0.9f, 0.3f, 0.9f);
+		b2BroadPhase* bp = &m_contactManager.m_broadPhase;
+
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			if (b->IsActive() == false)
+			{
+				continue;
+			}
+
+			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			{
+				for (int32 i = 0; i < f->m_proxyCount; ++i)
+				{
+					b2FixtureProxy* proxy = f->m_proxies + i;
+					b2AABB aabb = bp->GetFatAABB(proxy->proxyId);
+					b2Vec2 vs[4];
+					vs[0].Set(aabb.lowerBound.x, aabb.lowerBound.y);
+					vs[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
+					vs[2].Set(aabb.upperBound.x, aabb.upperBound.y);
+					vs[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
+
+					m_debugDraw->DrawPolygon(vs, 4, color);
+				}
+			}
+		}
+	}
+
+	if (flags & b2Draw::e_centerOfMassBit)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			b2Transform xf = b->GetTransform();
+			xf.p = b->GetWorldCenter();
+			m_debugDraw->DrawTransform(xf);
+		}
+	}
+}
+
+void b2World::SetThreadCachingAllocator(bool flag)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_blockAllocator.SetThreadCaching(flag);
+}
+
+void b2World::SetBroadPhaseFiltering(bool flag)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked() || flag == m_contactManager.m_filterProxies)
+	{
+		return;
+	}
+
+	m_contactManager.m_filterProxies = flag;
+
+	// Retag the proxies. Refilter also touches them, which finds the pairs
+	// that were skipped before.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			f->Refilter();
+		}
+	}
+}
+
+void b2World::SetSensorEvents(bool flag)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked() || flag == m_contactManager.m_sensorEvents)
+	{
+		return;
+	}
+
+	m_contactManager.m_sensorEvents = flag;
+	if (flag == false)
+	{
+		m_sensorManager.Clear();
+	}
+
+	// Refilter destroys the contacts of the sensors, or finds them again.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			if (f->m_isSensor == false)
+			{
+				continue;
+			}
+
+			if (flag)
+			{
+				m_sensorManager.AddSensor(f);
+			}
+
+			f->Refilter();
+		}
+	}
+}
+
+void b2World::GetAllocatorStats(b2BlockAllocatorStats* stats) const
+{
+	m_blockAllocator.GetStats(stats);
+}
+
+int32 b2World::GetMaxStackAllocation() const
+{
+	int32 allocation = m_stackAllocator.GetMaxAllocation();
+	if (m_workerAllocators)
+	{
+		for (int32 i = 0; i < b2_maxWorkers; ++i)
+		{
+			allocation += m_workerAllocators[i].GetMaxAllocation();
+		}
+	}
+	return allocation;
+}
+
+int32 b2World::GetProxyCount() const
+{
+	return m_contactManager.m_broadPhase.GetProxyCount();
+}
+
+int32 b2World::GetTreeHeight() const
+{
+	return m_contactManager.m_broadPhase.GetTreeHeight();
+}
+
+int32 b2World::GetTreeBalance() const
+{
+	return m_contactManager.m_broadPhase.GetTreeBalance();
+}
+
+float32 b2World::GetTreeQuality() const
+{
+	return m_contactManager.m_broadPhase.GetTreeQuality();
+}
+
+// FNV-1a over the bytes of a value.
+static uint32 b2HashBytes(uint32 hash, const void* data, int32 size)
+{
+	const uint8* bytes = (const uint8*)data;
+	for (int32 i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+uint32 b2World::ComputeStateHash() const
+{
+	uint32 hash = 2166136261u;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		hash = b2HashBytes(hash, &b->m_xf, sizeof(b2Transform));
+		hash = b2HashBytes(hash, &b->m_sweep, sizeof(b2Sweep));
+		hash = b2HashBytes(hash, &b->LinearVelocity(), sizeof(b2Vec2));
+		hash = b2HashBytes(hash, &b->AngularVelocity(), sizeof(float32));
+
+		// A static body is put to sleep with the serial island that reached it
+		// last, while parallel islands share it and leave its flag alone. The step
+		// never reads it, so only the bodies that move count.
+		if (b->m_type != b2_staticBody)
+		{
+			uint8 awake = b->IsAwake() ? 1 : 0;
+			hash = b2HashBytes(hash, &awake, sizeof(uint8));
+		}
+	}
+
+	hash = b2HashBytes(hash, &m_contactManager.m_contactCount, sizeof(int32));
+	return hash;
+}
+
+void b2World::Dump()
+{
+	if ((m_flags & e_locked) == e_locked)
+	{
+		return;
+	}
+
+	b2Log("b2Vec2 g(%.15lef, %.15lef);\n", m_gravity.x, m_gravity.y);
+	b2Log("m_world->SetGravity(g);\n");
+
+	b2Log("b2Body** bodies = (b2Body**)b2Alloc(%d * sizeof(b2Body*));\n", m_bodyCount);
+	b2Log("b2Joint** joints = (b2Joint**)b2Alloc(%d * sizeof(b2Joint*));\n", m_jointCount);
+	int32 i = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_islandIndex = i;
+		b->Dump();
+		++i;
+	}
+
+	i = 0;
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->m_index = i;
+		++i;
+	}
+
+	// First pass on joints, skip gear joints.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		if (j->m_type == e_gearJoint)
+		{
+			continue;
+		}
+
+		b2Log("{\n");
+		j->Dump();
+		b2Log("}\n");
+	}
+
+	// Second pass on joints, only gear joints.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		if (j->m_type != e_gearJoint)
+		{
+			continue;
+		}
+
+		b2Log("{\n");
+		j->Dump();
+		b2Log("}\n");
+	}
+
+	b2Log("b2Free(joints);\n");
+	b2Log("b2Free(bodies);\n");
+	b2Log("joints = NULL;\n");
+	b2Log("bodies = NULL;\n");
+}
+
+// Snapshot layout. Bump the version whenever the layout changes.
+const uint32 b2_snapshotMagic = 0x53573242;	// "B2WS"
+const int32 b2_snapshotVersion = 6;
+
+struct b2SnapshotHeader
+{
+	uint32 magic;
+	int32 version;
+	int32 pointerSize;
+	b2BroadPhaseType broadPhaseType;
+	int32 bodyCount;
+	int32 jointCount;
+	int32 gravitySourceCount;
+	int32 contactCount;
+};
+
+static void b2WriteShape(b2Snapshot* snapshot, const b2Shape* shape)
+{
+	snapshot->Write(shape->m_type);
+	snapshot->Write(shape->m_radius);
+
+	switch (shape->m_type)
+	{
+	case b2Shape::e_circle:
+		{
+			const b2CircleShape* circle = (const b2CircleShape*)shape;
+			snapshot->Write(circle->m_p);
+		}
+		break;
+
+	case b2Shape::e_edge:
+		{
+			const b2EdgeShape* edge = (const b2EdgeShape*)shape;
+			snapshot->Write(edge->m_vertex0);
+			snapshot->Write(edge->m_vertex1);
+			snapshot->Write(edge->m_vertex2);
+			snapshot->Write(edge->m_vertex3);
+			snapshot->Write(edge->m_hasVertex0);
+			snapshot->Write(edge->m_hasVertex3);
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			const b2PolygonShape* poly = (const b2PolygonShape*)shape;
+			snapshot->Write(poly->m_centroid);
+			snapshot->Write(poly->m_vertexCount);
+			snapshot->Write(poly->m_vertices, poly->m_vertexCount * sizeof(b2Vec2));
+			snapshot->Write(poly->m_normals, poly->m_vertexCount * sizeof(b2Vec2));
+		}
+		break;
+
+	case b2Shape::e_chain:
+		{
+			const b2ChainShape* chain = (const b2ChainShape*)shape;
+			snapshot->Write(chain->m_count);
+			snapshot->Write(chain->m_vertices, chain->m_count * sizeof(b2Vec2));
+			snapshot->Write(chain->m_prevVertex);
+			snapshot->Write(chain->m_nextVertex);
+			snapshot->Write(chain->m_hasPrevVertex);
+			snapshot->Write(chain->m_hasNextVertex);
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		break;
+	}
+}
+
+// The state the solver starts from is checked for non-finite values, which a
+// damaged snapshot would otherwise feed straight into the first step.
+static bool b2IsSweepValid(const b2Sweep& sweep)
+{
+	return sweep.localCenter.IsValid() && sweep.c0.IsValid() && sweep.c.IsValid() &&
+		b2IsValid(sweep.a0) && b2IsValid(sweep.a) && 0.0f <= sweep.alpha0 && sweep.alpha0 < 1.0f;
+}
+
+static bool b2IsManifoldValid(const b2Manifold& manifold)
+{
+	if (manifold.pointCount < 0 || manifold.pointCount > b2_maxManifoldPoints)
+	{
+		return false;
+	}
+
+	// The rest is left unset while there are no points.
+	if (manifold.pointCount == 0)
+	{
+		return true;
+	}
+
+	if (manifold.type < b2Manifold::e_circles || manifold.type > b2Manifold::e_faceB ||
+		manifold.localNormal.IsValid() == false || manifold.localPoint.IsValid() == false)
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < manifold.pointCount; ++i)
+	{
+		const b2ManifoldPoint* mp = manifold.points + i;
+		if (mp->localPoint.IsValid() == false || b2IsValid(mp->normalImpulse) == false ||
+			mp->normalImpulse < 0.0f || b2IsValid(mp->tangentImpulse) == false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool b2AreValid(const float32* values, int32 count)
+{
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (b2IsValid(values[i]) == false)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Masses, inverse masses and the like can't be negative.
+static bool b2AreNonNegative(const float32* values, int32 count)
+{
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (b2IsValid(values[i]) == false || values[i] < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// A polygon must still be convex with unit outward normals, which the collision
+// and time of impact code assume.
+static bool b2IsPolygonValid(const b2PolygonShape* poly)
+{
+	const float32 k_tolerance = 1.0e-3f;
+	int32 count = poly->m_vertexCount;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Vec2 v1 = poly->m_vertices[i];
+		b2Vec2 edge = poly->m_vertices[i + 1 < count ? i + 1 : 0] - v1;
+		b2Vec2 normal = poly->m_normals[i];
+		float32 length = edge.Length();
+		if (b2IsValid(length) == false || length <= b2_epsilon || b2Abs(normal.LengthSquared() - 1.0f) > k_tolerance ||
+			b2Abs(b2Dot(normal, edge)) > k_tolerance * length || b2Cross(edge, normal) >= 0.0f)
+		{
+			return false;
+		}
 
-					// Add the contact to the island
-					contact->m_flags |= b2Contact::e_islandFlag;
-					island.Add(contact);
+		for (int32 j = 0; j < count; ++j)
+		{
+			if (b2Dot(normal, poly->m_vertices[j] - v1) > b2_linearSlop)
+			{
+				return false;
+			}
+		}
+	}
 
-					// Has the other body already been added to the island?
-					if (other->m_flags & b2Body::e_islandFlag)
-					{
-						continue;
-					}
-					
-					// Add the other body to the island.
-					other->m_flags |= b2Body::e_islandFlag;
+	return true;
+}
 
-					if (other->m_type != b2_staticBody)
-					{
-						other->SetAwake(true);
-					}
+// Read a shape into the matching member of the caller's storage. Chain vertices
+// are allocated with b2Alloc and freed by the chain destructor.
+static b2Shape* b2ReadShape(b2SnapshotReader* reader, b2CircleShape* circle, b2EdgeShape* edge,
+							b2PolygonShape* poly, b2ChainShape* chain)
+{
+	b2Shape::Type type;
+	float32 radius;
+	reader->Read(&type);
+	reader->Read(&radius);
 
-					island.Add(other);
-				}
-			}
+	b2Shape* shape = NULL;
+	switch (type)
+	{
+	case b2Shape::e_circle:
+		reader->Read(&circle->m_p);
+		if (circle->m_p.IsValid() == false)
+		{
+			reader->Invalidate();
+			return NULL;
 		}
+		shape = circle;
+		break;
 
-		b2TimeStep subStep;
-		subStep.dt = (1.0f - minAlpha) * step.dt;
-		subStep.inv_dt = 1.0f / subStep.dt;
-		subStep.dtRatio = 1.0f;
-		subStep.positionIterations = 20;
-		subStep.velocityIterations = step.velocityIterations;
-		subStep.warmStarting = false;
-		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
+	case b2Shape::e_edge:
+		reader->Read(&edge->m_vertex0);
+		reader->Read(&edge->m_vertex1);
+		reader->Read(&edge->m_vertex2);
+		reader->Read(&edge->m_vertex3);
+		reader->Read(&edge->m_hasVertex0);
+		reader->Read(&edge->m_hasVertex3);
+		if (b2AreValid((const float32*)&edge->m_vertex0, 2) == false || b2AreValid((const float32*)&edge->m_vertex1, 2) == false ||
+			b2AreValid((const float32*)&edge->m_vertex2, 2) == false || b2AreValid((const float32*)&edge->m_vertex3, 2) == false)
+		{
+			reader->Invalidate();
+			return NULL;
+		}
+		shape = edge;
+		break;
 
-		// Reset island flags and synchronize broad-phase proxies.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
+	case b2Shape::e_polygon:
+		reader->Read(&poly->m_centroid);
+		reader->Read(&poly->m_vertexCount);
+		if (poly->m_vertexCount < 3 || poly->m_vertexCount > b2_maxPolygonVertices)
+		{
+			reader->Invalidate();
+			return NULL;
+		}
+		reader->Read(poly->m_vertices, poly->m_vertexCount * sizeof(b2Vec2));
+		reader->Read(poly->m_normals, poly->m_vertexCount * sizeof(b2Vec2));
+		if (poly->m_centroid.IsValid() == false ||
+			b2AreValid((const float32*)poly->m_vertices, 2 * poly->m_vertexCount) == false ||
+			b2AreValid((const float32*)poly->m_normals, 2 * poly->m_vertexCount) == false ||
+			b2IsPolygonValid(poly) == false)
 		{
-			b2Body* body = island.m_bodies[i];
-			body->m_flags &= ~b2Body::e_islandFlag;
+			reader->Invalidate();
+			return NULL;
+		}
+		shape = poly;
+		break;
 
-			if (body->m_type != b2_dynamicBody)
+	case b2Shape::e_chain:
+		{
+			int32 count;
+			reader->Read(&count);
+			if (count < 2 || count > reader->GetRemainingSize() / (int32)sizeof(b2Vec2) || reader->IsValid() == false)
 			{
-				continue;
+				reader->Invalidate();
+				return NULL;
 			}
 
-			body->SynchronizeFixtures();
-
-			// Invalidate all contact TOIs on this displaced body.
-			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+			if (chain->m_vertices)
+			{
+				b2Free(chain->m_vertices);
+			}
+			chain->m_count = count;
+			chain->m_vertices = (b2Vec2*)b2Alloc(count * sizeof(b2Vec2));
+			reader->Read(chain->m_vertices, count * sizeof(b2Vec2));
+			reader->Read(&chain->m_prevVertex);
+			reader->Read(&chain->m_nextVertex);
+			reader->Read(&chain->m_hasPrevVertex);
+			reader->Read(&chain->m_hasNextVertex);
+			if (b2AreValid((const float32*)chain->m_vertices, 2 * count) == false ||
+				chain->m_prevVertex.IsValid() == false || chain->m_nextVertex.IsValid() == false)
 			{
-				ce->contact->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+				reader->Invalidate();
+				return NULL;
 			}
+			shape = chain;
 		}
+		break;
 
-		// Commit fixture proxy movements to the broad-phase so that new contacts are created.
-		// Also, some contacts can be destroyed.
-		m_contactManager.FindNewContacts();
+	default:
+		reader->Invalidate();
+		return NULL;
+	}
 
-		if (m_subStepping)
-		{
-			m_stepComplete = false;
-			break;
-		}
+	if (b2IsValid(radius) == false || radius < 0.0f)
+	{
+		reader->Invalidate();
+		return NULL;
 	}
+
+	shape->m_radius = radius;
+	return reader->IsValid() ? shape : NULL;
 }
 
-void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
+// Sensor overlaps refer to a fixture by its body index and its position in the
+// body's fixture list.
+static int32 b2GetFixtureIndex(const b2Fixture* fixture)
 {
-	b2Timer stepTimer;
-
-	// If new fixtures were added, we need to find the new contacts.
-	if (m_flags & e_newFixture)
+	int32 index = 0;
+	for (const b2Fixture* f = fixture->GetBody()->GetFixtureList(); f != fixture; f = f->GetNext())
 	{
-		m_contactManager.FindNewContacts();
-		m_flags &= ~e_newFixture;
+		++index;
 	}
+	return index;
+}
 
-	m_flags |= e_locked;
+static void* b2SaveUserData(b2SnapshotListener* listener, void* userData)
+{
+	return listener ? listener->SaveUserData(userData) : userData;
+}
 
-	b2TimeStep step;
-	step.dt = dt;
-	step.velocityIterations	= velocityIterations;
-	step.positionIterations = positionIterations;
-	if (dt > 0.0f)
+static void* b2RestoreUserData(b2SnapshotListener* listener, void* value)
+{
+	return listener ? listener->RestoreUserData(value) : value;
+}
+
+static b2Fixture* b2ReadFixture(b2SnapshotReader* reader, b2Body** bodies, int32 bodyCount)
+{
+	int32 bodyIndex, index;
+	reader->Read(&bodyIndex);
+	reader->Read(&index);
+	if (reader->IsValid() == false || bodyIndex < 0 || bodyIndex >= bodyCount)
 	{
-		step.inv_dt = 1.0f / dt;
+		return NULL;
 	}
-	else
+
+	b2Fixture* f = bodies[bodyIndex]->GetFixtureList();
+	for (int32 i = 0; f && i < index; ++i)
 	{
-		step.inv_dt = 0.0f;
+		f = f->GetNext();
 	}
+	return f;
+}
 
-	step.dtRatio = m_inv_dt0 * dt;
-
-	step.warmStarting = m_warmStarting;
-	
-	// Update contacts. This is where some contacts are destroyed.
+// Create a joint of the given type. Its parameters are replaced by
+// b2Joint::ReadSnapshot afterwards, so the definition defaults are fine.
+static b2Joint* b2CreateSnapshotJoint(b2World* world, b2JointType type, b2Body* bodyA, b2Body* bodyB,
+									  bool collideConnected, b2Joint* joint1, b2Joint* joint2)
+{
+	b2DistanceJointDef distanceDef;
+	b2FrictionJointDef frictionDef;
+	b2GearJointDef gearDef;
+	b2MouseJointDef mouseDef;
+	b2PrismaticJointDef prismaticDef;
+	b2PulleyJointDef pulleyDef;
+	b2RevoluteJointDef revoluteDef;
+	b2RopeJointDef ropeDef;
+	b2WeldJointDef weldDef;
+	b2WheelJointDef wheelDef;
+
+	b2JointDef* def = NULL;
+	switch (type)
 	{
-		b2Timer timer;
-		m_contactManager.Collide();
-		m_profile.collide = timer.GetMilliseconds();
+	case e_distanceJoint:
+		def = &distanceDef;
+		break;
+
+	case e_frictionJoint:
+		def = &frictionDef;
+		break;
+
+	case e_gearJoint:
+		if (joint1 == NULL || joint2 == NULL)
+		{
+			return NULL;
+		}
+		gearDef.joint1 = joint1;
+		gearDef.joint2 = joint2;
+		def = &gearDef;
+		break;
+
+	case e_mouseJoint:
+		def = &mouseDef;
+		break;
+
+	case e_prismaticJoint:
+		def = &prismaticDef;
+		break;
+
+	case e_pulleyJoint:
+		def = &pulleyDef;
+		break;
+
+	case e_revoluteJoint:
+		def = &revoluteDef;
+		break;
+
+	case e_ropeJoint:
+		def = &ropeDef;
+		break;
+
+	case e_weldJoint:
+		def = &weldDef;
+		break;
+
+	case e_wheelJoint:
+		def = &wheelDef;
+		break;
+
+	default:
+		return NULL;
 	}
 
-	// Integrate velocities, solve velocity constraints, and integrate positions.
-	if (m_stepComplete && step.dt > 0.0f)
+	def->bodyA = bodyA;
+	def->bodyB = bodyB;
+	def->collideConnected = collideConnected;
+	return world->CreateJoint(def);
+}
+
+void b2World::SaveSnapshot(b2Snapshot* snapshot)
+{
+	b2Assert(IsLocked() == false);
+	snapshot->Clear();
+	if (IsLocked())
 	{
-		b2Timer timer;
-		Solve(step);
-		m_profile.solve = timer.GetMilliseconds();
+		return;
 	}
 
-	// Handle TOI events.
-	if (m_continuousPhysics && step.dt > 0.0f)
+	b2SnapshotHeader header;
+	header.magic = b2_snapshotMagic;
+	header.version = b2_snapshotVersion;
+	header.pointerSize = sizeof(void*);
+	header.broadPhaseType = m_contactManager.m_broadPhase.GetType();
+	header.bodyCount = m_bodyCount;
+	header.jointCount = m_jointCount;
+	header.gravitySourceCount = m_gravitySourceCount;
+	header.contactCount = m_contactManager.m_contactCount;
+	snapshot->Write(header);
+
+	snapshot->Write(m_flags);
+	snapshot->Write(m_gravity);
+	snapshot->Write(m_allowSleep);
+	snapshot->Write(m_warmStarting);
+	snapshot->Write(m_continuousPhysics);
+	snapshot->Write(m_subStepping);
+	snapshot->Write(m_nbodyGravity);
+	snapshot->Write(m_nbodyTheta);
+	snapshot->Write(m_lodEnabled);
+	snapshot->Write(m_lodDef);
+	snapshot->Write(m_focusPoints);
+	snapshot->Write(m_focusPointCount);
+	snapshot->Write(m_lodStepCount);
+	snapshot->Write(m_stepComplete);
+	snapshot->Write(m_inv_dt0);
+	snapshot->Write(m_contactManager.m_filterProxies);
+	snapshot->Write(m_contactManager.m_sensorEvents);
+
+	m_contactManager.m_broadPhase.WriteSnapshot(snapshot);
+
+	// The lists are built by prepending, so they are written oldest first and
+	// rebuilt in the same order on restore.
+	b2Body* lastBody = m_bodyList;
+	while (lastBody && lastBody->m_next)
 	{
-		b2Timer timer;
-		SolveTOI(step);
-		m_profile.solveTOI = timer.GetMilliseconds();
+		lastBody = lastBody->m_next;
 	}
 
-	if (step.dt > 0.0f)
+	int32 index = 0;
+	for (b2Body* b = lastBody; b; b = b->m_prev)
 	{
-		m_inv_dt0 = step.inv_dt;
+		b->m_islandIndex = index++;
+
+		snapshot->Write(b->m_type);
+		snapshot->Write(b->m_flags);
+		snapshot->Write(b->m_xf);
+		snapshot->Write(b->m_sweep);
+		snapshot->Write(b->m_storeIndex);
+		snapshot->Write(b->m_mass);
+		snapshot->Write(b->m_I);
+		snapshot->Write(b2SaveUserData(m_snapshotListener, b->m_userData));
+		snapshot->Write(b->m_fixtureCount);
+
+		// The fixture list is singly linked, so it is written in list order and
+		// rebuilt by appending.
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			b2WriteShape(snapshot, f->m_shape);
+			snapshot->Write(f->m_density);
+			snapshot->Write(f->m_friction);
+			snapshot->Write(f->m_restitution);
+			snapshot->Write(f->m_filter);
+			snapshot->Write(f->m_isSensor);
+			snapshot->Write(b2SaveUserData(m_snapshotListener, f->m_userData));
+			snapshot->Write(f->m_proxyCount);
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				snapshot->Write(f->m_proxies[i].aabb);
+				snapshot->Write(f->m_proxies[i].proxyId);
+			}
+		}
 	}
 
-	if (m_flags & e_clearForces)
+	// The hot body state, in store slot order.
+	int32 count = m_bodyStore.m_count;
+	snapshot->Write(m_bodyStore.m_linearVelocities, count * sizeof(b2Vec2));
+	snapshot->Write(m_bodyStore.m_angularVelocities, count * sizeof(float32));
+	snapshot->Write(m_bodyStore.m_forces, count * sizeof(b2Vec2));
+	snapshot->Write(m_bodyStore.m_torques, count * sizeof(float32));
+	snapshot->Write(m_bodyStore.m_invMasses, count * sizeof(float32));
+	snapshot->Write(m_bodyStore.m_invIs, count * sizeof(float32));
+	snapshot->Write(m_bodyStore.m_linearDampings, count * sizeof(float32));
+	snapshot->Write(m_bodyStore.m_angularDampings, count * sizeof(float32));
+	snapshot->Write(m_bodyStore.m_gravityScales, count * sizeof(float32));
+	snapshot->Write(m_bodyStore.m_sleepTimes, count * sizeof(float32));
+
+	b2Joint* lastJoint = m_jointList;
+	while (lastJoint && lastJoint->m_next)
 	{
-		ClearForces();
+		lastJoint = lastJoint->m_next;
 	}
 
-	m_flags &= ~e_locked;
+	index = 0;
+	for (b2Joint* j = lastJoint; j; j = j->m_prev)
+	{
+		j->m_index = index++;
 
-	m_profile.step = stepTimer.GetMilliseconds();
-}
+		snapshot->Write(j->m_type);
+		snapshot->Write(j->m_bodyA->m_islandIndex);
+		snapshot->Write(j->m_bodyB->m_islandIndex);
+		snapshot->Write(j->m_collideConnected);
+		snapshot->Write(b2SaveUserData(m_snapshotListener, j->m_userData));
 
-void b2World::ClearForces()
-{
-	for (b2Body* body = m_bodyList; body; body = body->GetNext())
-	{
-		body->m_force.SetZero();
-		body->m_torque = 0.0f;
+		if (j->m_type == e_gearJoint)
+		{
+			// A gear joint is always created after the joints it connects.
+			b2GearJoint* gear = (b2GearJoint*)j;
+			snapshot->Write(gear->GetJoint1()->m_index);
+			snapshot->Write(gear->GetJoint2()->m_index);
+		}
+
+		j->WriteSnapshot(snapshot);
 	}
-}
 
-struct b2WorldQueryWrapper
-{
-	bool QueryCallback(int32 proxyId)
+	b2GravitySource* lastSource = m_gravitySourceList;
+	while (lastSource && lastSource->m_next)
 	{
-		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
-		return callback->ReportFixture(proxy->fixture);
+		lastSource = lastSource->m_next;
 	}
 
-	const b2BroadPhase* broadPhase;
-	b2QueryCallback* callback;
-};
+	for (b2GravitySource* gs = lastSource; gs; gs = gs->m_prev)
+	{
+		int32 bodyIndex = gs->m_body ? gs->m_body->m_islandIndex : -1;
+		snapshot->Write(bodyIndex);
+		snapshot->Write(gs->m_center);
+		snapshot->Write(gs->m_strength);
+		snapshot->Write(gs->m_falloff);
+		snapshot->Write(gs->m_radius);
+		snapshot->Write(gs->m_minRadius);
+		snapshot->Write(b2SaveUserData(m_snapshotListener, gs->m_userData));
+	}
 
-void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
-{
-	b2WorldQueryWrapper wrapper;
-	wrapper.broadPhase = &m_contactManager.m_broadPhase;
-	wrapper.callback = callback;
-	m_contactManager.m_broadPhase.Query(&wrapper, aabb);
-}
+	b2Contact* lastContact = m_contactManager.m_contactList;
+	while (lastContact && lastContact->m_next)
+	{
+		lastContact = lastContact->m_next;
+	}
 
-struct b2WorldRayCastWrapper
-{
-	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	// Contacts refer to fixture children by broad-phase proxy id.
+	for (b2Contact* c = lastContact; c; c = c->m_prev)
 	{
-		void* userData = broadPhase->GetUserData(proxyId);
-		b2FixtureProxy* proxy = (b2FixtureProxy*)userData;
-		b2Fixture* fixture = proxy->fixture;
-		int32 index = proxy->childIndex;
-		b2RayCastOutput output;
-		bool hit = fixture->RayCast(&output, input, index);
+		snapshot->Write(c->m_fixtureA->m_proxies[c->m_indexA].proxyId);
+		snapshot->Write(c->m_fixtureB->m_proxies[c->m_indexB].proxyId);
+		snapshot->Write(c->m_flags);
+		snapshot->Write(c->m_manifold);
+		snapshot->Write(c->m_toiCount);
+		snapshot->Write(c->m_toi);
+		snapshot->Write(c->m_friction);
+		snapshot->Write(c->m_restitution);
+	}
 
-		if (hit)
+	snapshot->Write(m_sensorManager.m_sensorCount);
+	for (int32 i = 0; i < m_sensorManager.m_sensorCount; ++i)
+	{
+		const b2Sensor* sensor = m_sensorManager.m_sensors + i;
+		snapshot->Write(sensor->fixture->m_body->m_islandIndex);
+		snapshot->Write(b2GetFixtureIndex(sensor->fixture));
+		snapshot->Write(sensor->overlapCount);
+		for (int32 k = 0; k < sensor->overlapCount; ++k)
 		{
-			float32 fraction = output.fraction;
-			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
-			return callback->ReportFixture(fixture, point, output.normal, fraction);
+			b2Fixture* visitor = sensor->overlaps[k].fixture;
+			snapshot->Write(visitor->m_body->m_islandIndex);
+			snapshot->Write(b2GetFixtureIndex(visitor));
 		}
-
-		return input.maxFraction;
 	}
+}
 
-	const b2BroadPhase* broadPhase;
-	b2RayCastCallback* callback;
-};
-
-void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const
+bool b2World::RestoreSnapshot(const b2Snapshot& snapshot)
 {
-	b2WorldRayCastWrapper wrapper;
-	wrapper.broadPhase = &m_contactManager.m_broadPhase;
-	wrapper.callback = callback;
-	b2RayCastInput input;
-	input.maxFraction = 1.0f;
-	input.p1 = point1;
-	input.p2 = point2;
-	m_contactManager.m_broadPhase.RayCast(&wrapper, input);
+	return RestoreSnapshot(snapshot.GetData(), snapshot.GetSize());
 }
 
-void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color& color)
+bool b2World::RestoreSnapshot(const void* data, int32 size)
 {
-	switch (fixture->GetType())
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
 	{
-	case b2Shape::e_circle:
-		{
-			b2CircleShape* circle = (b2CircleShape*)fixture->GetShape();
-
-			b2Vec2 center = b2Mul(xf, circle->m_p);
-			float32 radius = circle->m_radius;
-			b2Vec2 axis = b2Mul(xf.q, b2Vec2(1.0f, 0.0f));
+		return false;
+	}
 
-			m_debugDraw->DrawSolidCircle(center, radius, axis, color);
-		}
-		break;
+	// Read into the spare world, so damaged data never touches this one. The
+	// spare keeps its memory, so rollbacks restoring every frame just trade
+	// the same blocks back and forth.
+	if (m_restoreWorld == NULL)
+	{
+		void* mem = b2Alloc(sizeof(b2World));
+		m_restoreWorld = new (mem) b2World(m_gravity, m_contactManager.m_broadPhase.GetType());
+	}
 
-	case b2Shape::e_edge:
-		{
-			b2EdgeShape* edge = (b2EdgeShape*)fixture->GetShape();
-			b2Vec2 v1 = b2Mul(xf, edge->m_vertex1);
-			b2Vec2 v2 = b2Mul(xf, edge->m_vertex2);
-			m_debugDraw->DrawSegment(v1, v2, color);
-		}
-		break;
+	m_restoreWorld->m_snapshotListener = m_snapshotListener;
+	m_restoreWorld->m_blockAllocator.SetThreadCaching(m_blockAllocator.GetThreadCaching());
+	if (m_restoreWorld->ReadSnapshot(data, size) == false)
+	{
+		return false;
+	}
 
-	case b2Shape::e_chain:
-		{
-			b2ChainShape* chain = (b2ChainShape*)fixture->GetShape();
-			int32 count = chain->m_count;
-			const b2Vec2* vertices = chain->m_vertices;
+	SwapContents(m_restoreWorld);
+	m_restoreWorld->ClearContents();
+	return true;
+}
 
-			b2Vec2 v1 = b2Mul(xf, vertices[0]);
-			for (int32 i = 1; i < count; ++i)
-			{
-				b2Vec2 v2 = b2Mul(xf, vertices[i]);
-				m_debugDraw->DrawSegment(v1, v2, color);
-				m_debugDraw->DrawCircle(v1, 0.05f, color);
-				v1 = v2;
-			}
-		}
-		break;
+// Replace the contents with a snapshot. Malformed data leaves the world empty.
+bool b2World::ReadSnapshot(const void* data, int32 size)
+{
+	b2SnapshotReader reader(data, size);
+
+	b2SnapshotHeader header;
+	reader.Read(&header);
+	if (reader.IsValid() == false || header.magic != b2_snapshotMagic ||
+		header.version != b2_snapshotVersion || header.pointerSize != (int32)sizeof(void*) ||
+		header.broadPhaseType != m_contactManager.m_broadPhase.GetType() ||
+		header.bodyCount < 0 || header.jointCount < 0 || header.gravitySourceCount < 0 ||
+		header.contactCount < 0)
+	{
+		return false;
+	}
 
-	case b2Shape::e_polygon:
-		{
-			b2PolygonShape* poly = (b2PolygonShape*)fixture->GetShape();
-			int32 vertexCount = poly->m_vertexCount;
-			b2Assert(vertexCount <= b2_maxPolygonVertices);
-			b2Vec2 vertices[b2_maxPolygonVertices];
+	// Each body and joint record is larger than a pointer, which bounds the counts
+	// by the bytes left before the index arrays are allocated.
+	if (header.bodyCount > reader.GetRemainingSize() / (int32)sizeof(b2Body*) ||
+		header.jointCount > reader.GetRemainingSize() / (int32)sizeof(b2Joint*))
+	{
+		return false;
+	}
 
-			for (int32 i = 0; i < vertexCount; ++i)
-			{
-				vertices[i] = b2Mul(xf, poly->m_vertices[i]);
-			}
+	DestroyContents();
 
-			m_debugDraw->DrawSolidPolygon(vertices, vertexCount, color);
-		}
-		break;
-            
-    default:
-        break;
+	reader.Read(&m_flags);
+	m_flags &= ~e_locked;
+	reader.Read(&m_gravity);
+	reader.Read(&m_allowSleep);
+	reader.Read(&m_warmStarting);
+	reader.Read(&m_continuousPhysics);
+	reader.Read(&m_subStepping);
+	reader.Read(&m_nbodyGravity);
+	reader.Read(&m_nbodyTheta);
+	reader.Read(&m_lodEnabled);
+	reader.Read(&m_lodDef);
+	reader.Read(&m_focusPoints);
+	reader.Read(&m_focusPointCount);
+	reader.Read(&m_lodStepCount);
+	reader.Read(&m_stepComplete);
+	reader.Read(&m_inv_dt0);
+	reader.Read(&m_contactManager.m_filterProxies);
+	reader.Read(&m_contactManager.m_sensorEvents);
+
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	bool valid = broadPhase->ReadSnapshot(&reader);
+
+	if (m_focusPointCount < 0 || m_focusPointCount > b2_maxFocusPoints || m_lodDef.reducedInterval < 1 ||
+		b2AreNonNegative(&m_lodDef.activeRadius, 1) == false || b2AreNonNegative(&m_lodDef.reducedRadius, 1) == false ||
+		b2AreValid((const float32*)m_focusPoints, 2 * m_focusPointCount) == false)
+	{
+		m_lodEnabled = false;
+		m_focusPointCount = 0;
+		m_lodDef = b2SimulationLODDef();
+		valid = false;
 	}
-}
 
-void b2World::DrawJoint(b2Joint* joint)
-{
-	b2Body* bodyA = joint->GetBodyA();
-	b2Body* bodyB = joint->GetBodyB();
-	const b2Transform& xf1 = bodyA->GetTransform();
-	const b2Transform& xf2 = bodyB->GetTransform();
-	b2Vec2 x1 = xf1.p;
-	b2Vec2 x2 = xf2.p;
-	b2Vec2 p1 = joint->GetAnchorA();
-	b2Vec2 p2 = joint->GetAnchorB();
+	// The warm starting impulses are scaled by m_inv_dt0, so a negative one would
+	// start the solver from negative impulses.
+	if (m_gravity.IsValid() == false || b2AreNonNegative(&m_nbodyTheta, 1) == false ||
+		b2AreNonNegative(&m_inv_dt0, 1) == false)
+	{
+		m_gravity.SetZero();
+		m_nbodyTheta = 0.5f;
+		m_inv_dt0 = 0.0f;
+		valid = false;
+	}
 
-	b2Color color(0.5f, 0.8f, 0.8f);
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(header.bodyCount * sizeof(b2Body*));
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate(header.jointCount * sizeof(b2Joint*));
 
-	switch (joint->GetType())
+	b2CircleShape circle;
+	b2EdgeShape edge;
+	b2PolygonShape poly;
+	b2ChainShape chain;
+
+	// Every proxy in the broad-phase must be claimed by exactly one fixture.
+	int32 claimedProxyCount = 0;
+
+	b2BodyDef bd;
+	for (int32 i = 0; valid && i < header.bodyCount; ++i)
 	{
-	case e_distanceJoint:
-		m_debugDraw->DrawSegment(p1, p2, color);
-		break;
+		void* mem = m_blockAllocator.Allocate(sizeof(b2Body));
+		b2Body* b = new (mem) b2Body(&bd, this);
 
-	case e_pulleyJoint:
+		b->m_prev = NULL;
+		b->m_next = m_bodyList;
+		if (m_bodyList)
 		{
-			b2PulleyJoint* pulley = (b2PulleyJoint*)joint;
-			b2Vec2 s1 = pulley->GetGroundAnchorA();
-			b2Vec2 s2 = pulley->GetGroundAnchorB();
-			m_debugDraw->DrawSegment(s1, p1, color);
-			m_debugDraw->DrawSegment(s2, p2, color);
-			m_debugDraw->DrawSegment(s1, s2, color);
+			m_bodyList->m_prev = b;
+		}
+		m_bodyList = b;
+		++m_bodyCount;
+		bodies[i] = b;
+
+		int32 fixtureCount;
+		reader.Read(&b->m_type);
+		reader.Read(&b->m_flags);
+		reader.Read(&b->m_xf);
+		reader.Read(&b->m_sweep);
+		reader.Read(&b->m_storeIndex);
+		reader.Read(&b->m_mass);
+		reader.Read(&b->m_I);
+		reader.Read(&b->m_userData);
+		reader.Read(&fixtureCount);
+		if (reader.IsValid() == false || b->m_type < b2_staticBody || b->m_type > b2_dynamicBody ||
+			b->m_storeIndex < 0 || b->m_storeIndex >= header.bodyCount ||
+			b->m_xf.p.IsValid() == false || b2IsValid(b->m_xf.q.s) == false || b2IsValid(b->m_xf.q.c) == false ||
+			b2AreNonNegative(&b->m_mass, 1) == false || b2AreNonNegative(&b->m_I, 1) == false || b2IsSweepValid(b->m_sweep) == false)
+		{
+			valid = false;
+			break;
 		}
-		break;
 
-	case e_mouseJoint:
-		// don't draw this
-		break;
+		b->m_userData = b2RestoreUserData(m_snapshotListener, b->m_userData);
 
-	default:
-		m_debugDraw->DrawSegment(x1, p1, color);
-		m_debugDraw->DrawSegment(p1, p2, color);
-		m_debugDraw->DrawSegment(x2, p2, color);
+		b2Fixture* lastFixture = NULL;
+		for (int32 k = 0; k < fixtureCount; ++k)
+		{
+			b2FixtureDef fd;
+			fd.shape = b2ReadShape(&reader, &circle, &edge, &poly, &chain);
+			reader.Read(&fd.density);
+			reader.Read(&fd.friction);
+			reader.Read(&fd.restitution);
+			reader.Read(&fd.filter);
+			reader.Read(&fd.isSensor);
+			reader.Read(&fd.userData);
+
+			int32 proxyCount;
+			reader.Read(&proxyCount);
+			// Only the fixtures of active bodies have proxies.
+			if (reader.IsValid() == false || fd.shape == NULL ||
+				proxyCount != (b->IsActive() ? fd.shape->GetChildCount() : 0))
+			{
+				valid = false;
+				break;
+			}
+
+			fd.userData = b2RestoreUserData(m_snapshotListener, fd.userData);
+
+			void* fixtureMem = m_blockAllocator.Allocate(sizeof(b2Fixture));
+			b2Fixture* fixture = new (fixtureMem) b2Fixture;
+			fixture->Create(&m_blockAllocator, b, &fd);
+			fixture->m_next = NULL;
+			if (lastFixture)
+			{
+				lastFixture->m_next = fixture;
+			}
+			else
+			{
+				b->m_fixtureList = fixture;
+			}
+			lastFixture = fixture;
+			++b->m_fixtureCount;
+
+			for (int32 n = 0; n < proxyCount; ++n)
+			{
+				b2FixtureProxy* proxy = fixture->m_proxies + n;
+				reader.Read(&proxy->aabb);
+				reader.Read(&proxy->proxyId);
+				proxy->fixture = fixture;
+				proxy->childIndex = n;
+				if (reader.IsValid() == false || proxy->aabb.IsValid() == false || broadPhase->IsProxyValid(proxy->proxyId) == false ||
+					broadPhase->GetUserData(proxy->proxyId) != NULL)
+				{
+					valid = false;
+					break;
+				}
+
+				broadPhase->SetUserData(proxy->proxyId, proxy);
+				++claimedProxyCount;
+			}
+			fixture->m_proxyCount = proxyCount;
+
+			if (valid == false)
+			{
+				break;
+			}
+		}
 	}
-}
 
-void b2World::DrawDebugData()
-{
-	if (m_debugDraw == NULL)
+	if (valid && claimedProxyCount != broadPhase->GetProxyCount())
 	{
-		return;
+		valid = false;
 	}
 
-	uint32 flags = m_debugDraw->GetFlags();
+	if (valid)
+	{
+		// Put each body back in its saved store slot, then load the hot state.
+		b2Assert(m_bodyStore.m_count == header.bodyCount);
+		memset(m_bodyStore.m_bodies, 0, header.bodyCount * sizeof(b2Body*));
+		for (int32 i = 0; i < header.bodyCount; ++i)
+		{
+			b2Body* b = bodies[i];
+			if (m_bodyStore.m_bodies[b->m_storeIndex] != NULL)
+			{
+				valid = false;
+				break;
+			}
+			m_bodyStore.m_bodies[b->m_storeIndex] = b;
+		}
 
-	if (flags & b2Draw::e_shapeBit)
+		int32 count = m_bodyStore.m_count;
+		reader.Read(m_bodyStore.m_linearVelocities, count * sizeof(b2Vec2));
+		reader.Read(m_bodyStore.m_angularVelocities, count * sizeof(float32));
+		reader.Read(m_bodyStore.m_forces, count * sizeof(b2Vec2));
+		reader.Read(m_bodyStore.m_torques, count * sizeof(float32));
+		reader.Read(m_bodyStore.m_invMasses, count * sizeof(float32));
+		reader.Read(m_bodyStore.m_invIs, count * sizeof(float32));
+		reader.Read(m_bodyStore.m_linearDampings, count * sizeof(float32));
+		reader.Read(m_bodyStore.m_angularDampings, count * sizeof(float32));
+		reader.Read(m_bodyStore.m_gravityScales, count * sizeof(float32));
+		reader.Read(m_bodyStore.m_sleepTimes, count * sizeof(float32));
+		valid = valid && reader.IsValid();
+		valid = valid && b2AreValid((const float32*)m_bodyStore.m_linearVelocities, 2 * count) &&
+			b2AreValid(m_bodyStore.m_angularVelocities, count) && b2AreValid((const float32*)m_bodyStore.m_forces, 2 * count) &&
+			b2AreValid(m_bodyStore.m_torques, count) && b2AreNonNegative(m_bodyStore.m_invMasses, count) &&
+			b2AreNonNegative(m_bodyStore.m_invIs, count);
+	}
+
+	for (int32 i = 0; valid && i < header.jointCount; ++i)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		b2JointType type;
+		int32 indexA, indexB;
+		bool collideConnected;
+		void* userData;
+		reader.Read(&type);
+		reader.Read(&indexA);
+		reader.Read(&indexB);
+		reader.Read(&collideConnected);
+		reader.Read(&userData);
+
+		b2Joint* joint1 = NULL;
+		b2Joint* joint2 = NULL;
+		if (type == e_gearJoint)
 		{
-			const b2Transform& xf = b->GetTransform();
-			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			int32 index1, index2;
+			reader.Read(&index1);
+			reader.Read(&index2);
+			if (0 <= index1 && index1 < i && 0 <= index2 && index2 < i)
 			{
-				if (b->IsActive() == false)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.5f, 0.3f));
-				}
-				else if (b->GetType() == b2_staticBody)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.9f, 0.5f));
-				}
-				else if (b->GetType() == b2_kinematicBody)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.5f, 0.9f));
-				}
-				else if (b->IsAwake() == false)
-				{
-					DrawShape(f, xf, b2Color(0.6f, 0.6f, 0.6f));
-				}
-				else
-				{
-					DrawShape(f, xf, b2Color(0.9f, 0.7f, 0.7f));
-				}
+				joint1 = joints[index1];
+				joint2 = joints[index2];
+			}
+
+			// A gear joint can only couple revolute and prismatic joints.
+			if (joint1 && joint1->GetType() != e_revoluteJoint && joint1->GetType() != e_prismaticJoint)
+			{
+				joint1 = NULL;
+			}
+			if (joint2 && joint2->GetType() != e_revoluteJoint && joint2->GetType() != e_prismaticJoint)
+			{
+				joint2 = NULL;
 			}
 		}
+
+		if (reader.IsValid() == false || indexA < 0 || indexA >= header.bodyCount ||
+			indexB < 0 || indexB >= header.bodyCount || indexA == indexB)
+		{
+			valid = false;
+			break;
+		}
+
+		b2Joint* joint = b2CreateSnapshotJoint(this, type, bodies[indexA], bodies[indexB], collideConnected, joint1, joint2);
+		if (joint == NULL)
+		{
+			valid = false;
+			break;
+		}
+
+		joint->m_userData = b2RestoreUserData(m_snapshotListener, userData);
+		joint->ReadSnapshot(&reader);
+		joints[i] = joint;
 	}
 
-	if (flags & b2Draw::e_jointBit)
+	for (int32 i = 0; valid && i < header.gravitySourceCount; ++i)
 	{
-		for (b2Joint* j = m_jointList; j; j = j->GetNext())
+		int32 bodyIndex;
+		b2GravitySourceDef def;
+		reader.Read(&bodyIndex);
+		reader.Read(&def.center);
+		reader.Read(&def.strength);
+		reader.Read(&def.falloff);
+		reader.Read(&def.radius);
+		reader.Read(&def.minRadius);
+		reader.Read(&def.userData);
+		if (reader.IsValid() == false || bodyIndex < -1 || bodyIndex >= header.bodyCount ||
+			def.radius < 0.0f || def.minRadius <= 0.0f)
 		{
-			DrawJoint(j);
+			valid = false;
+			break;
 		}
+
+		def.body = bodyIndex >= 0 ? bodies[bodyIndex] : NULL;
+		def.userData = b2RestoreUserData(m_snapshotListener, def.userData);
+		CreateGravitySource(&def);
 	}
 
-	if (flags & b2Draw::e_pairBit)
+	for (int32 i = 0; valid && i < header.contactCount; ++i)
 	{
-		b2Color color(0.3f, 0.9f, 0.9f);
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->GetNext())
+		int32 proxyIdA, proxyIdB;
+		reader.Read(&proxyIdA);
+		reader.Read(&proxyIdB);
+		if (reader.IsValid() == false || broadPhase->IsProxyValid(proxyIdA) == false ||
+			broadPhase->IsProxyValid(proxyIdB) == false)
 		{
-			//b2Fixture* fixtureA = c->GetFixtureA();
-			//b2Fixture* fixtureB = c->GetFixtureB();
+			valid = false;
+			break;
+		}
 
-			//b2Vec2 cA = fixtureA->GetAABB().GetCenter();
-			//b2Vec2 cB = fixtureB->GetAABB().GetCenter();
+		b2FixtureProxy* proxyA = (b2FixtureProxy*)broadPhase->GetUserData(proxyIdA);
+		b2FixtureProxy* proxyB = (b2FixtureProxy*)broadPhase->GetUserData(proxyIdB);
+		if (proxyA == NULL || proxyB == NULL || proxyA->fixture->m_body == proxyB->fixture->m_body ||
+			proxyB->fixture->m_body->ShouldCollide(proxyA->fixture->m_body) == false)
+		{
+			valid = false;
+			break;
+		}
 
-			//m_debugDraw->DrawSegment(cA, cB, color);
+		b2Contact* c = b2Contact::Create(proxyA->fixture, proxyA->childIndex, proxyB->fixture, proxyB->childIndex, &m_blockAllocator);
+		if (c == NULL)
+		{
+			valid = false;
+			break;
+		}
+
+		m_contactManager.Insert(c);
+
+		// Saved contacts were created in primary order, so nothing was swapped.
+		if (c->m_fixtureA != proxyA->fixture)
+		{
+			valid = false;
+			break;
+		}
+
+		reader.Read(&c->m_flags);
+		reader.Read(&c->m_manifold);
+
+		// The bodies were just rebuilt.
+		c->m_flags &= ~b2Contact::e_constraintCacheFlag;
+		reader.Read(&c->m_toiCount);
+		reader.Read(&c->m_toi);
+		reader.Read(&c->m_friction);
+		reader.Read(&c->m_restitution);
+		// The time of impact is only set while the flag is.
+		bool toiValid = (c->m_flags & b2Contact::e_toiFlag) == 0 || (0.0f <= c->m_toi && c->m_toi <= 1.0f);
+		if (b2IsManifoldValid(c->m_manifold) == false || toiValid == false ||
+			b2IsValid(c->m_friction) == false || b2IsValid(c->m_restitution) == false)
+		{
+			valid = false;
+			break;
 		}
 	}
 
-	if (flags & b2Draw::e_aabbBit)
+	// The sensors are added in their saved order.
+	int32 sensorCount = 0;
+	reader.Read(&sensorCount);
+	for (int32 i = 0; valid && i < sensorCount; ++i)
 	{
-		b2Color color(0.9f, 0.3f, 0.9f);
-		b2BroadPhase* bp = &m_contactManager.m_broadPhase;
+		b2Fixture* fixture = b2ReadFixture(&reader, bodies, header.bodyCount);
+		int32 overlapCount;
+		reader.Read(&overlapCount);
+		if (reader.IsValid() == false || fixture == NULL || fixture->m_isSensor == false ||
+			fixture->m_sensorIndex != b2_nullSensor || m_contactManager.m_sensorEvents == false)
+		{
+			valid = false;
+			break;
+		}
 
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		m_sensorManager.AddSensor(fixture);
+		b2Sensor* sensor = m_sensorManager.m_sensors + i;
+		for (int32 k = 0; k < overlapCount; ++k)
 		{
-			if (b->IsActive() == false)
+			b2Fixture* visitor = b2ReadFixture(&reader, bodies, header.bodyCount);
+			if (visitor == NULL)
 			{
-				continue;
+				valid = false;
+				break;
 			}
 
-			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
-			{
-				for (int32 i = 0; i < f->m_proxyCount; ++i)
-				{
-					b2FixtureProxy* proxy = f->m_proxies + i;
-					b2AABB aabb = bp->GetFatAABB(proxy->proxyId);
-					b2Vec2 vs[4];
-					vs[0].Set(aabb.lowerBound.x, aabb.lowerBound.y);
-					vs[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
-					vs[2].Set(aabb.upperBound.x, aabb.upperBound.y);
-					vs[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
-
-					m_debugDraw->DrawPolygon(vs, 4, color);
-				}
-			}
+			m_sensorManager.AddOverlap(sensor, visitor);
 		}
 	}
 
-	if (flags & b2Draw::e_centerOfMassBit)
+	valid = valid && reader.IsValid();
+
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(bodies);
+
+	if (valid == false)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
-		{
-			b2Transform xf = b->GetTransform();
-			xf.p = b->GetWorldCenter();
-			m_debugDraw->DrawTransform(xf);
-		}
+		ClearContents();
 	}
-}
 
-int32 b2World::GetProxyCount() const
-{
-	return m_contactManager.m_broadPhase.GetProxyCount();
+	return valid;
 }
 
-int32 b2World::GetTreeHeight() const
+// Swap two objects that reach their memory only through pointers and never
+// point into themselves, so their bytes can simply trade places.
+template <typename T>
+static void b2SwapBytes(T* a, T* b)
 {
-	return m_contactManager.m_broadPhase.GetTreeHeight();
+	char temp[sizeof(T)];
+	memcpy(temp, (void*)a, sizeof(T));
+	memcpy((void*)a, (void*)b, sizeof(T));
+	memcpy((void*)b, temp, sizeof(T));
 }
 
-int32 b2World::GetTreeBalance() const
+// Trade everything a snapshot holds with another world of the same broad-phase
+// type, along with the allocator the objects live in. Listeners, the debug
+// draw, the threading options and the profiler stay put.
+void b2World::SwapContents(b2World* other)
 {
-	return m_contactManager.m_broadPhase.GetTreeBalance();
-}
+	b2Assert(m_contactManager.m_broadPhase.GetType() == other->m_contactManager.m_broadPhase.GetType());
+	b2Assert(m_blockAllocator.GetThreadCaching() == other->m_blockAllocator.GetThreadCaching());
+
+	b2SwapBytes(&m_blockAllocator, &other->m_blockAllocator);
+	b2SwapBytes(&m_bodyStore, &other->m_bodyStore);
+	b2SwapBytes(&m_contactManager.m_broadPhase, &other->m_contactManager.m_broadPhase);
+	b2SwapBytes(&m_sensorManager, &other->m_sensorManager);
+	b2SwapBytes(&m_gravityTree, &other->m_gravityTree);
+	m_sensorManager.m_contactManager = &m_contactManager;
+	other->m_sensorManager.m_contactManager = &other->m_contactManager;
+
+	b2Swap(m_contactManager.m_contactList, other->m_contactManager.m_contactList);
+	b2Swap(m_contactManager.m_contactCount, other->m_contactManager.m_contactCount);
+	b2Swap(m_contactManager.m_filterProxies, other->m_contactManager.m_filterProxies);
+	b2Swap(m_contactManager.m_sensorEvents, other->m_contactManager.m_sensorEvents);
+
+	b2Swap(m_bodyList, other->m_bodyList);
+	b2Swap(m_jointList, other->m_jointList);
+	b2Swap(m_gravitySourceList, other->m_gravitySourceList);
+	b2Swap(m_bodyCount, other->m_bodyCount);
+	b2Swap(m_jointCount, other->m_jointCount);
+	b2Swap(m_gravitySourceCount, other->m_gravitySourceCount);
+
+	b2Swap(m_flags, other->m_flags);
+	b2Swap(m_gravity, other->m_gravity);
+	b2Swap(m_allowSleep, other->m_allowSleep);
+	b2Swap(m_warmStarting, other->m_warmStarting);
+	b2Swap(m_continuousPhysics, other->m_continuousPhysics);
+	b2Swap(m_subStepping, other->m_subStepping);
+	b2Swap(m_nbodyGravity, other->m_nbodyGravity);
+	b2Swap(m_nbodyTheta, other->m_nbodyTheta);
+	b2Swap(m_lodEnabled, other->m_lodEnabled);
+	b2Swap(m_lodDef, other->m_lodDef);
+	for (int32 i = 0; i < b2_maxFocusPoints; ++i)
+	{
+		b2Swap(m_focusPoints[i], other->m_focusPoints[i]);
+	}
+	b2Swap(m_focusPointCount, other->m_focusPointCount);
+	b2Swap(m_lodStepCount, other->m_lodStepCount);
+	b2Swap(m_stepComplete, other->m_stepComplete);
+	b2Swap(m_inv_dt0, other->m_inv_dt0);
 
-float32 b2World::GetTreeQuality() const
-{
-	return m_contactManager.m_broadPhase.GetTreeQuality();
-}
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_world = this;
+		b->m_store = &m_bodyStore;
+	}
 
-void b2World::Dump()
-{
-	if ((m_flags & e_locked) == e_locked)
+	for (b2Body* b = other->m_bodyList; b; b = b->m_next)
 	{
-		return;
+		b->m_world = other;
+		b->m_store = &other->m_bodyStore;
 	}
+}
 
-	b2Log("b2Vec2 g(%.15lef, %.15lef);\n", m_gravity.x, m_gravity.y);
-	b2Log("m_world->SetGravity(g);\n");
+// Free every contact, joint, fixture and body without callbacks. The broad-phase
+// proxies are left behind for the caller to replace.
+void b2World::DestroyContents()
+{
+	m_sensorManager.Clear();
 
-	b2Log("b2Body** bodies = (b2Body**)b2Alloc(%d * sizeof(b2Body*));\n", m_bodyCount);
-	b2Log("b2Joint** joints = (b2Joint**)b2Alloc(%d * sizeof(b2Joint*));\n", m_jointCount);
-	int32 i = 0;
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	b2Contact* c = m_contactManager.m_contactList;
+	while (c)
 	{
-		b->m_islandIndex = i;
-		b->Dump();
-		++i;
+		b2Contact* next = c->m_next;
+		b2Contact::Destroy(c, &m_blockAllocator);
+		c = next;
 	}
+	m_contactManager.m_contactList = NULL;
+	m_contactManager.m_contactCount = 0;
 
-	i = 0;
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	b2Joint* j = m_jointList;
+	while (j)
 	{
-		j->m_index = i;
-		++i;
+		b2Joint* next = j->m_next;
+		b2Joint::Destroy(j, &m_blockAllocator);
+		j = next;
 	}
+	m_jointList = NULL;
+	m_jointCount = 0;
 
-	// First pass on joints, skip gear joints.
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	b2GravitySource* gs = m_gravitySourceList;
+	while (gs)
 	{
-		if (j->m_type == e_gearJoint)
-		{
-			continue;
-		}
-
-		b2Log("{\n");
-		j->Dump();
-		b2Log("}\n");
+		b2GravitySource* next = gs->m_next;
+		gs->~b2GravitySource();
+		m_blockAllocator.Free(gs, sizeof(b2GravitySource));
+		gs = next;
 	}
+	m_gravitySourceList = NULL;
+	m_gravitySourceCount = 0;
 
-	// Second pass on joints, only gear joints.
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	b2Body* b = m_bodyList;
+	while (b)
 	{
-		if (j->m_type != e_gearJoint)
+		b2Body* bNext = b->m_next;
+
+		b2Fixture* f = b->m_fixtureList;
+		while (f)
 		{
-			continue;
+			b2Fixture* fNext = f->m_next;
+			f->m_proxyCount = 0;
+			f->Destroy(&m_blockAllocator);
+			f->~b2Fixture();
+			m_blockAllocator.Free(f, sizeof(b2Fixture));
+			f = fNext;
 		}
 
-		b2Log("{\n");
-		j->Dump();
-		b2Log("}\n");
+		b->~b2Body();
+		m_blockAllocator.Free(b, sizeof(b2Body));
+		b = bNext;
 	}
+	m_bodyList = NULL;
+	m_bodyCount = 0;
+	m_bodyStore.m_count = 0;
+}
 
-	b2Log("b2Free(joints);\n");
-	b2Log("b2Free(bodies);\n");
-	b2Log("joints = NULL;\n");
-	b2Log("bodies = NULL;\n");
+// Leave an empty world with a fresh broad-phase.
+void b2World::ClearContents()
+{
+	DestroyContents();
+
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	b2BroadPhaseType type = broadPhase->GetType();
+	broadPhase->~b2BroadPhase();
+	new (broadPhase) b2BroadPhase(type);
+	m_flags = e_clearForces;
 }
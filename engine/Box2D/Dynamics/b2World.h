@@ -22,19 +22,60 @@
 #include "../Common/b2Math.h"
 #include "../Common/b2BlockAllocator.h"
 #include "../Common/b2StackAllocator.h"
+#include "../Common/b2Snapshot.h"
+#include "../Dynamics/b2BodyStore.h"
 #include "../Dynamics/b2ContactManager.h"
+#include "../Dynamics/b2GravitySource.h"
+#include "../Dynamics/b2GravityTree.h"
+#include "../Dynamics/b2Profiler.h"
+#include "../Dynamics/b2SensorManager.h"
 #include "../Dynamics/b2WorldCallbacks.h"
 #include "../Dynamics/b2TimeStep.h"
 
 struct b2AABB;
 struct b2BodyDef;
 struct b2Color;
+struct b2FixtureDef;
 struct b2JointDef;
+struct b2TOIInput;
 class b2Body;
 class b2Draw;
 class b2Fixture;
+class b2Island;
 class b2Joint;
 
+/// The closest hit of one ray in a batched ray-cast. The fixture is NULL
+/// if the ray missed.
+struct b2RayCastHit
+{
+	b2Fixture* fixture;
+	b2Vec2 point;
+	b2Vec2 normal;
+	float32 fraction;
+};
+
+/// Simulation level of detail settings, see b2World::SetSimulationLOD.
+struct b2SimulationLODDef
+{
+	b2SimulationLODDef()
+	{
+		activeRadius = 50.0f;
+		reducedRadius = 100.0f;
+		reducedInterval = 4;
+	}
+
+	/// Bodies this close to a focus point are stepped every time step.
+	float32 activeRadius;
+
+	/// Bodies this close to a focus point, but outside the active radius, are
+	/// stepped every reducedInterval time steps with a step that many times longer.
+	/// Bodies farther away are frozen.
+	float32 reducedRadius;
+
+	/// The number of time steps covered by one reduced step.
+	int32 reducedInterval;
+};
+
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
 /// management facilities.
@@ -43,7 +84,8 @@ class b2World
 public:
 	/// Construct a world object.
 	/// @param gravity the world gravity vector.
-	b2World(const b2Vec2& gravity);
+	/// @param broadPhaseType the spatial structure used to find contact pairs.
+	b2World(const b2Vec2& gravity, b2BroadPhaseType broadPhaseType = b2_dynamicTreeBroadPhase);
 
 	/// Destruct the world. All physics entities are destroyed and all heap memory is released.
 	~b2World();
@@ -61,6 +103,10 @@ public:
 	/// remain in scope.
 	void SetContactListener(b2ContactListener* listener);
 
+	/// Register a snapshot listener to map user data in and out of snapshots.
+	/// The listener is owned by you and must remain in scope.
+	void SetSnapshotListener(b2SnapshotListener* listener);
+
 	/// Register a routine for debug drawing. The debug draw functions are called
 	/// inside with b2World::DrawDebugData method. The debug draw object is owned
 	/// by you and must remain in scope.
@@ -71,6 +117,20 @@ public:
 	/// @warning This function is locked during callbacks.
 	b2Body* CreateBody(const b2BodyDef* def);
 
+	/// Create many bodies and their fixtures at once. Body i gets the next fixtureCounts[i]
+	/// fixture definitions, or one each if fixtureCounts is NULL. The bodies and fixtures
+	/// are allocated contiguously and the mass of each body is computed once. On the tree
+	/// broad-phases a batch at least as large as the tree rebuilds it top-down, which
+	/// gives a better tree than inserting one proxy at a time; smaller batches and the
+	/// other broad-phases insert the proxies one at a time. This takes about as long as
+	/// CreateBody and CreateFixture. The world is the same either way, proxy ids included.
+	/// No reference to the definitions is retained.
+	/// @param fixtureDefs the fixture definitions, may be NULL to create bare bodies.
+	/// @param bodies receives the new bodies in order, may be NULL.
+	/// @warning This function is locked during callbacks.
+	void CreateBodies(const b2BodyDef* bodyDefs, int32 bodyCount,
+					  const b2FixtureDef* fixtureDefs, const int32* fixtureCounts, b2Body** bodies);
+
 	/// Destroy a rigid body given a definition. No reference to the definition
 	/// is retained. This function is locked during callbacks.
 	/// @warning This automatically deletes all associated shapes and joints.
@@ -86,6 +146,14 @@ public:
 	/// @warning This function is locked during callbacks.
 	void DestroyJoint(b2Joint* joint);
 
+	/// Create a radial gravity field. No reference to the definition is retained.
+	/// @warning This function is locked during callbacks.
+	b2GravitySource* CreateGravitySource(const b2GravitySourceDef* def);
+
+	/// Destroy a gravity field. Fields attached to a body are destroyed with it.
+	/// @warning This function is locked during callbacks.
+	void DestroyGravitySource(b2GravitySource* source);
+
 	/// Take a time step. This performs collision detection, integration,
 	/// and constraint solution.
 	/// @param timeStep the amount of time to simulate, this should not vary.
@@ -121,6 +189,25 @@ public:
 	/// @param point2 the ray ending point
 	void RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const;
 
+	/// Query the world with many AABBs at once. The queries are spread over worker
+	/// threads and no callbacks are made. Query i writes the fixtures whose proxies
+	/// overlap it to fixtures[i * maxFixtures] onward and its fixture count to
+	/// fixtureCounts[i]. A count of maxFixtures means the query may have been cut short.
+	/// @param maskBits only fixtures with a category bit in this mask are reported.
+	/// @warning do not call this during a time step.
+	void QueryAABBBatch(const b2AABB* aabbs, int32 count, b2Fixture** fixtures,
+						int32 maxFixtures, int32* fixtureCounts, uint16 maskBits = 0xFFFF) const;
+
+	/// Ray-cast the world with many rays at once and find the closest hit of each.
+	/// The rays are spread over worker threads and no callbacks are made.
+	/// Like RayCast, shapes that contain the starting point are ignored.
+	/// @param inputs the rays. Each ray extends from p1 to p1 + maxFraction * (p2 - p1).
+	/// @param hits receives the closest hit of each ray.
+	/// @param maskBits only fixtures with a category bit in this mask are hit.
+	/// @warning do not call this during a time step.
+	void RayCastBatch(const b2RayCastInput* inputs, int32 count, b2RayCastHit* hits,
+						uint16 maskBits = 0xFFFF) const;
+
 	/// Get the world body list. With the returned body, use b2Body::GetNext to get
 	/// the next body in the world list. A NULL body indicates the end of the list.
 	/// @return the head of the world body list.
@@ -133,6 +220,10 @@ public:
 	b2Joint* GetJointList();
 	const b2Joint* GetJointList() const;
 
+	/// Get the world gravity source list. Use b2GravitySource::GetNext to iterate.
+	b2GravitySource* GetGravitySourceList();
+	const b2GravitySource* GetGravitySourceList() const;
+
 	/// Get the world contact list. With the returned contact, use b2Contact::GetNext to get
 	/// the next contact in the world list. A NULL contact indicates the end of the list.
 	/// @return the head of the world contact list.
@@ -157,6 +248,92 @@ public:
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Enable/disable batched continuous physics. The times of impact of all
+	/// candidate contacts are computed concurrently on worker threads and the
+	/// impacts are then solved in time order. After each impact only the TOIs on
+	/// the moved bodies are recomputed. The results match the serial solver. Each
+	/// contact is still limited to b2_maxSubSteps impacts per step. Sub-stepping
+	/// takes precedence over this.
+	void SetParallelTOI(bool flag) { m_parallelTOI = flag; }
+	bool GetParallelTOI() const { return m_parallelTOI; }
+
+	/// Enable/disable solving islands concurrently on worker threads. All islands
+	/// are gathered first and then solved in parallel. PostSolve callbacks are
+	/// buffered and reported in island order once every island is solved.
+	void SetParallelIslands(bool flag) { m_parallelIslands = flag; }
+	bool GetParallelIslands() const { return m_parallelIslands; }
+
+	/// Enable/disable the wide contact solver. Contacts are colored so that no two
+	/// constraints in a batch share a dynamic body and each batch is solved in SIMD
+	/// lanes. The results match the scalar solver up to round-off and ordering.
+	void SetWideSolver(bool flag) { m_wideSolver = flag; }
+	bool GetWideSolver() const { return m_wideSolver; }
+
+	/// Enable/disable solving the constraints of large islands on worker threads.
+	/// Joints and contacts are colored together so that no two constraints of a
+	/// color share a dynamic body, and each color is solved in parallel using the
+	/// wide contact batches. Constraints that don't fit in a color are solved
+	/// serially afterwards. The visiting order differs from the serial solver, but
+	/// results don't depend on the worker count. See b2_parallelSolverMinConstraints.
+	void SetParallelSolver(bool flag) { m_parallelSolver = flag; }
+	bool GetParallelSolver() const { return m_parallelSolver; }
+
+	/// Enable/disable computing contact manifolds concurrently on worker threads.
+	/// Contact callbacks are still reported serially in contact list order.
+	void SetParallelNarrowPhase(bool flag) { m_contactManager.m_parallelCollide = flag; }
+	bool GetParallelNarrowPhase() const { return m_contactManager.m_parallelCollide; }
+
+	/// Enable/disable category filtering in the broad-phase. Proxies take the
+	/// category and mask bits of their fixtures, so pairs the bits reject are never
+	/// generated and tree queries skip subtrees without a match. Only use this with
+	/// the default contact filter or one that rejects at least those pairs. Only
+	/// the tree broad-phases use the bits.
+	/// @warning this should be called outside of a time step.
+	void SetBroadPhaseFiltering(bool flag);
+	bool GetBroadPhaseFiltering() const { return m_contactManager.m_filterProxies; }
+
+	/// Enable/disable sensor events. Sensor fixtures then get no contacts, so the
+	/// contact listener doesn't hear of them. Instead every step each sensor queries
+	/// the broad-phase on a worker thread and tests the shapes it finds for overlap.
+	/// The fixtures that started or stopped overlapping a sensor are reported by
+	/// GetSensorBeginEvents and GetSensorEndEvents. Sensors don't detect each other
+	/// and a fixture pair is reported once whatever the child count. The contact
+	/// filter is called from the worker threads. Unlike sensor contacts, a tracked
+	/// sensor doesn't wake the bodies it starts to overlap; sleeping fixtures are
+	/// still detected, so wake them in response to the begin events if needed.
+	/// @warning this should be called outside of a time step.
+	void SetSensorEvents(bool flag);
+	bool GetSensorEvents() const { return m_contactManager.m_sensorEvents; }
+
+	/// Get the sensor overlaps that began during the last time step, grouped by
+	/// sensor. The events stay valid until the next time step, or until one of
+	/// their fixtures is destroyed. A destroyed fixture ends its overlaps without
+	/// an event, a deactivated one ends them with events in the next time step.
+	const b2SensorEvent* GetSensorBeginEvents() const { return m_sensorManager.m_beginEvents; }
+	int32 GetSensorBeginEventCount() const { return m_sensorManager.m_beginEventCount; }
+
+	/// Get the sensor overlaps that ended during the last time step.
+	/// @see GetSensorBeginEvents
+	const b2SensorEvent* GetSensorEndEvents() const { return m_sensorManager.m_endEvents; }
+	int32 GetSensorEndEventCount() const { return m_sensorManager.m_endEventCount; }
+
+	/// Enable/disable per-worker caches in the block allocator shared by bodies,
+	/// fixtures, contacts and joints. This lets worker tasks allocate and free
+	/// concurrently. See b2BlockAllocator::SetThreadCaching.
+	/// @warning this should be called outside of a time step.
+	void SetThreadCachingAllocator(bool flag);
+	bool GetThreadCachingAllocator() const { return m_blockAllocator.GetThreadCaching(); }
+
+	/// Get the block allocator statistics: live and peak blocks per size class
+	/// and the chunk count. Use this to tune b2BlockAllocator.
+	/// @warning this should be called outside of a time step.
+	void GetAllocatorStats(b2BlockAllocatorStats* stats) const;
+
+	/// Get the most per-step scratch memory, in bytes, the stack allocators have
+	/// held at once. The worker stack allocators are included. This is also the
+	/// heap the stack allocators keep reserved once a scene has peaked.
+	int32 GetMaxStackAllocation() const;
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
@@ -166,6 +343,9 @@ public:
 	/// Get the number of joints.
 	int32 GetJointCount() const;
 
+	/// Get the number of gravity sources.
+	int32 GetGravitySourceCount() const;
+
 	/// Get the number of contacts (each may have 0 or more contact points).
 	int32 GetContactCount() const;
 
@@ -185,6 +365,36 @@ public:
 	/// Get the global gravity vector.
 	b2Vec2 GetGravity() const;
 
+	/// Enable/disable Barnes-Hut gravity. Inverse square gravity sources then pull
+	/// every awake dynamic body regardless of their radius, including bodies that
+	/// carry sources of their own, so dynamic planets attract each other. The
+	/// sources are put in a quadtree every step and the bodies are pulled on
+	/// worker threads. Sources with other falloffs keep using their radius.
+	void SetNBodyGravity(bool flag) { m_nbodyGravity = flag; }
+	bool GetNBodyGravity() const { return m_nbodyGravity; }
+
+	/// Set the Barnes-Hut accuracy. A group of sources of size s at distance d
+	/// acts as a single mass when s < theta * d. Zero is exact but visits every
+	/// source. The default is 0.5.
+	void SetNBodyTheta(float32 theta) { b2Assert(theta >= 0.0f); m_nbodyTheta = theta; }
+	float32 GetNBodyTheta() const { return m_nbodyTheta; }
+
+	/// Enable simulation level of detail. Awake bodies far from every focus point are
+	/// stepped at a reduced rate or frozen in place, see b2SimulationLODDef. Frozen
+	/// bodies keep their velocities and resume where they stopped. Islands are
+	/// always stepped whole: an island that reaches the active area is stepped
+	/// every time step, and a frozen body touched by a stepped island is stepped
+	/// with it. Forces on bodies that are not stepped are dropped as usual.
+	/// Pass NULL to step every body again (the default).
+	void SetSimulationLOD(const b2SimulationLODDef* def);
+	bool GetSimulationLOD() const { return m_lodEnabled; }
+
+	/// Set the points the simulation level of detail is centered on, such as the
+	/// cameras. The points are copied, at most b2_maxFocusPoints. Without focus
+	/// points every body is stepped.
+	void SetFocusPoints(const b2Vec2* points, int32 count);
+	int32 GetFocusPointCount() const { return m_focusPointCount; }
+
 	/// Is the world locked (in the middle of a time step).
 	bool IsLocked() const;
 
@@ -200,10 +410,47 @@ public:
 	/// Get the current profile.
 	const b2Profile& GetProfile() const;
 
+	/// Enable/disable the profiler. It records timed scopes for the step phases
+	/// and each solved island along with per-step counters. See b2Profiler.
+	void SetProfiling(bool flag) { m_profiler.SetEnabled(flag); }
+	bool GetProfiling() const { return m_profiler.IsEnabled(); }
+
+	/// Get the profiler, e.g. to build histograms or write a Chrome trace.
+	b2Profiler& GetProfiler() { return m_profiler; }
+	const b2Profiler& GetProfiler() const { return m_profiler; }
+
+	/// Compute a hash of the body transforms, velocities and sleep states, leaving out
+	/// the sleep state of static bodies, which depends on the island mode. Lockstep
+	/// peers can compare it every step to catch a desync early. See B2_DETERMINISTIC.
+	uint32 ComputeStateHash() const;
+
 	/// Dump the world into the log file.
 	/// @warning this should be called outside of a time step.
 	void Dump();
 
+	/// Save the simulation state into a binary snapshot: bodies, fixtures, joints,
+	/// gravity sources, contacts with their warm starting impulses, sensor overlaps
+	/// and the broad-phase. The snapshot is cleared first. Listeners, the debug draw,
+	/// the threading options and the last sensor events are not saved. User data is
+	/// saved as the pointer value unless a b2SnapshotListener maps it, so without
+	/// one a snapshot restored in another process has dangling user data.
+	/// @warning this should be called outside of a time step.
+	void SaveSnapshot(b2Snapshot* snapshot);
+
+	/// Replace the world contents with a snapshot made by SaveSnapshot. Stepping the
+	/// restored world gives the same results as stepping the saved one. Existing
+	/// bodies, fixtures and joints are destroyed without calling the destruction
+	/// listener, so pointers to them become invalid. The snapshot is read into a
+	/// second world first, which is kept for the next restore, and only swapped in
+	/// once all of it has been read.
+	/// @return false if the data was not saved by this build with the same broad-phase
+	/// type or if the data is malformed, in which case the world is unchanged.
+	/// Indices, counts, links between tree nodes and proxies, shapes and the solver
+	/// state are all checked, so damaged data is rejected rather than stepped.
+	/// @warning this should be called outside of a time step.
+	bool RestoreSnapshot(const void* data, int32 size);
+	bool RestoreSnapshot(const b2Snapshot& snapshot);
+
 private:
 
 	// m_flags
@@ -219,8 +466,25 @@ private:
 	friend class b2ContactManager;
 	friend class b2Controller;
 
+	void ApplyGravitySources();
+	void ApplyGravityTree();
+	void UpdateSimulationLOD();
+	void ClearSimulationLOD();
 	void Solve(const b2TimeStep& step);
+	void SolveIslands(const b2TimeStep& step, const b2TimeStep& reducedStep);
+	void SolveParallelIslands(const b2TimeStep& step, const b2TimeStep& reducedStep);
 	void SolveTOI(const b2TimeStep& step);
+	void SolveTOIBatches(b2Island* island, const b2TimeStep& step);
+	bool PrepareTOI(b2Contact* contact, b2TOIInput* input, float32* alpha0);
+	bool SolveTOIEvent(b2Island* island, b2Contact* contact, float32 alpha, const b2TimeStep& step);
+	void FindNewContacts();
+
+	void RecordProfile(float64 stepStart, const b2BlockAllocatorStats& allocatorStats);
+
+	bool ReadSnapshot(const void* data, int32 size);
+	void SwapContents(b2World* other);
+	void DestroyContents();
+	void ClearContents();
 
 	void DrawJoint(b2Joint* joint);
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
@@ -228,20 +492,41 @@ private:
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
 
+	// One stack allocator per worker for the parallel island solver. Created on first use.
+	b2StackAllocator* m_workerAllocators;
+
+	// The world RestoreSnapshot reads into. Created on first use.
+	b2World* m_restoreWorld;
+
 	int32 m_flags;
 
+	b2BodyStore m_bodyStore;
 	b2ContactManager m_contactManager;
+	b2SensorManager m_sensorManager;
 
 	b2Body* m_bodyList;
 	b2Joint* m_jointList;
+	b2GravitySource* m_gravitySourceList;
 
 	int32 m_bodyCount;
 	int32 m_jointCount;
+	int32 m_gravitySourceCount;
 
 	b2Vec2 m_gravity;
 	bool m_allowSleep;
 
+	bool m_nbodyGravity;
+	float32 m_nbodyTheta;
+	b2GravityTree m_gravityTree;
+
+	bool m_lodEnabled;
+	b2SimulationLODDef m_lodDef;
+	b2Vec2 m_focusPoints[b2_maxFocusPoints];
+	int32 m_focusPointCount;
+	int32 m_lodStepCount;
+
 	b2DestructionListener* m_destructionListener;
+	b2SnapshotListener* m_snapshotListener;
 	b2Draw* m_debugDraw;
 
 	// This is used to compute the time step ratio to
@@ -253,9 +538,16 @@ private:
 	bool m_continuousPhysics;
 	bool m_subStepping;
 
+	bool m_parallelIslands;
+	bool m_wideSolver;
+	bool m_parallelSolver;
+	bool m_parallelTOI;
+
 	bool m_stepComplete;
 
 	b2Profile m_profile;
+	b2Profiler m_profiler;
+	b2ProfileCounters m_counters;
 };
 
 inline b2Body* b2World::GetBodyList()
@@ -278,6 +570,16 @@ inline const b2Joint* b2World::GetJointList() const
 	return m_jointList;
 }
 
+inline b2GravitySource* b2World::GetGravitySourceList()
+{
+	return m_gravitySourceList;
+}
+
+inline const b2GravitySource* b2World::GetGravitySourceList() const
+{
+	return m_gravitySourceList;
+}
+
 inline b2Contact* b2World::GetContactList()
 {
 	return m_contactManager.m_contactList;
@@ -298,6 +600,11 @@ inline int32 b2World::GetJointCount() const
 	return m_jointCount;
 }
 
+inline int32 b2World::GetGravitySourceCount() const
+{
+	return m_gravitySourceCount;
+}
+
 inline int32 b2World::GetContactCount() const
 {
 	return m_contactManager.m_contactCount;
@@ -26,6 +26,7 @@ struct b2Transform;
 class b2Fixture;
 class b2Body;
 class b2Joint;
+class b2GravitySource;
 class b2Contact;
 struct b2ContactResult;
 struct b2Manifold;
@@ -45,6 +46,10 @@ public:
 	/// Called when any fixture is about to be destroyed due
 	/// to the destruction of its parent body.
 	virtual void SayGoodbye(b2Fixture* fixture) = 0;
+
+	/// Called when any gravity source is about to be destroyed due
+	/// to the destruction of its body.
+	virtual void SayGoodbye(b2GravitySource* source) { B2_NOT_USED(source); }
 };
 
 /// Implement this class to provide collision filtering. In other words, you can implement
@@ -152,4 +157,23 @@ public:
 									const b2Vec2& normal, float32 fraction) = 0;
 };
 
+/// Implement this class to control how user data goes into snapshots. Without
+/// it the pointer values are stored as they are, which only makes sense in the
+/// process that saved them. A bug report replayed elsewhere can store an object
+/// id instead and look the object up again on restore, or drop the user data.
+/// See b2World::SaveSnapshot
+class b2SnapshotListener
+{
+public:
+	virtual ~b2SnapshotListener() {}
+
+	/// Called for the user data of each body, fixture, joint and gravity source
+	/// being saved. @return the value to store
+	virtual void* SaveUserData(void* userData) { return userData; }
+
+	/// Called for each stored value while a snapshot is restored. It may be called
+	/// for data that is rejected later on. @return the user data to restore
+	virtual void* RestoreUserData(void* value) { return value; }
+};
+
 #endif
@@ -19,7 +19,7 @@
 #ifndef B2_ROPE_H
 #define B2_ROPE_H
 
-#include "../Common/b2Math.h"
+#include "b2RopeSystem.h"
 
 class b2Draw;
 
@@ -59,7 +59,8 @@ struct b2RopeDef
 	float32 k3;
 };
 
-/// 
+/// A single rope. This is a b2RopeSystem holding one rope, so use
+/// b2RopeSystem directly when there are many.
 class b2Rope
 {
 public:
@@ -92,24 +93,12 @@ public:
 
 private:
 
-	void SolveC2();
-	void SolveC3();
+	b2RopeSystem m_system;
+	int32 m_ropeId;
 
+	// A copy of the vertices for GetVertices.
 	int32 m_count;
 	b2Vec2* m_ps;
-	b2Vec2* m_p0s;
-	b2Vec2* m_vs;
-
-	float32* m_ims;
-
-	float32* m_Ls;
-	float32* m_as;
-
-	b2Vec2 m_gravity;
-	float32 m_damping;
-
-	float32 m_k2;
-	float32 m_k3;
 };
 
 #endif
@@ -0,0 +1,589 @@
+#include "b2RopeSystem.h"
+#include "b2Rope.h"
+#include "../Common/b2Draw.h"
+#include "../Common/b2Parallel.h"
+#include "../Common/b2Simd.h"
+#include <cstring>
+
+static const int32 b2_nullRope = -1;
+
+// Ropes whose vertex counts round up to the same multiple of this share packs.
+static const int32 b2_ropePackGranularity = 8;
+
+// Up to b2_simdWidth ropes stored lane by lane. Lane i of vertex v is at
+// [b2_simdWidth * v + i], and likewise for the constraints. Unused vertices
+// have no mass and unused constraints no stiffness, so they never move.
+struct b2RopePack
+{
+	int32 capacity;
+	int32 ropes[b2_simdWidth];
+	int32 ropeCount;
+
+	float32* px;
+	float32* py;
+	float32* p0x;
+	float32* p0y;
+	float32* vx;
+	float32* vy;
+	float32* ims;
+
+	// Stretch constraints between vertex v and v + 1.
+	float32* Ls;
+	float32* k2s;
+
+	// Bend constraints at vertex v + 1.
+	float32* as;
+	float32* k3s;
+
+	float32 gravityX[b2_simdWidth];
+	float32 gravityY[b2_simdWidth];
+	float32 damping[b2_simdWidth];
+};
+
+static void b2SolveC2(b2RopePack* pack)
+{
+	b2FloatW zero = b2ZeroW();
+	b2FloatW epsilon = b2SplatW(b2_epsilon);
+	b2FloatW one = b2SplatW(1.0f);
+
+	int32 count2 = pack->capacity - 1;
+	for (int32 i = 0; i < count2; ++i)
+	{
+		float32* x1 = pack->px + b2_simdWidth * i;
+		float32* y1 = pack->py + b2_simdWidth * i;
+		float32* x2 = x1 + b2_simdWidth;
+		float32* y2 = y1 + b2_simdWidth;
+
+		b2FloatW p1x = b2LoadW(x1), p1y = b2LoadW(y1);
+		b2FloatW p2x = b2LoadW(x2), p2y = b2LoadW(y2);
+
+		// Normalize like b2Vec2::Normalize, which leaves tiny vectors alone.
+		b2FloatW dx = b2SubW(p2x, p1x);
+		b2FloatW dy = b2SubW(p2y, p1y);
+		b2FloatW L = b2SqrtW(b2AddW(b2MulW(dx, dx), b2MulW(dy, dy)));
+		b2FloatW small = b2GreaterW(epsilon, L);
+		b2FloatW invL = b2DivW(one, L);
+		dx = b2SelectW(small, dx, b2MulW(dx, invL));
+		dy = b2SelectW(small, dy, b2MulW(dy, invL));
+		L = b2SelectW(small, zero, L);
+
+		b2FloatW im1 = b2LoadW(pack->ims + b2_simdWidth * i);
+		b2FloatW im2 = b2LoadW(pack->ims + b2_simdWidth * (i + 1));
+		b2FloatW im = b2AddW(im1, im2);
+		b2FloatW active = b2GreaterW(im, zero);
+
+		b2FloatW k2 = b2LoadW(pack->k2s + b2_simdWidth * i);
+		b2FloatW C = b2SubW(b2LoadW(pack->Ls + b2_simdWidth * i), L);
+		b2FloatW f1 = b2MulW(b2MulW(k2, b2DivW(im1, im)), C);
+		b2FloatW f2 = b2MulW(b2MulW(k2, b2DivW(im2, im)), C);
+
+		b2StoreW(x1, b2SelectW(active, b2SubW(p1x, b2MulW(f1, dx)), p1x));
+		b2StoreW(y1, b2SelectW(active, b2SubW(p1y, b2MulW(f1, dy)), p1y));
+		b2StoreW(x2, b2SelectW(active, b2AddW(p2x, b2MulW(f2, dx)), p2x));
+		b2StoreW(y2, b2SelectW(active, b2AddW(p2y, b2MulW(f2, dy)), p2y));
+	}
+}
+
+static void b2SolveC3(b2RopePack* pack)
+{
+	b2FloatW zero = b2ZeroW();
+	b2FloatW one = b2SplatW(1.0f);
+	b2FloatW pi = b2SplatW(b2_pi);
+	b2FloatW minusPi = b2SplatW(-b2_pi);
+	b2FloatW twoPi = b2SplatW(2.0f * b2_pi);
+
+	int32 count3 = pack->capacity - 2;
+	for (int32 i = 0; i < count3; ++i)
+	{
+		float32* x1 = pack->px + b2_simdWidth * i;
+		float32* y1 = pack->py + b2_simdWidth * i;
+		float32* x2 = x1 + b2_simdWidth;
+		float32* y2 = y1 + b2_simdWidth;
+		float32* x3 = x2 + b2_simdWidth;
+		float32* y3 = y2 + b2_simdWidth;
+
+		b2FloatW p1x = b2LoadW(x1), p1y = b2LoadW(y1);
+		b2FloatW p2x = b2LoadW(x2), p2y = b2LoadW(y2);
+		b2FloatW p3x = b2LoadW(x3), p3y = b2LoadW(y3);
+
+		b2FloatW m1 = b2LoadW(pack->ims + b2_simdWidth * i);
+		b2FloatW m2 = b2LoadW(pack->ims + b2_simdWidth * (i + 1));
+		b2FloatW m3 = b2LoadW(pack->ims + b2_simdWidth * (i + 2));
+
+		b2FloatW d1x = b2SubW(p2x, p1x), d1y = b2SubW(p2y, p1y);
+		b2FloatW d2x = b2SubW(p3x, p2x), d2y = b2SubW(p3y, p2y);
+
+		b2FloatW L1sqr = b2AddW(b2MulW(d1x, d1x), b2MulW(d1y, d1y));
+		b2FloatW L2sqr = b2AddW(b2MulW(d2x, d2x), b2MulW(d2y, d2y));
+
+		b2FloatW a = b2SubW(b2MulW(d1x, d2y), b2MulW(d1y, d2x));
+		b2FloatW b = b2AddW(b2MulW(d1x, d2x), b2MulW(d1y, d2y));
+
+		// Jd1 = (-1 / L1sqr) * d1.Skew(), Jd2 = (1 / L2sqr) * d2.Skew()
+		b2FloatW s1 = b2DivW(b2SplatW(-1.0f), L1sqr);
+		b2FloatW s2 = b2DivW(one, L2sqr);
+		b2FloatW Jd1x = b2MulW(s1, b2SubW(zero, d1y)), Jd1y = b2MulW(s1, d1x);
+		b2FloatW Jd2x = b2MulW(s2, b2SubW(zero, d2y)), Jd2y = b2MulW(s2, d2x);
+
+		b2FloatW J1x = b2SubW(zero, Jd1x), J1y = b2SubW(zero, Jd1y);
+		b2FloatW J2x = b2SubW(Jd1x, Jd2x), J2y = b2SubW(Jd1y, Jd2y);
+		b2FloatW J3x = Jd2x, J3y = Jd2y;
+
+		b2FloatW mass = b2MulW(m1, b2AddW(b2MulW(J1x, J1x), b2MulW(J1y, J1y)));
+		mass = b2AddW(mass, b2MulW(m2, b2AddW(b2MulW(J2x, J2x), b2MulW(J2y, J2y))));
+		mass = b2AddW(mass, b2MulW(m3, b2AddW(b2MulW(J3x, J3x), b2MulW(J3y, J3y))));
+
+		// Degenerate bends are skipped, as are the lanes past the end of a rope.
+		b2FloatW active = b2AndW(b2GreaterW(b2MulW(L1sqr, L2sqr), zero), b2GreaterW(mass, zero));
+		mass = b2DivW(one, mass);
+
+#if defined(B2_DETERMINISTIC)
+		b2FloatW angle = b2Atan2W(a, b);
+#else
+		// The polynomial only matches b2Atan2 in the deterministic build, so
+		// elsewhere the active lanes use b2Atan2 to keep the scalar results.
+		float32 ys[b2_simdWidth], xs[b2_simdWidth], angles[b2_simdWidth];
+		b2StoreW(ys, a);
+		b2StoreW(xs, b);
+		int32 activeBits = b2MaskBitsW(active);
+		for (int32 j = 0; j < b2_simdWidth; ++j)
+		{
+			angles[j] = (activeBits & (1 << j)) ? b2Atan2(ys[j], xs[j]) : 0.0f;
+		}
+		b2FloatW angle = b2LoadW(angles);
+#endif
+
+		b2FloatW restAngle = b2LoadW(pack->as + b2_simdWidth * i);
+		b2FloatW C = b2SubW(angle, restAngle);
+
+		// Wrap the error into [-pi, pi].
+		for (;;)
+		{
+			b2FloatW wrap = b2AndW(active, b2GreaterW(C, pi));
+			if (b2MaskBitsW(wrap) == 0)
+			{
+				break;
+			}
+
+			angle = b2SelectW(wrap, b2SubW(angle, twoPi), angle);
+			C = b2SubW(angle, restAngle);
+		}
+
+		for (;;)
+		{
+			b2FloatW wrap = b2AndW(active, b2GreaterW(minusPi, C));
+			if (b2MaskBitsW(wrap) == 0)
+			{
+				break;
+			}
+
+			angle = b2SelectW(wrap, b2AddW(angle, twoPi), angle);
+			C = b2SubW(angle, restAngle);
+		}
+
+		b2FloatW k3 = b2LoadW(pack->k3s + b2_simdWidth * i);
+		b2FloatW impulse = b2MulW(b2MulW(b2SubW(zero, k3), mass), C);
+
+		b2FloatW i1 = b2MulW(m1, impulse);
+		b2FloatW i2 = b2MulW(m2, impulse);
+		b2FloatW i3 = b2MulW(m3, impulse);
+
+		b2StoreW(x1, b2SelectW(active, b2AddW(p1x, b2MulW(i1, J1x)), p1x));
+		b2StoreW(y1, b2SelectW(active, b2AddW(p1y, b2MulW(i1, J1y)), p1y));
+		b2StoreW(x2, b2SelectW(active, b2AddW(p2x, b2MulW(i2, J2x)), p2x));
+		b2StoreW(y2, b2SelectW(active, b2AddW(p2y, b2MulW(i2, J2y)), p2y));
+		b2StoreW(x3, b2SelectW(active, b2AddW(p3x, b2MulW(i3, J3x)), p3x));
+		b2StoreW(y3, b2SelectW(active, b2AddW(p3y, b2MulW(i3, J3y)), p3y));
+	}
+}
+
+static void b2StepRopePack(b2RopePack* pack, float32 h, int32 iterations)
+{
+	if (pack->ropeCount == 0)
+	{
+		return;
+	}
+
+	float32 damping[b2_simdWidth];
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		damping[i] = expf(- h * pack->damping[i]);
+	}
+
+	b2FloatW zero = b2ZeroW();
+	b2FloatW hW = b2SplatW(h);
+	b2FloatW d = b2LoadW(damping);
+	b2FloatW hgx = b2MulW(hW, b2LoadW(pack->gravityX));
+	b2FloatW hgy = b2MulW(hW, b2LoadW(pack->gravityY));
+
+	for (int32 i = 0; i < pack->capacity; ++i)
+	{
+		int32 k = b2_simdWidth * i;
+		b2FloatW px = b2LoadW(pack->px + k);
+		b2FloatW py = b2LoadW(pack->py + k);
+		b2StoreW(pack->p0x + k, px);
+		b2StoreW(pack->p0y + k, py);
+
+		b2FloatW vx = b2LoadW(pack->vx + k);
+		b2FloatW vy = b2LoadW(pack->vy + k);
+		b2FloatW dynamic = b2GreaterW(b2LoadW(pack->ims + k), zero);
+		vx = b2MulW(b2SelectW(dynamic, b2AddW(vx, hgx), vx), d);
+		vy = b2MulW(b2SelectW(dynamic, b2AddW(vy, hgy), vy), d);
+		b2StoreW(pack->vx + k, vx);
+		b2StoreW(pack->vy + k, vy);
+
+		b2StoreW(pack->px + k, b2AddW(px, b2MulW(hW, vx)));
+		b2StoreW(pack->py + k, b2AddW(py, b2MulW(hW, vy)));
+	}
+
+	for (int32 i = 0; i < iterations; ++i)
+	{
+		b2SolveC2(pack);
+		b2SolveC3(pack);
+		b2SolveC2(pack);
+	}
+
+	b2FloatW inv_h = b2SplatW(1.0f / h);
+	for (int32 i = 0; i < pack->capacity; ++i)
+	{
+		int32 k = b2_simdWidth * i;
+		b2StoreW(pack->vx + k, b2MulW(inv_h, b2SubW(b2LoadW(pack->px + k), b2LoadW(pack->p0x + k))));
+		b2StoreW(pack->vy + k, b2MulW(inv_h, b2SubW(b2LoadW(pack->py + k), b2LoadW(pack->p0y + k))));
+	}
+}
+
+class b2RopeStepTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 index, int32 worker)
+	{
+		B2_NOT_USED(worker);
+		b2StepRopePack(packs + index, h, iterations);
+	}
+
+	b2RopePack* packs;
+	float32 h;
+	int32 iterations;
+};
+
+b2RopeSystem::b2RopeSystem()
+{
+	m_packs = NULL;
+	m_packCount = 0;
+	m_packCapacity = 0;
+
+	m_ropes = NULL;
+	m_slotCount = 0;
+	m_slotCapacity = 0;
+	m_ropeCount = 0;
+	m_freeRope = b2_nullRope;
+}
+
+b2RopeSystem::~b2RopeSystem()
+{
+	for (int32 i = 0; i < m_packCount; ++i)
+	{
+		b2Free(m_packs[i].px);
+	}
+
+	b2Free(m_packs);
+	b2Free(m_ropes);
+}
+
+int32 b2RopeSystem::AllocatePack(int32 capacity)
+{
+	if (m_packCount == m_packCapacity)
+	{
+		b2RopePack* oldPacks = m_packs;
+		m_packCapacity = b2Max(2 * m_packCapacity, 4);
+		m_packs = (b2RopePack*)b2Alloc(m_packCapacity * sizeof(b2RopePack));
+		if (oldPacks)
+		{
+			memcpy(m_packs, oldPacks, m_packCount * sizeof(b2RopePack));
+			b2Free(oldPacks);
+		}
+	}
+
+	b2RopePack* pack = m_packs + m_packCount;
+	pack->capacity = capacity;
+	pack->ropeCount = 0;
+
+	// Seven vertex arrays and four constraint arrays in one block, all zero.
+	int32 width = b2_simdWidth * capacity;
+	int32 size = 11 * width;
+	float32* memory = (float32*)b2Alloc(size * sizeof(float32));
+	memset(memory, 0, size * sizeof(float32));
+
+	pack->px = memory;
+	pack->py = pack->px + width;
+	pack->p0x = pack->py + width;
+	pack->p0y = pack->p0x + width;
+	pack->vx = pack->p0y + width;
+	pack->vy = pack->vx + width;
+	pack->ims = pack->vy + width;
+	pack->Ls = pack->ims + width;
+	pack->k2s = pack->Ls + width;
+	pack->as = pack->k2s + width;
+	pack->k3s = pack->as + width;
+
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		pack->ropes[i] = b2_nullRope;
+		pack->gravityX[i] = 0.0f;
+		pack->gravityY[i] = 0.0f;
+		pack->damping[i] = 0.0f;
+	}
+
+	return m_packCount++;
+}
+
+int32 b2RopeSystem::CreateRope(const b2RopeDef* def)
+{
+	return CreateRope(def, true);
+}
+
+int32 b2RopeSystem::CreateRope(const b2RopeDef* def, bool pad)
+{
+	b2Assert(def->count >= 3);
+	int32 count = def->count;
+
+	// Find a pack of the right size with a free lane. Padding lets ropes of
+	// similar length share packs, but a rope alone would only pay for it.
+	int32 capacity = count;
+	if (pad)
+	{
+		capacity = b2_ropePackGranularity * ((count + b2_ropePackGranularity - 1) / b2_ropePackGranularity);
+	}
+	int32 packIndex = b2_nullRope;
+	for (int32 i = 0; i < m_packCount; ++i)
+	{
+		if (m_packs[i].capacity == capacity && m_packs[i].ropeCount < b2_simdWidth)
+		{
+			packIndex = i;
+			break;
+		}
+	}
+
+	if (packIndex == b2_nullRope)
+	{
+		packIndex = AllocatePack(capacity);
+	}
+
+	b2RopePack* pack = m_packs + packIndex;
+	int32 lane = 0;
+	while (pack->ropes[lane] != b2_nullRope)
+	{
+		++lane;
+	}
+
+	// Take a rope id.
+	int32 ropeId = m_freeRope;
+	if (ropeId != b2_nullRope)
+	{
+		m_freeRope = m_ropes[ropeId].next;
+	}
+	else
+	{
+		if (m_slotCount == m_slotCapacity)
+		{
+			b2RopeSlot* oldRopes = m_ropes;
+			m_slotCapacity = b2Max(2 * m_slotCapacity, 16);
+			m_ropes = (b2RopeSlot*)b2Alloc(m_slotCapacity * sizeof(b2RopeSlot));
+			if (oldRopes)
+			{
+				memcpy(m_ropes, oldRopes, m_slotCount * sizeof(b2RopeSlot));
+				b2Free(oldRopes);
+			}
+		}
+
+		ropeId = m_slotCount++;
+	}
+
+	b2RopeSlot* slot = m_ropes + ropeId;
+	slot->pack = packIndex;
+	slot->lane = lane;
+	slot->count = count;
+	slot->next = b2_nullRope;
+
+	pack->ropes[lane] = ropeId;
+	++pack->ropeCount;
+	++m_ropeCount;
+
+	pack->gravityX[lane] = def->gravity.x;
+	pack->gravityY[lane] = def->gravity.y;
+	pack->damping[lane] = def->damping;
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 k = b2_simdWidth * i + lane;
+		pack->px[k] = def->vertices[i].x;
+		pack->py[k] = def->vertices[i].y;
+		pack->p0x[k] = def->vertices[i].x;
+		pack->p0y[k] = def->vertices[i].y;
+		pack->vx[k] = 0.0f;
+		pack->vy[k] = 0.0f;
+
+		float32 m = def->masses[i];
+		if (m > 0.0f)
+		{
+			pack->ims[k] = 1.0f / m;
+		}
+		else
+		{
+			pack->ims[k] = 0.0f;
+		}
+	}
+
+	for (int32 i = 0; i < count - 1; ++i)
+	{
+		b2Vec2 p1 = def->vertices[i];
+		b2Vec2 p2 = def->vertices[i + 1];
+
+		int32 k = b2_simdWidth * i + lane;
+		pack->Ls[k] = b2Distance(p1, p2);
+		pack->k2s[k] = def->k2;
+	}
+
+	for (int32 i = 0; i < count - 2; ++i)
+	{
+		b2Vec2 p1 = def->vertices[i];
+		b2Vec2 p2 = def->vertices[i + 1];
+		b2Vec2 p3 = def->vertices[i + 2];
+
+		b2Vec2 d1 = p2 - p1;
+		b2Vec2 d2 = p3 - p2;
+
+		float32 a = b2Cross(d1, d2);
+		float32 b = b2Dot(d1, d2);
+
+		int32 k = b2_simdWidth * i + lane;
+		pack->as[k] = b2Atan2(a, b);
+		pack->k3s[k] = def->k3;
+	}
+
+	return ropeId;
+}
+
+void b2RopeSystem::DestroyRope(int32 ropeId)
+{
+	b2Assert(0 <= ropeId && ropeId < m_slotCount && m_ropes[ropeId].count > 0);
+	b2RopeSlot* slot = m_ropes + ropeId;
+	b2RopePack* pack = m_packs + slot->pack;
+
+	// Clear the lane so it stays still until it is reused.
+	int32 width = b2_simdWidth * pack->capacity;
+	float32* lanes = pack->px + slot->lane;
+	for (int32 i = 0; i < 11 * width; i += b2_simdWidth)
+	{
+		lanes[i] = 0.0f;
+	}
+
+	pack->ropes[slot->lane] = b2_nullRope;
+	--pack->ropeCount;
+	--m_ropeCount;
+
+	slot->count = 0;
+	slot->next = m_freeRope;
+	m_freeRope = ropeId;
+}
+
+void b2RopeSystem::Step(float32 h, int32 iterations)
+{
+	if (h == 0.0)
+	{
+		return;
+	}
+
+	b2RopeStepTask task;
+	task.packs = m_packs;
+	task.h = h;
+	task.iterations = iterations;
+
+	// The packs are independent, so they go to the workers as they are.
+	if (m_packCount > 1)
+	{
+		b2ParallelFor(&task, m_packCount);
+	}
+	else if (m_packCount == 1)
+	{
+		task.Execute(0, 0);
+	}
+}
+
+int32 b2RopeSystem::GetVertexCount(int32 ropeId) const
+{
+	b2Assert(0 <= ropeId && ropeId < m_slotCount);
+	return m_ropes[ropeId].count;
+}
+
+b2Vec2 b2RopeSystem::GetVertex(int32 ropeId, int32 index) const
+{
+	b2Assert(0 <= ropeId && ropeId < m_slotCount);
+	const b2RopeSlot* slot = m_ropes + ropeId;
+	b2Assert(0 <= index && index < slot->count);
+
+	const b2RopePack* pack = m_packs + slot->pack;
+	int32 k = b2_simdWidth * index + slot->lane;
+	return b2Vec2(pack->px[k], pack->py[k]);
+}
+
+void b2RopeSystem::GetVertices(int32 ropeId, b2Vec2* vertices) const
+{
+	b2Assert(0 <= ropeId && ropeId < m_slotCount);
+	const b2RopeSlot* slot = m_ropes + ropeId;
+	const b2RopePack* pack = m_packs + slot->pack;
+	for (int32 i = 0; i < slot->count; ++i)
+	{
+		int32 k = b2_simdWidth * i + slot->lane;
+		vertices[i].Set(pack->px[k], pack->py[k]);
+	}
+}
+
+void b2RopeSystem::SetVertex(int32 ropeId, int32 index, const b2Vec2& position)
+{
+	b2Assert(0 <= ropeId && ropeId < m_slotCount);
+	const b2RopeSlot* slot = m_ropes + ropeId;
+	b2Assert(0 <= index && index < slot->count);
+
+	b2RopePack* pack = m_packs + slot->pack;
+	int32 k = b2_simdWidth * index + slot->lane;
+	pack->px[k] = position.x;
+	pack->py[k] = position.y;
+}
+
+void b2RopeSystem::SetAngle(int32 ropeId, float32 angle)
+{
+	b2Assert(0 <= ropeId && ropeId < m_slotCount);
+	const b2RopeSlot* slot = m_ropes + ropeId;
+	b2RopePack* pack = m_packs + slot->pack;
+	for (int32 i = 0; i < slot->count - 2; ++i)
+	{
+		pack->as[b2_simdWidth * i + slot->lane] = angle;
+	}
+}
+
+void b2RopeSystem::Draw(b2Draw* draw) const
+{
+	b2Color c(0.4f, 0.5f, 0.7f);
+
+	for (int32 i = 0; i < m_packCount; ++i)
+	{
+		const b2RopePack* pack = m_packs + i;
+		for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+		{
+			if (pack->ropes[lane] == b2_nullRope)
+			{
+				continue;
+			}
+
+			int32 count = m_ropes[pack->ropes[lane]].count;
+			for (int32 j = 0; j < count - 1; ++j)
+			{
+				int32 k = b2_simdWidth * j + lane;
+				b2Vec2 p1(pack->px[k], pack->py[k]);
+				b2Vec2 p2(pack->px[k + b2_simdWidth], pack->py[k + b2_simdWidth]);
+				draw->DrawSegment(p1, p2, c);
+			}
+		}
+	}
+}
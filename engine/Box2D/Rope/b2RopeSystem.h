@@ -0,0 +1,85 @@
+#ifndef B2_ROPE_SYSTEM_H
+#define B2_ROPE_SYSTEM_H
+
+#include "../Common/b2Math.h"
+
+class b2Draw;
+struct b2RopeDef;
+struct b2RopePack;
+
+/// Simulates many ropes together. Ropes of similar length are packed in groups of
+/// b2_simdWidth, one rope per SIMD lane, so the constraints of a whole group are
+/// projected at once. The groups are stepped on the b2ParallelFor workers.
+class b2RopeSystem
+{
+public:
+	b2RopeSystem();
+	~b2RopeSystem();
+
+	/// Create a rope. No reference to the definition is retained.
+	/// @return the rope id. Ids of destroyed ropes are reused.
+	int32 CreateRope(const b2RopeDef* def);
+
+	/// Destroy a rope.
+	void DestroyRope(int32 ropeId);
+
+	/// Step every rope with the same time step.
+	void Step(float32 timeStep, int32 iterations);
+
+	/// Get the number of ropes.
+	int32 GetRopeCount() const
+	{
+		return m_ropeCount;
+	}
+
+	/// Get the number of vertices of a rope.
+	int32 GetVertexCount(int32 ropeId) const;
+
+	/// Get the position of a vertex.
+	b2Vec2 GetVertex(int32 ropeId, int32 index) const;
+
+	/// Copy the vertex positions of a rope out of the packed storage.
+	/// @param vertices must hold GetVertexCount(ropeId) entries.
+	void GetVertices(int32 ropeId, b2Vec2* vertices) const;
+
+	/// Move a vertex. Use this to carry a pinned vertex along with whatever
+	/// the rope is tied to.
+	void SetVertex(int32 ropeId, int32 index, const b2Vec2& position);
+
+	/// Set the rest angle of every bend of a rope.
+	void SetAngle(int32 ropeId, float32 angle);
+
+	/// Draw every rope.
+	void Draw(b2Draw* draw) const;
+
+private:
+
+	friend class b2Rope;
+
+	// Ropes created with pad false get a pack of their exact length, which
+	// only ropes of that same length share.
+	int32 CreateRope(const b2RopeDef* def, bool pad);
+
+	struct b2RopeSlot
+	{
+		int32 pack;
+		int32 lane;
+		int32 count;
+		int32 next;
+	};
+
+	int32 AllocatePack(int32 capacity);
+
+	b2RopePack* m_packs;
+	int32 m_packCount;
+	int32 m_packCapacity;
+
+	// Rope ids index this. Destroyed slots form a free list through next.
+	b2RopeSlot* m_ropes;
+	int32 m_slotCount;
+	int32 m_slotCapacity;
+	int32 m_ropeCount;
+	int32 m_freeRope;
+};
+
+#endif
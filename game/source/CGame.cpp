@@ -2,6 +2,7 @@
 #include "CGame.h"
 #include <string>
 #include <iostream>
+#include <vector>
 #include <time.h>
 using std::string;
 
@@ -50,9 +51,11 @@ void CGame::Initialize()
 	m_Timer.Reset();
 	m_Timer.Start();
 
-	for (unsigned int i = 0; i < 25; ++i)
+	std::vector<ATHObject*> vecSquares;
+	m_Engine.GetObjectManager()->InstanceObjects(float3(0.0f, 10.0f, 0.0f), "Square", 25, &vecSquares);
+	for (unsigned int i = 0; i < vecSquares.size(); ++i)
 	{
-		ATHObject* pObj = m_Engine.GetObjectManager()->InstanceObject(float3(0.0f, 10.0f, 0.0f), "Square");
+		ATHObject* pObj = vecSquares[i];
 		pObj->GetBody()->ApplyLinearImpulse(b2Vec2(70.0f, -55.0f), pObj->GetBody()->GetWorldCenter());
 	}
 
@@ -10,6 +10,7 @@ Planet::Planet()
 {
 	ATHObject();
 	m_fMass = 0.0f;
+	m_pGravitySource = nullptr;
 }
 
 Planet::~Planet()
@@ -22,59 +23,35 @@ Planet::~Planet()
 	}
 }
 
-void Planet::FixedUpdate()
+void Planet::CreateGravityField(float _fRadius)
 {
-	std::list< b2Body* >::iterator itrBody = m_liGravityTargets.begin();
-	std::list< b2Body* >::iterator itrEnd = m_liGravityTargets.end();
+	if (!m_pBody)
+		return;
 
-	float fRadius = GetPropertyAsFloat("gravity-radius");
+	SetProperty("gravity-radius", &_fRadius, APT_FLOAT);
 
-	while (itrBody != itrEnd)
-	{
-		b2Vec2 dirVec = m_pBody->GetWorldCenter() - (*itrBody)->GetWorldCenter();
-		float fDist = dirVec.Normalize();
-		float fForce = PLANET_GRAVITY_CONSTANT * GetMass() * (*itrBody)->GetMass() / ( fDist * fDist );
-		fForce = fForce * (fDist / fRadius);
-
-		(*itrBody)->ApplyForceToCenter(fForce * dirVec);
-
-		itrBody++;
-	}
+	// The pull is G * M / d, scaled down by the field radius
+	b2GravitySourceDef gravityDef;
+	gravityDef.body = m_pBody;
+	gravityDef.falloff = e_linearFalloff;
+	gravityDef.radius = _fRadius;
+	gravityDef.minRadius = GetPropertyAsFloat("radius");
 
+	// Destroyed along with the body
+	m_pGravitySource = m_pBody->GetWorld()->CreateGravitySource(&gravityDef);
+	UpdateGravityStrength();
 }
 
-void Planet::OnCollisionEnter(b2Contact* _pContact)
+void Planet::SetMass(float _fMass)
 {
-	ATHObject* pObjA = (ATHObject*)_pContact->GetFixtureA()->GetBody()->GetUserData();
-	ATHObject* pObjB = (ATHObject*)_pContact->GetFixtureB()->GetBody()->GetUserData();
-
-	// Check to see which object this one is
-	if (this == pObjA)
-	{
-		if (_pContact->GetFixtureA()->IsSensor())
-			m_liGravityTargets.push_back(_pContact->GetFixtureB()->GetBody());
-	}
-	else if (this == pObjB)
-	{
-		if(_pContact->GetFixtureB()->IsSensor())
-			m_liGravityTargets.push_back(_pContact->GetFixtureA()->GetBody());
-	}
+	m_fMass = _fMass;
+	UpdateGravityStrength();
 }
 
-void Planet::OnCollisionExit(b2Contact* _pContact)
+void Planet::UpdateGravityStrength()
 {
-	ATHObject* pObjA = (ATHObject*)_pContact->GetFixtureA()->GetBody()->GetUserData();
-	ATHObject* pObjB = (ATHObject*)_pContact->GetFixtureB()->GetBody()->GetUserData();
+	if (!m_pGravitySource)
+		return;
 
-	// Check to see which object this one is
-	if (this == pObjA)
-	{
-		if (_pContact->GetFixtureA()->IsSensor())
-			m_liGravityTargets.remove(_pContact->GetFixtureB()->GetBody());
-	}
-	else if (this == pObjB)
-	{
-		if (_pContact->GetFixtureB()->IsSensor())
-			m_liGravityTargets.remove(_pContact->GetFixtureA()->GetBody());
-	}
+	m_pGravitySource->SetStrength(PLANET_GRAVITY_CONSTANT * GetMass() / m_pGravitySource->GetRadius());
 }
\ No newline at end of file
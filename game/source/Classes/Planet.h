@@ -2,27 +2,29 @@
 #define PLANET_H
 
 #include "../../../engine/ATHObjectSystem/ATHObject.h"
-#include <list>
 
-class b2Body;
+class b2GravitySource;
 class Planet : public ATHObject
 {
 private:
 
-	std::list< b2Body* > m_liGravityTargets;
 	// Planets are kinematic, but we need mass for gravity calculations;
 	float m_fMass;
+	// The field pulling bodies toward the planet, owned by the planet's body
+	b2GravitySource* m_pGravitySource;
+
+	void UpdateGravityStrength();
 
 public:
 
 	Planet();
 	~Planet();
-	virtual void FixedUpdate();
-	virtual void OnCollisionEnter(b2Contact* _pContact);
-	virtual void OnCollisionExit(b2Contact* _pContact);
+
+	// Attach a gravity field reaching _fRadius from the center. Call after Init.
+	void CreateGravityField(float _fRadius);
 
 	float GetMass() { return m_fMass; }
-	void SetMass(float _fMass) { m_fMass = _fMass; }
+	void SetMass(float _fMass);
 
 };
 
@@ -11,6 +11,8 @@
 
 #define PLANET_SLOT_LENGTH 1.0f
 #define UNIT_TO_PIXEL_RATIO 128
+#define PLANET_GRAVITY_RADIUS_SCALE 5.0f
+#define PLANET_SYSTEM_MARGIN 10.0f
 unsigned int ObjectGenerator::s_unPlanetTextureCount = 0;
 
 ObjectGenerator::ObjectGenerator()
@@ -79,8 +81,20 @@ ATHObject* ObjectGenerator::GeneratePlanet(float2 _fPos, float _fMinRadius, floa
 	b2BodyDef bodyDef;
 	bodyDef.position = b2Vec2(_fPos.vX, _fPos.vY);
 	bodyDef.type = b2_kinematicBody;
-	
-	b2Body* pPlanetBody = m_pObjectManager->m_pWorld->CreateBody(&bodyDef);
+
+	// Each planet system gets its own physics partition, unless it is
+	// placed inside of another one
+	b2World* pWorld = m_pObjectManager->GetWorldAt(bodyDef.position);
+	if (pWorld == m_pObjectManager->m_pWorld)
+	{
+		float fSystemRadius = fPlanetRadius * PLANET_GRAVITY_RADIUS_SCALE + PLANET_SYSTEM_MARGIN;
+		b2AABB aabbSystem;
+		aabbSystem.lowerBound = bodyDef.position - b2Vec2(fSystemRadius, fSystemRadius);
+		aabbSystem.upperBound = bodyDef.position + b2Vec2(fSystemRadius, fSystemRadius);
+		pWorld = m_pObjectManager->CreatePartition(aabbSystem);
+	}
+
+	b2Body* pPlanetBody = pWorld->CreateBody(&bodyDef);
 
 	// Create the planet fixture
 	b2FixtureDef fixtureDef;
@@ -90,13 +104,6 @@ ATHObject* ObjectGenerator::GeneratePlanet(float2 _fPos, float _fMinRadius, floa
 	fixtureDef.shape = &planetCircleShape;
 	pPlanetBody->CreateFixture(&fixtureDef);
 
-	// Create the gravity sensor
-	planetCircleShape.m_radius = fPlanetRadius * 5.0f;
-	fixtureDef.shape = &planetCircleShape;
-	fixtureDef.isSensor = true;
-	pPlanetBody->CreateFixture(&fixtureDef);
-	pNewObject->SetProperty("gravity-radius", &planetCircleShape.m_radius, APT_FLOAT);
-
 	// Create the image
 	ATHRenderNode* pRenderNode = GeneratePlanetTexture(_fColor, fPlanetRadius);
 
@@ -104,6 +111,9 @@ ATHObject* ObjectGenerator::GeneratePlanet(float2 _fPos, float _fMinRadius, floa
 	pNewObject->Init(pRenderNode, pPlanetBody);
 	m_pObjectManager->AddObject(pNewObject);
 
+	// Create the gravity field
+	pNewObject->CreateGravityField(fPlanetRadius * PLANET_GRAVITY_RADIUS_SCALE);
+
 	return pNewObject;
 }
 
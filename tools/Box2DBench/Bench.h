@@ -0,0 +1,54 @@
+#ifndef BOX2D_BENCH_H
+#define BOX2D_BENCH_H
+
+#include "../../engine/Box2D/Box2D.h"
+
+/// A check or benchmark of the embedded Box2D. It prints its measurements and
+/// returns false if a check failed.
+typedef bool (*BenchFunction)();
+
+struct Bench
+{
+	const char* name;
+	BenchFunction function;
+};
+
+/// Seed RandomFloat. The benches seed it so every run creates the same scenes.
+void SeedRandom(uint32 seed);
+
+/// Get a pseudo random number in [lo, hi].
+float32 RandomFloat(float32 lo, float32 hi);
+
+/// Print a labelled time in milliseconds.
+void PrintTime(const char* label, float32 milliseconds);
+
+/// Report a failed check. Always returns false.
+bool Fail(const char* message);
+
+/// Create a static ground box under a pyramid of 1x1 boxes, like the Square
+/// prefab, with baseCount boxes in the bottom row.
+/// @return the number of boxes.
+int32 CreatePyramid(b2World* world, int32 baseCount, const b2Vec2& position);
+
+/// Step a world with the usual 60 Hz settings.
+/// @return the average step time in milliseconds.
+float32 StepWorld(b2World* world, int32 stepCount);
+
+/// Get the largest distance between the positions of matching bodies of two
+/// worlds built the same way.
+float32 GetMaxSeparation(const b2World* world1, const b2World* world2);
+
+bool SolverBench();
+bool BroadPhaseBench();
+bool TreeBench();
+bool SnapshotBench();
+bool DeterminismBench();
+bool TOIBench();
+bool NBodyBench();
+bool ParallelSolverBench();
+bool KernelBench();
+bool CreateBench();
+bool RopeBench();
+bool SensorBench();
+
+#endif
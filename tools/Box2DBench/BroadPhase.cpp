@@ -0,0 +1,147 @@
+#include "Bench.h"
+#include <cstdio>
+
+// Counts the pairs of a broad-phase update and hashes them, so types that report
+// the same pairs in another order get the same hash.
+class PairCallback
+{
+public:
+	void AddPair(void* userDataA, void* userDataB)
+	{
+		uint32 a = (uint32)(size_t)userDataA;
+		uint32 b = (uint32)(size_t)userDataB;
+		if (a > b)
+		{
+			b2Swap(a, b);
+		}
+
+		uint32 key = a * 2654435761u ^ b * 2246822519u;
+		key ^= key >> 15;
+		key *= 2246822519u;
+		key ^= key >> 13;
+		hash += key;
+		++count;
+	}
+
+	uint32 hash;
+	int32 count;
+};
+
+struct BroadPhaseResult
+{
+	float32 createTime;
+	float32 updateTime;
+	uint32 hash;
+	int32 pairCount;
+};
+
+// Create proxyCount unit boxes at the Square prefab density, then move all of
+// them for a few frames, updating the pairs after each frame.
+static BroadPhaseResult RunBroadPhase(b2BroadPhaseType type, int32 proxyCount)
+{
+	const int32 frameCount = 10;
+
+	b2BroadPhase broadPhase(type);
+	b2Vec2* positions = new b2Vec2[proxyCount];
+	b2Vec2* velocities = new b2Vec2[proxyCount];
+	int32* proxyIds = new int32[proxyCount];
+
+	SeedRandom(proxyCount);
+	float32 extent = 2.0f * b2Sqrt(float32(proxyCount));
+	b2Vec2 r(0.5f, 0.5f);
+
+	BroadPhaseResult result;
+	result.hash = 0;
+	result.pairCount = 0;
+
+	b2Timer timer;
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		positions[i].Set(RandomFloat(0.0f, extent), RandomFloat(0.0f, extent));
+		velocities[i].Set(RandomFloat(-0.3f, 0.3f), RandomFloat(-0.3f, 0.3f));
+
+		b2AABB aabb;
+		aabb.lowerBound = positions[i] - r;
+		aabb.upperBound = positions[i] + r;
+		proxyIds[i] = broadPhase.CreateProxy(aabb, (void*)(size_t)(i + 1));
+	}
+	result.createTime = timer.GetMilliseconds();
+
+	timer.Reset();
+	for (int32 frame = 0; frame < frameCount; ++frame)
+	{
+		for (int32 i = 0; i < proxyCount && frame > 0; ++i)
+		{
+			positions[i] += velocities[i];
+
+			b2AABB aabb;
+			aabb.lowerBound = positions[i] - r;
+			aabb.upperBound = positions[i] + r;
+			broadPhase.MoveProxy(proxyIds[i], aabb, velocities[i]);
+		}
+
+		PairCallback callback;
+		callback.hash = 0;
+		callback.count = 0;
+		broadPhase.UpdatePairs(&callback);
+
+		result.hash = 31 * result.hash + callback.hash;
+		result.pairCount += callback.count;
+	}
+	result.updateTime = timer.GetMilliseconds() / frameCount;
+
+	delete [] positions;
+	delete [] velocities;
+	delete [] proxyIds;
+	return result;
+}
+
+// Compares the pair-finding cost of every broad-phase type. All types must
+// report the same pairs.
+bool BroadPhaseBench()
+{
+	const b2BroadPhaseType types[] =
+	{
+		b2_dynamicTreeBroadPhase,
+		b2_sweepAndPruneBroadPhase,
+		b2_uniformGridBroadPhase,
+		b2_splitTreeBroadPhase
+	};
+
+	const char* names[] =
+	{
+		"dynamic tree",
+		"sweep and prune",
+		"uniform grid",
+		"split tree"
+	};
+
+	const int32 proxyCounts[] = { 1000, 10000, 50000 };
+
+	bool success = true;
+	for (int32 i = 0; i < 3; ++i)
+	{
+		printf("  %d proxies\n", proxyCounts[i]);
+
+		BroadPhaseResult results[4];
+		for (int32 j = 0; j < 4; ++j)
+		{
+			BroadPhaseResult& result = results[j];
+			result = RunBroadPhase(types[j], proxyCounts[i]);
+
+			char label[64];
+			sprintf(label, "%s create", names[j]);
+			PrintTime(label, result.createTime);
+			sprintf(label, "%s update pairs", names[j]);
+			PrintTime(label, result.updateTime);
+
+			if (result.pairCount != results[0].pairCount || result.hash != results[0].hash)
+			{
+				printf("  %s found %d pairs, the tree %d\n", names[j], result.pairCount, results[0].pairCount);
+				success = Fail("the broad-phase types report different pairs");
+			}
+		}
+	}
+
+	return success;
+}
@@ -0,0 +1,139 @@
+#include "Bench.h"
+#include <cstdio>
+
+struct CreateResult
+{
+	float32 createTime;
+	float32 destroyTime;
+	float32 treeQuality;
+	uint32 createHash;
+	uint32 stepHash;
+};
+
+// Spawns bodyCount boxes and circles scattered over a grid, the way the object
+// manager spawns prefabs, either one CreateBody and CreateFixture at a time or
+// with one CreateBodies call. Then steps the world a little and destroys it.
+static CreateResult RunCreateScene(b2BroadPhaseType type, bool bulk, int32 bodyCount)
+{
+	b2BodyDef* bodyDefs = new b2BodyDef[bodyCount];
+	b2FixtureDef* fixtureDefs = new b2FixtureDef[bodyCount];
+	b2Body** bodies = new b2Body*[bodyCount];
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	SeedRandom(21);
+	int32 columnCount = (int32)b2Sqrt(float32(bodyCount));
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodyDefs[i].type = b2_dynamicBody;
+		bodyDefs[i].position.Set(2.0f * (i % columnCount) + RandomFloat(-0.4f, 0.4f),
+								 2.0f * (i / columnCount) + RandomFloat(-0.4f, 0.4f));
+		bodyDefs[i].angle = RandomFloat(-b2_pi, b2_pi);
+		fixtureDefs[i].shape = (i & 1) ? (b2Shape*)&box : (b2Shape*)&circle;
+		fixtureDefs[i].density = 1.0f;
+	}
+
+	b2World* world = new b2World(b2Vec2(0.0f, -10.0f), type);
+
+	CreateResult result;
+
+	b2Timer timer;
+	if (bulk)
+	{
+		world->CreateBodies(bodyDefs, bodyCount, fixtureDefs, NULL, bodies);
+	}
+	else
+	{
+		for (int32 i = 0; i < bodyCount; ++i)
+		{
+			bodies[i] = world->CreateBody(bodyDefs + i);
+			bodies[i]->CreateFixture(fixtureDefs + i);
+		}
+	}
+	result.createTime = timer.GetMilliseconds();
+	result.treeQuality = world->GetTreeQuality();
+	result.createHash = world->ComputeStateHash();
+
+	StepWorld(world, 10);
+	result.stepHash = world->ComputeStateHash();
+
+	timer.Reset();
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		world->DestroyBody(bodies[i]);
+	}
+	result.destroyTime = timer.GetMilliseconds();
+
+	delete world;
+	delete [] bodyDefs;
+	delete [] fixtureDefs;
+	delete [] bodies;
+	return result;
+}
+
+// Compares CreateBodies with CreateBody and CreateFixture. Both must build the
+// same world, with the same proxy ids, on every broad-phase type.
+bool CreateBench()
+{
+	const int32 bodyCount = 10000;
+	const int32 repeatCount = 5;
+	const b2BroadPhaseType types[4] =
+	{
+		b2_dynamicTreeBroadPhase,
+		b2_sweepAndPruneBroadPhase,
+		b2_uniformGridBroadPhase,
+		b2_splitTreeBroadPhase
+	};
+	const char* names[4] = { "tree", "SAP", "grid", "split tree" };
+
+	printf("  %d bodies, best of %d runs\n", bodyCount, repeatCount);
+
+	bool success = true;
+	for (int32 i = 0; i < 4; ++i)
+	{
+		CreateResult single = RunCreateScene(types[i], false, bodyCount);
+		CreateResult bulk = RunCreateScene(types[i], true, bodyCount);
+
+		// Spawning one batch is short, so keep the best of a few runs.
+		for (int32 repeat = 1; repeat < repeatCount; ++repeat)
+		{
+			CreateResult result = RunCreateScene(types[i], false, bodyCount);
+			single.createTime = b2Min(single.createTime, result.createTime);
+			single.destroyTime = b2Min(single.destroyTime, result.destroyTime);
+
+			result = RunCreateScene(types[i], true, bodyCount);
+			bulk.createTime = b2Min(bulk.createTime, result.createTime);
+			bulk.destroyTime = b2Min(bulk.destroyTime, result.destroyTime);
+		}
+
+		char label[64];
+		sprintf(label, "%s, one by one create", names[i]);
+		PrintTime(label, single.createTime);
+		sprintf(label, "%s, bulk create", names[i]);
+		PrintTime(label, bulk.createTime);
+		sprintf(label, "%s, destroy one by one world", names[i]);
+		PrintTime(label, single.destroyTime);
+		sprintf(label, "%s, destroy bulk world", names[i]);
+		PrintTime(label, bulk.destroyTime);
+
+		if (types[i] == b2_dynamicTreeBroadPhase)
+		{
+			printf("  tree area ratio %.1f one by one, %.1f bulk\n", single.treeQuality, bulk.treeQuality);
+			if (bulk.treeQuality > single.treeQuality)
+			{
+				success = Fail("the bulk tree build made a worse tree");
+			}
+		}
+
+		if (single.createHash != bulk.createHash || single.stepHash != bulk.stepHash)
+		{
+			success = Fail("the bulk created world doesn't match");
+		}
+	}
+
+	return success;
+}
@@ -0,0 +1,102 @@
+#include "Bench.h"
+#include "../../engine/Box2D/Common/b2Parallel.h"
+#include <cstdio>
+
+// A pyramid, a chain of spinning links and tumbling boxes, so the step goes
+// through the contact and joint solvers, b2Rot and the TOI solver.
+static void CreateDeterminismScene(b2World* world)
+{
+	CreatePyramid(world, 20, b2Vec2_zero);
+
+	b2BodyDef anchorDef;
+	anchorDef.position.Set(-25.0f, 20.0f);
+	b2Body* anchor = world->CreateBody(&anchorDef);
+
+	b2PolygonShape link;
+	link.SetAsBox(0.5f, 0.125f);
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	b2RevoluteJointDef jointDef;
+	b2Body* previous = anchor;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bodyDef.position.Set(-24.5f + i, 20.0f);
+		b2Body* body = world->CreateBody(&bodyDef);
+		body->CreateFixture(&link, 1.0f);
+
+		jointDef.Initialize(previous, body, b2Vec2(-25.0f + i, 20.0f));
+		world->CreateJoint(&jointDef);
+		previous = body;
+	}
+
+	b2PolygonShape box;
+	box.SetAsBox(0.3f, 0.6f);
+	SeedRandom(3);
+	for (int32 i = 0; i < 40; ++i)
+	{
+		bodyDef.position.Set(RandomFloat(-10.0f, 10.0f), RandomFloat(25.0f, 40.0f));
+		bodyDef.angle = RandomFloat(-b2_pi, b2_pi);
+		bodyDef.angularVelocity = RandomFloat(-5.0f, 5.0f);
+		bodyDef.bullet = i % 10 == 0;
+		world->CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+	}
+}
+
+// Run the scene and record the state hash of every step.
+static void RunDeterminismScene(bool parallel, uint32* hashes, int32 stepCount)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetParallelIslands(parallel);
+	world.SetParallelNarrowPhase(parallel);
+	world.SetParallelTOI(parallel);
+	CreateDeterminismScene(&world);
+
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		hashes[i] = world.ComputeStateHash();
+	}
+}
+
+// Runs the same scene twice, serially and on the workers, and compares the state
+// hash of every step. The final hash is printed so builds with B2_DETERMINISTIC
+// can be compared with each other.
+bool DeterminismBench()
+{
+	const int32 stepCount = 400;
+
+	uint32* hashes1 = new uint32[stepCount];
+	uint32* hashes2 = new uint32[stepCount];
+	uint32* hashes3 = new uint32[stepCount];
+	RunDeterminismScene(false, hashes1, stepCount);
+	RunDeterminismScene(false, hashes2, stepCount);
+	RunDeterminismScene(true, hashes3, stepCount);
+
+	bool success = true;
+	for (int32 i = 0; i < stepCount && success; ++i)
+	{
+		if (hashes1[i] != hashes2[i])
+		{
+			printf("  step %d differs between runs\n", i);
+			success = Fail("the same scene gave different results");
+		}
+		else if (hashes1[i] != hashes3[i])
+		{
+			printf("  step %d differs on %d workers\n", i, b2GetWorkerCount());
+			success = Fail("the parallel step gave different results");
+		}
+	}
+
+#if defined(B2_DETERMINISTIC)
+	printf("  deterministic build, final hash %08x\n", hashes1[stepCount - 1]);
+#else
+	printf("  final hash %08x\n", hashes1[stepCount - 1]);
+#endif
+
+	delete [] hashes1;
+	delete [] hashes2;
+	delete [] hashes3;
+	return success;
+}
@@ -0,0 +1,160 @@
+#include "Bench.h"
+#include <cstdio>
+
+// Random convex polygons with 3 to 8 vertices and transforms that make about
+// half of the pairs overlap.
+struct KernelScene
+{
+	enum
+	{
+		e_count = 4096
+	};
+
+	b2PolygonShape polygons[e_count];
+	b2CircleShape circles[e_count];
+	b2EdgeShape edges[e_count];
+	b2Transform transforms[e_count];
+};
+
+static void CreateKernelScene(KernelScene* scene)
+{
+	SeedRandom(20);
+	for (int32 i = 0; i < KernelScene::e_count; ++i)
+	{
+		int32 count = 3 + i % 6;
+		// Points on a circle in angular order make a convex polygon.
+		b2Vec2 vertices[b2_maxPolygonVertices];
+		float32 radius = RandomFloat(0.5f, 1.0f);
+		float32 angle = RandomFloat(0.0f, 2.0f * b2_pi);
+		for (int32 j = 0; j < count; ++j)
+		{
+			float32 jitter = RandomFloat(-0.3f, 0.3f) * b2_pi / count;
+			vertices[j].Set(radius * cosf(angle + jitter), radius * sinf(angle + jitter));
+			angle += 2.0f * b2_pi / count;
+		}
+		scene->polygons[i].Set(vertices, count);
+
+		scene->circles[i].m_p.Set(RandomFloat(-0.2f, 0.2f), RandomFloat(-0.2f, 0.2f));
+		scene->circles[i].m_radius = RandomFloat(0.2f, 0.8f);
+
+		scene->edges[i].Set(b2Vec2(RandomFloat(-1.5f, -0.5f), RandomFloat(-0.5f, 0.5f)),
+							b2Vec2(RandomFloat(0.5f, 1.5f), RandomFloat(-0.5f, 0.5f)));
+
+		scene->transforms[i].Set(b2Vec2(RandomFloat(-1.5f, 1.5f), RandomFloat(-1.5f, 1.5f)),
+								 RandomFloat(-b2_pi, b2_pi));
+	}
+}
+
+// Times the collision routines and GJK on random pairs, and checks the polygon
+// manifolds against the GJK distances. Build Box2D with B2_SIMD_COLLISION to
+// time the SIMD kernels.
+bool KernelBench()
+{
+	const int32 repeatCount = 20;
+	const int32 count = KernelScene::e_count;
+
+	KernelScene* scene = new KernelScene;
+	CreateKernelScene(scene);
+
+	b2Transform identity;
+	identity.SetIdentity();
+
+	int32 pointCounts[3] = { 0, 0, 0 };
+	int32 mismatchCount = 0;
+	float32 times[4];
+
+	for (int32 kind = 0; kind < 3; ++kind)
+	{
+		b2Timer timer;
+		for (int32 repeat = 0; repeat < repeatCount; ++repeat)
+		{
+			for (int32 i = 0; i < count; ++i)
+			{
+				const b2PolygonShape* polygon = scene->polygons + i;
+				int32 j = (i + 1) % count;
+
+				b2Manifold manifold;
+				if (kind == 0)
+				{
+					b2CollidePolygons(&manifold, polygon, identity, scene->polygons + j, scene->transforms[i]);
+				}
+				else if (kind == 1)
+				{
+					b2CollidePolygonAndCircle(&manifold, polygon, identity, scene->circles + j, scene->transforms[i]);
+				}
+				else
+				{
+					b2CollideEdgeAndPolygon(&manifold, scene->edges + j, scene->transforms[i], polygon, identity);
+				}
+
+				pointCounts[kind] += manifold.pointCount;
+			}
+		}
+		times[kind] = timer.GetMilliseconds();
+	}
+
+	b2DistanceOutput output;
+	b2Timer timer;
+	for (int32 repeat = 0; repeat < repeatCount; ++repeat)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			int32 j = (i + 1) % count;
+
+			b2DistanceInput input;
+			input.proxyA.Set(scene->polygons + i, 0);
+			input.proxyB.Set(scene->polygons + j, 0);
+			input.transformA = identity;
+			input.transformB = scene->transforms[i];
+			input.useRadii = false;
+
+			b2SimplexCache cache;
+			cache.count = 0;
+			b2Distance(&output, &cache, &input);
+		}
+	}
+	times[3] = timer.GetMilliseconds();
+
+	// The separating axis test can only underestimate the distance, so a pair
+	// without manifold points must be at least the polygon radii apart.
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 j = (i + 1) % count;
+
+		b2DistanceInput input;
+		input.proxyA.Set(scene->polygons + i, 0);
+		input.proxyB.Set(scene->polygons + j, 0);
+		input.transformA = identity;
+		input.transformB = scene->transforms[i];
+		input.useRadii = false;
+
+		b2SimplexCache cache;
+		cache.count = 0;
+		b2Distance(&output, &cache, &input);
+
+		b2Manifold manifold;
+		b2CollidePolygons(&manifold, scene->polygons + i, identity, scene->polygons + j, scene->transforms[i]);
+		float32 radius = scene->polygons[i].m_radius + scene->polygons[j].m_radius;
+		if (manifold.pointCount == 0 && output.distance < radius - b2_linearSlop)
+		{
+			++mismatchCount;
+		}
+	}
+
+	const char* names[4] = { "polygon-polygon", "polygon-circle", "edge-polygon", "GJK distance" };
+	for (int32 i = 0; i < 4; ++i)
+	{
+		printf("  %-40s %10.1f ns\n", names[i], 1.0e6f * times[i] / (repeatCount * count));
+	}
+	printf("  manifold points %d %d %d\n", pointCounts[0], pointCounts[1], pointCounts[2]);
+
+	delete scene;
+
+	if (mismatchCount > 0)
+	{
+		printf("  %d polygon pairs disagree with GJK\n", mismatchCount);
+		return Fail("the polygon manifolds don't match the distances");
+	}
+
+	return true;
+}
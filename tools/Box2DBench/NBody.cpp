@@ -0,0 +1,163 @@
+#include "Bench.h"
+#include <cstdio>
+
+// The pull Planet::FixedUpdate used to apply, without its range scaling, so the
+// N-body sources are compared with the exact pairwise sum.
+#define PLANET_GRAVITY_CONSTANT 9.8f
+
+enum NBodyMode
+{
+	e_bruteForce,
+	e_exactTree,
+	e_approximateTree
+};
+
+struct NBodyResult
+{
+	float32 stepTime;
+	b2Vec2* velocities;
+};
+
+// Static planets and small dynamic bodies scattered over the same area. The brute
+// force mode loops over every planet and body before each step like
+// Planet::FixedUpdate did, the others use N-body gravity sources.
+static NBodyResult RunNBodyScene(NBodyMode mode, int32 planetCount, int32 bodyCount, int32 stepCount)
+{
+	const float32 extent = 400.0f;
+	const float32 planetMass = 100.0f;
+	const float32 minRadius = 0.1f;
+
+	b2World world(b2Vec2_zero);
+	world.SetNBodyGravity(mode != e_bruteForce);
+	world.SetNBodyTheta(mode == e_approximateTree ? 0.5f : 0.0f);
+
+	SeedRandom(16);
+	b2Vec2* planets = new b2Vec2[planetCount];
+	b2CircleShape planetShape;
+	planetShape.m_radius = 2.0f;
+	for (int32 i = 0; i < planetCount; ++i)
+	{
+		b2BodyDef planetDef;
+		planetDef.position.Set(RandomFloat(0.0f, extent), RandomFloat(0.0f, extent));
+		b2Body* planet = world.CreateBody(&planetDef);
+		planet->CreateFixture(&planetShape, 0.0f);
+		planets[i] = planetDef.position;
+
+		if (mode != e_bruteForce)
+		{
+			b2GravitySourceDef sourceDef;
+			sourceDef.body = planet;
+			sourceDef.strength = PLANET_GRAVITY_CONSTANT * planetMass;
+			sourceDef.radius = 2.0f * extent;
+			sourceDef.minRadius = minRadius;
+			world.CreateGravitySource(&sourceDef);
+		}
+	}
+
+	b2Body** bodies = new b2Body*[bodyCount];
+	b2CircleShape bodyShape;
+	bodyShape.m_radius = 0.25f;
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		// Keep clear of the planets, so the first step has no contacts.
+		bool clear = false;
+		while (clear == false)
+		{
+			bodyDef.position.Set(RandomFloat(0.0f, extent), RandomFloat(0.0f, extent));
+			clear = true;
+			for (int32 j = 0; j < planetCount && clear; ++j)
+			{
+				clear = b2DistanceSquared(planets[j], bodyDef.position) > 9.0f;
+			}
+		}
+
+		bodies[i] = world.CreateBody(&bodyDef);
+		bodies[i]->CreateFixture(&bodyShape, 1.0f);
+	}
+
+	NBodyResult result;
+	result.velocities = new b2Vec2[bodyCount];
+
+	b2Timer timer;
+	for (int32 step = 0; step < stepCount; ++step)
+	{
+		for (int32 i = 0; i < planetCount && mode == e_bruteForce; ++i)
+		{
+			for (int32 j = 0; j < bodyCount; ++j)
+			{
+				b2Vec2 d = planets[i] - bodies[j]->GetWorldCenter();
+				float32 distance = b2Max(d.Normalize(), minRadius);
+				float32 force = PLANET_GRAVITY_CONSTANT * planetMass * bodies[j]->GetMass() / (distance * distance);
+				bodies[j]->ApplyForceToCenter(force * d);
+			}
+		}
+
+		world.Step(1.0f / 60.0f, 8, 3);
+
+		// The first step starts from rest, so it shows the accelerations.
+		for (int32 i = 0; i < bodyCount && step == 0; ++i)
+		{
+			result.velocities[i] = bodies[i]->GetLinearVelocity();
+		}
+	}
+	result.stepTime = timer.GetMilliseconds() / stepCount;
+
+	delete [] planets;
+	delete [] bodies;
+	return result;
+}
+
+// Get the error of the first step velocities relative to the brute force ones,
+// summed over all bodies. Single bodies can have tiny velocities where the pulls
+// cancel out, so they are not compared one by one.
+static float32 GetRelativeError(const NBodyResult& reference, const NBodyResult& result, int32 bodyCount)
+{
+	float32 error = 0.0f;
+	float32 magnitude = 0.0f;
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		error += b2Distance(reference.velocities[i], result.velocities[i]);
+		magnitude += reference.velocities[i].Length();
+	}
+
+	return error / b2Max(magnitude, b2_epsilon);
+}
+
+// Compares the Barnes-Hut gravity tree, exact and approximate, with the brute
+// force planet loop.
+bool NBodyBench()
+{
+	const int32 planetCounts[] = { 64, 1000 };
+	const int32 bodyCount = 4000;
+	const int32 stepCount = 20;
+
+	bool success = true;
+	for (int32 i = 0; i < 2; ++i)
+	{
+		NBodyResult bruteForce = RunNBodyScene(e_bruteForce, planetCounts[i], bodyCount, stepCount);
+		NBodyResult exact = RunNBodyScene(e_exactTree, planetCounts[i], bodyCount, stepCount);
+		NBodyResult approximate = RunNBodyScene(e_approximateTree, planetCounts[i], bodyCount, stepCount);
+
+		float32 exactError = GetRelativeError(bruteForce, exact, bodyCount);
+		float32 approximateError = GetRelativeError(bruteForce, approximate, bodyCount);
+
+		printf("  %d planets, %d bodies\n", planetCounts[i], bodyCount);
+		PrintTime("brute force step", bruteForce.stepTime);
+		PrintTime("tree step, theta 0", exact.stepTime);
+		PrintTime("tree step, theta 0.5", approximate.stepTime);
+		printf("  relative error %.2e at theta 0, %.2e at theta 0.5\n", exactError, approximateError);
+
+		if (exactError > 1.0e-3f || approximateError > 0.05f)
+		{
+			success = Fail("the gravity tree is off");
+		}
+
+		delete [] bruteForce.velocities;
+		delete [] exact.velocities;
+		delete [] approximate.velocities;
+	}
+
+	return success;
+}
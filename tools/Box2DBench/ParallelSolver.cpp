@@ -0,0 +1,145 @@
+#include "Bench.h"
+#include "../../engine/Box2D/Common/b2Parallel.h"
+#include <cstdio>
+
+enum SolverMode
+{
+	e_scalarSolver,
+	e_wideSolver,
+	e_parallelSolver
+};
+
+// A 2016-box pyramid, one big island, whose bottom row is pinned together so
+// the colors mix contacts and joints. A hanging joint chain and a gear pair
+// beside it are solved as small islands.
+static void CreateIslandScene(b2World* world)
+{
+	CreatePyramid(world, 63, b2Vec2_zero);
+
+	// The body list runs backwards, so the bottom row comes last, right to left.
+	b2RevoluteJointDef pinDef;
+	b2Body* right = NULL;
+	for (b2Body* body = world->GetBodyList(); body; body = body->GetNext())
+	{
+		if (body->GetType() != b2_dynamicBody || body->GetPosition().y > 1.0f)
+		{
+			continue;
+		}
+
+		if (right)
+		{
+			pinDef.Initialize(body, right, body->GetPosition() + b2Vec2(0.5f, 0.0f));
+			world->CreateJoint(&pinDef);
+		}
+		right = body;
+	}
+
+	b2BodyDef anchorDef;
+	anchorDef.position.Set(-45.0f, 30.0f);
+	b2Body* anchor = world->CreateBody(&anchorDef);
+
+	b2PolygonShape link;
+	link.SetAsBox(0.125f, 0.5f);
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	b2RevoluteJointDef jointDef;
+	b2Body* previous = anchor;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bodyDef.position.Set(-45.0f, 29.5f - i);
+		b2Body* body = world->CreateBody(&bodyDef);
+		body->CreateFixture(&link, 1.0f);
+
+		jointDef.Initialize(previous, body, b2Vec2(-45.0f, 30.0f - i));
+		world->CreateJoint(&jointDef);
+		previous = body;
+	}
+
+	b2CircleShape wheel;
+	wheel.m_radius = 1.0f;
+
+	b2RevoluteJoint* wheelJoints[2];
+	b2Body* wheels[2];
+	for (int32 i = 0; i < 2; ++i)
+	{
+		bodyDef.position.Set(-40.0f + 2.5f * i, 5.0f);
+		wheels[i] = world->CreateBody(&bodyDef);
+		wheels[i]->CreateFixture(&wheel, 1.0f);
+		wheels[i]->SetAngularVelocity(i == 0 ? 4.0f : 0.0f);
+
+		jointDef.Initialize(anchor, wheels[i], bodyDef.position);
+		wheelJoints[i] = (b2RevoluteJoint*)world->CreateJoint(&jointDef);
+	}
+
+	b2GearJointDef gearDef;
+	gearDef.bodyA = wheels[0];
+	gearDef.bodyB = wheels[1];
+	gearDef.joint1 = wheelJoints[0];
+	gearDef.joint2 = wheelJoints[1];
+	gearDef.ratio = 1.0f;
+	world->CreateJoint(&gearDef);
+}
+
+struct SolverResult
+{
+	float32 solveTime;
+	uint32 hash;
+};
+
+static SolverResult RunIslandScene(b2World* world, SolverMode mode, int32 stepCount)
+{
+	world->SetWideSolver(mode == e_wideSolver);
+	world->SetParallelSolver(mode == e_parallelSolver);
+	CreateIslandScene(world);
+
+	SolverResult result;
+	result.solveTime = 0.0f;
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		world->Step(1.0f / 60.0f, 8, 3);
+		result.solveTime += world->GetProfile().solve;
+	}
+	result.solveTime /= stepCount;
+	result.hash = world->ComputeStateHash();
+	return result;
+}
+
+// Solves one large island with the scalar, wide and graph-colored parallel
+// solvers. The parallel solver visits the constraints in another order, so it
+// only matches the scalar solver within a tolerance, but it must give the same
+// result on every run whatever the worker count.
+bool ParallelSolverBench()
+{
+	const int32 stepCount = 120;
+
+	b2World scalarWorld(b2Vec2(0.0f, -10.0f));
+	b2World wideWorld(b2Vec2(0.0f, -10.0f));
+	b2World parallelWorld(b2Vec2(0.0f, -10.0f));
+	b2World repeatWorld(b2Vec2(0.0f, -10.0f));
+
+	SolverResult scalar = RunIslandScene(&scalarWorld, e_scalarSolver, stepCount);
+	SolverResult wide = RunIslandScene(&wideWorld, e_wideSolver, stepCount);
+	SolverResult parallel = RunIslandScene(&parallelWorld, e_parallelSolver, stepCount);
+	SolverResult repeat = RunIslandScene(&repeatWorld, e_parallelSolver, stepCount);
+
+	printf("  %d bodies, %d workers, parallel hash %08x\n", scalarWorld.GetBodyCount(), b2GetWorkerCount(), parallel.hash);
+	PrintTime("scalar solve", scalar.solveTime);
+	PrintTime("wide solve", wide.solveTime);
+	PrintTime("parallel solve", parallel.solveTime);
+
+	if (parallel.hash != repeat.hash)
+	{
+		return Fail("the parallel solver gave different results on two runs");
+	}
+
+	float32 separation = GetMaxSeparation(&scalarWorld, &parallelWorld);
+	printf("  max separation from the scalar solver %.4f m\n", separation);
+	if (separation > 0.1f)
+	{
+		return Fail("the parallel solver doesn't match the scalar solver");
+	}
+
+	return true;
+}
@@ -0,0 +1,349 @@
+#include "Bench.h"
+#include "../../engine/Box2D/Rope/b2Rope.h"
+#include "../../engine/Box2D/Rope/b2RopeSystem.h"
+#include <cstdio>
+#include <cstring>
+
+// The scalar Verlet rope b2Rope used before it moved onto b2RopeSystem, kept
+// here as the reference.
+struct ScalarRope
+{
+	int32 count;
+	b2Vec2* ps;
+	b2Vec2* p0s;
+	b2Vec2* vs;
+	float32* ims;
+	float32* Ls;
+	float32* as;
+	b2Vec2 gravity;
+	float32 damping;
+	float32 k2;
+	float32 k3;
+};
+
+static void InitializeScalarRope(ScalarRope* rope, const b2RopeDef* def)
+{
+	rope->count = def->count;
+	rope->ps = new b2Vec2[def->count];
+	rope->p0s = new b2Vec2[def->count];
+	rope->vs = new b2Vec2[def->count];
+	rope->ims = new float32[def->count];
+	rope->Ls = new float32[def->count - 1];
+	rope->as = new float32[def->count - 2];
+
+	for (int32 i = 0; i < def->count; ++i)
+	{
+		rope->ps[i] = def->vertices[i];
+		rope->p0s[i] = def->vertices[i];
+		rope->vs[i].SetZero();
+		rope->ims[i] = def->masses[i] > 0.0f ? 1.0f / def->masses[i] : 0.0f;
+	}
+
+	for (int32 i = 0; i < def->count - 1; ++i)
+	{
+		rope->Ls[i] = b2Distance(rope->ps[i], rope->ps[i + 1]);
+	}
+
+	for (int32 i = 0; i < def->count - 2; ++i)
+	{
+		b2Vec2 d1 = rope->ps[i + 1] - rope->ps[i];
+		b2Vec2 d2 = rope->ps[i + 2] - rope->ps[i + 1];
+		rope->as[i] = b2Atan2(b2Cross(d1, d2), b2Dot(d1, d2));
+	}
+
+	rope->gravity = def->gravity;
+	rope->damping = def->damping;
+	rope->k2 = def->k2;
+	rope->k3 = def->k3;
+}
+
+static void DestroyScalarRope(ScalarRope* rope)
+{
+	delete [] rope->ps;
+	delete [] rope->p0s;
+	delete [] rope->vs;
+	delete [] rope->ims;
+	delete [] rope->Ls;
+	delete [] rope->as;
+}
+
+static void SolveScalarC2(ScalarRope* rope)
+{
+	for (int32 i = 0; i < rope->count - 1; ++i)
+	{
+		b2Vec2 p1 = rope->ps[i];
+		b2Vec2 p2 = rope->ps[i + 1];
+
+		b2Vec2 d = p2 - p1;
+		float32 L = d.Normalize();
+
+		float32 im1 = rope->ims[i];
+		float32 im2 = rope->ims[i + 1];
+		if (im1 + im2 == 0.0f)
+		{
+			continue;
+		}
+
+		float32 s1 = im1 / (im1 + im2);
+		float32 s2 = im2 / (im1 + im2);
+
+		rope->ps[i] = p1 - rope->k2 * s1 * (rope->Ls[i] - L) * d;
+		rope->ps[i + 1] = p2 + rope->k2 * s2 * (rope->Ls[i] - L) * d;
+	}
+}
+
+static void SolveScalarC3(ScalarRope* rope)
+{
+	for (int32 i = 0; i < rope->count - 2; ++i)
+	{
+		b2Vec2 p1 = rope->ps[i];
+		b2Vec2 p2 = rope->ps[i + 1];
+		b2Vec2 p3 = rope->ps[i + 2];
+
+		float32 m1 = rope->ims[i];
+		float32 m2 = rope->ims[i + 1];
+		float32 m3 = rope->ims[i + 2];
+
+		b2Vec2 d1 = p2 - p1;
+		b2Vec2 d2 = p3 - p2;
+
+		float32 L1sqr = d1.LengthSquared();
+		float32 L2sqr = d2.LengthSquared();
+		if (L1sqr * L2sqr == 0.0f)
+		{
+			continue;
+		}
+
+		float32 angle = b2Atan2(b2Cross(d1, d2), b2Dot(d1, d2));
+
+		b2Vec2 Jd1 = (-1.0f / L1sqr) * d1.Skew();
+		b2Vec2 Jd2 = (1.0f / L2sqr) * d2.Skew();
+
+		b2Vec2 J1 = -Jd1;
+		b2Vec2 J2 = Jd1 - Jd2;
+		b2Vec2 J3 = Jd2;
+
+		float32 mass = m1 * b2Dot(J1, J1) + m2 * b2Dot(J2, J2) + m3 * b2Dot(J3, J3);
+		if (mass == 0.0f)
+		{
+			continue;
+		}
+
+		mass = 1.0f / mass;
+
+		float32 C = angle - rope->as[i];
+		while (C > b2_pi)
+		{
+			angle -= 2 * b2_pi;
+			C = angle - rope->as[i];
+		}
+
+		while (C < -b2_pi)
+		{
+			angle += 2.0f * b2_pi;
+			C = angle - rope->as[i];
+		}
+
+		float32 impulse = - rope->k3 * mass * C;
+
+		rope->ps[i] = p1 + (m1 * impulse) * J1;
+		rope->ps[i + 1] = p2 + (m2 * impulse) * J2;
+		rope->ps[i + 2] = p3 + (m3 * impulse) * J3;
+	}
+}
+
+static void StepScalarRope(ScalarRope* rope, float32 h, int32 iterations)
+{
+	float32 d = expf(- h * rope->damping);
+
+	for (int32 i = 0; i < rope->count; ++i)
+	{
+		rope->p0s[i] = rope->ps[i];
+		if (rope->ims[i] > 0.0f)
+		{
+			rope->vs[i] += h * rope->gravity;
+		}
+		rope->vs[i] *= d;
+		rope->ps[i] += h * rope->vs[i];
+	}
+
+	for (int32 i = 0; i < iterations; ++i)
+	{
+		SolveScalarC2(rope);
+		SolveScalarC3(rope);
+		SolveScalarC2(rope);
+	}
+
+	float32 inv_h = 1.0f / h;
+	for (int32 i = 0; i < rope->count; ++i)
+	{
+		rope->vs[i] = inv_h * (rope->ps[i] - rope->p0s[i]);
+	}
+}
+
+enum RopeMode
+{
+	e_scalarRopes,
+	e_singleRopes,
+	e_ropeSystem
+};
+
+struct RopeResult
+{
+	float32 stepTime;
+	b2Vec2* vertices;
+};
+
+// Tethers of 10 to 32 vertices, pinned at the first vertex and released
+// sideways so they swing down. The vertices of every rope are copied out one
+// after the other at the end.
+static RopeResult RunRopeScene(RopeMode mode, int32 ropeCount, int32 stepCount, int32 iterations, int32 vertexCount)
+{
+	ScalarRope* scalarRopes = new ScalarRope[ropeCount];
+	b2Rope* singleRopes = mode == e_singleRopes ? new b2Rope[ropeCount] : NULL;
+	b2RopeSystem system;
+	int32* ropeIds = new int32[ropeCount];
+
+	b2Vec2 vertices[32];
+	float32 masses[32];
+
+	SeedRandom(22);
+	for (int32 i = 0; i < ropeCount; ++i)
+	{
+		b2RopeDef def;
+		def.count = 10 + i % 23;
+		def.vertices = vertices;
+		def.masses = masses;
+		def.gravity.Set(0.0f, -10.0f);
+		def.k3 = 0.5f * RandomFloat(0.1f, 0.9f);
+
+		b2Vec2 anchor(2.0f * (i % 20), -40.0f * (i / 20));
+		float32 angle = RandomFloat(-0.25f * b2_pi, 0.25f * b2_pi);
+		for (int32 j = 0; j < def.count; ++j)
+		{
+			vertices[j] = anchor + (0.5f * j) * b2Vec2(cosf(angle), sinf(angle));
+			masses[j] = j == 0 ? 0.0f : 1.0f;
+		}
+
+		if (mode == e_scalarRopes)
+		{
+			InitializeScalarRope(scalarRopes + i, &def);
+		}
+		else if (mode == e_singleRopes)
+		{
+			singleRopes[i].Initialize(&def);
+		}
+		else
+		{
+			ropeIds[i] = system.CreateRope(&def);
+		}
+	}
+
+	const float32 timeStep = 1.0f / 60.0f;
+
+	b2Timer timer;
+	for (int32 step = 0; step < stepCount; ++step)
+	{
+		for (int32 i = 0; i < ropeCount && mode == e_scalarRopes; ++i)
+		{
+			StepScalarRope(scalarRopes + i, timeStep, iterations);
+		}
+
+		for (int32 i = 0; i < ropeCount && mode == e_singleRopes; ++i)
+		{
+			singleRopes[i].Step(timeStep, iterations);
+		}
+
+		if (mode == e_ropeSystem)
+		{
+			system.Step(timeStep, iterations);
+		}
+	}
+
+	RopeResult result;
+	result.stepTime = timer.GetMilliseconds() / stepCount;
+	result.vertices = new b2Vec2[vertexCount];
+
+	b2Vec2* out = result.vertices;
+	for (int32 i = 0; i < ropeCount; ++i)
+	{
+		if (mode == e_scalarRopes)
+		{
+			memcpy(out, scalarRopes[i].ps, scalarRopes[i].count * sizeof(b2Vec2));
+			out += scalarRopes[i].count;
+			DestroyScalarRope(scalarRopes + i);
+		}
+		else if (mode == e_singleRopes)
+		{
+			memcpy(out, singleRopes[i].GetVertices(), singleRopes[i].GetVertexCount() * sizeof(b2Vec2));
+			out += singleRopes[i].GetVertexCount();
+		}
+		else
+		{
+			system.GetVertices(ropeIds[i], out);
+			out += system.GetVertexCount(ropeIds[i]);
+		}
+	}
+
+	delete [] scalarRopes;
+	delete [] singleRopes;
+	delete [] ropeIds;
+	return result;
+}
+
+static float32 GetVertexSeparation(const RopeResult& result1, const RopeResult& result2, int32 vertexCount)
+{
+	float32 separation = 0.0f;
+	for (int32 i = 0; i < vertexCount; ++i)
+	{
+		separation = b2Max(separation, b2Distance(result1.vertices[i], result2.vertices[i]));
+	}
+
+	return separation;
+}
+
+// Compares the packed rope system with one b2Rope per rope and with the old
+// scalar rope. The lanes of a pack are independent, so a rope must end up in
+// the same place whether it has a pack of its own or shares one, and the packs
+// must follow the scalar rope over every step.
+bool RopeBench()
+{
+	const int32 ropeCount = 400;
+	const int32 stepCount = 300;
+	const int32 iterations = 8;
+
+	int32 vertexCount = 0;
+	for (int32 i = 0; i < ropeCount; ++i)
+	{
+		vertexCount += 10 + i % 23;
+	}
+
+	RopeResult scalar = RunRopeScene(e_scalarRopes, ropeCount, stepCount, iterations, vertexCount);
+	RopeResult single = RunRopeScene(e_singleRopes, ropeCount, stepCount, iterations, vertexCount);
+	RopeResult system = RunRopeScene(e_ropeSystem, ropeCount, stepCount, iterations, vertexCount);
+
+	float32 singleSeparation = GetVertexSeparation(single, system, vertexCount);
+	float32 scalarSeparation = GetVertexSeparation(scalar, system, vertexCount);
+
+	printf("  %d ropes, %d vertices, %d iterations\n", ropeCount, vertexCount, iterations);
+	PrintTime("scalar rope step", scalar.stepTime);
+	PrintTime("b2Rope step", single.stepTime);
+	PrintTime("rope system step", system.stepTime);
+	printf("  max separation from the scalar rope %.2e m\n", scalarSeparation);
+
+	delete [] scalar.vertices;
+	delete [] single.vertices;
+	delete [] system.vertices;
+
+	if (singleSeparation > 0.0f)
+	{
+		return Fail("a rope moves differently in a shared pack");
+	}
+
+	if (scalarSeparation > 0.0f)
+	{
+		return Fail("the rope system doesn't match the scalar rope");
+	}
+
+	return true;
+}
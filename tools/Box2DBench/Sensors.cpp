@@ -0,0 +1,108 @@
+#include "Bench.h"
+#include <cstdio>
+
+// Count the events of the last step that involve a fixture.
+static int32 CountEvents(const b2SensorEvent* events, int32 count, const b2Fixture* fixture)
+{
+	int32 matchCount = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (events[i].sensorFixture == fixture || events[i].visitorFixture == fixture)
+		{
+			++matchCount;
+		}
+	}
+
+	return matchCount;
+}
+
+// Create a dynamic circle inside the sensor box.
+static b2Fixture* CreateVisitor(b2World* world, float32 x)
+{
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(x, 0.0f);
+	b2Body* body = world->CreateBody(&bodyDef);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+	return body->CreateFixture(&circle, 1.0f);
+}
+
+// Destroys visitors right after the step that found them, and makes sure the
+// next step reports nothing for them, even when a new fixture takes over the
+// memory of a destroyed one.
+bool SensorBench()
+{
+	b2World world(b2Vec2_zero);
+	world.SetSensorEvents(true);
+
+	b2BodyDef groundDef;
+	b2Body* ground = world.CreateBody(&groundDef);
+
+	b2PolygonShape box;
+	box.SetAsBox(10.0f, 10.0f);
+
+	b2FixtureDef sensorDef;
+	sensorDef.shape = &box;
+	sensorDef.isSensor = true;
+	b2Fixture* sensor = ground->CreateFixture(&sensorDef);
+
+	// A visitor destroyed in the step after it began overlapping gets no end
+	// event.
+	b2Fixture* visitor = CreateVisitor(&world, 0.0f);
+	world.Step(1.0f / 60.0f, 8, 3);
+	if (world.GetSensorBeginEventCount() != 1 || world.GetSensorBeginEvents()[0].sensorFixture != sensor ||
+		world.GetSensorBeginEvents()[0].visitorFixture != visitor)
+	{
+		return Fail("the visitor didn't begin overlapping the sensor");
+	}
+
+	world.DestroyBody(visitor->GetBody());
+	world.Step(1.0f / 60.0f, 8, 3);
+	if (world.GetSensorBeginEventCount() != 0 || world.GetSensorEndEventCount() != 0)
+	{
+		return Fail("a destroyed visitor was reported");
+	}
+
+	// A visitor made a sensor stays held by the sensor until the next step.
+	// When it is destroyed, a new fixture may take its memory and must be
+	// reported as a new visitor.
+	visitor = CreateVisitor(&world, 1.0f);
+	world.Step(1.0f / 60.0f, 8, 3);
+	if (CountEvents(world.GetSensorBeginEvents(), world.GetSensorBeginEventCount(), visitor) != 1)
+	{
+		return Fail("the second visitor didn't begin overlapping the sensor");
+	}
+
+	b2Body* body = visitor->GetBody();
+	visitor->SetSensor(true);
+	body->DestroyFixture(visitor);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+	b2Fixture* reused = body->CreateFixture(&circle, 1.0f);
+	if (reused != visitor)
+	{
+		return Fail("the new fixture didn't reuse the memory of the destroyed one");
+	}
+
+	world.Step(1.0f / 60.0f, 8, 3);
+	if (world.GetSensorBeginEventCount() != 1 || world.GetSensorBeginEvents()[0].visitorFixture != reused ||
+		world.GetSensorEndEventCount() != 0)
+	{
+		return Fail("the fixture at a reused address wasn't reported as new");
+	}
+
+	// A visitor created and destroyed between two steps is never seen.
+	visitor = CreateVisitor(&world, -1.0f);
+	world.DestroyBody(visitor->GetBody());
+	world.Step(1.0f / 60.0f, 8, 3);
+	if (world.GetSensorBeginEventCount() != 0 || world.GetSensorEndEventCount() != 0)
+	{
+		return Fail("a visitor destroyed before the step was reported");
+	}
+
+	printf("  destroyed and reused visitors reported correctly\n");
+	return true;
+}
@@ -0,0 +1,290 @@
+#include "Bench.h"
+#include "../../engine/Box2D/Common/b2Snapshot.h"
+#include <cstdio>
+#include <cstring>
+
+// Step two worlds side by side and compare their state hashes every step.
+static bool StepMatches(b2World* world1, b2World* world2, int32 stepCount)
+{
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		world1->Step(1.0f / 60.0f, 8, 3);
+		world2->Step(1.0f / 60.0f, 8, 3);
+		if (world1->ComputeStateHash() != world2->ComputeStateHash())
+		{
+			printf("  step %d differs\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// A small pyramid next to a swinging chain of boxes, circles on a sensor
+// and an edge, so the snapshot holds every kind of data.
+static void CreateSnapshotScene(b2World* world)
+{
+	CreatePyramid(world, 8, b2Vec2_zero);
+
+	b2BodyDef anchorDef;
+	anchorDef.position.Set(-15.0f, 10.0f);
+	b2Body* anchor = world->CreateBody(&anchorDef);
+
+	b2EdgeShape edge;
+	edge.Set(b2Vec2(-5.0f, 0.0f), b2Vec2(5.0f, -2.0f));
+	anchor->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape link;
+	link.SetAsBox(0.5f, 0.125f);
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	b2RevoluteJointDef jointDef;
+	b2Body* previous = anchor;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		bodyDef.position.Set(-14.5f + i, 10.0f);
+		b2Body* body = world->CreateBody(&bodyDef);
+		body->CreateFixture(&link, 1.0f);
+
+		jointDef.Initialize(previous, body, b2Vec2(-15.0f + i, 10.0f));
+		world->CreateJoint(&jointDef);
+		previous = body;
+	}
+
+	b2CircleShape sensorShape;
+	sensorShape.m_radius = 3.0f;
+	b2FixtureDef sensorDef;
+	sensorDef.shape = &sensorShape;
+	sensorDef.isSensor = true;
+	anchor->CreateFixture(&sensorDef);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.4f;
+	for (int32 i = 0; i < 5; ++i)
+	{
+		bodyDef.position.Set(-15.0f + 0.3f * i, 12.0f + i);
+		bodyDef.bullet = i == 0;
+		world->CreateBody(&bodyDef)->CreateFixture(&circle, 1.0f);
+	}
+}
+
+// Stores body user data as the index of the body in a table, the way a bug
+// report would store object ids.
+class IndexSnapshotListener : public b2SnapshotListener
+{
+public:
+	IndexSnapshotListener(b2Body** table, int32 count) : m_table(table), m_count(count) {}
+
+	void* SaveUserData(void* userData)
+	{
+		for (int32 i = 0; i < m_count; ++i)
+		{
+			if (m_table + i == userData)
+			{
+				return (void*)(size_t)(i + 1);
+			}
+		}
+		return NULL;
+	}
+
+	void* RestoreUserData(void* value)
+	{
+		size_t index = (size_t)value - 1;
+		return index < (size_t)m_count ? m_table + index : NULL;
+	}
+
+	b2Body** m_table;
+	int32 m_count;
+};
+
+// Saves the user data of the joint scene as table indices and restores it
+// into a second table.
+static bool CheckUserDataRemap(b2World* world)
+{
+	const int32 tableSize = 64;
+	b2Body* savedTable[tableSize];
+	b2Body* restoredTable[tableSize];
+
+	int32 bodyCount = 0;
+	for (b2Body* b = world->GetBodyList(); b && bodyCount < tableSize; b = b->GetNext())
+	{
+		savedTable[bodyCount] = b;
+		b->SetUserData(savedTable + bodyCount);
+		++bodyCount;
+	}
+
+	b2Snapshot snapshot;
+	IndexSnapshotListener saveListener(savedTable, bodyCount);
+	world->SetSnapshotListener(&saveListener);
+	world->SaveSnapshot(&snapshot);
+	world->SetSnapshotListener(NULL);
+
+	b2World restored(b2Vec2(0.0f, -10.0f));
+	IndexSnapshotListener restoreListener(restoredTable, bodyCount);
+	restored.SetSnapshotListener(&restoreListener);
+	if (restored.RestoreSnapshot(snapshot) == false)
+	{
+		return Fail("a snapshot with remapped user data was rejected");
+	}
+
+	// Both lists keep the same order.
+	bool success = true;
+	b2Body* r = restored.GetBodyList();
+	for (b2Body* b = world->GetBodyList(); b && r; b = b->GetNext(), r = r->GetNext())
+	{
+		int32 index = (int32)((b2Body**)b->GetUserData() - savedTable);
+		if (r->GetUserData() != restoredTable + index)
+		{
+			success = Fail("the user data wasn't remapped");
+			break;
+		}
+	}
+
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		b->SetUserData(NULL);
+	}
+
+	return success;
+}
+
+// Restore damaged copies of a snapshot and step the worlds that accept them.
+// Truncated data must always be rejected; other damage must be rejected or
+// restore into a world that steps without crashing. A rejected snapshot must
+// leave the running world exactly as it was.
+static bool CheckDamagedSnapshots(const b2Snapshot& snapshot)
+{
+	const int32 caseCount = 2000;
+
+	const char* data = (const char*)snapshot.GetData();
+	int32 size = snapshot.GetSize();
+	char* copy = new char[size];
+
+	// The running world, with pointers the game would hold on to.
+	b2World running(b2Vec2(0.0f, -10.0f));
+	running.RestoreSnapshot(snapshot);
+	b2Body* firstBody = running.GetBodyList();
+	uint32 runningHash = running.ComputeStateHash();
+
+	SeedRandom(11);
+	bool success = true;
+	for (int32 i = 0; i < 100; ++i)
+	{
+		int32 truncatedSize = (int32)RandomFloat(0.0f, size - 1.0f);
+		if (running.RestoreSnapshot(data, truncatedSize))
+		{
+			success = Fail("a truncated snapshot was accepted");
+			break;
+		}
+
+		if (running.GetBodyList() != firstBody || running.ComputeStateHash() != runningHash)
+		{
+			success = Fail("a rejected snapshot changed the world");
+			break;
+		}
+	}
+
+	int32 acceptedCount = 0;
+	for (int32 i = 0; i < caseCount; ++i)
+	{
+		memcpy(copy, data, size);
+		int32 offset = b2Min((int32)RandomFloat(0.0f, float32(size)), size - 1);
+		if (i & 1)
+		{
+			copy[offset] ^= 1 << ((int32)RandomFloat(0.0f, 7.99f));
+		}
+		else
+		{
+			for (int32 j = offset; j < size && j < offset + 4; ++j)
+			{
+				copy[j] = (char)(int32)RandomFloat(0.0f, 255.99f);
+			}
+		}
+
+		b2World world(b2Vec2(0.0f, -10.0f));
+		if (world.RestoreSnapshot(copy, size))
+		{
+			++acceptedCount;
+			StepWorld(&world, 10);
+		}
+		else if (running.RestoreSnapshot(copy, size) || running.GetBodyList() != firstBody ||
+				 running.ComputeStateHash() != runningHash)
+		{
+			success = Fail("a rejected snapshot changed the world");
+			break;
+		}
+	}
+
+	// The world still steps like one that never saw the damaged data.
+	b2World reference(b2Vec2(0.0f, -10.0f));
+	reference.RestoreSnapshot(snapshot);
+	if (success && StepMatches(&running, &reference, 30) == false)
+	{
+		success = Fail("the world diverged after rejecting snapshots");
+	}
+
+	printf("  %d of %d damaged snapshots accepted and stepped\n", acceptedCount, caseCount);
+
+	delete [] copy;
+	return success;
+}
+
+// Times saving and restoring a snapshot of 10k bodies and checks that the
+// restored world steps exactly like the saved one.
+bool SnapshotBench()
+{
+	const int32 repeatCount = 10;
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+	int32 boxCount = CreatePyramid(&world, 141, b2Vec2_zero);
+	StepWorld(&world, 30);
+
+	b2Snapshot snapshot;
+	b2Timer timer;
+	for (int32 i = 0; i < repeatCount; ++i)
+	{
+		world.SaveSnapshot(&snapshot);
+	}
+	float32 saveTime = timer.GetMilliseconds() / repeatCount;
+
+	b2World restored(b2Vec2(0.0f, -10.0f));
+	timer.Reset();
+	for (int32 i = 0; i < repeatCount; ++i)
+	{
+		if (restored.RestoreSnapshot(snapshot) == false)
+		{
+			return Fail("a clean snapshot was rejected");
+		}
+	}
+	float32 restoreTime = timer.GetMilliseconds() / repeatCount;
+
+	printf("  %d boxes, %d contacts, %d bytes\n", boxCount, world.GetContactCount(), snapshot.GetSize());
+	PrintTime("save", saveTime);
+	PrintTime("restore", restoreTime);
+
+	if (StepMatches(&world, &restored, 30) == false)
+	{
+		return Fail("the restored world diverged");
+	}
+
+	b2World small(b2Vec2(0.0f, -10.0f));
+	CreateSnapshotScene(&small);
+	StepWorld(&small, 60);
+	small.SaveSnapshot(&snapshot);
+
+	b2World smallRestored(b2Vec2(0.0f, -10.0f));
+	if (smallRestored.RestoreSnapshot(snapshot) == false || StepMatches(&small, &smallRestored, 60) == false)
+	{
+		return Fail("the restored joint scene diverged");
+	}
+
+	if (CheckUserDataRemap(&small) == false)
+	{
+		return false;
+	}
+
+	small.SaveSnapshot(&snapshot);
+	return CheckDamagedSnapshots(snapshot);
+}
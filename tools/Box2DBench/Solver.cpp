@@ -0,0 +1,43 @@
+#include "Bench.h"
+#include <cstdio>
+
+// Compares the wide contact solver with the scalar one on a large pyramid. The
+// two solve the constraints in a different order, so the stacks match within a
+// tolerance rather than bit for bit.
+bool SolverBench()
+{
+	const int32 baseCount = 40;
+	const int32 stepCount = 240;
+
+	b2World scalarWorld(b2Vec2(0.0f, -10.0f));
+	int32 boxCount = CreatePyramid(&scalarWorld, baseCount, b2Vec2_zero);
+
+	b2World wideWorld(b2Vec2(0.0f, -10.0f));
+	CreatePyramid(&wideWorld, baseCount, b2Vec2_zero);
+	wideWorld.SetWideSolver(true);
+
+	printf("  %d boxes, %d steps\n", boxCount, stepCount);
+	PrintTime("scalar solver step", StepWorld(&scalarWorld, stepCount));
+	PrintTime("wide solver step", StepWorld(&wideWorld, stepCount));
+
+	float32 separation = GetMaxSeparation(&scalarWorld, &wideWorld);
+	printf("  max separation %.4f m\n", separation);
+	if (separation > 0.1f)
+	{
+		return Fail("the wide solver doesn't match the scalar solver");
+	}
+
+	// The pyramid must still stand.
+	float32 top = -b2_maxFloat;
+	for (const b2Body* body = wideWorld.GetBodyList(); body; body = body->GetNext())
+	{
+		top = b2Max(top, body->GetPosition().y);
+	}
+
+	if (top < baseCount - 1.0f)
+	{
+		return Fail("the wide solver pyramid collapsed");
+	}
+
+	return true;
+}
@@ -0,0 +1,134 @@
+#include "Bench.h"
+#include <cstdio>
+
+extern int32 b2_toiCalls;
+
+struct TOIResult
+{
+	float32 stepTime;
+	float32 toiTime;
+	uint32 hash;
+	int32 escapedCount;
+	int32 toiCalls;
+};
+
+// 1000 bullets, circles and boxes at 400 m/s, inside a box of thin static walls
+// crossed by edge baffles.
+static TOIResult RunTOIScene(bool parallel, int32 stepCount)
+{
+	const float32 extent = 30.0f;
+	const int32 bulletCount = 1000;
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetParallelTOI(parallel);
+
+	b2BodyDef groundDef;
+	b2Body* ground = world.CreateBody(&groundDef);
+
+	b2PolygonShape wall;
+	wall.SetAsBox(extent, 0.05f, b2Vec2(0.0f, -extent), 0.0f);
+	ground->CreateFixture(&wall, 0.0f);
+	wall.SetAsBox(extent, 0.05f, b2Vec2(0.0f, extent), 0.0f);
+	ground->CreateFixture(&wall, 0.0f);
+	wall.SetAsBox(0.05f, extent, b2Vec2(-extent, 0.0f), 0.0f);
+	ground->CreateFixture(&wall, 0.0f);
+	wall.SetAsBox(0.05f, extent, b2Vec2(extent, 0.0f), 0.0f);
+	ground->CreateFixture(&wall, 0.0f);
+
+	b2EdgeShape baffle;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		float32 y = -extent + 3.0f * (i + 0.5f);
+		float32 x = (i & 1) ? 5.0f : -5.0f;
+		baffle.Set(b2Vec2(x - 12.0f, y), b2Vec2(x + 12.0f, y + 1.0f));
+		ground->CreateFixture(&baffle, 0.0f);
+	}
+
+	b2CircleShape circle;
+	circle.m_radius = 0.2f;
+
+	b2PolygonShape box;
+	box.SetAsBox(0.2f, 0.2f);
+
+	b2FixtureDef fixtureDef;
+	fixtureDef.density = 1.0f;
+	fixtureDef.restitution = 0.5f;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.bullet = true;
+
+	SeedRandom(14);
+	for (int32 i = 0; i < bulletCount; ++i)
+	{
+		float32 angle = RandomFloat(-b2_pi, b2_pi);
+		bodyDef.position.Set(RandomFloat(-0.9f * extent, 0.9f * extent), RandomFloat(-0.9f * extent, 0.9f * extent));
+		bodyDef.linearVelocity.Set(400.0f * cosf(angle), 400.0f * sinf(angle));
+		fixtureDef.shape = (i & 1) ? (b2Shape*)&box : (b2Shape*)&circle;
+		world.CreateBody(&bodyDef)->CreateFixture(&fixtureDef);
+	}
+
+	TOIResult result;
+	result.toiTime = 0.0f;
+	result.toiCalls = b2_toiCalls;
+
+	b2Timer timer;
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		result.toiTime += world.GetProfile().solveTOI;
+	}
+	result.stepTime = timer.GetMilliseconds() / stepCount;
+	result.toiTime /= stepCount;
+	result.hash = world.ComputeStateHash();
+	result.toiCalls = b2_toiCalls - result.toiCalls;
+
+	result.escapedCount = 0;
+	for (const b2Body* body = world.GetBodyList(); body; body = body->GetNext())
+	{
+		b2Vec2 p = body->GetPosition();
+		if (b2Abs(p.x) > extent || b2Abs(p.y) > extent)
+		{
+			++result.escapedCount;
+		}
+	}
+
+	return result;
+}
+
+// Compares the serial TOI loop with the batched parallel one. The batches keep
+// the serial impact order, so both must give the same world, and no bullet may
+// tunnel out through the walls.
+bool TOIBench()
+{
+	const int32 stepCount = 120;
+
+	TOIResult serial = RunTOIScene(false, stepCount);
+	TOIResult parallel = RunTOIScene(true, stepCount);
+
+	printf("  1000 bullets, %d steps\n", stepCount);
+	PrintTime("serial step", serial.stepTime);
+	PrintTime("serial TOI", serial.toiTime);
+	PrintTime("batched step", parallel.stepTime);
+	PrintTime("batched TOI", parallel.toiTime);
+	printf("  %d serial and %d batched TOI calls\n", serial.toiCalls, parallel.toiCalls);
+
+	if (serial.hash != parallel.hash)
+	{
+		return Fail("the batched TOI solver gave a different world");
+	}
+
+	// The workers count their own calls, which must reach the globals.
+	if (serial.toiCalls == 0 || parallel.toiCalls == 0)
+	{
+		return Fail("the TOI statistics weren't counted");
+	}
+
+	if (serial.escapedCount > 0 || parallel.escapedCount > 0)
+	{
+		printf("  %d and %d bullets escaped\n", serial.escapedCount, parallel.escapedCount);
+		return Fail("bullets tunneled through the walls");
+	}
+
+	return true;
+}
@@ -0,0 +1,200 @@
+#include "Bench.h"
+#include <cstdio>
+
+// Counts the proxies a query or ray-cast visits.
+class TreeCallback
+{
+public:
+	bool QueryCallback(int32 proxyId)
+	{
+		B2_NOT_USED(proxyId);
+		++count;
+		return true;
+	}
+
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		B2_NOT_USED(proxyId);
+		++count;
+		return input.maxFraction;
+	}
+
+	int32 count;
+};
+
+struct TreeResult
+{
+	float32 pairTime;
+	float32 queryTime;
+	float32 rayCastTime;
+	int32 count;
+};
+
+// Time the queries UpdatePairs makes for every proxy, plus a set of random
+// queries and ray-casts.
+static TreeResult MeasureTree(const b2DynamicTree* tree, const int32* proxyIds, int32 proxyCount, float32 extent)
+{
+	const int32 queryCount = 2000;
+	const int32 rayCount = 500;
+
+	TreeResult result;
+	TreeCallback callback;
+	callback.count = 0;
+
+	b2Timer timer;
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		tree->Query(&callback, tree->GetFatAABB(proxyIds[i]));
+	}
+	result.pairTime = timer.GetMilliseconds();
+
+	SeedRandom(7);
+	timer.Reset();
+	for (int32 i = 0; i < queryCount; ++i)
+	{
+		b2Vec2 center(RandomFloat(0.0f, extent), RandomFloat(0.0f, extent));
+		b2Vec2 r(2.0f, 2.0f);
+		b2AABB aabb;
+		aabb.lowerBound = center - r;
+		aabb.upperBound = center + r;
+		tree->Query(&callback, aabb);
+	}
+	result.queryTime = timer.GetMilliseconds();
+
+	timer.Reset();
+	for (int32 i = 0; i < rayCount; ++i)
+	{
+		b2RayCastInput input;
+		input.p1.Set(RandomFloat(0.0f, extent), RandomFloat(0.0f, extent));
+		input.p2.Set(RandomFloat(0.0f, extent), RandomFloat(0.0f, extent));
+		input.maxFraction = 1.0f;
+		tree->RayCast(&callback, input);
+	}
+	result.rayCastTime = timer.GetMilliseconds();
+
+	result.count = callback.count;
+	return result;
+}
+
+static void PrintTreeResult(const char* name, const b2DynamicTree* tree, const TreeResult& result)
+{
+	printf("  %s: height %d, area ratio %.1f\n", name, tree->GetHeight(), tree->GetAreaRatio());
+	PrintTime("pair queries", result.pairTime);
+	PrintTime("2000 queries", result.queryTime);
+	PrintTime("500 ray-casts", result.rayCastTime);
+}
+
+// Degrades a tree by moving its proxies around for a long session, then compares
+// it with the same tree optimized every frame and with a fresh SAH rebuild.
+bool TreeBench()
+{
+	const int32 proxyCount = 5000;
+	const int32 frameCount = 600;
+
+	float32 extent = 2.0f * b2Sqrt(float32(proxyCount));
+	b2Vec2* positions = new b2Vec2[proxyCount];
+	b2Vec2* velocities = new b2Vec2[proxyCount];
+	int32* proxyIds = new int32[proxyCount];
+	int32* optimizedIds = new int32[proxyCount];
+
+	b2DynamicTree tree;
+	b2DynamicTree optimizedTree;
+	b2Vec2 r(0.5f, 0.5f);
+
+	SeedRandom(proxyCount);
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		positions[i].Set(RandomFloat(0.0f, extent), RandomFloat(0.0f, extent));
+		velocities[i].Set(RandomFloat(-0.2f, 0.2f), RandomFloat(-0.2f, 0.2f));
+
+		b2AABB aabb;
+		aabb.lowerBound = positions[i] - r;
+		aabb.upperBound = positions[i] + r;
+		proxyIds[i] = tree.CreateProxy(aabb, NULL);
+		optimizedIds[i] = optimizedTree.CreateProxy(aabb, NULL);
+	}
+
+	// Wander around the area, bouncing off its sides.
+	float32 moveTime = 0.0f;
+	float32 optimizedMoveTime = 0.0f;
+	b2Timer timer;
+	for (int32 frame = 0; frame < frameCount; ++frame)
+	{
+		for (int32 i = 0; i < proxyCount; ++i)
+		{
+			b2Vec2 p = positions[i] + velocities[i];
+			if (p.x < 0.0f || p.x > extent)
+			{
+				velocities[i].x = -velocities[i].x;
+			}
+
+			if (p.y < 0.0f || p.y > extent)
+			{
+				velocities[i].y = -velocities[i].y;
+			}
+			positions[i] += velocities[i];
+		}
+
+		timer.Reset();
+		for (int32 i = 0; i < proxyCount; ++i)
+		{
+			b2AABB aabb;
+			aabb.lowerBound = positions[i] - r;
+			aabb.upperBound = positions[i] + r;
+			tree.MoveProxy(proxyIds[i], aabb, velocities[i]);
+		}
+		moveTime += timer.GetMilliseconds();
+
+		timer.Reset();
+		for (int32 i = 0; i < proxyCount; ++i)
+		{
+			b2AABB aabb;
+			aabb.lowerBound = positions[i] - r;
+			aabb.upperBound = positions[i] + r;
+			optimizedTree.MoveProxy(optimizedIds[i], aabb, velocities[i]);
+		}
+		optimizedTree.Optimize();
+		optimizedMoveTime += timer.GetMilliseconds();
+	}
+
+	// MoveProxy leaves the ancestors of leaves updated in place loose.
+	tree.Refit();
+
+	printf("  %d proxies, %d frames\n", proxyCount, frameCount);
+	PrintTime("move per frame", moveTime / frameCount);
+	PrintTime("move and optimize per frame", optimizedMoveTime / frameCount);
+
+	TreeResult degraded = MeasureTree(&tree, proxyIds, proxyCount, extent);
+	PrintTreeResult("degraded", &tree, degraded);
+	float32 degradedRatio = tree.GetAreaRatio();
+
+	TreeResult optimized = MeasureTree(&optimizedTree, optimizedIds, proxyCount, extent);
+	PrintTreeResult("optimized every frame", &optimizedTree, optimized);
+
+	timer.Reset();
+	tree.RebuildTopDown();
+	PrintTime("SAH rebuild", timer.GetMilliseconds());
+
+	TreeResult rebuilt = MeasureTree(&tree, proxyIds, proxyCount, extent);
+	PrintTreeResult("rebuilt", &tree, rebuilt);
+
+	tree.Validate();
+	optimizedTree.Validate();
+
+	delete [] positions;
+	delete [] velocities;
+	delete [] proxyIds;
+	delete [] optimizedIds;
+
+	if (degraded.count != optimized.count || degraded.count != rebuilt.count)
+	{
+		return Fail("the trees found different proxies");
+	}
+
+	if (tree.GetAreaRatio() > degradedRatio)
+	{
+		return Fail("the SAH rebuild made the tree worse");
+	}
+
+	return true;
+}
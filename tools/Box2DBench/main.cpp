@@ -0,0 +1,144 @@
+#include "Bench.h"
+#include <cstdio>
+#include <cstring>
+
+// Run with no arguments for every bench, or name the ones to run.
+static const Bench s_benches[] =
+{
+	{ "solver", SolverBench },
+	{ "broadphase", BroadPhaseBench },
+	{ "tree", TreeBench },
+	{ "snapshot", SnapshotBench },
+	{ "determinism", DeterminismBench },
+	{ "toi", TOIBench },
+	{ "nbody", NBodyBench },
+	{ "island", ParallelSolverBench },
+	{ "kernels", KernelBench },
+	{ "create", CreateBench },
+	{ "rope", RopeBench },
+	{ "sensors", SensorBench },
+};
+
+static const int32 s_benchCount = sizeof(s_benches) / sizeof(s_benches[0]);
+
+static uint32 s_randomState = 1;
+
+void SeedRandom(uint32 seed)
+{
+	s_randomState = seed;
+}
+
+float32 RandomFloat(float32 lo, float32 hi)
+{
+	s_randomState = 1664525u * s_randomState + 1013904223u;
+	float32 r = (float32)(s_randomState >> 8) / (float32)(1 << 24);
+	return lo + r * (hi - lo);
+}
+
+void PrintTime(const char* label, float32 milliseconds)
+{
+	printf("  %-40s %10.3f ms\n", label, milliseconds);
+}
+
+bool Fail(const char* message)
+{
+	printf("  FAILED: %s\n", message);
+	return false;
+}
+
+int32 CreatePyramid(b2World* world, int32 baseCount, const b2Vec2& position)
+{
+	b2BodyDef groundDef;
+	groundDef.position = position;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2PolygonShape groundShape;
+	groundShape.SetAsBox(0.5f * baseCount + 10.0f, 0.5f, b2Vec2(0.0f, -0.5f), 0.0f);
+	ground->CreateFixture(&groundShape, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2FixtureDef fixtureDef;
+	fixtureDef.shape = &box;
+	fixtureDef.density = 1.0f;
+	fixtureDef.friction = 0.6f;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	int32 count = 0;
+	for (int32 row = 0; row < baseCount; ++row)
+	{
+		int32 rowCount = baseCount - row;
+		float32 x = position.x - 0.5f * (rowCount - 1);
+		for (int32 i = 0; i < rowCount; ++i)
+		{
+			bodyDef.position.Set(x + i, position.y + 0.5f + row);
+			world->CreateBody(&bodyDef)->CreateFixture(&fixtureDef);
+			++count;
+		}
+	}
+
+	return count;
+}
+
+float32 StepWorld(b2World* world, int32 stepCount)
+{
+	b2Timer timer;
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		world->Step(1.0f / 60.0f, 8, 3);
+	}
+
+	return timer.GetMilliseconds() / b2Max(stepCount, 1);
+}
+
+float32 GetMaxSeparation(const b2World* world1, const b2World* world2)
+{
+	float32 maxSeparation = 0.0f;
+	const b2Body* body1 = world1->GetBodyList();
+	const b2Body* body2 = world2->GetBodyList();
+	while (body1 && body2)
+	{
+		maxSeparation = b2Max(maxSeparation, b2Distance(body1->GetPosition(), body2->GetPosition()));
+		body1 = body1->GetNext();
+		body2 = body2->GetNext();
+	}
+
+	if (body1 || body2)
+	{
+		return b2_maxFloat;
+	}
+
+	return maxSeparation;
+}
+
+int main(int argc, char** argv)
+{
+	int32 failCount = 0;
+	int32 runCount = 0;
+	for (int32 i = 0; i < s_benchCount; ++i)
+	{
+		bool selected = argc < 2;
+		for (int32 j = 1; j < argc; ++j)
+		{
+			selected = selected || strcmp(argv[j], s_benches[i].name) == 0;
+		}
+
+		if (selected == false)
+		{
+			continue;
+		}
+
+		printf("%s\n", s_benches[i].name);
+		if (s_benches[i].function() == false)
+		{
+			++failCount;
+		}
+		++runCount;
+	}
+
+	printf("%d run, %d failed\n", runCount, failCount);
+	return failCount > 0 ? 1 : 0;
+}